@@ -23,6 +23,7 @@ if errorlevel 1 (
 
 REM Copy kernel file to Release directory
 copy hello.cl Release\hello.cl >nul
+copy microbench.cl Release\microbench.cl >nul
 
 cd ..
 echo.
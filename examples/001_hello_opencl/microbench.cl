@@ -0,0 +1,19 @@
+// Kernels for the API overhead microbenchmarks. They do (almost) nothing, so
+// everything measured is host, driver and launch overhead.
+
+__kernel void empty_kernel()
+{
+}
+
+// Same amount of work, but with the argument kinds clSetKernelArg has to handle
+__kernel void args_kernel(__global float* data,
+                          const int n,
+                          const float value,
+                          __local float* scratch)
+{
+    int gid = get_global_id(0);
+    if (gid == 0 && n < 0) {
+        scratch[0] = value;
+        data[0] = scratch[0];
+    }
+}
@@ -0,0 +1,277 @@
+#define CL_TARGET_OPENCL_VERSION 300
+#include <CL/opencl.h>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <iomanip>
+#include <algorithm>
+#include <cstdlib>
+#include "../common/completion.h"
+
+// API overhead microbenchmarks: every call is timed individually and reported
+// as a distribution, because the tail (p99, max) matters as much as the median
+// for the small-problem rows of the other examples.
+
+using Clock = std::chrono::high_resolution_clock;
+
+std::string loadKernelSource(const char* filename) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open kernel file: " << filename << "\n";
+        return "";
+    }
+    return std::string(std::istreambuf_iterator<char>(file),
+                       std::istreambuf_iterator<char>());
+}
+
+void checkError(cl_int err, const char* operation) {
+    if (err != CL_SUCCESS) {
+        std::cerr << "Error during " << operation << ": " << err << "\n";
+        exit(1);
+    }
+}
+
+double elapsedUs(Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+struct Distribution {
+    double min, p50, p90, p99, max, mean;
+};
+
+Distribution summarize(std::vector<double> samples) {
+    std::sort(samples.begin(), samples.end());
+    
+    double sum = 0.0;
+    for (double s : samples) sum += s;
+    return {samples.front(), percentile(samples, 0.50), percentile(samples, 0.90), percentile(samples, 0.99),
+            samples.back(), sum / samples.size()};
+}
+
+void printHeader() {
+    std::cout << std::left << std::setw(40) << "Operation (us)"
+              << std::right << std::setw(10) << "min"
+              << std::setw(10) << "p50"
+              << std::setw(10) << "p90"
+              << std::setw(10) << "p99"
+              << std::setw(10) << "max"
+              << std::setw(10) << "mean\n";
+    std::cout << std::string(100, '-') << "\n";
+}
+
+void printRow(const std::string& name, const std::vector<double>& samples) {
+    Distribution d = summarize(samples);
+    std::cout << std::left << std::setw(40) << name
+              << std::right << std::fixed << std::setprecision(2)
+              << std::setw(10) << d.min
+              << std::setw(10) << d.p50
+              << std::setw(10) << d.p90
+              << std::setw(10) << d.p99
+              << std::setw(10) << d.max
+              << std::setw(10) << d.mean << "\n";
+}
+
+std::string formatBytes(size_t bytes) {
+    if (bytes >= (1u << 20)) return std::to_string(bytes >> 20) + " MB";
+    return std::to_string(bytes >> 10) + " KB";
+}
+
+void benchmarkDevice(cl_device_id device, const std::string& kernelSource, int iterations) {
+    cl_int err;
+    const int WARMUP = 50;
+    
+    cl_context context = clCreateContext(nullptr, 1, &device, nullptr, nullptr, &err);
+    checkError(err, "clCreateContext");
+    cl_command_queue queue = clCreateCommandQueueWithProperties(context, device, nullptr, &err);
+    checkError(err, "clCreateCommandQueueWithProperties");
+    
+    const char* sourcePtr = kernelSource.c_str();
+    size_t sourceSize = kernelSource.size();
+    cl_program program = clCreateProgramWithSource(context, 1, &sourcePtr, &sourceSize, &err);
+    checkError(err, "clCreateProgramWithSource");
+    err = clBuildProgram(program, 1, &device, nullptr, nullptr, nullptr);
+    if (err != CL_SUCCESS) {
+        size_t logSize;
+        clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, 0, nullptr, &logSize);
+        std::vector<char> log(logSize);
+        clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, logSize, log.data(), nullptr);
+        std::cerr << "Build error:\n" << log.data() << "\n";
+        clReleaseProgram(program);
+        clReleaseCommandQueue(queue);
+        clReleaseContext(context);
+        return;
+    }
+    
+    cl_kernel emptyKernel = clCreateKernel(program, "empty_kernel", &err);
+    checkError(err, "clCreateKernel empty_kernel");
+    size_t globalSize = 1;
+    std::vector<double> samples(iterations);
+    
+    printHeader();
+    
+    // 1. Submit cost: the enqueue call alone. The queue is drained every 256
+    //    launches so its depth (and any driver throttling) stays bounded.
+    for (int i = 0; i < WARMUP; i++) {
+        clEnqueueNDRangeKernel(queue, emptyKernel, 1, nullptr, &globalSize, nullptr, 0, nullptr, nullptr);
+    }
+    clFinish(queue);
+    for (int i = 0; i < iterations; i++) {
+        auto start = Clock::now();
+        clEnqueueNDRangeKernel(queue, emptyKernel, 1, nullptr, &globalSize, nullptr, 0, nullptr, nullptr);
+        samples[i] = elapsedUs(start, Clock::now());
+        if (i % 256 == 255) clFinish(queue);
+    }
+    clFinish(queue);
+    printRow("clEnqueueNDRangeKernel (submit)", samples);
+    
+    // 2. Round trip, blocking: enqueue + clFinish
+    for (int i = 0; i < iterations; i++) {
+        auto start = Clock::now();
+        clEnqueueNDRangeKernel(queue, emptyKernel, 1, nullptr, &globalSize, nullptr, 0, nullptr, nullptr);
+        clFinish(queue);
+        samples[i] = elapsedUs(start, Clock::now());
+    }
+    printRow("Empty kernel + clFinish", samples);
+    
+    // 3. Round trip, polling: enqueue with an event, flush, spin on its status
+    for (int i = 0; i < iterations; i++) {
+        cl_event event;
+        auto start = Clock::now();
+        clEnqueueNDRangeKernel(queue, emptyKernel, 1, nullptr, &globalSize, nullptr, 0, nullptr, &event);
+        clFlush(queue);
+        cl_int status;
+        do {
+            clGetEventInfo(event, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(status), &status, nullptr);
+        } while (status > CL_COMPLETE);
+        samples[i] = elapsedUs(start, Clock::now());
+        clReleaseEvent(event);
+    }
+    printRow("Empty kernel + event poll", samples);
+    
+    // 4. clSetKernelArg by argument kind
+    cl_kernel argsKernel = clCreateKernel(program, "args_kernel", &err);
+    checkError(err, "clCreateKernel args_kernel");
+    cl_mem argBuffer = clCreateBuffer(context, CL_MEM_READ_WRITE, 4096, nullptr, &err);
+    checkError(err, "clCreateBuffer");
+    int n = 1;
+    float value = 1.0f;
+    
+    for (int i = 0; i < iterations; i++) {
+        auto start = Clock::now();
+        clSetKernelArg(argsKernel, 0, sizeof(cl_mem), &argBuffer);
+        samples[i] = elapsedUs(start, Clock::now());
+    }
+    printRow("clSetKernelArg (cl_mem)", samples);
+    
+    for (int i = 0; i < iterations; i++) {
+        n = i;
+        auto start = Clock::now();
+        clSetKernelArg(argsKernel, 1, sizeof(int), &n);
+        samples[i] = elapsedUs(start, Clock::now());
+    }
+    printRow("clSetKernelArg (int)", samples);
+    
+    for (int i = 0; i < iterations; i++) {
+        auto start = Clock::now();
+        clSetKernelArg(argsKernel, 2, sizeof(float), &value);
+        samples[i] = elapsedUs(start, Clock::now());
+    }
+    printRow("clSetKernelArg (float)", samples);
+    
+    for (int i = 0; i < iterations; i++) {
+        auto start = Clock::now();
+        clSetKernelArg(argsKernel, 3, 256 * sizeof(float), nullptr);
+        samples[i] = elapsedUs(start, Clock::now());
+    }
+    printRow("clSetKernelArg (__local)", samples);
+    
+    clReleaseMemObject(argBuffer);
+    clReleaseKernel(argsKernel);
+    
+    // 5. clCreateKernel / clReleaseKernel from an already built program
+    std::vector<double> releaseSamples(iterations);
+    for (int i = 0; i < iterations; i++) {
+        auto start = Clock::now();
+        cl_kernel kernel = clCreateKernel(program, "args_kernel", &err);
+        auto created = Clock::now();
+        checkError(err, "clCreateKernel");
+        clReleaseKernel(kernel);
+        samples[i] = elapsedUs(start, created);
+        releaseSamples[i] = elapsedUs(created, Clock::now());
+    }
+    printRow("clCreateKernel", samples);
+    printRow("clReleaseKernel", releaseSamples);
+    
+    // 6. clCreateBuffer / clReleaseMemObject by size. Many drivers allocate
+    //    lazily on first use, so creation alone can look almost free; the
+    //    cost then appears with the first command that touches the buffer.
+    cl_ulong maxAlloc;
+    clGetDeviceInfo(device, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(maxAlloc), &maxAlloc, nullptr);
+    const size_t sizes[] = {4u << 10, 64u << 10, 1u << 20, 16u << 20, 256u << 20};
+    
+    for (size_t bytes : sizes) {
+        if (bytes > maxAlloc) continue;
+        int count = (bytes >= (16u << 20)) ? std::max(10, iterations / 20) : iterations;
+        std::vector<double> createSamples(count), freeSamples(count);
+        
+        for (int i = 0; i < count; i++) {
+            auto start = Clock::now();
+            cl_mem buffer = clCreateBuffer(context, CL_MEM_READ_WRITE, bytes, nullptr, &err);
+            auto created = Clock::now();
+            checkError(err, "clCreateBuffer");
+            clReleaseMemObject(buffer);
+            createSamples[i] = elapsedUs(start, created);
+            freeSamples[i] = elapsedUs(created, Clock::now());
+        }
+        printRow("clCreateBuffer " + formatBytes(bytes), createSamples);
+        printRow("clReleaseMemObject " + formatBytes(bytes), freeSamples);
+    }
+    
+    clReleaseKernel(emptyKernel);
+    clReleaseProgram(program);
+    clReleaseCommandQueue(queue);
+    clReleaseContext(context);
+}
+
+int main(int argc, char** argv) {
+    std::cout << "=== OpenCL API Overhead Microbenchmarks ===\n\n";
+    
+    int iterations = (argc > 1) ? std::atoi(argv[1]) : 1000;
+    iterations = std::max(iterations, 10);
+    
+    std::string kernelSource = loadKernelSource("microbench.cl");
+    if (kernelSource.empty()) {
+        return 1;
+    }
+    
+    cl_uint numPlatforms;
+    clGetPlatformIDs(0, nullptr, &numPlatforms);
+    std::vector<cl_platform_id> platforms(numPlatforms);
+    clGetPlatformIDs(numPlatforms, platforms.data(), nullptr);
+    
+    std::cout << "Iterations per measurement: " << iterations << "\n\n";
+    
+    for (cl_uint p = 0; p < numPlatforms; p++) {
+        cl_uint numDevices;
+        cl_int err = clGetDeviceIDs(platforms[p], CL_DEVICE_TYPE_ALL, 0, nullptr, &numDevices);
+        if (err != CL_SUCCESS || numDevices == 0) continue;
+        
+        std::vector<cl_device_id> devices(numDevices);
+        clGetDeviceIDs(platforms[p], CL_DEVICE_TYPE_ALL, numDevices, devices.data(), nullptr);
+        
+        for (cl_device_id device : devices) {
+            char name[128];
+            clGetDeviceInfo(device, CL_DEVICE_NAME, sizeof(name), name, nullptr);
+            std::cout << "========================================\n";
+            std::cout << "Device: " << name << "\n";
+            std::cout << "========================================\n";
+            
+            benchmarkDevice(device, kernelSource, iterations);
+            std::cout << "\n";
+        }
+    }
+    
+    return 0;
+}
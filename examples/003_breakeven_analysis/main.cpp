@@ -8,6 +8,14 @@
 #include <algorithm>
 #include <string>
 #include <sstream>
+#include <map>
+#include <atomic>
+#include <memory>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include "../common/completion.h"
+#include "../common/memory_accounting.h"
 
 std::string loadKernelSource(const char* filename) {
     std::ifstream file(filename);
@@ -26,9 +34,9 @@ void checkError(cl_int err, const char* operation) {
     }
 }
 
-double vectorAddCPU(const std::vector<float>& a, 
-                    const std::vector<float>& b, 
-                    std::vector<float>& result,
+double vectorAddCPU(const HostVector<float>& a, 
+                    const HostVector<float>& b, 
+                    HostVector<float>& result,
                     int iterations = 5) {
     double minTime = 1e9;
     
@@ -45,9 +53,9 @@ double vectorAddCPU(const std::vector<float>& a,
     return minTime;
 }
 
-double vectorAddOpenCL(const std::vector<float>& a,
-                       const std::vector<float>& b,
-                       std::vector<float>& result,
+double vectorAddOpenCL(const HostVector<float>& a,
+                       const HostVector<float>& b,
+                       HostVector<float>& result,
                        cl_device_id device,
                        cl_context context,
                        cl_program program,
@@ -62,15 +70,15 @@ double vectorAddOpenCL(const std::vector<float>& a,
     checkError(err, "clCreateCommandQueue");
 
     // Create buffers
-    cl_mem bufferA = clCreateBuffer(context, CL_MEM_READ_ONLY, 
+    cl_mem bufferA = allocateBuffer(context, CL_MEM_READ_ONLY, 
                                      n * sizeof(float), nullptr, &err);
     checkError(err, "clCreateBuffer A");
 
-    cl_mem bufferB = clCreateBuffer(context, CL_MEM_READ_ONLY,
+    cl_mem bufferB = allocateBuffer(context, CL_MEM_READ_ONLY,
                                      n * sizeof(float), nullptr, &err);
     checkError(err, "clCreateBuffer B");
 
-    cl_mem bufferResult = clCreateBuffer(context, CL_MEM_WRITE_ONLY,
+    cl_mem bufferResult = allocateBuffer(context, CL_MEM_WRITE_ONLY,
                                           n * sizeof(float), nullptr, &err);
     checkError(err, "clCreateBuffer Result");
 
@@ -109,22 +117,547 @@ double vectorAddOpenCL(const std::vector<float>& a,
         }
     }
 
-    clReleaseMemObject(bufferA);
-    clReleaseMemObject(bufferB);
-    clReleaseMemObject(bufferResult);
+    releaseBuffer(bufferA);
+    releaseBuffer(bufferB);
+    releaseBuffer(bufferResult);
     clReleaseKernel(kernel);
     clReleaseCommandQueue(queue);
 
     return minTime;
 }
 
+// Throughput mode: `depth` independent vector_adds enqueued back-to-back,
+// round-robin over `numQueues` queues, with one synchronization at the end.
+// Inputs are shared and uploaded once (as in the timed region of
+// vectorAddOpenCL); every queue writes its own result buffer. Returns ops/s,
+// or -1 if the inputs and one result buffer do not fit in device memory.
+double vectorAddOpenCLThroughput(const HostVector<float>& a,
+                                 const HostVector<float>& b,
+                                 HostVector<float>& result,
+                                 int numQueues,
+                                 int depth,
+                                 cl_device_id device,
+                                 cl_context context,
+                                 cl_program program) {
+    cl_int err;
+    size_t n = a.size();
+    size_t bytes = n * sizeof(float);
+    
+    // Fewer queues where one result buffer per queue would not fit; half of
+    // global memory has to hold both inputs plus the result buffers
+    cl_ulong globalMem;
+    clGetDeviceInfo(device, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(globalMem), &globalMem, nullptr);
+    cl_ulong buffersThatFit = globalMem / 2 / bytes;
+    if (buffersThatFit < 3) return -1.0;
+    numQueues = (int)std::min<cl_ulong>(numQueues, buffersThatFit - 2);
+    
+    cl_mem bufferA = allocateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, bytes, (void*)a.data(), &err);
+    checkError(err, "clCreateBuffer A");
+    cl_mem bufferB = allocateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, bytes, (void*)b.data(), &err);
+    checkError(err, "clCreateBuffer B");
+    
+    std::vector<cl_command_queue> queues(numQueues);
+    std::vector<cl_mem> results(numQueues);
+    std::vector<cl_kernel> kernels(numQueues);
+    unsigned int nArg = (unsigned int)n;
+    size_t globalWorkSize = n;
+    
+    for (int q = 0; q < numQueues; q++) {
+        queues[q] = clCreateCommandQueueWithProperties(context, device, nullptr, &err);
+        checkError(err, "clCreateCommandQueue");
+        results[q] = allocateBuffer(context, CL_MEM_WRITE_ONLY, bytes, nullptr, &err);
+        checkError(err, "clCreateBuffer Result");
+        
+        kernels[q] = clCreateKernel(program, "vector_add", &err);
+        checkError(err, "clCreateKernel");
+        clSetKernelArg(kernels[q], 0, sizeof(cl_mem), &bufferA);
+        clSetKernelArg(kernels[q], 1, sizeof(cl_mem), &bufferB);
+        clSetKernelArg(kernels[q], 2, sizeof(cl_mem), &results[q]);
+        clSetKernelArg(kernels[q], 3, sizeof(unsigned int), &nArg);
+        
+        // Warm-up launch, so first-use costs stay out of the timing
+        clEnqueueNDRangeKernel(queues[q], kernels[q], 1, nullptr, &globalWorkSize, nullptr, 0, nullptr, nullptr);
+        clFinish(queues[q]);
+    }
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    for (int iter = 0; iter < depth; iter++) {
+        int q = iter % numQueues;
+        err = clEnqueueNDRangeKernel(queues[q], kernels[q], 1, nullptr, &globalWorkSize,
+                                     nullptr, 0, nullptr, nullptr);
+        checkError(err, "clEnqueueNDRangeKernel");
+    }
+    for (auto& queue : queues) clFlush(queue);
+    for (auto& queue : queues) clFinish(queue);
+    
+    auto end = std::chrono::high_resolution_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count();
+    
+    clEnqueueReadBuffer(queues[0], results[0], CL_TRUE, 0, bytes, result.data(), 0, nullptr, nullptr);
+    
+    for (int q = 0; q < numQueues; q++) {
+        clReleaseKernel(kernels[q]);
+        releaseBuffer(results[q]);
+        clReleaseCommandQueue(queues[q]);
+    }
+    releaseBuffer(bufferA);
+    releaseBuffer(bufferB);
+    
+    return depth / seconds;
+}
+
+// Enough launches to amortize the final synchronization, without spending
+// minutes at the largest sizes
+int throughputDepth(size_t n) {
+    return (int)std::min<size_t>(4096, std::max<size_t>(16, ((size_t)1 << 28) / n));
+}
+
 struct DeviceInfo {
     cl_device_id id;
     std::string name;
     cl_device_type type;
 };
 
-int main() {
+// Whole-run peaks, for the modes whose tables have no footprint columns
+void printPeakFootprint(const std::vector<DeviceInfo>& devices, const std::vector<cl_context>& contexts) {
+    std::cout << std::fixed << std::setprecision(1) << "Peak memory footprint:\n";
+    std::cout << "  " << std::left << std::setw(40) << "Host" << std::right << std::setw(10)
+              << toMB(hostMemory.peak) << " MB\n";
+    for (size_t i = 0; i < devices.size(); i++) {
+        std::cout << "  " << std::left << std::setw(40) << devices[i].name << std::right << std::setw(10)
+                  << toMB(deviceMemory[contexts[i]].peak) << " MB\n";
+    }
+}
+
+// Launch + completion latency of one small vector_add, per iteration, in us.
+// Inputs are uploaded once; the timed region matches vectorAddOpenCL.
+std::vector<double> vectorAddLatencies(const HostVector<float>& a,
+                                       const HostVector<float>& b,
+                                       Completion policy,
+                                       int iterations,
+                                       cl_device_id device,
+                                       cl_context context,
+                                       cl_program program) {
+    cl_int err;
+    size_t n = a.size();
+    const int WARMUP = 20;
+    
+    cl_command_queue queue = clCreateCommandQueueWithProperties(context, device, nullptr, &err);
+    checkError(err, "clCreateCommandQueue");
+    
+    cl_mem bufferA = allocateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                    n * sizeof(float), (void*)a.data(), &err);
+    checkError(err, "clCreateBuffer A");
+    cl_mem bufferB = allocateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                    n * sizeof(float), (void*)b.data(), &err);
+    checkError(err, "clCreateBuffer B");
+    cl_mem bufferResult = allocateBuffer(context, CL_MEM_WRITE_ONLY, n * sizeof(float), nullptr, &err);
+    checkError(err, "clCreateBuffer Result");
+    
+    cl_kernel kernel = clCreateKernel(program, "vector_add", &err);
+    checkError(err, "clCreateKernel");
+    unsigned int nArg = (unsigned int)n;
+    clSetKernelArg(kernel, 0, sizeof(cl_mem), &bufferA);
+    clSetKernelArg(kernel, 1, sizeof(cl_mem), &bufferB);
+    clSetKernelArg(kernel, 2, sizeof(cl_mem), &bufferResult);
+    clSetKernelArg(kernel, 3, sizeof(unsigned int), &nArg);
+    clFinish(queue);
+    
+    std::vector<double> latencies;
+    latencies.reserve(iterations);
+    size_t globalWorkSize = n;
+    
+    for (int iter = 0; iter < WARMUP + iterations; iter++) {
+        cl_event event;
+        auto start = std::chrono::high_resolution_clock::now();
+        err = clEnqueueNDRangeKernel(queue, kernel, 1, nullptr, &globalWorkSize, nullptr, 0, nullptr, &event);
+        checkError(err, "clEnqueueNDRangeKernel");
+        waitForCompletion(queue, event, policy);
+        auto end = std::chrono::high_resolution_clock::now();
+        clReleaseEvent(event);
+        
+        if (iter >= WARMUP) {
+            latencies.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+        }
+    }
+    
+    releaseBuffer(bufferA);
+    releaseBuffer(bufferB);
+    releaseBuffer(bufferResult);
+    clReleaseKernel(kernel);
+    clReleaseCommandQueue(queue);
+    return latencies;
+}
+
+void runCompletionPolicies(int iterations,
+                           const std::vector<DeviceInfo>& devices,
+                           const std::vector<cl_context>& contexts,
+                           const std::vector<cl_program>& programs) {
+    const size_t sizes[] = {1024, 4096, 16384, 65536};
+    
+    std::cout << "Iterations per policy: " << iterations << ", hybrid spin: " << HYBRID_SPIN_US << " us\n\n";
+    std::cout << std::fixed << std::setprecision(1);
+    
+    for (size_t d = 0; d < devices.size(); d++) {
+        std::cout << devices[d].name << "\n";
+        std::cout << std::left << std::setw(8) << "Size"
+                  << std::setw(20) << "Policy"
+                  << std::right << std::setw(10) << "p50 (us)"
+                  << std::setw(10) << "p90"
+                  << std::setw(10) << "p99"
+                  << std::setw(10) << "p99.9"
+                  << std::setw(10) << "max\n";
+        std::cout << std::string(77, '-') << "\n";
+        
+        for (size_t testSize : sizes) {
+            HostVector<float> a(testSize), b(testSize);
+            for (size_t i = 0; i < testSize; i++) {
+                a[i] = static_cast<float>(i % 1000);
+                b[i] = static_cast<float>((i * 2) % 1000);
+            }
+            
+            for (Completion policy : COMPLETION_POLICIES) {
+                std::vector<double> latencies = vectorAddLatencies(a, b, policy, iterations,
+                                                                   devices[d].id, contexts[d], programs[d]);
+                std::sort(latencies.begin(), latencies.end());
+                
+                std::cout << std::left << std::setw(8) << (std::to_string(testSize / 1024) + "K")
+                          << std::setw(20) << completionName(policy)
+                          << std::right << std::setw(10) << percentile(latencies, 0.50)
+                          << std::setw(10) << percentile(latencies, 0.90)
+                          << std::setw(10) << percentile(latencies, 0.99)
+                          << std::setw(10) << percentile(latencies, 0.999)
+                          << std::setw(10) << latencies.back() << "\n";
+            }
+        }
+        std::cout << "\n";
+    }
+    
+    std::cout << "Latency = kernel launch until the host sees completion. busy-poll keeps one core\n"
+              << "at 100% while waiting; hybrid bounds that to the spin window.\n";
+}
+
+// ============================================================================
+// Small-op coalescing
+// ============================================================================
+
+const size_t BATCH_LOCAL_SIZE = 64;                 // one work-group per op
+const size_t BATCH_MAX_ELEMENTS = 4 * 1024 * 1024;  // flush early once a batch is this large
+
+// One small, independent request: result = a + b over n elements
+struct SmallOp {
+    const float* a;
+    const float* b;
+    float* result;
+    unsigned int n;
+    std::chrono::high_resolution_clock::time_point arrival;
+    std::chrono::high_resolution_clock::time_point done;
+};
+
+// Accumulates small ops for up to `latencyBudgetUs` after the first one
+// arrives, then runs them all as one launch: inputs are concatenated into
+// staging vectors with an offset table, uploaded once, and the results are
+// scattered back to each op's own output.
+struct OpBatcher {
+    cl_context context;
+    cl_command_queue queue;
+    cl_kernel kernel;
+    cl_mem bufA = nullptr, bufB = nullptr, bufResult = nullptr, bufOffsets = nullptr;
+    size_t capacityElements = 0;
+    size_t capacityOps = 0;
+    HostVector<float> stageA, stageB, stageResult;
+    HostVector<unsigned int> offsets;
+    std::vector<SmallOp*> pending;
+    size_t pendingElements = 0;
+    double latencyBudgetUs;
+    std::chrono::high_resolution_clock::time_point windowStart;
+    long long batches = 0;
+    long long ops = 0;
+};
+
+OpBatcher createOpBatcher(double latencyBudgetUs, cl_device_id device, cl_context context, cl_program program) {
+    cl_int err;
+    OpBatcher batcher;
+    batcher.context = context;
+    batcher.latencyBudgetUs = latencyBudgetUs;
+    batcher.queue = clCreateCommandQueueWithProperties(context, device, nullptr, &err);
+    checkError(err, "clCreateCommandQueue");
+    batcher.kernel = clCreateKernel(program, "vector_add_batched", &err);
+    checkError(err, "clCreateKernel vector_add_batched");
+    return batcher;
+}
+
+// Device buffers only grow, so a steady stream of batches reuses them
+void reserveBatchBuffers(OpBatcher& batcher, size_t elements, size_t numOps) {
+    cl_int err;
+    if (elements > batcher.capacityElements) {
+        if (batcher.bufA) {
+            releaseBuffer(batcher.bufA);
+            releaseBuffer(batcher.bufB);
+            releaseBuffer(batcher.bufResult);
+        }
+        batcher.capacityElements = std::max(elements, 2 * batcher.capacityElements);
+        size_t bytes = batcher.capacityElements * sizeof(float);
+        batcher.bufA = allocateBuffer(batcher.context, CL_MEM_READ_ONLY, bytes, nullptr, &err);
+        checkError(err, "clCreateBuffer batch A");
+        batcher.bufB = allocateBuffer(batcher.context, CL_MEM_READ_ONLY, bytes, nullptr, &err);
+        checkError(err, "clCreateBuffer batch B");
+        batcher.bufResult = allocateBuffer(batcher.context, CL_MEM_WRITE_ONLY, bytes, nullptr, &err);
+        checkError(err, "clCreateBuffer batch result");
+        batcher.stageA.resize(batcher.capacityElements);
+        batcher.stageB.resize(batcher.capacityElements);
+        batcher.stageResult.resize(batcher.capacityElements);
+    }
+    if (numOps + 1 > batcher.capacityOps) {
+        if (batcher.bufOffsets) releaseBuffer(batcher.bufOffsets);
+        batcher.capacityOps = std::max(numOps + 1, 2 * batcher.capacityOps);
+        batcher.bufOffsets = allocateBuffer(batcher.context, CL_MEM_READ_ONLY,
+                                            batcher.capacityOps * sizeof(unsigned int), nullptr, &err);
+        checkError(err, "clCreateBuffer batch offsets");
+        batcher.offsets.resize(batcher.capacityOps);
+    }
+}
+
+// Gather → one upload per array → one launch → one read → scatter
+void flushBatch(OpBatcher& batcher) {
+    if (batcher.pending.empty()) return;
+    
+    size_t total = batcher.pendingElements;
+    size_t numOps = batcher.pending.size();
+    reserveBatchBuffers(batcher, total, numOps);
+    
+    unsigned int offset = 0;
+    for (size_t k = 0; k < numOps; k++) {
+        const SmallOp* op = batcher.pending[k];
+        batcher.offsets[k] = offset;
+        std::memcpy(&batcher.stageA[offset], op->a, op->n * sizeof(float));
+        std::memcpy(&batcher.stageB[offset], op->b, op->n * sizeof(float));
+        offset += op->n;
+    }
+    batcher.offsets[numOps] = offset;
+    
+    size_t bytes = total * sizeof(float);
+    clEnqueueWriteBuffer(batcher.queue, batcher.bufA, CL_FALSE, 0, bytes, batcher.stageA.data(), 0, nullptr, nullptr);
+    clEnqueueWriteBuffer(batcher.queue, batcher.bufB, CL_FALSE, 0, bytes, batcher.stageB.data(), 0, nullptr, nullptr);
+    clEnqueueWriteBuffer(batcher.queue, batcher.bufOffsets, CL_FALSE, 0, (numOps + 1) * sizeof(unsigned int),
+                         batcher.offsets.data(), 0, nullptr, nullptr);
+    
+    unsigned int opCount = (unsigned int)numOps;
+    clSetKernelArg(batcher.kernel, 0, sizeof(cl_mem), &batcher.bufA);
+    clSetKernelArg(batcher.kernel, 1, sizeof(cl_mem), &batcher.bufB);
+    clSetKernelArg(batcher.kernel, 2, sizeof(cl_mem), &batcher.bufResult);
+    clSetKernelArg(batcher.kernel, 3, sizeof(cl_mem), &batcher.bufOffsets);
+    clSetKernelArg(batcher.kernel, 4, sizeof(unsigned int), &opCount);
+    size_t localSize = BATCH_LOCAL_SIZE;
+    size_t globalSize = numOps * BATCH_LOCAL_SIZE;
+    cl_int err = clEnqueueNDRangeKernel(batcher.queue, batcher.kernel, 1, nullptr, &globalSize, &localSize,
+                                        0, nullptr, nullptr);
+    checkError(err, "clEnqueueNDRangeKernel vector_add_batched");
+    clEnqueueReadBuffer(batcher.queue, batcher.bufResult, CL_TRUE, 0, bytes, batcher.stageResult.data(),
+                        0, nullptr, nullptr);
+    
+    auto done = std::chrono::high_resolution_clock::now();
+    for (size_t k = 0; k < numOps; k++) {
+        SmallOp* op = batcher.pending[k];
+        std::memcpy(op->result, &batcher.stageResult[batcher.offsets[k]], op->n * sizeof(float));
+        op->done = done;
+    }
+    
+    batcher.batches++;
+    batcher.ops += numOps;
+    batcher.pending.clear();
+    batcher.pendingElements = 0;
+}
+
+// Flushes once the open batch has been collecting for the latency budget.
+// The window starts when the batch opens rather than at the first op's
+// arrival, so a backlog is absorbed into one batch instead of being flushed
+// one already-late op at a time.
+void pollBatcher(OpBatcher& batcher) {
+    if (batcher.pending.empty()) return;
+    double waitedUs = std::chrono::duration<double, std::micro>(
+        std::chrono::high_resolution_clock::now() - batcher.windowStart).count();
+    if (waitedUs >= batcher.latencyBudgetUs) flushBatch(batcher);
+}
+
+void submitOp(OpBatcher& batcher, SmallOp* op) {
+    if (batcher.pending.empty()) batcher.windowStart = std::chrono::high_resolution_clock::now();
+    batcher.pending.push_back(op);
+    batcher.pendingElements += op->n;
+    if (batcher.pendingElements >= BATCH_MAX_ELEMENTS) flushBatch(batcher);
+    else pollBatcher(batcher);
+}
+
+void releaseOpBatcher(OpBatcher& batcher) {
+    if (batcher.bufA) {
+        releaseBuffer(batcher.bufA);
+        releaseBuffer(batcher.bufB);
+        releaseBuffer(batcher.bufResult);
+    }
+    if (batcher.bufOffsets) releaseBuffer(batcher.bufOffsets);
+    clReleaseKernel(batcher.kernel);
+    clReleaseCommandQueue(batcher.queue);
+}
+
+// The same ops, one write/write/launch/read round trip each, on warm buffers
+// sized for the largest op (so only per-launch overhead differs)
+void runPerRequest(std::vector<SmallOp>& ops, double ratePerSecond,
+                   cl_device_id device, cl_context context, cl_program program) {
+    cl_int err;
+    cl_command_queue queue = clCreateCommandQueueWithProperties(context, device, nullptr, &err);
+    checkError(err, "clCreateCommandQueue");
+    
+    unsigned int maxN = 0;
+    for (const auto& op : ops) maxN = std::max(maxN, op.n);
+    size_t maxBytes = maxN * sizeof(float);
+    cl_mem bufA = allocateBuffer(context, CL_MEM_READ_ONLY, maxBytes, nullptr, &err);
+    checkError(err, "clCreateBuffer A");
+    cl_mem bufB = allocateBuffer(context, CL_MEM_READ_ONLY, maxBytes, nullptr, &err);
+    checkError(err, "clCreateBuffer B");
+    cl_mem bufResult = allocateBuffer(context, CL_MEM_WRITE_ONLY, maxBytes, nullptr, &err);
+    checkError(err, "clCreateBuffer Result");
+    cl_kernel kernel = clCreateKernel(program, "vector_add", &err);
+    checkError(err, "clCreateKernel");
+    clSetKernelArg(kernel, 0, sizeof(cl_mem), &bufA);
+    clSetKernelArg(kernel, 1, sizeof(cl_mem), &bufB);
+    clSetKernelArg(kernel, 2, sizeof(cl_mem), &bufResult);
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t k = 0; k < ops.size(); k++) {
+        SmallOp& op = ops[k];
+        op.arrival = start + std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(
+            std::chrono::duration<double>(k / ratePerSecond));
+        while (std::chrono::high_resolution_clock::now() < op.arrival) {}
+        
+        size_t bytes = op.n * sizeof(float);
+        size_t globalSize = op.n;
+        clSetKernelArg(kernel, 3, sizeof(unsigned int), &op.n);
+        clEnqueueWriteBuffer(queue, bufA, CL_FALSE, 0, bytes, op.a, 0, nullptr, nullptr);
+        clEnqueueWriteBuffer(queue, bufB, CL_FALSE, 0, bytes, op.b, 0, nullptr, nullptr);
+        clEnqueueNDRangeKernel(queue, kernel, 1, nullptr, &globalSize, nullptr, 0, nullptr, nullptr);
+        clEnqueueReadBuffer(queue, bufResult, CL_TRUE, 0, bytes, op.result, 0, nullptr, nullptr);
+        op.done = std::chrono::high_resolution_clock::now();
+    }
+    
+    releaseBuffer(bufA);
+    releaseBuffer(bufB);
+    releaseBuffer(bufResult);
+    clReleaseKernel(kernel);
+    clReleaseCommandQueue(queue);
+}
+
+// Ops arrive at `ratePerSecond`; the batcher flushes on its latency budget
+// (checked on every submit and while the submitter is idle) or when a batch
+// gets large
+void runBatched(std::vector<SmallOp>& ops, double ratePerSecond, OpBatcher& batcher) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t k = 0; k < ops.size(); k++) {
+        SmallOp& op = ops[k];
+        op.arrival = start + std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(
+            std::chrono::duration<double>(k / ratePerSecond));
+        while (std::chrono::high_resolution_clock::now() < op.arrival) pollBatcher(batcher);
+        submitOp(batcher, &op);
+    }
+    flushBatch(batcher);
+}
+
+// Throughput and arrival-to-result latency, plus a correctness check
+void printCoalesceRow(const std::string& name, const std::vector<SmallOp>& ops, double opsPerBatch) {
+    std::vector<double> latencies;
+    bool correct = true;
+    auto first = ops.front().arrival;
+    auto last = ops.front().done;
+    for (const auto& op : ops) {
+        latencies.push_back(std::chrono::duration<double, std::micro>(op.done - op.arrival).count());
+        last = std::max(last, op.done);
+        for (unsigned int i = 0; i < op.n && correct; i++) {
+            correct = op.result[i] == op.a[i] + op.b[i];
+        }
+    }
+    std::sort(latencies.begin(), latencies.end());
+    double seconds = std::chrono::duration<double>(last - first).count();
+    
+    std::cout << std::left << std::setw(26) << name
+              << std::right << std::setw(12) << std::setprecision(0) << (ops.size() / seconds)
+              << std::setw(10) << std::setprecision(1) << opsPerBatch
+              << std::setw(12) << percentile(latencies, 0.50)
+              << std::setw(12) << percentile(latencies, 0.99)
+              << std::setw(8) << (correct ? "ok" : "FAIL") << "\n";
+}
+
+// Thousands of independent small vector_adds (64-4096 elements) arriving at a
+// fixed rate: per-request launches vs the batcher at several latency budgets
+void runCoalescing(double ratePerSecond, int numOps,
+                   const std::vector<DeviceInfo>& devices,
+                   const std::vector<cl_context>& contexts,
+                   const std::vector<cl_program>& programs) {
+    const double LATENCY_BUDGETS_US[] = {50.0, 200.0, 1000.0, 5000.0};
+    
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<unsigned int> sizeDist(64, 4096);
+    std::vector<unsigned int> sizes(numOps);
+    size_t totalElements = 0;
+    for (auto& n : sizes) {
+        n = sizeDist(rng);
+        totalElements += n;
+    }
+    HostVector<float> a(totalElements), b(totalElements), result(totalElements);
+    for (size_t i = 0; i < totalElements; i++) {
+        a[i] = static_cast<float>(i % 1000);
+        b[i] = static_cast<float>((i * 2) % 1000);
+    }
+    
+    // Every run resets the op list, pointing each op at its own slice
+    auto makeOps = [&]() {
+        std::vector<SmallOp> ops(numOps);
+        size_t offset = 0;
+        for (int k = 0; k < numOps; k++) {
+            ops[k] = {&a[offset], &b[offset], &result[offset], sizes[k], {}, {}};
+            offset += sizes[k];
+        }
+        std::fill(result.begin(), result.end(), 0.0f);
+        return ops;
+    };
+    
+    std::cout << numOps << " ops of 64-4096 elements (avg " << totalElements / numOps << "), offered load "
+              << std::setprecision(0) << std::fixed << ratePerSecond << " ops/s\n\n";
+    
+    for (size_t d = 0; d < devices.size(); d++) {
+        std::cout << devices[d].name << "\n";
+        std::cout << std::left << std::setw(26) << "Submission"
+                  << std::right << std::setw(12) << "ops/s"
+                  << std::setw(10) << "ops/batch"
+                  << std::setw(12) << "p50 (us)"
+                  << std::setw(12) << "p99 (us)"
+                  << std::setw(8) << "Check" << "\n";
+        std::cout << std::string(80, '-') << "\n";
+        
+        std::vector<SmallOp> ops = makeOps();
+        runPerRequest(ops, ratePerSecond, devices[d].id, contexts[d], programs[d]);
+        printCoalesceRow("Per-request launches", ops, 1.0);
+        
+        for (double budget : LATENCY_BUDGETS_US) {
+            // Allocate for the largest possible batch up front so no run pays for growth
+            OpBatcher batcher = createOpBatcher(budget, devices[d].id, contexts[d], programs[d]);
+            reserveBatchBuffers(batcher, BATCH_MAX_ELEMENTS + 4096, BATCH_MAX_ELEMENTS / 64 + 1);
+            ops = makeOps();
+            runBatched(ops, ratePerSecond, batcher);
+            
+            std::ostringstream label;
+            label << "Batched, budget " << (int)budget << " us";
+            printCoalesceRow(label.str(), ops, (double)batcher.ops / batcher.batches);
+            releaseOpBatcher(batcher);
+        }
+        std::cout << "\n";
+    }
+    
+    std::cout << "Latency = arrival until the result is back in the op's own output. Once the\n"
+              << "offered load exceeds what per-request launches sustain, their queueing delay grows\n"
+              << "without bound; the batcher trades up to one budget of delay for one launch per batch.\n";
+}
+
+int main(int argc, char** argv) {
     std::cout << "=== OpenCL Breakeven Point Analysis ===\n\n";
     std::cout << "Finding the vector size where OpenCL becomes faster than serial C++\n\n";
 
@@ -193,6 +726,37 @@ int main() {
         programs.push_back(program);
     }
 
+    if (argc > 1 && std::string(argv[1]) == "--coalesce") {
+        double rate = (argc > 2) ? std::atof(argv[2]) : 200000.0;
+        int numOps = (argc > 3) ? std::atoi(argv[3]) : 20000;
+        if (rate <= 0.0 || numOps <= 0) {
+            std::cerr << "Usage: breakeven_analysis --coalesce [ops per second] [ops]\n";
+            return 1;
+        }
+        
+        std::cout << "=== Small-Op Coalescing ===\n\n";
+        runCoalescing(rate, numOps, devices, contexts, programs);
+        std::cout << "\n";
+        printPeakFootprint(devices, contexts);
+        
+        for (auto& program : programs) clReleaseProgram(program);
+        for (auto& context : contexts) clReleaseContext(context);
+        return 0;
+    }
+    
+    if (argc > 1 && std::string(argv[1]) == "--completion") {
+        int iterations = (argc > 2) ? std::atoi(argv[2]) : 2000;
+        
+        std::cout << "=== Completion Policies: Small-Size Tail Latency ===\n\n";
+        runCompletionPolicies(std::max(iterations, 10), devices, contexts, programs);
+        std::cout << "\n";
+        printPeakFootprint(devices, contexts);
+        
+        for (auto& program : programs) clReleaseProgram(program);
+        for (auto& context : contexts) clReleaseContext(context);
+        return 0;
+    }
+
     // Test different vector sizes (powers of 2)
     std::vector<size_t> sizes = {
         1024,           // 1K
@@ -207,34 +771,61 @@ int main() {
         134217728       // 128M
     };
 
+    // --throughput [queues]: every device gets a second column measured with
+    // deep submission, and the table switches to ops/s so both modes compare
+    bool throughputMode = argc > 1 && std::string(argv[1]) == "--throughput";
+    int numQueues = (throughputMode && argc > 2) ? std::max(1, std::atoi(argv[2])) : 1;
+
     std::cout << std::fixed << std::setprecision(3);
-    std::cout << "Running tests (best of 5 iterations per size)...\n\n";
+    std::cout << "Running tests (best of 5 iterations per size)...\n";
+    if (throughputMode) {
+        std::cout << "Throughput: back-to-back launches on " << numQueues
+                  << " queue(s), one sync at the end\n";
+    }
+    std::cout << "\n";
 
     // Table header
+    int columnsPerDevice = throughputMode ? 2 : 1;
     std::cout << std::left << std::setw(12) << "Size"
               << std::right << std::setw(12) << "Elements"
-              << std::setw(12) << "CPU (ms)";
+              << std::setw(12) << (throughputMode ? "CPU ops/s" : "CPU (ms)");
     
     for (const auto& device : devices) {
         std::string shortName = device.name.substr(0, 10);
         std::cout << std::setw(12) << shortName;
+        if (throughputMode) std::cout << std::setw(12) << "";
+    }
+    // Peak footprint of each row: host vectors, then each device's cl_mems
+    std::cout << std::setw(12) << "Host MB";
+    for (size_t i = 0; i < devices.size(); i++) {
+        std::cout << std::setw(12) << ("Dev" + std::to_string(i + 1) + " MB");
+    }
+    if (throughputMode) {
+        std::cout << "\n" << std::string(36, ' ');
+        for (size_t i = 0; i < devices.size(); i++) {
+            std::cout << std::setw(12) << "latency" << std::setw(12) << "throughput";
+        }
     }
-    std::cout << "\n" << std::string(12 + 12 + 12 + devices.size() * 12, '-') << "\n";
+    std::cout << "\n" << std::string(12 + 12 + 12 + devices.size() * 12 * (columnsPerDevice + 1) + 12, '-') << "\n";
 
     // Track breakeven points
     std::vector<size_t> breakevenPoints(devices.size(), 0);
     std::vector<bool> foundBreakeven(devices.size(), false);
+    std::vector<size_t> throughputBreakeven(devices.size(), 0);
+    std::vector<bool> foundThroughputBreakeven(devices.size(), false);
 
     for (size_t testSize : sizes) {
+        resetMemoryPeaks();
+        
         // Initialize test vectors
-        std::vector<float> a(testSize), b(testSize);
+        HostVector<float> a(testSize), b(testSize);
         for (size_t i = 0; i < testSize; i++) {
             a[i] = static_cast<float>(i % 1000);
             b[i] = static_cast<float>((i * 2) % 1000);
         }
 
         // CPU baseline
-        std::vector<float> resultCPU(testSize);
+        HostVector<float> resultCPU(testSize);
         double cpuTime = vectorAddCPU(a, b, resultCPU);
 
         // Size label
@@ -251,17 +842,41 @@ int main() {
             sizeLabel = oss.str();
         }
 
+        // ops/s for the throughput table; the CPU loop can round to 0 ms at 1K
+        double cpuOpsPerSecond = 1000.0 / std::max(cpuTime, 1e-6);
+
         std::cout << std::left << std::setw(12) << sizeLabel
-                  << std::right << std::setw(12) << testSize
-                  << std::setw(12) << cpuTime;
+                  << std::right << std::setw(12) << testSize;
+        if (throughputMode) {
+            std::cout << std::setprecision(1) << std::setw(12) << cpuOpsPerSecond;
+        } else {
+            std::cout << std::setw(12) << cpuTime;
+        }
 
         // Test each OpenCL device
         for (size_t i = 0; i < devices.size(); i++) {
-            std::vector<float> resultOpenCL(testSize);
+            HostVector<float> resultOpenCL(testSize);
             double openclTime = vectorAddOpenCL(a, b, resultOpenCL, devices[i].id, 
                                                  contexts[i], programs[i]);
             
-            std::cout << std::setw(12) << openclTime;
+            if (throughputMode) {
+                double opsPerSecond = vectorAddOpenCLThroughput(a, b, resultOpenCL, numQueues,
+                                                                throughputDepth(testSize),
+                                                                devices[i].id, contexts[i], programs[i]);
+                std::cout << std::setw(12) << (1000.0 / openclTime);
+                if (opsPerSecond < 0.0) {
+                    std::cout << std::setw(12) << "-";   // too large for device memory
+                } else {
+                    std::cout << std::setw(12) << opsPerSecond;
+                }
+                
+                if (!foundThroughputBreakeven[i] && opsPerSecond > cpuOpsPerSecond) {
+                    throughputBreakeven[i] = testSize;
+                    foundThroughputBreakeven[i] = true;
+                }
+            } else {
+                std::cout << std::setw(12) << openclTime;
+            }
 
             // Check for breakeven point
             if (!foundBreakeven[i] && openclTime < cpuTime) {
@@ -269,7 +884,12 @@ int main() {
                 foundBreakeven[i] = true;
             }
         }
-        std::cout << "\n";
+        
+        std::cout << std::setprecision(1) << std::setw(12) << toMB(hostMemory.peak);
+        for (size_t i = 0; i < devices.size(); i++) {
+            std::cout << std::setw(12) << toMB(deviceMemory[contexts[i]].peak);
+        }
+        std::cout << std::setprecision(3) << "\n";
     }
 
     // Summary
@@ -283,6 +903,21 @@ int main() {
         }
     }
 
+    if (throughputMode) {
+        std::cout << "\n=== Throughput Breakeven Points (deep submission) ===\n\n";
+        for (size_t i = 0; i < devices.size(); i++) {
+            std::cout << devices[i].name << ": ";
+            if (foundThroughputBreakeven[i]) {
+                std::cout << throughputBreakeven[i] << " elements\n";
+            } else {
+                std::cout << "Not reached (OpenCL slower for all tested sizes)\n";
+            }
+        }
+    }
+
+    std::cout << "\n";
+    printPeakFootprint(devices, contexts);
+    
     // Cleanup
     for (auto& program : programs) clReleaseProgram(program);
     for (auto& context : contexts) clReleaseContext(context);
@@ -7,4 +7,21 @@ __kernel void vector_add(__global const float* a,
     if (gid < n) {
         result[gid] = a[gid] + b[gid];
     }
-}
\ No newline at end of file
+}
+
+// Many small vector_adds concatenated into one launch. offsets[op]..offsets[op+1]
+// is op's slice of a/b/result; one work-group per op strides over its slice.
+__kernel void vector_add_batched(__global const float* a,
+                                 __global const float* b,
+                                 __global float* result,
+                                 __global const unsigned int* offsets,
+                                 const unsigned int numOps)
+{
+    unsigned int op = get_group_id(0);
+    if (op >= numOps) return;
+    
+    unsigned int end = offsets[op + 1];
+    for (unsigned int i = offsets[op] + get_local_id(0); i < end; i += get_local_size(0)) {
+        result[i] = a[i] + b[i];
+    }
+}
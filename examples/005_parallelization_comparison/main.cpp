@@ -9,7 +9,12 @@
 #include <thread>
 #include <execution>
 #include <numeric>
+#include <string>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
 #include <omp.h>
+#include "../common/fp64.h"
 
 // Utility functions
 std::string loadKernelSource(const char* filename) {
@@ -29,15 +34,16 @@ void checkError(cl_int err, const char* operation) {
     }
 }
 
-// 1. Serial implementation
-double matvecSerial(const std::vector<float>& matrix,
-                    const std::vector<float>& vector,
-                    std::vector<float>& result,
+// 1. Serial implementation (float, or double for the fp64 comparison)
+template <typename Real>
+double matvecSerial(const std::vector<Real>& matrix,
+                    const std::vector<Real>& vector,
+                    std::vector<Real>& result,
                     int rows, int cols) {
     auto start = std::chrono::high_resolution_clock::now();
     
     for (int i = 0; i < rows; i++) {
-        float sum = 0.0f;
+        Real sum = 0;
         for (int j = 0; j < cols; j++) {
             sum += matrix[i * cols + j] * vector[j];
         }
@@ -72,15 +78,16 @@ double matvecStdPar(const std::vector<float>& matrix,
 }
 
 // 3. OpenMP
-double matvecOpenMP(const std::vector<float>& matrix,
-                    const std::vector<float>& vector,
-                    std::vector<float>& result,
+template <typename Real>
+double matvecOpenMP(const std::vector<Real>& matrix,
+                    const std::vector<Real>& vector,
+                    std::vector<Real>& result,
                     int rows, int cols) {
     auto start = std::chrono::high_resolution_clock::now();
     
     #pragma omp parallel for
     for (int i = 0; i < rows; i++) {
-        float sum = 0.0f;
+        Real sum = 0;
         for (int j = 0; j < cols; j++) {
             sum += matrix[i * cols + j] * vector[j];
         }
@@ -91,10 +98,11 @@ double matvecOpenMP(const std::vector<float>& matrix,
     return std::chrono::duration<double, std::milli>(end - start).count();
 }
 
-// 4. OpenCL
-double matvecOpenCL(const std::vector<float>& matrix,
-                    const std::vector<float>& vector,
-                    std::vector<float>& result,
+// 4. OpenCL. With double the matvec_multiply_fp64 kernel is used.
+template <typename Real>
+double matvecOpenCL(const std::vector<Real>& matrix,
+                    const std::vector<Real>& vector,
+                    std::vector<Real>& result,
                     int rows, int cols,
                     cl_device_id device,
                     cl_context context,
@@ -105,18 +113,19 @@ double matvecOpenCL(const std::vector<float>& matrix,
     checkError(err, "clCreateCommandQueue");
     
     cl_mem bufMatrix = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
-                                       matrix.size() * sizeof(float), (void*)matrix.data(), &err);
+                                       matrix.size() * sizeof(Real), (void*)matrix.data(), &err);
     checkError(err, "clCreateBuffer matrix");
     
     cl_mem bufVector = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
-                                       vector.size() * sizeof(float), (void*)vector.data(), &err);
+                                       vector.size() * sizeof(Real), (void*)vector.data(), &err);
     checkError(err, "clCreateBuffer vector");
     
     cl_mem bufResult = clCreateBuffer(context, CL_MEM_WRITE_ONLY,
-                                       result.size() * sizeof(float), nullptr, &err);
+                                       result.size() * sizeof(Real), nullptr, &err);
     checkError(err, "clCreateBuffer result");
     
-    cl_kernel kernel = clCreateKernel(program, "matvec_multiply", &err);
+    const char* kernelName = (sizeof(Real) == sizeof(double)) ? "matvec_multiply_fp64" : "matvec_multiply";
+    cl_kernel kernel = clCreateKernel(program, kernelName, &err);
     checkError(err, "clCreateKernel");
     
     clSetKernelArg(kernel, 0, sizeof(cl_mem), &bufMatrix);
@@ -135,7 +144,7 @@ double matvecOpenCL(const std::vector<float>& matrix,
     
     auto end = std::chrono::high_resolution_clock::now();
     
-    clEnqueueReadBuffer(queue, bufResult, CL_TRUE, 0, result.size() * sizeof(float),
+    clEnqueueReadBuffer(queue, bufResult, CL_TRUE, 0, result.size() * sizeof(Real),
                         result.data(), 0, nullptr, nullptr);
     
     clReleaseMemObject(bufMatrix);
@@ -147,7 +156,92 @@ double matvecOpenCL(const std::vector<float>& matrix,
     return std::chrono::duration<double, std::milli>(end - start).count();
 }
 
-int main() {
+// Largest deviation from the serial double result, scaled by the largest |y|.
+// Rows of sin*cos sums land near zero, so per-element relative error would blow up.
+template <typename Real>
+double resultError(const std::vector<double>& reference, const std::vector<Real>& y) {
+    double worst = 0.0, scale = 0.0;
+    for (size_t i = 0; i < reference.size(); i++) {
+        worst = std::max(worst, std::abs((double)y[i] - reference[i]));
+        scale = std::max(scale, std::abs(reference[i]));
+    }
+    return worst / scale;
+}
+
+void runFp64Comparison(int size,
+                       const std::vector<cl_device_id>& devices,
+                       const std::vector<std::string>& deviceNames,
+                       const std::vector<cl_context>& contexts,
+                       const std::vector<cl_program>& programs) {
+    int rows = size, cols = size;
+    
+    std::cout << "Matrix size: " << rows << "x" << cols << "\n\n";
+    
+    std::vector<double> matrix((size_t)rows * cols), vector(cols), result(rows);
+    for (size_t i = 0; i < matrix.size(); i++) matrix[i] = std::sin(0.001 * i);
+    for (int i = 0; i < cols; i++) vector[i] = std::cos(0.002 * i);
+    std::vector<float> matrixf(matrix.begin(), matrix.end()), vectorf(vector.begin(), vector.end());
+    std::vector<float> resultf(rows);
+    
+    // CPU baselines in double; the serial result is the reference
+    double serialTime = matvecSerial(matrix, vector, result, rows, cols);
+    std::vector<double> reference = result;
+    double openmpTime = matvecOpenMP(matrix, vector, result, rows, cols);
+    
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << std::left << std::setw(28) << "Implementation"
+              << std::right << std::setw(12) << "fp32 (ms)"
+              << std::setw(12) << "fp64 (ms)"
+              << std::setw(12) << "fp64:fp32"
+              << std::setw(12) << "fp32 error"
+              << std::setw(12) << "fp64 error\n";
+    std::cout << std::string(88, '-') << "\n";
+    
+    std::cout << std::left << std::setw(28) << "Serial C++ (double)"
+              << std::right << std::setw(12) << "-"
+              << std::setw(12) << serialTime << "\n";
+    std::cout << std::left << std::setw(28) << "OpenMP (double)"
+              << std::right << std::setw(12) << "-"
+              << std::setw(12) << openmpTime
+              << std::setw(24) << std::scientific << std::setprecision(1)
+              << resultError(reference, result) << std::fixed << std::setprecision(3) << "\n";
+    
+    for (size_t i = 0; i < devices.size(); i++) {
+        std::string name = "OpenCL: " + deviceNames[i].substr(0, 18);
+        
+        double fp32Time = matvecOpenCL(matrixf, vectorf, resultf, rows, cols, devices[i], contexts[i], programs[i]);
+        double fp32Error = resultError(reference, resultf);
+        
+        std::cout << std::left << std::setw(28) << name
+                  << std::right << std::setw(12) << fp32Time;
+        
+        if (!deviceSupportsFp64(devices[i])) {
+            std::cout << std::setw(12) << "n/a" << std::setw(12) << "-"
+                      << std::setw(12) << std::scientific << std::setprecision(1) << fp32Error
+                      << std::fixed << std::setprecision(3) << "   (no cl_khr_fp64)\n";
+            continue;
+        }
+        
+        std::fill(result.begin(), result.end(), 0.0);
+        double fp64Time = matvecOpenCL(matrix, vector, result, rows, cols, devices[i], contexts[i], programs[i]);
+        
+        char ratio[32];
+        std::snprintf(ratio, sizeof(ratio), "1:%.1f", fp64Time / fp32Time);
+        
+        std::cout << std::setw(12) << fp64Time
+                  << std::setw(12) << ratio
+                  << std::scientific << std::setprecision(1)
+                  << std::setw(12) << fp32Error
+                  << std::setw(12) << resultError(reference, result)
+                  << std::fixed << std::setprecision(3) << "\n";
+    }
+    
+    std::cout << "\nfp64:fp32 is the throughput ratio. Matvec is bandwidth-bound, so expect about 1:2\n"
+              << "(twice the bytes) even on devices whose double arithmetic is far slower.\n"
+              << "Errors are relative to the serial double result.\n";
+}
+
+int main(int argc, char** argv) {
     std::cout << "=== Parallelization Comparison: Matrix-Vector Multiplication ===\n\n";
     
     // Problem sizes to test
@@ -196,6 +290,17 @@ int main() {
     std::cout << "Hardware threads: " << std::thread::hardware_concurrency() << "\n";
     std::cout << "OpenCL devices: " << devices.size() << "\n\n";
     
+    if (argc > 1 && std::string(argv[1]) == "--fp64") {
+        int size = (argc > 2) ? std::atoi(argv[2]) : 4096;
+        
+        std::cout << "=== Double Precision (cl_khr_fp64) ===\n\n";
+        runFp64Comparison(size, devices, deviceNames, contexts, programs);
+        
+        for (auto& prog : programs) clReleaseProgram(prog);
+        for (auto& ctx : contexts) clReleaseContext(ctx);
+        return 0;
+    }
+    
     for (int size : sizes) {
         int rows = size;
         int cols = size;
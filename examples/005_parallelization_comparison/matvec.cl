@@ -12,4 +12,29 @@ __kernel void matvec_multiply(__global const float* matrix,
         }
         result[i] = sum;
     }
-}
\ No newline at end of file
+}
+
+// Double-precision variant, compiled only where the device supports doubles
+// (the host checks CL_DEVICE_DOUBLE_FP_CONFIG before using it)
+#if defined(cl_khr_fp64) || defined(__opencl_c_fp64)
+#if defined(cl_khr_fp64)
+#pragma OPENCL EXTENSION cl_khr_fp64 : enable
+#endif
+
+__kernel void matvec_multiply_fp64(__global const double* matrix,
+                                   __global const double* vector,
+                                   __global double* result,
+                                   const int rows,
+                                   const int cols)
+{
+    int i = get_global_id(0);
+    if (i < rows) {
+        double sum = 0.0;
+        for (int j = 0; j < cols; j++) {
+            sum += matrix[i * cols + j] * vector[j];
+        }
+        result[i] = sum;
+    }
+}
+
+#endif
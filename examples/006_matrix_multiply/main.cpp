@@ -9,7 +9,11 @@
 #include <execution>
 #include <numeric>
 #include <cmath>
+#include <string>
+#include <cstdlib>
+#include <cstdio>
 #include <omp.h>
+#include "../common/fp64.h"
 
 std::string loadKernelSource(const char* filename) {
     std::ifstream file(filename);
@@ -28,16 +32,17 @@ void checkError(cl_int err, const char* operation) {
     }
 }
 
-// 1. Serial implementation
-double matmulSerial(const std::vector<float>& A,
-                    const std::vector<float>& B,
-                    std::vector<float>& C,
+// 1. Serial implementation (float, or double for the fp64 comparison)
+template <typename Real>
+double matmulSerial(const std::vector<Real>& A,
+                    const std::vector<Real>& B,
+                    std::vector<Real>& C,
                     int M, int N, int K) {
     auto start = std::chrono::high_resolution_clock::now();
     
     for (int i = 0; i < M; i++) {
         for (int j = 0; j < K; j++) {
-            float sum = 0.0f;
+            Real sum = 0;
             for (int k = 0; k < N; k++) {
                 sum += A[i * N + k] * B[k * K + j];
             }
@@ -75,16 +80,17 @@ double matmulStdPar(const std::vector<float>& A,
 }
 
 // 3. OpenMP
-double matmulOpenMP(const std::vector<float>& A,
-                    const std::vector<float>& B,
-                    std::vector<float>& C,
+template <typename Real>
+double matmulOpenMP(const std::vector<Real>& A,
+                    const std::vector<Real>& B,
+                    std::vector<Real>& C,
                     int M, int N, int K) {
     auto start = std::chrono::high_resolution_clock::now();
     
     #pragma omp parallel for collapse(2)
     for (int i = 0; i < M; i++) {
         for (int j = 0; j < K; j++) {
-            float sum = 0.0f;
+            Real sum = 0;
             for (int k = 0; k < N; k++) {
                 sum += A[i * N + k] * B[k * K + j];
             }
@@ -96,10 +102,11 @@ double matmulOpenMP(const std::vector<float>& A,
     return std::chrono::duration<double, std::milli>(end - start).count();
 }
 
-// 4. OpenCL (simple version)
-double matmulOpenCL(const std::vector<float>& A,
-                    const std::vector<float>& B,
-                    std::vector<float>& C,
+// 4. OpenCL (simple version). With double the *_fp64 kernels are used.
+template <typename Real>
+double matmulOpenCL(const std::vector<Real>& A,
+                    const std::vector<Real>& B,
+                    std::vector<Real>& C,
                     int M, int N, int K,
                     cl_device_id device,
                     cl_context context,
@@ -110,9 +117,9 @@ double matmulOpenCL(const std::vector<float>& A,
     cl_command_queue queue = clCreateCommandQueueWithProperties(context, device, nullptr, &err);
     checkError(err, "clCreateCommandQueue");
     
-    size_t bufSizeA = M * N * sizeof(float);
-    size_t bufSizeB = N * K * sizeof(float);
-    size_t bufSizeC = M * K * sizeof(float);
+    size_t bufSizeA = (size_t)M * N * sizeof(Real);
+    size_t bufSizeB = (size_t)N * K * sizeof(Real);
+    size_t bufSizeC = (size_t)M * K * sizeof(Real);
     
     cl_mem bufA = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
                                   bufSizeA, (void*)A.data(), &err);
@@ -125,7 +132,9 @@ double matmulOpenCL(const std::vector<float>& A,
     cl_mem bufC = clCreateBuffer(context, CL_MEM_WRITE_ONLY, bufSizeC, nullptr, &err);
     checkError(err, "clCreateBuffer C");
     
-    const char* kernelName = useTiled ? "matrix_multiply_tiled" : "matrix_multiply";
+    const bool fp64 = sizeof(Real) == sizeof(double);
+    const char* kernelName = useTiled ? (fp64 ? "matrix_multiply_tiled_fp64" : "matrix_multiply_tiled")
+                                      : (fp64 ? "matrix_multiply_fp64" : "matrix_multiply");
     cl_kernel kernel = clCreateKernel(program, kernelName, &err);
     checkError(err, "clCreateKernel");
     
@@ -138,7 +147,7 @@ double matmulOpenCL(const std::vector<float>& A,
     
     if (useTiled) {
         const int TILE_SIZE = 16;
-        size_t localMemSize = TILE_SIZE * TILE_SIZE * sizeof(float);
+        size_t localMemSize = TILE_SIZE * TILE_SIZE * sizeof(Real);
         clSetKernelArg(kernel, 6, localMemSize, nullptr);
         clSetKernelArg(kernel, 7, localMemSize, nullptr);
     }
@@ -196,7 +205,96 @@ void verifyResults(const std::vector<float>& expected, const std::vector<float>&
     }
 }
 
-int main() {
+// Error of C against the double reference in units of its largest entry.
+// Every entry is a K-term dot product, so absolute error alone grows with K.
+template <typename Real>
+double matrixError(const std::vector<double>& reference, const std::vector<Real>& C) {
+    double largest = 0.0;
+    for (double v : reference) largest = std::max(largest, std::abs(v));
+    
+    double worst = 0.0;
+    for (size_t i = 0; i < C.size(); i++) {
+        worst = std::max(worst, std::abs((double)C[i] - reference[i]));
+    }
+    return worst / largest;
+}
+
+void runFp64Comparison(int size,
+                       const std::vector<cl_device_id>& devices,
+                       const std::vector<std::string>& deviceNames,
+                       const std::vector<cl_context>& contexts,
+                       const std::vector<cl_program>& programs) {
+    int M = size, N = size, K = size;
+    double gflop = 2.0 * M * N * K / 1e9;
+    
+    std::cout << "Matrix size: " << M << "x" << N << " × " << N << "x" << K << "\n\n";
+    
+    // Non-repeating values, so float rounding actually shows up in the error
+    std::vector<double> A(M * N), B(N * K), C(M * K);
+    for (int i = 0; i < M * N; i++) A[i] = std::sin(0.001 * i);
+    for (int i = 0; i < N * K; i++) B[i] = std::cos(0.002 * i);
+    std::vector<float> Af(A.begin(), A.end()), Bf(B.begin(), B.end()), Cf(M * K);
+    
+    // CPU baselines in double; the serial result is the reference
+    double serialTime = matmulSerial(A, B, C, M, N, K);
+    std::vector<double> reference = C;
+    double openmpTime = matmulOpenMP(A, B, C, M, N, K);
+    
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << std::left << std::setw(35) << "Implementation"
+              << std::right << std::setw(12) << "fp32 GFLOPS"
+              << std::setw(12) << "fp64 GFLOPS"
+              << std::setw(12) << "fp64:fp32"
+              << std::setw(12) << "fp32 error"
+              << std::setw(12) << "fp64 error\n";
+    std::cout << std::string(95, '-') << "\n";
+    
+    std::cout << std::left << std::setw(35) << "Serial C++ (double)"
+              << std::right << std::setw(12) << "-"
+              << std::setw(12) << (gflop / (serialTime / 1000.0)) << "\n";
+    std::cout << std::left << std::setw(35) << "OpenMP (double)"
+              << std::right << std::setw(12) << "-"
+              << std::setw(12) << (gflop / (openmpTime / 1000.0))
+              << std::setw(24) << std::scientific << std::setprecision(1)
+              << matrixError(reference, C) << std::fixed << std::setprecision(2) << "\n";
+    
+    for (size_t i = 0; i < devices.size(); i++) {
+        for (bool tiled : {false, true}) {
+            std::string name = "OpenCL: " + deviceNames[i].substr(0, 18) + (tiled ? " (tiled)" : " (simple)");
+            
+            double fp32Time = matmulOpenCL(Af, Bf, Cf, M, N, K, devices[i], contexts[i], programs[i], tiled);
+            double fp32Error = matrixError(reference, Cf);
+            
+            std::cout << std::left << std::setw(35) << name
+                      << std::right << std::setw(12) << (gflop / (fp32Time / 1000.0));
+            
+            if (!deviceSupportsFp64(devices[i])) {
+                std::cout << std::setw(12) << "n/a" << std::setw(12) << "-"
+                          << std::setw(12) << std::scientific << std::setprecision(1) << fp32Error
+                          << std::fixed << std::setprecision(2) << "   (no cl_khr_fp64)\n";
+                continue;
+            }
+            
+            std::fill(C.begin(), C.end(), 0.0);
+            double fp64Time = matmulOpenCL(A, B, C, M, N, K, devices[i], contexts[i], programs[i], tiled);
+            
+            char ratio[32];
+            std::snprintf(ratio, sizeof(ratio), "1:%.1f", fp64Time / fp32Time);
+            
+            std::cout << std::setw(12) << (gflop / (fp64Time / 1000.0))
+                      << std::setw(12) << ratio
+                      << std::scientific << std::setprecision(1)
+                      << std::setw(12) << fp32Error
+                      << std::setw(12) << matrixError(reference, C)
+                      << std::fixed << std::setprecision(2) << "\n";
+        }
+    }
+    
+    std::cout << "\nfp64:fp32 is the throughput ratio (1:2 = doubles at half the float rate).\n"
+              << "Errors are relative to the serial double result.\n";
+}
+
+int main(int argc, char** argv) {
     std::cout << "=== Matrix Multiplication Performance Comparison ===\n\n";
     
     // Test sizes - square matrices
@@ -251,6 +349,17 @@ int main() {
     std::cout << "CPU Cores (OpenMP): " << omp_get_max_threads() << "\n";
     std::cout << "OpenCL Devices: " << devices.size() << "\n\n";
     
+    if (argc > 1 && std::string(argv[1]) == "--fp64") {
+        int size = (argc > 2) ? std::atoi(argv[2]) : 1024;
+        
+        std::cout << "=== Double Precision (cl_khr_fp64) ===\n\n";
+        runFp64Comparison(size, devices, deviceNames, contexts, programs);
+        
+        for (auto& prog : programs) clReleaseProgram(prog);
+        for (auto& ctx : contexts) clReleaseContext(ctx);
+        return 0;
+    }
+    
     for (int size : sizes) {
         int M = size, N = size, K = size;
         
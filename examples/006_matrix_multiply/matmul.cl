@@ -63,4 +63,79 @@ __kernel void matrix_multiply_tiled(__global const float* A,
     if (globalRow < M && globalCol < K) {
         C[globalRow * K + globalCol] = sum;
     }
-}
\ No newline at end of file
+}
+
+// ============================================================================
+// Double-precision variants. Compiled only where the device supports doubles;
+// the host checks CL_DEVICE_DOUBLE_FP_CONFIG before creating them.
+// ============================================================================
+
+#if defined(cl_khr_fp64) || defined(__opencl_c_fp64)
+#if defined(cl_khr_fp64)
+#pragma OPENCL EXTENSION cl_khr_fp64 : enable
+#endif
+
+__kernel void matrix_multiply_fp64(__global const double* A,
+                                   __global const double* B,
+                                   __global double* C,
+                                   const int M,
+                                   const int N,
+                                   const int K)
+{
+    int row = get_global_id(0);
+    int col = get_global_id(1);
+    
+    if (row < M && col < K) {
+        double sum = 0.0;
+        for (int i = 0; i < N; i++) {
+            sum += A[row * N + i] * B[i * K + col];
+        }
+        C[row * K + col] = sum;
+    }
+}
+
+__kernel void matrix_multiply_tiled_fp64(__global const double* A,
+                                         __global const double* B,
+                                         __global double* C,
+                                         const int M,
+                                         const int N,
+                                         const int K,
+                                         __local double* A_tile,
+                                         __local double* B_tile)
+{
+    const int TILE_SIZE = 16;
+    
+    int globalRow = get_global_id(0);
+    int globalCol = get_global_id(1);
+    int localRow = get_local_id(0);
+    int localCol = get_local_id(1);
+    
+    double sum = 0.0;
+    
+    int numTiles = (N + TILE_SIZE - 1) / TILE_SIZE;
+    
+    for (int t = 0; t < numTiles; t++) {
+        int tiledRow = TILE_SIZE * t + localCol;
+        int tiledCol = TILE_SIZE * t + localRow;
+        
+        A_tile[localRow * TILE_SIZE + localCol] = 
+            (globalRow < M && tiledRow < N) ? A[globalRow * N + tiledRow] : 0.0;
+        
+        B_tile[localRow * TILE_SIZE + localCol] = 
+            (tiledCol < N && globalCol < K) ? B[tiledCol * K + globalCol] : 0.0;
+        
+        barrier(CLK_LOCAL_MEM_FENCE);
+        
+        for (int k = 0; k < TILE_SIZE; k++) {
+            sum += A_tile[localRow * TILE_SIZE + k] * B_tile[k * TILE_SIZE + localCol];
+        }
+        
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    
+    if (globalRow < M && globalCol < K) {
+        C[globalRow * K + globalCol] = sum;
+    }
+}
+
+#endif
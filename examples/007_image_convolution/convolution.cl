@@ -135,4 +135,680 @@ __kernel void convolve_v(__global const float* input,
     }
     
     output[y * width + x] = sum;
-}
\ No newline at end of file
+}
+
+// Separable convolution for 8-bit video frames (horizontal pass, uchar -> float)
+__kernel void convolve_h_u8(__global const uchar* input,
+                            __global float* output,
+                            __constant float* filter,
+                            const int width,
+                            const int height,
+                            const int ksize)
+{
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+    
+    if (x >= width || y >= height) return;
+    
+    int khalf = ksize / 2;
+    float sum = 0.0f;
+    
+    for (int k = -khalf; k <= khalf; k++) {
+        int ix = clamp_int(x + k, 0, width - 1);
+        sum += (float)input[y * width + ix] * filter[k + khalf];
+    }
+    
+    output[y * width + x] = sum;
+}
+
+// Separable convolution for 8-bit video frames (vertical pass, float -> uchar)
+__kernel void convolve_v_u8(__global const float* input,
+                            __global uchar* output,
+                            __constant float* filter,
+                            const int width,
+                            const int height,
+                            const int ksize)
+{
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+    
+    if (x >= width || y >= height) return;
+    
+    int khalf = ksize / 2;
+    float sum = 0.0f;
+    
+    for (int k = -khalf; k <= khalf; k++) {
+        int iy = clamp_int(y + k, 0, height - 1);
+        sum += input[iy * width + x] * filter[k + khalf];
+    }
+    
+    output[y * width + x] = convert_uchar_sat_rte(sum);
+}
+
+// Box/mean filters with O(1) cost per pixel (independent of ksize)
+
+// Fixed-point scale for the summed-area table: values are stored as Q40.24 in a
+// 64-bit long so rectangle differences stay exact (a float table loses all
+// precision once the running total passes ~2^24)
+#define SAT_ONE 16777216.0f
+
+// Row pass of the 2D scan: one work-group per row, Hillis-Steele scan per chunk
+__kernel void sat_scan_rows(__global const float* input,
+                            __global long* sat,
+                            const int width,
+                            const int height,
+                            __local long* scratch)
+{
+    int y = get_group_id(0);
+    int lid = get_local_id(0);
+    int lsize = get_local_size(0);
+    
+    if (y >= height) return;
+    
+    long carry = 0;
+    for (int base = 0; base < width; base += lsize) {
+        int x = base + lid;
+        scratch[lid] = (x < width) ? convert_long_rte(input[y * width + x] * SAT_ONE) : 0;
+        barrier(CLK_LOCAL_MEM_FENCE);
+        
+        for (int offset = 1; offset < lsize; offset <<= 1) {
+            long add = (lid >= offset) ? scratch[lid - offset] : 0;
+            barrier(CLK_LOCAL_MEM_FENCE);
+            scratch[lid] += add;
+            barrier(CLK_LOCAL_MEM_FENCE);
+        }
+        
+        if (x < width) sat[y * width + x] = scratch[lid] + carry;
+        carry += scratch[lsize - 1];
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+}
+
+// Column pass of the 2D scan: one work-item per column (coalesced across columns)
+__kernel void sat_scan_columns(__global long* sat,
+                               const int width,
+                               const int height)
+{
+    int x = get_global_id(0);
+    if (x >= width) return;
+    
+    long sum = 0;
+    for (int y = 0; y < height; y++) {
+        sum += sat[y * width + x];
+        sat[y * width + x] = sum;
+    }
+}
+
+// Sum of the inclusive rectangle [r0,r1] x [c0,c1]
+inline long sat_rect(__global const long* sat, int width, int r0, int r1, int c0, int c1)
+{
+    long s = sat[r1 * width + c1];
+    if (r0 > 0) s -= sat[(r0 - 1) * width + c1];
+    if (c0 > 0) s -= sat[r1 * width + c0 - 1];
+    if (r0 > 0 && c0 > 0) s += sat[(r0 - 1) * width + c0 - 1];
+    return s;
+}
+
+// Mean filter from the summed-area table. Clamp-to-edge sampling is the interior
+// rectangle plus the replicated edge rows/columns/corners, so the result matches
+// convolve_2d with a uniform filter.
+__kernel void box_filter_integral(__global const long* sat,
+                                  __global float* output,
+                                  const int width,
+                                  const int height,
+                                  const int ksize)
+{
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+    
+    if (x >= width || y >= height) return;
+    
+    int khalf = ksize / 2;
+    int r0 = max(y - khalf, 0);
+    int r1 = min(y + khalf, height - 1);
+    int c0 = max(x - khalf, 0);
+    int c1 = min(x + khalf, width - 1);
+    long top = max(khalf - y, 0);
+    long bottom = max(y + khalf - (height - 1), 0);
+    long left = max(khalf - x, 0);
+    long right = max(x + khalf - (width - 1), 0);
+    
+    long sum = sat_rect(sat, width, r0, r1, c0, c1);
+    if (top)    sum += top * sat_rect(sat, width, 0, 0, c0, c1);
+    if (bottom) sum += bottom * sat_rect(sat, width, height - 1, height - 1, c0, c1);
+    if (left)   sum += left * sat_rect(sat, width, r0, r1, 0, 0);
+    if (right)  sum += right * sat_rect(sat, width, r0, r1, width - 1, width - 1);
+    if (top && left)     sum += top * left * sat_rect(sat, width, 0, 0, 0, 0);
+    if (top && right)    sum += top * right * sat_rect(sat, width, 0, 0, width - 1, width - 1);
+    if (bottom && left)  sum += bottom * left * sat_rect(sat, width, height - 1, height - 1, 0, 0);
+    if (bottom && right) sum += bottom * right * sat_rect(sat, width, height - 1, height - 1, width - 1, width - 1);
+    
+    output[y * width + x] = convert_float(sum) * (1.0f / (SAT_ONE * ksize * ksize));
+}
+
+// Running-sum box filter (horizontal pass): each work-item slides a window
+// along `segment` pixels of one row - one add and one subtract per pixel
+__kernel void box_h_running(__global const float* input,
+                            __global float* output,
+                            const int width,
+                            const int height,
+                            const int ksize,
+                            const int segment)
+{
+    int x0 = get_global_id(0) * segment;
+    int y = get_global_id(1);
+    
+    if (x0 >= width || y >= height) return;
+    
+    int khalf = ksize / 2;
+    int x1 = min(x0 + segment, width);
+    __global const float* row = input + y * width;
+    
+    float sum = 0.0f;
+    for (int k = -khalf; k <= khalf; k++) {
+        sum += row[clamp_int(x0 + k, 0, width - 1)];
+    }
+    
+    for (int x = x0; x < x1; x++) {
+        output[y * width + x] = sum;
+        sum += row[clamp_int(x + khalf + 1, 0, width - 1)] - row[clamp_int(x - khalf, 0, width - 1)];
+    }
+}
+
+// Running-sum box filter (vertical pass, applies the 1/ksize^2 normalization)
+__kernel void box_v_running(__global const float* input,
+                            __global float* output,
+                            const int width,
+                            const int height,
+                            const int ksize,
+                            const int segment)
+{
+    int x = get_global_id(0);
+    int y0 = get_global_id(1) * segment;
+    
+    if (x >= width || y0 >= height) return;
+    
+    int khalf = ksize / 2;
+    int y1 = min(y0 + segment, height);
+    float scale = 1.0f / (ksize * ksize);
+    
+    float sum = 0.0f;
+    for (int k = -khalf; k <= khalf; k++) {
+        sum += input[clamp_int(y0 + k, 0, height - 1) * width + x];
+    }
+    
+    for (int y = y0; y < y1; y++) {
+        output[y * width + x] = sum * scale;
+        sum += input[clamp_int(y + khalf + 1, 0, height - 1) * width + x]
+             - input[clamp_int(y - khalf, 0, height - 1) * width + x];
+    }
+}
+
+// Batched multi-channel convolution layers (NCHW input, K filters, stride, zero padding)
+
+// im2col: col[(c*R + r)*S + s][n*OH*OW + oh*OW + ow] = input[n][c][oh*stride-pad+r][ow*stride-pad+s]
+__kernel void im2col_nchw(__global const float* input,
+                          __global float* col,
+                          const int N,
+                          const int C,
+                          const int H,
+                          const int W,
+                          const int R,
+                          const int S,
+                          const int OH,
+                          const int OW,
+                          const int stride,
+                          const int pad)
+{
+    int p = get_global_id(0);
+    int row = get_global_id(1);
+    int P = N * OH * OW;
+    
+    if (p >= P || row >= C * R * S) return;
+    
+    int n = p / (OH * OW);
+    int q = p % (OH * OW);
+    int oh = q / OW;
+    int ow = q % OW;
+    int c = row / (R * S);
+    int r = (row / S) % R;
+    int s = row % S;
+    
+    int ih = oh * stride - pad + r;
+    int iw = ow * stride - pad + s;
+    
+    float v = 0.0f;
+    if (ih >= 0 && ih < H && iw >= 0 && iw < W) {
+        v = input[((size_t)(n * C + c) * H + ih) * W + iw];
+    }
+    col[(size_t)row * P + p] = v;
+}
+
+// Tiled GEMM from 006_matrix_multiply (C = A * B, A is MxN, B is NxK)
+__kernel void matrix_multiply_tiled(__global const float* A,
+                                    __global const float* B,
+                                    __global float* C,
+                                    const int M,
+                                    const int N,
+                                    const int K,
+                                    __local float* A_tile,
+                                    __local float* B_tile)
+{
+    const int TILE_SIZE = 16;
+    
+    int globalRow = get_global_id(0);
+    int globalCol = get_global_id(1);
+    int localRow = get_local_id(0);
+    int localCol = get_local_id(1);
+    
+    float sum = 0.0f;
+    
+    int numTiles = (N + TILE_SIZE - 1) / TILE_SIZE;
+    
+    for (int t = 0; t < numTiles; t++) {
+        // Load tiles into local memory
+        int tiledRow = TILE_SIZE * t + localCol;
+        int tiledCol = TILE_SIZE * t + localRow;
+        
+        A_tile[localRow * TILE_SIZE + localCol] = 
+            (globalRow < M && tiledRow < N) ? A[globalRow * N + tiledRow] : 0.0f;
+        
+        B_tile[localRow * TILE_SIZE + localCol] = 
+            (tiledCol < N && globalCol < K) ? B[tiledCol * K + globalCol] : 0.0f;
+        
+        barrier(CLK_LOCAL_MEM_FENCE);
+        
+        // Compute partial sum
+        for (int k = 0; k < TILE_SIZE; k++) {
+            sum += A_tile[localRow * TILE_SIZE + k] * B_tile[k * TILE_SIZE + localCol];
+        }
+        
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    
+    if (globalRow < M && globalCol < K) {
+        C[globalRow * K + globalCol] = sum;
+    }
+}
+
+// GEMM result [K][N*OH*OW] -> NCHW output [N][K][OH*OW]
+__kernel void gemm_to_nchw(__global const float* gemm,
+                           __global float* output,
+                           const int N,
+                           const int K,
+                           const int OHW)
+{
+    int p = get_global_id(0);
+    int k = get_global_id(1);
+    
+    if (p >= N * OHW || k >= K) return;
+    
+    int n = p / OHW;
+    int q = p % OHW;
+    output[((size_t)n * K + k) * OHW + q] = gemm[(size_t)k * N * OHW + p];
+}
+
+// Direct batched convolution derived from convolve_2d_local: each work-group
+// computes a tile of one output channel of one image, staging every input
+// channel's tile (stride-spaced, with halo) in local memory
+__kernel void conv_nchw_direct_local(__global const float* input,
+                                     __global const float* weights,
+                                     __global float* output,
+                                     const int C,
+                                     const int H,
+                                     const int W,
+                                     const int K,
+                                     const int R,
+                                     const int S,
+                                     const int OH,
+                                     const int OW,
+                                     const int stride,
+                                     const int pad,
+                                     __local float* tile)
+{
+    int ox = get_global_id(0);
+    int oy = get_global_id(1);
+    int n = get_global_id(2) / K;
+    int k = get_global_id(2) % K;
+    int lx = get_local_id(0);
+    int ly = get_local_id(1);
+    int lw = get_local_size(0);
+    int lh = get_local_size(1);
+    
+    int tile_w = (lw - 1) * stride + S;
+    int tile_h = (lh - 1) * stride + R;
+    int ix0 = get_group_id(0) * lw * stride - pad;
+    int iy0 = get_group_id(1) * lh * stride - pad;
+    
+    float sum = 0.0f;
+    
+    for (int c = 0; c < C; c++) {
+        __global const float* plane = input + (size_t)(n * C + c) * H * W;
+        
+        // Load tile with halo into local memory (zero padding outside the image)
+        for (int ty = ly; ty < tile_h; ty += lh) {
+            for (int tx = lx; tx < tile_w; tx += lw) {
+                int ix = ix0 + tx;
+                int iy = iy0 + ty;
+                tile[ty * tile_w + tx] = (ix >= 0 && ix < W && iy >= 0 && iy < H) ? plane[iy * W + ix] : 0.0f;
+            }
+        }
+        
+        barrier(CLK_LOCAL_MEM_FENCE);
+        
+        __global const float* filter = weights + (size_t)(k * C + c) * R * S;
+        for (int r = 0; r < R; r++) {
+            for (int s = 0; s < S; s++) {
+                sum += tile[(ly * stride + r) * tile_w + lx * stride + s] * filter[r * S + s];
+            }
+        }
+        
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    
+    if (ox < OW && oy < OH) {
+        output[((size_t)(n * K + k) * OH + oy) * OW + ox] = sum;
+    }
+}
+
+// Winograd minimal filtering for 3x3 kernels: F(2x2,3x3) and F(4x4,3x3)
+//
+// Y = A^T [ (G g G^T) .* (B^T d B) ] A for each m x m output tile, where d is the
+// (m+2) x (m+2) input tile. The elementwise stage needs (m+2)^2 multiplies per
+// tile instead of 9 m^2: 16 vs 36 for F(2,3), 36 vs 144 for F(4,3). Input tiles
+// are loaded with clamp-to-edge, so results match convolve_2d exactly up to rounding.
+// 1D transforms take element strides so the same code runs down columns and along rows.
+
+inline void wino2_in_1d(const float* d, int ds, float* o, int os)
+{
+    float d0 = d[0], d1 = d[ds], d2 = d[2 * ds], d3 = d[3 * ds];
+    o[0]      = d0 - d2;
+    o[os]     = d1 + d2;
+    o[2 * os] = d2 - d1;
+    o[3 * os] = d1 - d3;
+}
+
+inline void wino2_filter_1d(const float* g, int gs, float* u, int us)
+{
+    float g0 = g[0], g1 = g[gs], g2 = g[2 * gs];
+    u[0]      = g0;
+    u[us]     = 0.5f * (g0 + g1 + g2);
+    u[2 * us] = 0.5f * (g0 - g1 + g2);
+    u[3 * us] = g2;
+}
+
+inline void wino2_out_1d(const float* m, int ms, float* y, int ys)
+{
+    float m0 = m[0], m1 = m[ms], m2 = m[2 * ms], m3 = m[3 * ms];
+    y[0]  = m0 + m1 + m2;
+    y[ys] = m1 - m2 - m3;
+}
+
+inline void wino4_in_1d(const float* d, int ds, float* o, int os)
+{
+    float d0 = d[0], d1 = d[ds], d2 = d[2 * ds], d3 = d[3 * ds], d4 = d[4 * ds], d5 = d[5 * ds];
+    o[0]      = 4.0f * d0 - 5.0f * d2 + d4;
+    o[os]     = -4.0f * (d1 + d2) + d3 + d4;
+    o[2 * os] = 4.0f * (d1 - d2) - d3 + d4;
+    o[3 * os] = 2.0f * (d3 - d1) - d2 + d4;
+    o[4 * os] = 2.0f * (d1 - d3) - d2 + d4;
+    o[5 * os] = 4.0f * d1 - 5.0f * d3 + d5;
+}
+
+inline void wino4_filter_1d(const float* g, int gs, float* u, int us)
+{
+    float g0 = g[0], g1 = g[gs], g2 = g[2 * gs];
+    u[0]      = 0.25f * g0;
+    u[us]     = -(g0 + g1 + g2) / 6.0f;
+    u[2 * us] = -(g0 - g1 + g2) / 6.0f;
+    u[3 * us] = g0 / 24.0f + g1 / 12.0f + g2 / 6.0f;
+    u[4 * us] = g0 / 24.0f - g1 / 12.0f + g2 / 6.0f;
+    u[5 * us] = g2;
+}
+
+inline void wino4_out_1d(const float* m, int ms, float* y, int ys)
+{
+    float m0 = m[0], m1 = m[ms], m2 = m[2 * ms], m3 = m[3 * ms], m4 = m[4 * ms], m5 = m[5 * ms];
+    y[0]      = m0 + m1 + m2 + m3 + m4;
+    y[ys]     = m1 - m2 + 2.0f * (m3 - m4);
+    y[2 * ys] = m1 + m2 + 4.0f * (m3 + m4);
+    y[3 * ys] = m1 - m2 + 8.0f * (m3 - m4) + m5;
+}
+
+// B^T d B, in place on a 4x4 tile
+inline void wino2_input_transform(float* t)
+{
+    for (int j = 0; j < 4; j++) wino2_in_1d(t + j, 4, t + j, 4);
+    for (int i = 0; i < 4; i++) wino2_in_1d(t + 4 * i, 1, t + 4 * i, 1);
+}
+
+// A^T m A: 4x4 -> 2x2
+inline void wino2_output_transform(const float* m, float* y)
+{
+    float t[8];
+    for (int j = 0; j < 4; j++) wino2_out_1d(m + j, 4, t + j, 4);
+    for (int i = 0; i < 2; i++) wino2_out_1d(t + 4 * i, 1, y + 2 * i, 1);
+}
+
+// G g G^T: 3x3 -> 4x4
+inline void wino2_filter_transform(const float* g, float* u)
+{
+    float t[12];
+    for (int j = 0; j < 3; j++) wino2_filter_1d(g + j, 3, t + j, 3);
+    for (int i = 0; i < 4; i++) wino2_filter_1d(t + 3 * i, 1, u + 4 * i, 1);
+}
+
+inline void wino4_input_transform(float* t)
+{
+    for (int j = 0; j < 6; j++) wino4_in_1d(t + j, 6, t + j, 6);
+    for (int i = 0; i < 6; i++) wino4_in_1d(t + 6 * i, 1, t + 6 * i, 1);
+}
+
+inline void wino4_output_transform(const float* m, float* y)
+{
+    float t[24];
+    for (int j = 0; j < 6; j++) wino4_out_1d(m + j, 6, t + j, 6);
+    for (int i = 0; i < 4; i++) wino4_out_1d(t + 6 * i, 1, y + 4 * i, 1);
+}
+
+inline void wino4_filter_transform(const float* g, float* u)
+{
+    float t[18];
+    for (int j = 0; j < 3; j++) wino4_filter_1d(g + j, 3, t + j, 3);
+    for (int i = 0; i < 6; i++) wino4_filter_1d(t + 3 * i, 1, u + 6 * i, 1);
+}
+
+// Load the (m+2)x(m+2) input tile for output tile (tx, ty) with clamp-to-edge
+inline void wino_load_tile(__global const float* input, int width, int height,
+                           int tx, int ty, int m, float* d)
+{
+    int alpha = m + 2;
+    int x0 = tx * m - 1;
+    int y0 = ty * m - 1;
+    for (int i = 0; i < alpha; i++) {
+        int iy = clamp_int(y0 + i, 0, height - 1);
+        for (int j = 0; j < alpha; j++) {
+            d[i * alpha + j] = input[iy * width + clamp_int(x0 + j, 0, width - 1)];
+        }
+    }
+}
+
+inline void wino_store_tile(__global float* output, int width, int height,
+                            int tx, int ty, int m, const float* y)
+{
+    for (int i = 0; i < m; i++) {
+        int oy = ty * m + i;
+        if (oy >= height) return;
+        for (int j = 0; j < m; j++) {
+            int ox = tx * m + j;
+            if (ox < width) output[oy * width + ox] = y[i * m + j];
+        }
+    }
+}
+
+// Stage 1: filter transform (a single work-item; one 3x3 filter)
+__kernel void winograd_f2_filter(__constant float* filter, __global float* U)
+{
+    if (get_global_id(0) != 0) return;
+    float g[9], u[16];
+    for (int i = 0; i < 9; i++) g[i] = filter[i];
+    wino2_filter_transform(g, u);
+    for (int e = 0; e < 16; e++) U[e] = u[e];
+}
+
+__kernel void winograd_f4_filter(__constant float* filter, __global float* U)
+{
+    if (get_global_id(0) != 0) return;
+    float g[9], u[36];
+    for (int i = 0; i < 9; i++) g[i] = filter[i];
+    wino4_filter_transform(g, u);
+    for (int e = 0; e < 36; e++) U[e] = u[e];
+}
+
+// Stage 2: input transform, one work-item per tile. V is laid out [element][tile]
+// so the elementwise stage and the output transform read it coalesced.
+__kernel void winograd_f2_input(__global const float* input,
+                                __global float* V,
+                                const int width,
+                                const int height,
+                                const int tilesX,
+                                const int tilesY)
+{
+    int tx = get_global_id(0);
+    int ty = get_global_id(1);
+    if (tx >= tilesX || ty >= tilesY) return;
+    
+    float d[16];
+    wino_load_tile(input, width, height, tx, ty, 2, d);
+    wino2_input_transform(d);
+    
+    int numTiles = tilesX * tilesY;
+    int tile = ty * tilesX + tx;
+    for (int e = 0; e < 16; e++) V[e * numTiles + tile] = d[e];
+}
+
+__kernel void winograd_f4_input(__global const float* input,
+                                __global float* V,
+                                const int width,
+                                const int height,
+                                const int tilesX,
+                                const int tilesY)
+{
+    int tx = get_global_id(0);
+    int ty = get_global_id(1);
+    if (tx >= tilesX || ty >= tilesY) return;
+    
+    float d[36];
+    wino_load_tile(input, width, height, tx, ty, 4, d);
+    wino4_input_transform(d);
+    
+    int numTiles = tilesX * tilesY;
+    int tile = ty * tilesX + tx;
+    for (int e = 0; e < 36; e++) V[e * numTiles + tile] = d[e];
+}
+
+// Stage 3: batched elementwise product M = U .* V over all tiles (shared by both variants)
+__kernel void winograd_multiply(__global const float* U,
+                                __global const float* V,
+                                __global float* M,
+                                const int numTiles,
+                                const int elements)
+{
+    int tile = get_global_id(0);
+    int e = get_global_id(1);
+    if (tile >= numTiles || e >= elements) return;
+    
+    M[e * numTiles + tile] = U[e] * V[e * numTiles + tile];
+}
+
+// Stage 4: output transform, one work-item per tile
+__kernel void winograd_f2_output(__global const float* M,
+                                 __global float* output,
+                                 const int width,
+                                 const int height,
+                                 const int tilesX,
+                                 const int tilesY)
+{
+    int tx = get_global_id(0);
+    int ty = get_global_id(1);
+    if (tx >= tilesX || ty >= tilesY) return;
+    
+    int numTiles = tilesX * tilesY;
+    int tile = ty * tilesX + tx;
+    float m[16], y[4];
+    for (int e = 0; e < 16; e++) m[e] = M[e * numTiles + tile];
+    wino2_output_transform(m, y);
+    wino_store_tile(output, width, height, tx, ty, 2, y);
+}
+
+__kernel void winograd_f4_output(__global const float* M,
+                                 __global float* output,
+                                 const int width,
+                                 const int height,
+                                 const int tilesX,
+                                 const int tilesY)
+{
+    int tx = get_global_id(0);
+    int ty = get_global_id(1);
+    if (tx >= tilesX || ty >= tilesY) return;
+    
+    int numTiles = tilesX * tilesY;
+    int tile = ty * tilesX + tx;
+    float m[36], y[16];
+    for (int e = 0; e < 36; e++) m[e] = M[e * numTiles + tile];
+    wino4_output_transform(m, y);
+    wino_store_tile(output, width, height, tx, ty, 4, y);
+}
+
+// Fused variants: all three per-tile stages in registers, no V/M round trip
+__kernel void winograd_f2_fused(__global const float* input,
+                                __global float* output,
+                                __constant float* U,
+                                const int width,
+                                const int height,
+                                const int tilesX,
+                                const int tilesY)
+{
+    int tx = get_global_id(0);
+    int ty = get_global_id(1);
+    if (tx >= tilesX || ty >= tilesY) return;
+    
+    float d[16], y[4];
+    wino_load_tile(input, width, height, tx, ty, 2, d);
+    wino2_input_transform(d);
+    for (int e = 0; e < 16; e++) d[e] *= U[e];
+    wino2_output_transform(d, y);
+    wino_store_tile(output, width, height, tx, ty, 2, y);
+}
+
+__kernel void winograd_f4_fused(__global const float* input,
+                                __global float* output,
+                                __constant float* U,
+                                const int width,
+                                const int height,
+                                const int tilesX,
+                                const int tilesY)
+{
+    int tx = get_global_id(0);
+    int ty = get_global_id(1);
+    if (tx >= tilesX || ty >= tilesY) return;
+    
+    float d[36], y[16];
+    wino_load_tile(input, width, height, tx, ty, 4, d);
+    wino4_input_transform(d);
+    for (int e = 0; e < 36; e++) d[e] *= U[e];
+    wino4_output_transform(d, y);
+    wino_store_tile(output, width, height, tx, ty, 4, y);
+}
+
+// Difference of Gaussians: band-pass between two blurs of the same image
+__kernel void image_difference(__global const float* a,
+                               __global const float* b,
+                               __global float* output,
+                               const int count)
+{
+    int i = get_global_id(0);
+    if (i >= count) return;
+    
+    output[i] = a[i] - b[i];
+}
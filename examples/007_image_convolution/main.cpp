@@ -9,7 +9,18 @@
 #include <algorithm>
 #include <execution>
 #include <cmath>
+#include <random>
+#include <string>
+#include <cctype>
+#include <cstdlib>
+#include <atomic>
+#include <thread>
+#include <map>
+#include <memory>
 #include <omp.h>
+#include "../common/completion.h"
+#include "../common/command_replay.h"
+#include "../common/memory_accounting.h"
 
 std::string loadKernelSource(const char* filename) {
     std::ifstream file(filename);
@@ -28,9 +39,27 @@ void checkError(cl_int err, const char* operation) {
     }
 }
 
+// Trailing Host MB / Device MB columns of a result row; no context = host-only run
+void printFootprintColumns(size_t hostPeak, cl_context context) {
+    std::cout << std::setw(12) << toMB(hostPeak);
+    if (context) std::cout << std::setw(12) << toMB(deviceMemory[context].peak) << "\n";
+    else std::cout << std::setw(12) << "-" << "\n";
+}
+
+// Whole-run peaks, for the modes whose tables have no footprint columns
+void printPeakFootprint(const std::vector<std::string>& deviceNames, const std::vector<cl_context>& contexts) {
+    std::cout << std::fixed << std::setprecision(1) << "Peak memory footprint:\n";
+    std::cout << "  " << std::left << std::setw(40) << "Host" << std::right << std::setw(10)
+              << toMB(hostMemory.peak) << " MB\n";
+    for (size_t i = 0; i < contexts.size(); i++) {
+        std::cout << "  " << std::left << std::setw(40) << deviceNames[i] << std::right << std::setw(10)
+                  << toMB(deviceMemory[contexts[i]].peak) << " MB\n";
+    }
+}
+
 // Generate Gaussian kernel
-std::vector<float> createGaussianKernel(int size, float sigma) {
-    std::vector<float> kernel(size * size);
+HostVector<float> createGaussianKernel(int size, float sigma) {
+    HostVector<float> kernel(size * size);
     int half = size / 2;
     float sum = 0.0f;
     
@@ -48,8 +77,8 @@ std::vector<float> createGaussianKernel(int size, float sigma) {
 }
 
 // Generate 1D Gaussian kernel (for separable convolution)
-std::vector<float> createGaussianKernel1D(int size, float sigma) {
-    std::vector<float> kernel(size);
+HostVector<float> createGaussianKernel1D(int size, float sigma) {
+    HostVector<float> kernel(size);
     int half = size / 2;
     float sum = 0.0f;
     
@@ -64,9 +93,9 @@ std::vector<float> createGaussianKernel1D(int size, float sigma) {
 }
 
 // 1. Serial implementation
-double convolveSerial(const std::vector<float>& input,
-                      std::vector<float>& output,
-                      const std::vector<float>& kernel,
+double convolveSerial(const HostVector<float>& input,
+                      HostVector<float>& output,
+                      const HostVector<float>& kernel,
                       int width, int height, int ksize) {
     auto start = std::chrono::high_resolution_clock::now();
     
@@ -95,9 +124,9 @@ double convolveSerial(const std::vector<float>& input,
 }
 
 // 2. OpenMP implementation
-double convolveOpenMP(const std::vector<float>& input,
-                      std::vector<float>& output,
-                      const std::vector<float>& kernel,
+double convolveOpenMP(const HostVector<float>& input,
+                      HostVector<float>& output,
+                      const HostVector<float>& kernel,
                       int width, int height, int ksize) {
     auto start = std::chrono::high_resolution_clock::now();
     
@@ -127,9 +156,9 @@ double convolveOpenMP(const std::vector<float>& input,
 }
 
 // 3. OpenCL implementation
-double convolveOpenCL(const std::vector<float>& input,
-                      std::vector<float>& output,
-                      const std::vector<float>& kernel,
+double convolveOpenCL(const HostVector<float>& input,
+                      HostVector<float>& output,
+                      const HostVector<float>& kernel,
                       int width, int height, int ksize,
                       cl_device_id device,
                       cl_context context,
@@ -144,14 +173,14 @@ double convolveOpenCL(const std::vector<float>& input,
     size_t imageSize = width * height * sizeof(float);
     size_t kernelSize = ksize * ksize * sizeof(float);
     
-    cl_mem bufInput = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+    cl_mem bufInput = allocateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
                                       imageSize, (void*)input.data(), &err);
     checkError(err, "clCreateBuffer input");
     
-    cl_mem bufOutput = clCreateBuffer(context, CL_MEM_WRITE_ONLY, imageSize, nullptr, &err);
+    cl_mem bufOutput = allocateBuffer(context, CL_MEM_WRITE_ONLY, imageSize, nullptr, &err);
     checkError(err, "clCreateBuffer output");
     
-    cl_mem bufKernel = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+    cl_mem bufKernel = allocateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
                                        kernelSize, (void*)kernel.data(), &err);
     checkError(err, "clCreateBuffer kernel");
     
@@ -192,9 +221,9 @@ double convolveOpenCL(const std::vector<float>& input,
     
     clEnqueueReadBuffer(queue, bufOutput, CL_TRUE, 0, imageSize, output.data(), 0, nullptr, nullptr);
     
-    clReleaseMemObject(bufInput);
-    clReleaseMemObject(bufOutput);
-    clReleaseMemObject(bufKernel);
+    releaseBuffer(bufInput);
+    releaseBuffer(bufOutput);
+    releaseBuffer(bufKernel);
     clReleaseKernel(clKernel);
     clReleaseCommandQueue(queue);
     
@@ -202,9 +231,9 @@ double convolveOpenCL(const std::vector<float>& input,
 }
 
 // Separable convolution (OpenCL)
-double convolveSeparable(const std::vector<float>& input,
-                         std::vector<float>& output,
-                         const std::vector<float>& kernel1d,
+double convolveSeparable(const HostVector<float>& input,
+                         HostVector<float>& output,
+                         const HostVector<float>& kernel1d,
                          int width, int height, int ksize,
                          cl_device_id device,
                          cl_context context,
@@ -216,11 +245,11 @@ double convolveSeparable(const std::vector<float>& input,
     size_t imageSize = width * height * sizeof(float);
     size_t kernelSize = ksize * sizeof(float);
     
-    cl_mem bufInput = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+    cl_mem bufInput = allocateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
                                       imageSize, (void*)input.data(), &err);
-    cl_mem bufTemp = clCreateBuffer(context, CL_MEM_READ_WRITE, imageSize, nullptr, &err);
-    cl_mem bufOutput = clCreateBuffer(context, CL_MEM_WRITE_ONLY, imageSize, nullptr, &err);
-    cl_mem bufKernel = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+    cl_mem bufTemp = allocateBuffer(context, CL_MEM_READ_WRITE, imageSize, nullptr, &err);
+    cl_mem bufOutput = allocateBuffer(context, CL_MEM_WRITE_ONLY, imageSize, nullptr, &err);
+    cl_mem bufKernel = allocateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
                                        kernelSize, (void*)kernel1d.data(), &err);
     
     cl_kernel kernelH = clCreateKernel(program, "convolve_h", &err);
@@ -255,10 +284,10 @@ double convolveSeparable(const std::vector<float>& input,
     
     clEnqueueReadBuffer(queue, bufOutput, CL_TRUE, 0, imageSize, output.data(), 0, nullptr, nullptr);
     
-    clReleaseMemObject(bufInput);
-    clReleaseMemObject(bufTemp);
-    clReleaseMemObject(bufOutput);
-    clReleaseMemObject(bufKernel);
+    releaseBuffer(bufInput);
+    releaseBuffer(bufTemp);
+    releaseBuffer(bufOutput);
+    releaseBuffer(bufKernel);
     clReleaseKernel(kernelH);
     clReleaseKernel(kernelV);
     clReleaseCommandQueue(queue);
@@ -266,70 +295,2391 @@ double convolveSeparable(const std::vector<float>& input,
     return std::chrono::duration<double, std::milli>(end - start).count();
 }
 
-int main() {
-    std::cout << "=== Image Convolution Performance Comparison ===\n\n";
+// Box/mean filters (O(1) per pixel)
+const int BOX_SEGMENT = 64;          // pixels per work-item in the running-sum kernels
+const float SAT_ONE = 16777216.0f;   // Q40.24 fixed point, must match convolution.cl
+
+// Uniform kernel for the direct-convolution comparison
+HostVector<float> createBoxKernel(int size) {
+    return HostVector<float>(size * size, 1.0f / (size * size));
+}
+
+// Sum of the inclusive rectangle [r0,r1] x [c0,c1]
+long long satRect(const HostVector<long long>& sat, int width, int r0, int r1, int c0, int c1) {
+    long long s = sat[(size_t)r1 * width + c1];
+    if (r0 > 0) s -= sat[(size_t)(r0 - 1) * width + c1];
+    if (c0 > 0) s -= sat[(size_t)r1 * width + c0 - 1];
+    if (r0 > 0 && c0 > 0) s += sat[(size_t)(r0 - 1) * width + c0 - 1];
+    return s;
+}
+
+// CPU mirror of sat_scan_rows/sat_scan_columns + box_filter_integral
+double boxFilterIntegral(const HostVector<float>& input,
+                         HostVector<float>& output,
+                         int width, int height, int ksize) {
+    auto start = std::chrono::high_resolution_clock::now();
     
-    // Test configurations
-    std::vector<int> imageSizes = {512, 1024, 2048, 4096};
-    std::vector<int> kernelSizes = {3, 5, 7, 11, 15};
+    HostVector<long long> sat((size_t)width * height);
+    for (int y = 0; y < height; y++) {
+        long long rowSum = 0;
+        for (int x = 0; x < width; x++) {
+            size_t idx = (size_t)y * width + x;
+            rowSum += std::llrint(input[idx] * SAT_ONE);
+            sat[idx] = rowSum + (y > 0 ? sat[idx - width] : 0);
+        }
+    }
     
-    // Get OpenCL devices
-    cl_uint numPlatforms;
-    clGetPlatformIDs(0, nullptr, &numPlatforms);
-    std::vector<cl_platform_id> platforms(numPlatforms);
-    clGetPlatformIDs(numPlatforms, platforms.data(), nullptr);
+    int khalf = ksize / 2;
+    float scale = 1.0f / (SAT_ONE * ksize * ksize);
+    for (int y = 0; y < height; y++) {
+        int r0 = std::max(y - khalf, 0), r1 = std::min(y + khalf, height - 1);
+        long long top = std::max(khalf - y, 0), bottom = std::max(y + khalf - (height - 1), 0);
+        for (int x = 0; x < width; x++) {
+            int c0 = std::max(x - khalf, 0), c1 = std::min(x + khalf, width - 1);
+            long long left = std::max(khalf - x, 0), right = std::max(x + khalf - (width - 1), 0);
+            
+            long long sum = satRect(sat, width, r0, r1, c0, c1);
+            if (top)    sum += top * satRect(sat, width, 0, 0, c0, c1);
+            if (bottom) sum += bottom * satRect(sat, width, height - 1, height - 1, c0, c1);
+            if (left)   sum += left * satRect(sat, width, r0, r1, 0, 0);
+            if (right)  sum += right * satRect(sat, width, r0, r1, width - 1, width - 1);
+            if (top && left)     sum += top * left * satRect(sat, width, 0, 0, 0, 0);
+            if (top && right)    sum += top * right * satRect(sat, width, 0, 0, width - 1, width - 1);
+            if (bottom && left)  sum += bottom * left * satRect(sat, width, height - 1, height - 1, 0, 0);
+            if (bottom && right) sum += bottom * right * satRect(sat, width, height - 1, height - 1, width - 1, width - 1);
+            
+            output[(size_t)y * width + x] = (float)sum * scale;
+        }
+    }
     
-    std::vector<cl_device_id> devices;
-    std::vector<std::string> deviceNames;
-    std::vector<cl_context> contexts;
-    std::vector<cl_program> programs;
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// CPU mirror of box_h_running/box_v_running (OpenMP)
+double boxFilterRunningSum(const HostVector<float>& input,
+                           HostVector<float>& output,
+                           int width, int height, int ksize) {
+    auto start = std::chrono::high_resolution_clock::now();
     
-    std::string kernelSource = loadKernelSource("convolution.cl");
-    const char* kernelSourcePtr = kernelSource.c_str();
-    size_t kernelSourceSize = kernelSource.size();
+    int khalf = ksize / 2;
+    float scale = 1.0f / (ksize * ksize);
+    HostVector<float> temp((size_t)width * height);
     
-    for (cl_uint p = 0; p < numPlatforms; p++) {
-        cl_uint numDevices;
-        cl_int err = clGetDeviceIDs(platforms[p], CL_DEVICE_TYPE_ALL, 0, nullptr, &numDevices);
-        if (err == CL_SUCCESS && numDevices > 0) {
-            std::vector<cl_device_id> platformDevices(numDevices);
-            clGetDeviceIDs(platforms[p], CL_DEVICE_TYPE_ALL, numDevices, platformDevices.data(), nullptr);
+    #pragma omp parallel for
+    for (int y = 0; y < height; y++) {
+        const float* row = &input[(size_t)y * width];
+        float sum = 0.0f;
+        for (int k = -khalf; k <= khalf; k++) sum += row[std::max(0, std::min(k, width - 1))];
+        for (int x = 0; x < width; x++) {
+            temp[(size_t)y * width + x] = sum;
+            sum += row[std::min(x + khalf + 1, width - 1)] - row[std::max(x - khalf, 0)];
+        }
+    }
+    
+    // Vertical pass slides whole row segments so each thread streams memory in order
+    const int COLUMN_BLOCK = 256;
+    #pragma omp parallel for
+    for (int bx = 0; bx < width; bx += COLUMN_BLOCK) {
+        int bw = std::min(COLUMN_BLOCK, width - bx);
+        HostVector<float> acc(bw, 0.0f);
+        for (int k = -khalf; k <= khalf; k++) {
+            const float* row = &temp[(size_t)std::max(0, std::min(k, height - 1)) * width + bx];
+            for (int i = 0; i < bw; i++) acc[i] += row[i];
+        }
+        for (int y = 0; y < height; y++) {
+            const float* add = &temp[(size_t)std::min(y + khalf + 1, height - 1) * width + bx];
+            const float* sub = &temp[(size_t)std::max(y - khalf, 0) * width + bx];
+            float* out = &output[(size_t)y * width + bx];
+            for (int i = 0; i < bw; i++) {
+                out[i] = acc[i] * scale;
+                acc[i] += add[i] - sub[i];
+            }
+        }
+    }
+    
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// Integral-image box filter (OpenCL): row scan + column scan + O(1) query
+double boxFilterIntegralOpenCL(const HostVector<float>& input,
+                               HostVector<float>& output,
+                               int width, int height, int ksize,
+                               cl_device_id device,
+                               cl_context context,
+                               cl_program program) {
+    cl_int err;
+    
+    cl_command_queue queue = clCreateCommandQueueWithProperties(context, device, nullptr, &err);
+    checkError(err, "clCreateCommandQueue");
+    
+    size_t imageSize = (size_t)width * height * sizeof(float);
+    size_t satSize = (size_t)width * height * sizeof(cl_long);
+    
+    cl_mem bufInput = allocateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                      imageSize, (void*)input.data(), &err);
+    checkError(err, "clCreateBuffer input");
+    cl_mem bufSat = allocateBuffer(context, CL_MEM_READ_WRITE, satSize, nullptr, &err);
+    checkError(err, "clCreateBuffer sat");
+    cl_mem bufOutput = allocateBuffer(context, CL_MEM_WRITE_ONLY, imageSize, nullptr, &err);
+    checkError(err, "clCreateBuffer output");
+    
+    cl_kernel kernelRows = clCreateKernel(program, "sat_scan_rows", &err);
+    checkError(err, "clCreateKernel sat_scan_rows");
+    cl_kernel kernelCols = clCreateKernel(program, "sat_scan_columns", &err);
+    checkError(err, "clCreateKernel sat_scan_columns");
+    cl_kernel kernelQuery = clCreateKernel(program, "box_filter_integral", &err);
+    checkError(err, "clCreateKernel box_filter_integral");
+    
+    size_t scanLocal = 256;
+    size_t maxGroup = 0;
+    clGetKernelWorkGroupInfo(kernelRows, device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(maxGroup), &maxGroup, nullptr);
+    while (scanLocal > maxGroup && scanLocal > 1) scanLocal /= 2;
+    
+    clSetKernelArg(kernelRows, 0, sizeof(cl_mem), &bufInput);
+    clSetKernelArg(kernelRows, 1, sizeof(cl_mem), &bufSat);
+    clSetKernelArg(kernelRows, 2, sizeof(int), &width);
+    clSetKernelArg(kernelRows, 3, sizeof(int), &height);
+    clSetKernelArg(kernelRows, 4, scanLocal * sizeof(cl_long), nullptr);
+    
+    clSetKernelArg(kernelCols, 0, sizeof(cl_mem), &bufSat);
+    clSetKernelArg(kernelCols, 1, sizeof(int), &width);
+    clSetKernelArg(kernelCols, 2, sizeof(int), &height);
+    
+    clSetKernelArg(kernelQuery, 0, sizeof(cl_mem), &bufSat);
+    clSetKernelArg(kernelQuery, 1, sizeof(cl_mem), &bufOutput);
+    clSetKernelArg(kernelQuery, 2, sizeof(int), &width);
+    clSetKernelArg(kernelQuery, 3, sizeof(int), &height);
+    clSetKernelArg(kernelQuery, 4, sizeof(int), &ksize);
+    
+    size_t rowsGlobal = (size_t)height * scanLocal;
+    size_t colsGlobal = (size_t)width;
+    size_t queryGlobal[2] = {(size_t)width, (size_t)height};
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    clEnqueueNDRangeKernel(queue, kernelRows, 1, nullptr, &rowsGlobal, &scanLocal, 0, nullptr, nullptr);
+    clEnqueueNDRangeKernel(queue, kernelCols, 1, nullptr, &colsGlobal, nullptr, 0, nullptr, nullptr);
+    err = clEnqueueNDRangeKernel(queue, kernelQuery, 2, nullptr, queryGlobal, nullptr, 0, nullptr, nullptr);
+    checkError(err, "clEnqueueNDRangeKernel");
+    
+    clFinish(queue);
+    
+    auto end = std::chrono::high_resolution_clock::now();
+    
+    clEnqueueReadBuffer(queue, bufOutput, CL_TRUE, 0, imageSize, output.data(), 0, nullptr, nullptr);
+    
+    releaseBuffer(bufInput);
+    releaseBuffer(bufSat);
+    releaseBuffer(bufOutput);
+    clReleaseKernel(kernelRows);
+    clReleaseKernel(kernelCols);
+    clReleaseKernel(kernelQuery);
+    clReleaseCommandQueue(queue);
+    
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// Running-sum separable box filter (OpenCL)
+double boxFilterRunningSumOpenCL(const HostVector<float>& input,
+                                 HostVector<float>& output,
+                                 int width, int height, int ksize,
+                                 cl_device_id device,
+                                 cl_context context,
+                                 cl_program program) {
+    cl_int err;
+    
+    cl_command_queue queue = clCreateCommandQueueWithProperties(context, device, nullptr, &err);
+    checkError(err, "clCreateCommandQueue");
+    
+    size_t imageSize = (size_t)width * height * sizeof(float);
+    
+    cl_mem bufInput = allocateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                      imageSize, (void*)input.data(), &err);
+    checkError(err, "clCreateBuffer input");
+    cl_mem bufTemp = allocateBuffer(context, CL_MEM_READ_WRITE, imageSize, nullptr, &err);
+    checkError(err, "clCreateBuffer temp");
+    cl_mem bufOutput = allocateBuffer(context, CL_MEM_WRITE_ONLY, imageSize, nullptr, &err);
+    checkError(err, "clCreateBuffer output");
+    
+    cl_kernel kernelH = clCreateKernel(program, "box_h_running", &err);
+    checkError(err, "clCreateKernel box_h_running");
+    cl_kernel kernelV = clCreateKernel(program, "box_v_running", &err);
+    checkError(err, "clCreateKernel box_v_running");
+    
+    int segment = BOX_SEGMENT;
+    clSetKernelArg(kernelH, 0, sizeof(cl_mem), &bufInput);
+    clSetKernelArg(kernelH, 1, sizeof(cl_mem), &bufTemp);
+    clSetKernelArg(kernelH, 2, sizeof(int), &width);
+    clSetKernelArg(kernelH, 3, sizeof(int), &height);
+    clSetKernelArg(kernelH, 4, sizeof(int), &ksize);
+    clSetKernelArg(kernelH, 5, sizeof(int), &segment);
+    
+    clSetKernelArg(kernelV, 0, sizeof(cl_mem), &bufTemp);
+    clSetKernelArg(kernelV, 1, sizeof(cl_mem), &bufOutput);
+    clSetKernelArg(kernelV, 2, sizeof(int), &width);
+    clSetKernelArg(kernelV, 3, sizeof(int), &height);
+    clSetKernelArg(kernelV, 4, sizeof(int), &ksize);
+    clSetKernelArg(kernelV, 5, sizeof(int), &segment);
+    
+    size_t globalH[2] = {(size_t)((width + segment - 1) / segment), (size_t)height};
+    size_t globalV[2] = {(size_t)width, (size_t)((height + segment - 1) / segment)};
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    clEnqueueNDRangeKernel(queue, kernelH, 2, nullptr, globalH, nullptr, 0, nullptr, nullptr);
+    err = clEnqueueNDRangeKernel(queue, kernelV, 2, nullptr, globalV, nullptr, 0, nullptr, nullptr);
+    checkError(err, "clEnqueueNDRangeKernel");
+    
+    clFinish(queue);
+    
+    auto end = std::chrono::high_resolution_clock::now();
+    
+    clEnqueueReadBuffer(queue, bufOutput, CL_TRUE, 0, imageSize, output.data(), 0, nullptr, nullptr);
+    
+    releaseBuffer(bufInput);
+    releaseBuffer(bufTemp);
+    releaseBuffer(bufOutput);
+    clReleaseKernel(kernelH);
+    clReleaseKernel(kernelV);
+    clReleaseCommandQueue(queue);
+    
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+float maxAbsDiff(const HostVector<float>& a, const HostVector<float>& b) {
+    float diff = 0.0f;
+    for (size_t i = 0; i < a.size(); i++) diff = std::max(diff, std::abs(a[i] - b[i]));
+    return diff;
+}
+
+void printBoxRow(const std::string& name, double timeMs, int width, int height, float error) {
+    std::cout << std::left << std::setw(40) << name
+              << std::right << std::setw(12) << timeMs
+              << std::setw(12) << ((double)width * height / (timeMs * 1e3))
+              << std::setw(12) << std::scientific << std::setprecision(1) << error
+              << std::fixed << std::setprecision(2) << "\n";
+}
+
+void runBoxFilterSweep(const std::vector<cl_device_id>& devices,
+                       const std::vector<std::string>& deviceNames,
+                       const std::vector<cl_context>& contexts,
+                       const std::vector<cl_program>& programs) {
+    std::vector<int> imageSizes = {1024, 2048, 4096};
+    std::vector<int> kernelSizes = {3, 15, 31, 63};
+    const double DIRECT_SERIAL_LIMIT = 2e9;   // skip the k^2 serial loop beyond this many MACs
+    
+    for (int imgSize : imageSizes) {
+        for (int ksize : kernelSizes) {
+            int width = imgSize;
+            int height = imgSize;
             
-            for (cl_uint d = 0; d < numDevices; d++) {
-                devices.push_back(platformDevices[d]);
-                
-                char name[128];
-                clGetDeviceInfo(platformDevices[d], CL_DEVICE_NAME, sizeof(name), name, nullptr);
-                deviceNames.push_back(std::string(name));
-                
-                cl_context context = clCreateContext(nullptr, 1, &platformDevices[d], nullptr, nullptr, &err);
-                contexts.push_back(context);
+            std::cout << "========================================\n";
+            std::cout << "Box filter: " << width << "x" << height << ", Kernel: " << ksize << "x" << ksize << "\n";
+            std::cout << "Direct ops/pixel: " << (ksize * ksize) << ", integral/running-sum: O(1)\n";
+            std::cout << "========================================\n";
+            
+            HostVector<float> input((size_t)width * height);
+            for (size_t i = 0; i < input.size(); i++) {
+                input[i] = static_cast<float>(i % 256) / 255.0f;
+            }
+            HostVector<float> output(input.size());
+            HostVector<float> boxKernel = createBoxKernel(ksize);
+            
+            // The integral-image result is exact up to the final float conversion: use it as reference
+            HostVector<float> reference(input.size());
+            double integralTime = boxFilterIntegral(input, reference, width, height, ksize);
+            
+            std::cout << "\n" << std::fixed << std::setprecision(2);
+            std::cout << std::left << std::setw(40) << "Implementation"
+                      << std::right << std::setw(12) << "Time (ms)"
+                      << std::setw(12) << "Mpixel/s"
+                      << std::setw(12) << "Max error\n";
+            std::cout << std::string(76, '-') << "\n";
+            
+            if ((double)width * height * ksize * ksize <= DIRECT_SERIAL_LIMIT) {
+                double directTime = convolveSerial(input, output, boxKernel, width, height, ksize);
+                printBoxRow("Serial C++ (direct k^2)", directTime, width, height, maxAbsDiff(reference, output));
+            } else {
+                std::cout << std::left << std::setw(40) << "Serial C++ (direct k^2)"
+                          << std::right << std::setw(12) << "skipped" << "\n";
+            }
+            printBoxRow("Serial C++ (integral image)", integralTime, width, height, 0.0f);
+            
+            double runningTime = boxFilterRunningSum(input, output, width, height, ksize);
+            printBoxRow("OpenMP (running sum)", runningTime, width, height, maxAbsDiff(reference, output));
+            
+            for (size_t i = 0; i < devices.size(); i++) {
+                std::fill(output.begin(), output.end(), 0.0f);
+                double directTime = convolveOpenCL(input, output, boxKernel, width, height, ksize,
+                                                    devices[i], contexts[i], programs[i],
+                                                    "convolve_2d_local", true);
+                printBoxRow("OpenCL: " + deviceNames[i].substr(0, 20) + " (direct)",
+                            directTime, width, height, maxAbsDiff(reference, output));
                 
-                cl_program program = clCreateProgramWithSource(context, 1, &kernelSourcePtr, &kernelSourceSize, &err);
-                err = clBuildProgram(program, 1, &platformDevices[d], nullptr, nullptr, nullptr);
+                std::fill(output.begin(), output.end(), 0.0f);
+                double satTime = boxFilterIntegralOpenCL(input, output, width, height, ksize,
+                                                          devices[i], contexts[i], programs[i]);
+                printBoxRow("OpenCL: " + deviceNames[i].substr(0, 18) + " (integral)",
+                            satTime, width, height, maxAbsDiff(reference, output));
                 
-                // CHECK BUILD STATUS
-                if (err != CL_SUCCESS) {
-                    size_t logSize;
-                    clGetProgramBuildInfo(program, platformDevices[d], CL_PROGRAM_BUILD_LOG, 0, nullptr, &logSize);
-                    std::vector<char> log(logSize);
-                    clGetProgramBuildInfo(program, platformDevices[d], CL_PROGRAM_BUILD_LOG, logSize, log.data(), nullptr);
-                    std::cerr << "Build error for " << name << ":\n" << log.data() << "\n";
-                    std::cerr << "Skipping this device.\n\n";
-                    clReleaseContext(context);
-                    contexts.pop_back();
-                    devices.pop_back();
-                    deviceNames.pop_back();
-                    continue;
+                std::fill(output.begin(), output.end(), 0.0f);
+                double runTime = boxFilterRunningSumOpenCL(input, output, width, height, ksize,
+                                                            devices[i], contexts[i], programs[i]);
+                printBoxRow("OpenCL: " + deviceNames[i].substr(0, 16) + " (running sum)",
+                            runTime, width, height, maxAbsDiff(reference, output));
+            }
+            
+            std::cout << "\n";
+        }
+    }
+}
+
+// Winograd F(2x2,3x3) / F(4x4,3x3) (OpenCL). m is the output tile size (2 or 4);
+// the staged path runs filter/input transforms, the batched elementwise product
+// and the output transform as separate kernels, the fused path one kernel per tile.
+double convolveWinograd(const HostVector<float>& input,
+                        HostVector<float>& output,
+                        const HostVector<float>& kernel3x3,
+                        int width, int height, int m, bool fused,
+                        cl_device_id device,
+                        cl_context context,
+                        cl_program program) {
+    cl_int err;
+    
+    cl_command_queue queue = clCreateCommandQueueWithProperties(context, device, nullptr, &err);
+    checkError(err, "clCreateCommandQueue");
+    
+    std::string prefix = (m == 2) ? "winograd_f2_" : "winograd_f4_";
+    int tilesX = (width + m - 1) / m;
+    int tilesY = (height + m - 1) / m;
+    int numTiles = tilesX * tilesY;
+    int elements = (m + 2) * (m + 2);
+    size_t imageSize = (size_t)width * height * sizeof(float);
+    size_t transformedSize = (size_t)elements * numTiles * sizeof(float);
+    
+    cl_mem bufInput = allocateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                      imageSize, (void*)input.data(), &err);
+    checkError(err, "clCreateBuffer input");
+    cl_mem bufOutput = allocateBuffer(context, CL_MEM_WRITE_ONLY, imageSize, nullptr, &err);
+    checkError(err, "clCreateBuffer output");
+    cl_mem bufFilter = allocateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                       9 * sizeof(float), (void*)kernel3x3.data(), &err);
+    checkError(err, "clCreateBuffer filter");
+    cl_mem bufU = allocateBuffer(context, CL_MEM_READ_WRITE, elements * sizeof(float), nullptr, &err);
+    checkError(err, "clCreateBuffer U");
+    cl_mem bufV = nullptr;
+    cl_mem bufM = nullptr;
+    if (!fused) {
+        bufV = allocateBuffer(context, CL_MEM_READ_WRITE, transformedSize, nullptr, &err);
+        checkError(err, "clCreateBuffer V");
+        bufM = allocateBuffer(context, CL_MEM_READ_WRITE, transformedSize, nullptr, &err);
+        checkError(err, "clCreateBuffer M");
+    }
+    
+    cl_kernel kernelFilter = clCreateKernel(program, (prefix + "filter").c_str(), &err);
+    checkError(err, "clCreateKernel winograd filter");
+    clSetKernelArg(kernelFilter, 0, sizeof(cl_mem), &bufFilter);
+    clSetKernelArg(kernelFilter, 1, sizeof(cl_mem), &bufU);
+    
+    cl_kernel kernelInput = nullptr, kernelMultiply = nullptr, kernelOutput = nullptr, kernelFused = nullptr;
+    if (fused) {
+        kernelFused = clCreateKernel(program, (prefix + "fused").c_str(), &err);
+        checkError(err, "clCreateKernel winograd fused");
+        clSetKernelArg(kernelFused, 0, sizeof(cl_mem), &bufInput);
+        clSetKernelArg(kernelFused, 1, sizeof(cl_mem), &bufOutput);
+        clSetKernelArg(kernelFused, 2, sizeof(cl_mem), &bufU);
+        clSetKernelArg(kernelFused, 3, sizeof(int), &width);
+        clSetKernelArg(kernelFused, 4, sizeof(int), &height);
+        clSetKernelArg(kernelFused, 5, sizeof(int), &tilesX);
+        clSetKernelArg(kernelFused, 6, sizeof(int), &tilesY);
+    } else {
+        kernelInput = clCreateKernel(program, (prefix + "input").c_str(), &err);
+        checkError(err, "clCreateKernel winograd input");
+        kernelMultiply = clCreateKernel(program, "winograd_multiply", &err);
+        checkError(err, "clCreateKernel winograd_multiply");
+        kernelOutput = clCreateKernel(program, (prefix + "output").c_str(), &err);
+        checkError(err, "clCreateKernel winograd output");
+        
+        clSetKernelArg(kernelInput, 0, sizeof(cl_mem), &bufInput);
+        clSetKernelArg(kernelInput, 1, sizeof(cl_mem), &bufV);
+        clSetKernelArg(kernelInput, 2, sizeof(int), &width);
+        clSetKernelArg(kernelInput, 3, sizeof(int), &height);
+        clSetKernelArg(kernelInput, 4, sizeof(int), &tilesX);
+        clSetKernelArg(kernelInput, 5, sizeof(int), &tilesY);
+        
+        clSetKernelArg(kernelMultiply, 0, sizeof(cl_mem), &bufU);
+        clSetKernelArg(kernelMultiply, 1, sizeof(cl_mem), &bufV);
+        clSetKernelArg(kernelMultiply, 2, sizeof(cl_mem), &bufM);
+        clSetKernelArg(kernelMultiply, 3, sizeof(int), &numTiles);
+        clSetKernelArg(kernelMultiply, 4, sizeof(int), &elements);
+        
+        clSetKernelArg(kernelOutput, 0, sizeof(cl_mem), &bufM);
+        clSetKernelArg(kernelOutput, 1, sizeof(cl_mem), &bufOutput);
+        clSetKernelArg(kernelOutput, 2, sizeof(int), &width);
+        clSetKernelArg(kernelOutput, 3, sizeof(int), &height);
+        clSetKernelArg(kernelOutput, 4, sizeof(int), &tilesX);
+        clSetKernelArg(kernelOutput, 5, sizeof(int), &tilesY);
+    }
+    
+    size_t one = 1;
+    size_t tileGlobal[2] = {(size_t)tilesX, (size_t)tilesY};
+    size_t multiplyGlobal[2] = {(size_t)numTiles, (size_t)elements};
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    clEnqueueNDRangeKernel(queue, kernelFilter, 1, nullptr, &one, nullptr, 0, nullptr, nullptr);
+    if (fused) {
+        err = clEnqueueNDRangeKernel(queue, kernelFused, 2, nullptr, tileGlobal, nullptr, 0, nullptr, nullptr);
+    } else {
+        clEnqueueNDRangeKernel(queue, kernelInput, 2, nullptr, tileGlobal, nullptr, 0, nullptr, nullptr);
+        clEnqueueNDRangeKernel(queue, kernelMultiply, 2, nullptr, multiplyGlobal, nullptr, 0, nullptr, nullptr);
+        err = clEnqueueNDRangeKernel(queue, kernelOutput, 2, nullptr, tileGlobal, nullptr, 0, nullptr, nullptr);
+    }
+    checkError(err, "clEnqueueNDRangeKernel");
+    
+    clFinish(queue);
+    
+    auto end = std::chrono::high_resolution_clock::now();
+    
+    clEnqueueReadBuffer(queue, bufOutput, CL_TRUE, 0, imageSize, output.data(), 0, nullptr, nullptr);
+    
+    releaseBuffer(bufInput);
+    releaseBuffer(bufOutput);
+    releaseBuffer(bufFilter);
+    releaseBuffer(bufU);
+    if (bufV) releaseBuffer(bufV);
+    if (bufM) releaseBuffer(bufM);
+    clReleaseKernel(kernelFilter);
+    if (kernelInput) clReleaseKernel(kernelInput);
+    if (kernelMultiply) clReleaseKernel(kernelMultiply);
+    if (kernelOutput) clReleaseKernel(kernelOutput);
+    if (kernelFused) clReleaseKernel(kernelFused);
+    clReleaseCommandQueue(queue);
+    
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void printWinogradRow(const std::string& name, double timeMs, double gflop, double mults, float error) {
+    std::cout << std::left << std::setw(40) << name
+              << std::right << std::setw(12) << timeMs
+              << std::setw(12) << (gflop / (timeMs / 1000.0))
+              << std::setw(10) << mults
+              << std::setw(12) << std::scientific << std::setprecision(1) << error
+              << std::fixed << std::setprecision(2) << "\n";
+}
+
+void runWinogradSweep(const std::vector<cl_device_id>& devices,
+                      const std::vector<std::string>& deviceNames,
+                      const std::vector<cl_context>& contexts,
+                      const std::vector<cl_program>& programs) {
+    std::vector<int> imageSizes = {512, 1024, 2048, 4096};
+    const int ksize = 3;
+    
+    for (int imgSize : imageSizes) {
+        int width = imgSize;
+        int height = imgSize;
+        // Effective GFLOPS count the direct algorithm's 2*9 flops per output pixel
+        double gflop = 2.0 * ksize * ksize * width * height / 1e9;
+        
+        std::cout << "========================================\n";
+        std::cout << "Image: " << width << "x" << height << ", Kernel: 3x3 (Winograd)\n";
+        std::cout << "========================================\n";
+        
+        HostVector<float> input((size_t)width * height);
+        for (size_t i = 0; i < input.size(); i++) {
+            input[i] = static_cast<float>(i % 256) / 255.0f;
+        }
+        HostVector<float> output(input.size());
+        HostVector<float> kernel2d = createGaussianKernel(ksize, ksize / 6.0f);
+        
+        double serialTime = convolveSerial(input, output, kernel2d, width, height, ksize);
+        HostVector<float> expectedResult = output;
+        
+        std::cout << "\n" << std::fixed << std::setprecision(2);
+        std::cout << std::left << std::setw(40) << "Implementation"
+                  << std::right << std::setw(12) << "Time (ms)"
+                  << std::setw(12) << "Eff. GFLOPS"
+                  << std::setw(10) << "Mul/px"
+                  << std::setw(12) << "Max error\n";
+        std::cout << std::string(86, '-') << "\n";
+        printWinogradRow("Serial C++", serialTime, gflop, 9.0, 0.0f);
+        
+        for (size_t i = 0; i < devices.size(); i++) {
+            std::fill(output.begin(), output.end(), 0.0f);
+            double directTime = convolveOpenCL(input, output, kernel2d, width, height, ksize,
+                                                devices[i], contexts[i], programs[i],
+                                                "convolve_2d_local", true);
+            printWinogradRow("OpenCL: " + deviceNames[i].substr(0, 22) + " (local)",
+                             directTime, gflop, 9.0, maxAbsDiff(expectedResult, output));
+            
+            for (int m : {2, 4}) {
+                double mults = (m + 2) * (m + 2) / (double)(m * m);
+                for (bool fused : {false, true}) {
+                    std::fill(output.begin(), output.end(), 0.0f);
+                    double winoTime = convolveWinograd(input, output, kernel2d, width, height, m, fused,
+                                                       devices[i], contexts[i], programs[i]);
+                    std::string label = "OpenCL: " + deviceNames[i].substr(0, 14) + " F(" + std::to_string(m) + "x"
+                                      + std::to_string(m) + ",3x3)" + (fused ? " fused" : " staged");
+                    printWinogradRow(label, winoTime, gflop, mults, maxAbsDiff(expectedResult, output));
                 }
-                
-                programs.push_back(program);
             }
         }
+        
+        std::cout << "\n";
+    }
+}
+
+// Multi-device row-split convolution with halo exchange
+struct RowSlab {
+    int device;                 // index into devices/contexts/programs
+    int rowStart, rowCount;     // rows owned by this device
+    int haloTop, haloBottom;    // extra rows held above/below (ksize/2 at internal boundaries)
+    cl_command_queue queue;
+    cl_mem bufCur, bufNext, bufTemp, bufKernel;
+    cl_kernel kernelH, kernelV;
+    HostVector<float> sendTop, sendBottom;   // owned boundary rows staged for neighbours
+};
+
+// Runs `passes` separable passes with the image split by rows across `slabs`.
+// Between passes each device's boundary rows are copied (via the host, since the
+// devices live in separate contexts) into the neighbours' halo rows.
+double convolveRowSplit(const HostVector<float>& input,
+                        HostVector<float>& output,
+                        const HostVector<float>& kernel1d,
+                        int width, int height, int ksize, int passes,
+                        std::vector<RowSlab>& slabs,
+                        const std::vector<cl_device_id>& devices,
+                        const std::vector<cl_context>& contexts,
+                        const std::vector<cl_program>& programs,
+                        double* exchangeMs) {
+    cl_int err;
+    int khalf = ksize / 2;
+    size_t rowBytes = (size_t)width * sizeof(float);
+    size_t haloBytes = (size_t)khalf * rowBytes;
+    
+    // The slabs must tile the image top to bottom with no gaps or overlaps
+    int coveredRows = 0;
+    for (const RowSlab& slab : slabs) {
+        if (slab.rowStart != coveredRows || slab.rowCount <= 0) break;
+        coveredRows += slab.rowCount;
+    }
+    if (coveredRows != height) {
+        std::cerr << "Row split covers " << coveredRows << " of " << height << " rows\n";
+        exit(1);
     }
     
-    std::cout << "OpenMP threads: " << omp_get_max_threads() << "\n";
-    std::cout << "OpenCL devices: " << devices.size() << "\n\n";
+    for (size_t s = 0; s < slabs.size(); s++) {
+        RowSlab& slab = slabs[s];
+        cl_context context = contexts[slab.device];
+        slab.haloTop = (s > 0) ? khalf : 0;
+        slab.haloBottom = (s + 1 < slabs.size()) ? khalf : 0;
+        size_t slabBytes = (size_t)(slab.haloTop + slab.rowCount + slab.haloBottom) * rowBytes;
+        
+        slab.queue = clCreateCommandQueueWithProperties(context, devices[slab.device], nullptr, &err);
+        checkError(err, "clCreateCommandQueue");
+        slab.bufCur = allocateBuffer(context, CL_MEM_READ_WRITE, slabBytes, nullptr, &err);
+        checkError(err, "clCreateBuffer slab");
+        slab.bufNext = allocateBuffer(context, CL_MEM_READ_WRITE, slabBytes, nullptr, &err);
+        checkError(err, "clCreateBuffer slab");
+        slab.bufTemp = allocateBuffer(context, CL_MEM_READ_WRITE, slabBytes, nullptr, &err);
+        checkError(err, "clCreateBuffer slab temp");
+        slab.bufKernel = allocateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                        ksize * sizeof(float), (void*)kernel1d.data(), &err);
+        checkError(err, "clCreateBuffer kernel");
+        slab.kernelH = clCreateKernel(programs[slab.device], "convolve_h", &err);
+        checkError(err, "clCreateKernel convolve_h");
+        slab.kernelV = clCreateKernel(programs[slab.device], "convolve_v", &err);
+        checkError(err, "clCreateKernel convolve_v");
+        slab.sendTop.resize((size_t)khalf * width);
+        slab.sendBottom.resize((size_t)khalf * width);
+    }
+    
+    *exchangeMs = 0.0;
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    // Scatter: each device receives its rows plus halo rows
+    for (RowSlab& slab : slabs) {
+        int firstRow = slab.rowStart - slab.haloTop;
+        int localRows = slab.haloTop + slab.rowCount + slab.haloBottom;
+        clEnqueueWriteBuffer(slab.queue, slab.bufCur, CL_FALSE, 0, (size_t)localRows * rowBytes,
+                             &input[(size_t)firstRow * width], 0, nullptr, nullptr);
+        clFlush(slab.queue);
+    }
+    
+    for (int p = 0; p < passes; p++) {
+        for (RowSlab& slab : slabs) {
+            // The slab is a standalone image to the kernels: clamping at its top/bottom
+            // only affects halo rows, which are refreshed before the next pass
+            int localRows = slab.haloTop + slab.rowCount + slab.haloBottom;
+            size_t globalSize[2] = {(size_t)width, (size_t)localRows};
+            
+            clSetKernelArg(slab.kernelH, 0, sizeof(cl_mem), &slab.bufCur);
+            clSetKernelArg(slab.kernelH, 1, sizeof(cl_mem), &slab.bufTemp);
+            clSetKernelArg(slab.kernelH, 2, sizeof(cl_mem), &slab.bufKernel);
+            clSetKernelArg(slab.kernelH, 3, sizeof(int), &width);
+            clSetKernelArg(slab.kernelH, 4, sizeof(int), &localRows);
+            clSetKernelArg(slab.kernelH, 5, sizeof(int), &ksize);
+            
+            clSetKernelArg(slab.kernelV, 0, sizeof(cl_mem), &slab.bufTemp);
+            clSetKernelArg(slab.kernelV, 1, sizeof(cl_mem), &slab.bufNext);
+            clSetKernelArg(slab.kernelV, 2, sizeof(cl_mem), &slab.bufKernel);
+            clSetKernelArg(slab.kernelV, 3, sizeof(int), &width);
+            clSetKernelArg(slab.kernelV, 4, sizeof(int), &localRows);
+            clSetKernelArg(slab.kernelV, 5, sizeof(int), &ksize);
+            
+            clEnqueueNDRangeKernel(slab.queue, slab.kernelH, 2, nullptr, globalSize, nullptr, 0, nullptr, nullptr);
+            err = clEnqueueNDRangeKernel(slab.queue, slab.kernelV, 2, nullptr, globalSize, nullptr, 0, nullptr, nullptr);
+            checkError(err, "clEnqueueNDRangeKernel");
+            clFlush(slab.queue);
+            std::swap(slab.bufCur, slab.bufNext);
+        }
+        
+        if (p + 1 == passes || slabs.size() < 2 || khalf == 0) continue;
+        
+        // Halo exchange. Everything is drained first so the staging vectors are no
+        // longer referenced by the previous exchange's non-blocking writes.
+        for (RowSlab& slab : slabs) clFinish(slab.queue);
+        auto exchangeStart = std::chrono::high_resolution_clock::now();
+        
+        for (size_t s = 0; s < slabs.size(); s++) {
+            RowSlab& slab = slabs[s];
+            if (s > 0) {
+                clEnqueueReadBuffer(slab.queue, slab.bufCur, CL_FALSE, (size_t)slab.haloTop * rowBytes,
+                                    haloBytes, slab.sendTop.data(), 0, nullptr, nullptr);
+            }
+            if (s + 1 < slabs.size()) {
+                clEnqueueReadBuffer(slab.queue, slab.bufCur, CL_FALSE,
+                                    (size_t)(slab.haloTop + slab.rowCount - khalf) * rowBytes,
+                                    haloBytes, slab.sendBottom.data(), 0, nullptr, nullptr);
+            }
+            clFlush(slab.queue);
+        }
+        for (RowSlab& slab : slabs) clFinish(slab.queue);
+        
+        for (size_t s = 0; s < slabs.size(); s++) {
+            RowSlab& slab = slabs[s];
+            if (s > 0) {
+                clEnqueueWriteBuffer(slab.queue, slab.bufCur, CL_FALSE, 0, haloBytes,
+                                     slabs[s - 1].sendBottom.data(), 0, nullptr, nullptr);
+            }
+            if (s + 1 < slabs.size()) {
+                clEnqueueWriteBuffer(slab.queue, slab.bufCur, CL_FALSE,
+                                     (size_t)(slab.haloTop + slab.rowCount) * rowBytes, haloBytes,
+                                     slabs[s + 1].sendTop.data(), 0, nullptr, nullptr);
+            }
+            clFlush(slab.queue);
+        }
+        
+        auto exchangeEnd = std::chrono::high_resolution_clock::now();
+        *exchangeMs += std::chrono::duration<double, std::milli>(exchangeEnd - exchangeStart).count();
+    }
+    
+    // Gather owned rows into one host buffer
+    for (RowSlab& slab : slabs) {
+        clEnqueueReadBuffer(slab.queue, slab.bufCur, CL_FALSE, (size_t)slab.haloTop * rowBytes,
+                            (size_t)slab.rowCount * rowBytes, &output[(size_t)slab.rowStart * width],
+                            0, nullptr, nullptr);
+        clFlush(slab.queue);
+    }
+    for (RowSlab& slab : slabs) clFinish(slab.queue);
+    
+    auto end = std::chrono::high_resolution_clock::now();
+    
+    for (RowSlab& slab : slabs) {
+        releaseBuffer(slab.bufCur);
+        releaseBuffer(slab.bufNext);
+        releaseBuffer(slab.bufTemp);
+        releaseBuffer(slab.bufKernel);
+        clReleaseKernel(slab.kernelH);
+        clReleaseKernel(slab.kernelV);
+        clReleaseCommandQueue(slab.queue);
+    }
+    
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void runMultiDevice(int imgSize, int ksize,
+                    const std::vector<cl_device_id>& devices,
+                    const std::vector<std::string>& deviceNames,
+                    const std::vector<cl_context>& contexts,
+                    const std::vector<cl_program>& programs) {
+    std::vector<int> passCounts = {1, 4};
+    int width = imgSize;
+    int height = imgSize;
+    int khalf = ksize / 2;
+    
+    HostVector<float> input((size_t)width * height);
+    for (size_t i = 0; i < input.size(); i++) {
+        input[i] = static_cast<float>(i % 256) / 255.0f;
+    }
+    HostVector<float> kernel1d = createGaussianKernel1D(ksize, ksize / 6.0f);
+    
+    for (int passes : passCounts) {
+        std::cout << "========================================\n";
+        std::cout << "Image: " << width << "x" << height << ", separable " << ksize << "x" << ksize
+                  << ", " << passes << " pass(es)\n";
+        std::cout << "========================================\n";
+        
+        std::cout << "\n" << std::fixed << std::setprecision(2);
+        std::cout << std::left << std::setw(40) << "Configuration"
+                  << std::right << std::setw(10) << "Rows"
+                  << std::setw(12) << "Time (ms)"
+                  << std::setw(12) << "Exchange\n";
+        std::cout << std::string(74, '-') << "\n";
+        
+        // Single-device baselines (end-to-end: upload, passes, readback)
+        std::vector<double> singleTimes(devices.size());
+        HostVector<float> bestOutput;
+        size_t best = 0;
+        for (size_t d = 0; d < devices.size(); d++) {
+            HostVector<float> output(input.size());
+            std::vector<RowSlab> slabs(1);
+            slabs[0].device = (int)d;
+            slabs[0].rowStart = 0;
+            slabs[0].rowCount = height;
+            double exchangeMs;
+            singleTimes[d] = convolveRowSplit(input, output, kernel1d, width, height, ksize, passes,
+                                              slabs, devices, contexts, programs, &exchangeMs);
+            if (singleTimes[d] < singleTimes[best] || d == 0) {
+                best = d;
+                bestOutput = output;
+            }
+            
+            std::cout << std::left << std::setw(40) << ("Single: " + deviceNames[d].substr(0, 30))
+                      << std::right << std::setw(10) << height
+                      << std::setw(12) << singleTimes[d]
+                      << std::setw(12) << "-" << "\n";
+        }
+        
+        // Split rows in proportion to single-device throughput; every slab must be
+        // at least ksize/2 rows so one neighbour can supply a whole halo
+        double totalRate = 0.0;
+        for (double t : singleTimes) totalRate += 1.0 / t;
+        
+        std::vector<RowSlab> slabs;
+        int nextRow = 0;
+        for (size_t d = 0; d < devices.size(); d++) {
+            int rows = (d + 1 == devices.size())
+                       ? height - nextRow
+                       : (int)std::lround(height * (1.0 / singleTimes[d]) / totalRate);
+            rows = std::min(rows, height - nextRow);
+            if (rows < std::max(khalf, 1)) continue;
+            RowSlab slab;
+            slab.device = (int)d;
+            slab.rowStart = nextRow;
+            slab.rowCount = rows;
+            slabs.push_back(slab);
+            nextRow += rows;
+        }
+        if (slabs.empty() || nextRow < height) {
+            // Remainder too thin for its own slab: fold it into the last one
+            if (slabs.empty()) {
+                RowSlab slab;
+                slab.device = (int)best;
+                slab.rowStart = 0;
+                slab.rowCount = 0;
+                slabs.push_back(slab);
+            }
+            slabs.back().rowCount += height - nextRow;
+        }
+        
+        HostVector<float> output(input.size());
+        double exchangeMs = 0.0;
+        double multiTime = convolveRowSplit(input, output, kernel1d, width, height, ksize, passes,
+                                            slabs, devices, contexts, programs, &exchangeMs);
+        
+        for (const RowSlab& slab : slabs) {
+            std::cout << std::left << std::setw(40) << ("  rows on " + deviceNames[slab.device].substr(0, 28))
+                      << std::right << std::setw(10) << slab.rowCount << "\n";
+        }
+        std::cout << std::left << std::setw(40) << ("Row-split (" + std::to_string(slabs.size()) + " devices)")
+                  << std::right << std::setw(10) << height
+                  << std::setw(12) << multiTime
+                  << std::setw(12) << exchangeMs << "\n";
+        
+        // Ideal aggregate: all devices busy for the same time at their single-device rate
+        double idealTime = 0.0;
+        for (const RowSlab& slab : slabs) idealTime += 1.0 / singleTimes[slab.device];
+        idealTime = 1.0 / idealTime;
+        
+        std::cout << "\nSpeedup vs best single device (" << deviceNames[best].substr(0, 24) << "): "
+                  << (singleTimes[best] / multiTime) << "x\n";
+        std::cout << "Scaling efficiency (ideal aggregate " << idealTime << " ms): "
+                  << (100.0 * idealTime / multiTime) << "%\n";
+        
+        float maxDiff = 0.0f;
+        for (size_t i = 0; i < output.size(); i++) maxDiff = std::max(maxDiff, std::abs(output[i] - bestOutput[i]));
+        if (maxDiff < 1e-4f) {
+            std::cout << "  ✓ Verified against single-device result (max diff " << maxDiff << ")\n\n";
+        } else {
+            std::cout << "  ✗ Failed (max diff " << maxDiff << ")\n\n";
+        }
+    }
+}
+
+// Batched NCHW convolution layers
+struct ConvShape {
+    const char* name;
+    int N, C, H, W;      // input batch, channels, height, width
+    int K, R, S;         // filters, filter height, filter width
+    int stride, pad;
+    int OH() const { return (H + 2 * pad - R) / stride + 1; }
+    int OW() const { return (W + 2 * pad - S) / stride + 1; }
+    double gflop() const { return 2.0 * N * K * C * R * S * OH() * OW() / 1e9; }
+};
+
+// CPU reference, blocked over output channels so each input row is reused across
+// a block of filters while it is in cache (OpenMP over images x filter blocks)
+double convLayerCPU(const HostVector<float>& input,
+                    const HostVector<float>& weights,
+                    HostVector<float>& output,
+                    const ConvShape& L) {
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    const int KBLOCK = 8;
+    int OH = L.OH(), OW = L.OW();
+    int numBlocks = (L.K + KBLOCK - 1) / KBLOCK;
+    
+    #pragma omp parallel for collapse(2)
+    for (int n = 0; n < L.N; n++) {
+        for (int kb = 0; kb < numBlocks; kb++) {
+            int k0 = kb * KBLOCK;
+            int kcount = std::min(KBLOCK, L.K - k0);
+            HostVector<float> acc((size_t)kcount * OH * OW, 0.0f);
+            
+            for (int c = 0; c < L.C; c++) {
+                const float* plane = &input[((size_t)n * L.C + c) * L.H * L.W];
+                for (int r = 0; r < L.R; r++) {
+                    for (int s = 0; s < L.S; s++) {
+                        for (int kk = 0; kk < kcount; kk++) {
+                            float w = weights[(((size_t)(k0 + kk) * L.C + c) * L.R + r) * L.S + s];
+                            float* out = &acc[(size_t)kk * OH * OW];
+                            for (int oh = 0; oh < OH; oh++) {
+                                int ih = oh * L.stride - L.pad + r;
+                                if (ih < 0 || ih >= L.H) continue;
+                                for (int ow = 0; ow < OW; ow++) {
+                                    int iw = ow * L.stride - L.pad + s;
+                                    if (iw < 0 || iw >= L.W) continue;
+                                    out[oh * OW + ow] += w * plane[ih * L.W + iw];
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+            
+            std::copy(acc.begin(), acc.end(), &output[((size_t)n * L.K + k0) * OH * OW]);
+        }
+    }
+    
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// im2col + 006 tiled GEMM + reorder to NCHW (OpenCL)
+double convLayerIm2colOpenCL(const HostVector<float>& input,
+                             const HostVector<float>& weights,
+                             HostVector<float>& output,
+                             const ConvShape& L,
+                             cl_device_id device,
+                             cl_context context,
+                             cl_program program) {
+    cl_int err;
+    const int TILE_SIZE = 16;
+    
+    cl_command_queue queue = clCreateCommandQueueWithProperties(context, device, nullptr, &err);
+    checkError(err, "clCreateCommandQueue");
+    
+    int OH = L.OH(), OW = L.OW();
+    int OHW = OH * OW;
+    int gemmM = L.K;                 // rows of the weight matrix
+    int gemmN = L.C * L.R * L.S;     // shared dimension
+    int gemmK = L.N * OHW;           // columns of the im2col matrix
+    
+    cl_mem bufInput = allocateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                      input.size() * sizeof(float), (void*)input.data(), &err);
+    checkError(err, "clCreateBuffer input");
+    cl_mem bufWeights = allocateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                        weights.size() * sizeof(float), (void*)weights.data(), &err);
+    checkError(err, "clCreateBuffer weights");
+    cl_mem bufCol = allocateBuffer(context, CL_MEM_READ_WRITE, (size_t)gemmN * gemmK * sizeof(float), nullptr, &err);
+    checkError(err, "clCreateBuffer im2col");
+    cl_mem bufGemm = allocateBuffer(context, CL_MEM_READ_WRITE, (size_t)gemmM * gemmK * sizeof(float), nullptr, &err);
+    checkError(err, "clCreateBuffer gemm");
+    cl_mem bufOutput = allocateBuffer(context, CL_MEM_WRITE_ONLY, output.size() * sizeof(float), nullptr, &err);
+    checkError(err, "clCreateBuffer output");
+    
+    cl_kernel kernelCol = clCreateKernel(program, "im2col_nchw", &err);
+    checkError(err, "clCreateKernel im2col_nchw");
+    cl_kernel kernelGemm = clCreateKernel(program, "matrix_multiply_tiled", &err);
+    checkError(err, "clCreateKernel matrix_multiply_tiled");
+    cl_kernel kernelReorder = clCreateKernel(program, "gemm_to_nchw", &err);
+    checkError(err, "clCreateKernel gemm_to_nchw");
+    
+    clSetKernelArg(kernelCol, 0, sizeof(cl_mem), &bufInput);
+    clSetKernelArg(kernelCol, 1, sizeof(cl_mem), &bufCol);
+    clSetKernelArg(kernelCol, 2, sizeof(int), &L.N);
+    clSetKernelArg(kernelCol, 3, sizeof(int), &L.C);
+    clSetKernelArg(kernelCol, 4, sizeof(int), &L.H);
+    clSetKernelArg(kernelCol, 5, sizeof(int), &L.W);
+    clSetKernelArg(kernelCol, 6, sizeof(int), &L.R);
+    clSetKernelArg(kernelCol, 7, sizeof(int), &L.S);
+    clSetKernelArg(kernelCol, 8, sizeof(int), &OH);
+    clSetKernelArg(kernelCol, 9, sizeof(int), &OW);
+    clSetKernelArg(kernelCol, 10, sizeof(int), &L.stride);
+    clSetKernelArg(kernelCol, 11, sizeof(int), &L.pad);
+    
+    clSetKernelArg(kernelGemm, 0, sizeof(cl_mem), &bufWeights);
+    clSetKernelArg(kernelGemm, 1, sizeof(cl_mem), &bufCol);
+    clSetKernelArg(kernelGemm, 2, sizeof(cl_mem), &bufGemm);
+    clSetKernelArg(kernelGemm, 3, sizeof(int), &gemmM);
+    clSetKernelArg(kernelGemm, 4, sizeof(int), &gemmN);
+    clSetKernelArg(kernelGemm, 5, sizeof(int), &gemmK);
+    clSetKernelArg(kernelGemm, 6, TILE_SIZE * TILE_SIZE * sizeof(float), nullptr);
+    clSetKernelArg(kernelGemm, 7, TILE_SIZE * TILE_SIZE * sizeof(float), nullptr);
+    
+    clSetKernelArg(kernelReorder, 0, sizeof(cl_mem), &bufGemm);
+    clSetKernelArg(kernelReorder, 1, sizeof(cl_mem), &bufOutput);
+    clSetKernelArg(kernelReorder, 2, sizeof(int), &L.N);
+    clSetKernelArg(kernelReorder, 3, sizeof(int), &L.K);
+    clSetKernelArg(kernelReorder, 4, sizeof(int), &OHW);
+    
+    size_t colGlobal[2] = {(size_t)gemmK, (size_t)gemmN};
+    size_t gemmGlobal[2] = {(size_t)((gemmM + TILE_SIZE - 1) / TILE_SIZE) * TILE_SIZE,
+                            (size_t)((gemmK + TILE_SIZE - 1) / TILE_SIZE) * TILE_SIZE};
+    size_t gemmLocal[2] = {TILE_SIZE, TILE_SIZE};
+    size_t reorderGlobal[2] = {(size_t)gemmK, (size_t)L.K};
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    clEnqueueNDRangeKernel(queue, kernelCol, 2, nullptr, colGlobal, nullptr, 0, nullptr, nullptr);
+    clEnqueueNDRangeKernel(queue, kernelGemm, 2, nullptr, gemmGlobal, gemmLocal, 0, nullptr, nullptr);
+    err = clEnqueueNDRangeKernel(queue, kernelReorder, 2, nullptr, reorderGlobal, nullptr, 0, nullptr, nullptr);
+    checkError(err, "clEnqueueNDRangeKernel");
+    
+    clFinish(queue);
+    
+    auto end = std::chrono::high_resolution_clock::now();
+    
+    clEnqueueReadBuffer(queue, bufOutput, CL_TRUE, 0, output.size() * sizeof(float), output.data(), 0, nullptr, nullptr);
+    
+    releaseBuffer(bufInput);
+    releaseBuffer(bufWeights);
+    releaseBuffer(bufCol);
+    releaseBuffer(bufGemm);
+    releaseBuffer(bufOutput);
+    clReleaseKernel(kernelCol);
+    clReleaseKernel(kernelGemm);
+    clReleaseKernel(kernelReorder);
+    clReleaseCommandQueue(queue);
+    
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// Direct local-memory convolution layer (OpenCL)
+double convLayerDirectOpenCL(const HostVector<float>& input,
+                             const HostVector<float>& weights,
+                             HostVector<float>& output,
+                             const ConvShape& L,
+                             cl_device_id device,
+                             cl_context context,
+                             cl_program program) {
+    cl_int err;
+    
+    cl_command_queue queue = clCreateCommandQueueWithProperties(context, device, nullptr, &err);
+    checkError(err, "clCreateCommandQueue");
+    
+    int OH = L.OH(), OW = L.OW();
+    
+    cl_mem bufInput = allocateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                      input.size() * sizeof(float), (void*)input.data(), &err);
+    checkError(err, "clCreateBuffer input");
+    cl_mem bufWeights = allocateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                        weights.size() * sizeof(float), (void*)weights.data(), &err);
+    checkError(err, "clCreateBuffer weights");
+    cl_mem bufOutput = allocateBuffer(context, CL_MEM_WRITE_ONLY, output.size() * sizeof(float), nullptr, &err);
+    checkError(err, "clCreateBuffer output");
+    
+    cl_kernel kernel = clCreateKernel(program, "conv_nchw_direct_local", &err);
+    checkError(err, "clCreateKernel conv_nchw_direct_local");
+    
+    // Small feature maps (7x7, 14x14) waste most of a 16x16 tile
+    const int LOCAL_SIZE = (OW >= 16) ? 16 : 8;
+    int tileW = (LOCAL_SIZE - 1) * L.stride + L.S;
+    int tileH = (LOCAL_SIZE - 1) * L.stride + L.R;
+    
+    clSetKernelArg(kernel, 0, sizeof(cl_mem), &bufInput);
+    clSetKernelArg(kernel, 1, sizeof(cl_mem), &bufWeights);
+    clSetKernelArg(kernel, 2, sizeof(cl_mem), &bufOutput);
+    clSetKernelArg(kernel, 3, sizeof(int), &L.C);
+    clSetKernelArg(kernel, 4, sizeof(int), &L.H);
+    clSetKernelArg(kernel, 5, sizeof(int), &L.W);
+    clSetKernelArg(kernel, 6, sizeof(int), &L.K);
+    clSetKernelArg(kernel, 7, sizeof(int), &L.R);
+    clSetKernelArg(kernel, 8, sizeof(int), &L.S);
+    clSetKernelArg(kernel, 9, sizeof(int), &OH);
+    clSetKernelArg(kernel, 10, sizeof(int), &OW);
+    clSetKernelArg(kernel, 11, sizeof(int), &L.stride);
+    clSetKernelArg(kernel, 12, sizeof(int), &L.pad);
+    clSetKernelArg(kernel, 13, (size_t)tileW * tileH * sizeof(float), nullptr);
+    
+    size_t globalSize[3] = {(size_t)((OW + LOCAL_SIZE - 1) / LOCAL_SIZE) * LOCAL_SIZE,
+                            (size_t)((OH + LOCAL_SIZE - 1) / LOCAL_SIZE) * LOCAL_SIZE,
+                            (size_t)L.N * L.K};
+    size_t localSize[3] = {(size_t)LOCAL_SIZE, (size_t)LOCAL_SIZE, 1};
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    err = clEnqueueNDRangeKernel(queue, kernel, 3, nullptr, globalSize, localSize, 0, nullptr, nullptr);
+    checkError(err, "clEnqueueNDRangeKernel");
+    
+    clFinish(queue);
+    
+    auto end = std::chrono::high_resolution_clock::now();
+    
+    clEnqueueReadBuffer(queue, bufOutput, CL_TRUE, 0, output.size() * sizeof(float), output.data(), 0, nullptr, nullptr);
+    
+    releaseBuffer(bufInput);
+    releaseBuffer(bufWeights);
+    releaseBuffer(bufOutput);
+    clReleaseKernel(kernel);
+    clReleaseCommandQueue(queue);
+    
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void verifyResults(const HostVector<float>& expected, const HostVector<float>& actual, const char* name) {
+    const float TOLERANCE = 1e-3f;
+    int errors = 0;
+    
+    for (size_t i = 0; i < expected.size(); i++) {
+        if (std::abs(expected[i] - actual[i]) > TOLERANCE * std::max(1.0f, std::abs(expected[i]))) {
+            if (errors < 5) {
+                std::cerr << "Mismatch in " << name << " at " << i
+                          << ": expected " << expected[i]
+                          << ", got " << actual[i] << "\n";
+            }
+            errors++;
+        }
+    }
+    
+    if (errors == 0) {
+        std::cout << "  ✓ Verified\n";
+    } else {
+        std::cout << "  ✗ Failed (" << errors << " errors)\n";
+    }
+}
+
+void printLayerRow(const std::string& name, double timeMs, double gflop, double baseTime) {
+    std::cout << std::left << std::setw(40) << name
+              << std::right << std::setw(12) << timeMs
+              << std::setw(12) << (gflop / (timeMs / 1000.0))
+              << std::setw(12) << (baseTime / timeMs) << "x\n";
+}
+
+void runConvLayers(int batch,
+                   const std::vector<cl_device_id>& devices,
+                   const std::vector<std::string>& deviceNames,
+                   const std::vector<cl_context>& contexts,
+                   const std::vector<cl_program>& programs) {
+    // ResNet-50 style layer shapes
+    std::vector<ConvShape> layers = {
+        {"conv1 7x7/2 (224x224x3 -> 64)",     batch,   3, 224, 224,  64, 7, 7, 2, 3},
+        {"3x3 (56x56x64 -> 64)",              batch,  64,  56,  56,  64, 3, 3, 1, 1},
+        {"1x1 (56x56x256 -> 64)",             batch, 256,  56,  56,  64, 1, 1, 1, 0},
+        {"3x3 (28x28x128 -> 128)",            batch, 128,  28,  28, 128, 3, 3, 1, 1},
+        {"3x3 (14x14x256 -> 256)",            batch, 256,  14,  14, 256, 3, 3, 1, 1},
+        {"3x3 (7x7x512 -> 512)",              batch, 512,   7,   7, 512, 3, 3, 1, 1},
+    };
+    
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<float> inputDist(0.0f, 1.0f);
+    std::uniform_real_distribution<float> weightDist(-0.1f, 0.1f);
+    
+    for (const ConvShape& L : layers) {
+        std::cout << "========================================\n";
+        std::cout << "Layer: " << L.name << ", batch " << L.N << "\n";
+        std::cout << "Output: " << L.N << "x" << L.K << "x" << L.OH() << "x" << L.OW()
+                  << ", " << L.gflop() << " GFLOP\n";
+        std::cout << "========================================\n";
+        
+        HostVector<float> input((size_t)L.N * L.C * L.H * L.W);
+        HostVector<float> weights((size_t)L.K * L.C * L.R * L.S);
+        HostVector<float> output((size_t)L.N * L.K * L.OH() * L.OW());
+        for (auto& v : input) v = inputDist(gen);
+        for (auto& v : weights) v = weightDist(gen);
+        
+        double cpuTime = convLayerCPU(input, weights, output, L);
+        HostVector<float> expectedResult = output;
+        
+        std::cout << "\n" << std::fixed << std::setprecision(2);
+        std::cout << std::left << std::setw(40) << "Implementation"
+                  << std::right << std::setw(12) << "Time (ms)"
+                  << std::setw(12) << "GFLOPS"
+                  << std::setw(12) << "Speedup\n";
+        std::cout << std::string(76, '-') << "\n";
+        printLayerRow("OpenMP (blocked)", cpuTime, L.gflop(), cpuTime);
+        
+        for (size_t i = 0; i < devices.size(); i++) {
+            std::fill(output.begin(), output.end(), 0.0f);
+            double gemmTime = convLayerIm2colOpenCL(input, weights, output, L,
+                                                    devices[i], contexts[i], programs[i]);
+            printLayerRow("OpenCL: " + deviceNames[i].substr(0, 17) + " (im2col+GEMM)", gemmTime, L.gflop(), cpuTime);
+            verifyResults(expectedResult, output, (deviceNames[i] + " im2col").c_str());
+            
+            std::fill(output.begin(), output.end(), 0.0f);
+            double directTime = convLayerDirectOpenCL(input, weights, output, L,
+                                                      devices[i], contexts[i], programs[i]);
+            printLayerRow("OpenCL: " + deviceNames[i].substr(0, 22) + " (direct)", directTime, L.gflop(), cpuTime);
+            verifyResults(expectedResult, output, (deviceNames[i] + " direct").c_str());
+        }
+        
+        std::cout << "\n";
+    }
+}
+
+// Precision modes: the same convolution.cl built with different options.
+// Convolution is pure multiply-add, so the knob is contraction and relaxed
+// IEEE semantics rather than sqrt/rsqrt (see 008 for those).
+struct PrecisionMode {
+    const char* name;
+    const char* options;
+};
+
+const PrecisionMode PRECISION_MODES[] = {
+    {"precise", ""},
+    {"mad", "-cl-mad-enable"},
+    {"fast-relaxed-math", "-cl-fast-relaxed-math"},
+};
+
+// Returns nullptr (after printing the log) if the build fails
+cl_program buildProgram(cl_context context, cl_device_id device,
+                        const std::string& source, const char* options) {
+    cl_int err;
+    const char* sourcePtr = source.c_str();
+    size_t sourceSize = source.size();
+    
+    cl_program program = clCreateProgramWithSource(context, 1, &sourcePtr, &sourceSize, &err);
+    checkError(err, "clCreateProgramWithSource");
+    
+    err = clBuildProgram(program, 1, &device, options, nullptr, nullptr);
+    if (err != CL_SUCCESS) {
+        size_t logSize;
+        clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, 0, nullptr, &logSize);
+        std::vector<char> log(logSize);
+        clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, logSize, log.data(), nullptr);
+        std::cerr << "Build error (" << options << "):\n" << log.data() << "\n";
+        clReleaseProgram(program);
+        return nullptr;
+    }
+    return program;
+}
+
+// Largest difference relative to the largest reference value
+float maxRelativeError(const HostVector<float>& expected, const HostVector<float>& actual) {
+    float maxRef = 0.0f;
+    for (float v : expected) maxRef = std::max(maxRef, std::abs(v));
+    return maxRef > 0.0f ? maxAbsDiff(expected, actual) / maxRef : 0.0f;
+}
+
+void runPrecisionSweep(const std::vector<cl_device_id>& devices,
+                       const std::vector<std::string>& deviceNames,
+                       const std::vector<cl_context>& contexts,
+                       const std::string& kernelSource) {
+    const int width = 2048;
+    const int height = 2048;
+    std::vector<int> kernelSizes = {5, 15};
+    
+    HostVector<float> input((size_t)width * height);
+    for (size_t i = 0; i < input.size(); i++) {
+        input[i] = static_cast<float>(i % 256) / 255.0f;
+    }
+    HostVector<float> output(input.size());
+    
+    for (int ksize : kernelSizes) {
+        HostVector<float> kernel = createGaussianKernel(ksize, ksize / 6.0f);
+        convolveSerial(input, output, kernel, width, height, ksize);
+        HostVector<float> expectedResult = output;
+        double gflop = 2.0 * ksize * ksize * width * height / 1e9;
+        
+        std::cout << "========================================\n";
+        std::cout << "Image: " << width << "x" << height << ", Kernel: " << ksize << "x" << ksize << "\n";
+        std::cout << "========================================\n\n";
+        
+        for (size_t d = 0; d < devices.size(); d++) {
+            std::cout << "OpenCL: " << deviceNames[d] << "\n";
+            std::cout << std::fixed << std::setprecision(2);
+            std::cout << std::left << std::setw(36) << "Mode / kernel"
+                      << std::right << std::setw(12) << "Time (ms)"
+                      << std::setw(12) << "GFLOPS"
+                      << std::setw(10) << "Speedup"
+                      << std::setw(14) << "Max rel err\n";
+            std::cout << std::string(83, '-') << "\n";
+            
+            double preciseMs[2] = {0.0, 0.0};
+            for (const PrecisionMode& mode : PRECISION_MODES) {
+                cl_program program = buildProgram(contexts[d], devices[d], kernelSource, mode.options);
+                if (!program) continue;
+                
+                for (int useLocal = 0; useLocal < 2; useLocal++) {
+                    const char* kernelName = useLocal ? "convolve_2d_local" : "convolve_2d";
+                    convolveOpenCL(input, output, kernel, width, height, ksize,
+                                   devices[d], contexts[d], program, kernelName, useLocal);
+                    double ms = convolveOpenCL(input, output, kernel, width, height, ksize,
+                                               devices[d], contexts[d], program, kernelName, useLocal);
+                    if (preciseMs[useLocal] == 0.0) preciseMs[useLocal] = ms;
+                    
+                    std::cout << std::left << std::setw(36) << (std::string(mode.name) + " / " + kernelName)
+                              << std::right << std::setw(12) << ms
+                              << std::setw(12) << (gflop / (ms / 1000.0))
+                              << std::setw(9) << (preciseMs[useLocal] / ms) << "x"
+                              << std::setw(13) << std::scientific << std::setprecision(1)
+                              << maxRelativeError(expectedResult, output)
+                              << std::fixed << std::setprecision(2) << "\n";
+                }
+                
+                clReleaseProgram(program);
+            }
+            std::cout << "\n";
+        }
+    }
+}
+
+// Streaming frame-sequence mode
+struct StreamConfig {
+    int width = 3840;
+    int height = 2160;
+    double targetFps = 60.0;  // 0 = unpaced (submit as fast as possible)
+    int frames = 240;
+    int ksize = 7;
+    std::string rawFile;      // 8-bit grayscale frames; empty = synthetic generator
+};
+
+struct FrameRecord {
+    std::chrono::high_resolution_clock::time_point arrival;
+    std::chrono::high_resolution_clock::time_point done;
+    std::atomic<int>* completed;
+};
+
+void CL_CALLBACK onFrameComplete(cl_event, cl_int, void* userData) {
+    FrameRecord* rec = static_cast<FrameRecord*>(userData);
+    rec->done = std::chrono::high_resolution_clock::now();
+    rec->completed->fetch_add(1, std::memory_order_release);
+}
+
+// One of three in-flight frame slots (triple buffering)
+struct StreamSlot {
+    cl_mem pinnedIn, pinnedOut;           // CL_MEM_ALLOC_HOST_PTR staging, mapped once
+    unsigned char* hostIn;
+    unsigned char* hostOut;
+    cl_mem devIn, devTemp, devOut;
+    cl_kernel kernelH, kernelV;           // per-slot kernels so arguments are set once
+    cl_event readDone;
+};
+
+cl_ulong eventTime(cl_event event, cl_profiling_info param) {
+    cl_ulong time = 0;
+    clGetEventProfilingInfo(event, param, sizeof(time), &time, nullptr);
+    return time;
+}
+
+void runStreaming(const StreamConfig& cfg,
+                  cl_device_id device,
+                  cl_context context,
+                  cl_program program,
+                  const std::string& deviceName) {
+    const int NUM_SLOTS = 3;
+    const int POOL_FRAMES = 4;
+    cl_int err;
+    
+    int width = cfg.width;
+    int height = cfg.height;
+    int ksize = cfg.ksize;
+    size_t frameBytes = (size_t)width * height;
+    
+    std::cout << "----------------------------------------\n";
+    std::cout << "Device: " << deviceName << "\n";
+    std::cout << "----------------------------------------\n";
+    
+    // Frame source: raw file (read per frame) or a small pool of generated frames
+    std::ifstream rawFile;
+    std::vector<HostVector<unsigned char>> pool;
+    if (!cfg.rawFile.empty()) {
+        rawFile.open(cfg.rawFile, std::ios::binary);
+        if (!rawFile.is_open()) {
+            std::cerr << "Failed to open: " << cfg.rawFile << "\n";
+            return;
+        }
+    } else {
+        pool.resize(POOL_FRAMES, HostVector<unsigned char>(frameBytes));
+        for (int f = 0; f < POOL_FRAMES; f++) {
+            #pragma omp parallel for
+            for (int y = 0; y < height; y++) {
+                for (int x = 0; x < width; x++) {
+                    pool[f][(size_t)y * width + x] = (unsigned char)(((x + f * 16) ^ (y + f * 8)) & 255);
+                }
+            }
+        }
+    }
+    
+    // Separate queues so the upload of frame N+1 can overlap the compute of frame N
+    cl_queue_properties props[] = {CL_QUEUE_PROPERTIES, CL_QUEUE_PROFILING_ENABLE, 0};
+    cl_command_queue uploadQueue = clCreateCommandQueueWithProperties(context, device, props, &err);
+    checkError(err, "clCreateCommandQueue upload");
+    cl_command_queue computeQueue = clCreateCommandQueueWithProperties(context, device, props, &err);
+    checkError(err, "clCreateCommandQueue compute");
+    cl_command_queue downloadQueue = clCreateCommandQueueWithProperties(context, device, props, &err);
+    checkError(err, "clCreateCommandQueue download");
+    
+    HostVector<float> kernel1d = createGaussianKernel1D(ksize, ksize / 6.0f);
+    cl_mem bufKernel = allocateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                       ksize * sizeof(float), kernel1d.data(), &err);
+    checkError(err, "clCreateBuffer kernel");
+    
+    StreamSlot slots[NUM_SLOTS];
+    for (StreamSlot& slot : slots) {
+        slot.pinnedIn = allocateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, frameBytes, nullptr, &err);
+        checkError(err, "clCreateBuffer pinned input");
+        slot.pinnedOut = allocateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, frameBytes, nullptr, &err);
+        checkError(err, "clCreateBuffer pinned output");
+        slot.hostIn = (unsigned char*)clEnqueueMapBuffer(uploadQueue, slot.pinnedIn, CL_TRUE, CL_MAP_WRITE,
+                                                          0, frameBytes, 0, nullptr, nullptr, &err);
+        checkError(err, "clEnqueueMapBuffer input");
+        slot.hostOut = (unsigned char*)clEnqueueMapBuffer(downloadQueue, slot.pinnedOut, CL_TRUE, CL_MAP_READ,
+                                                           0, frameBytes, 0, nullptr, nullptr, &err);
+        checkError(err, "clEnqueueMapBuffer output");
+        
+        slot.devIn = allocateBuffer(context, CL_MEM_READ_ONLY, frameBytes, nullptr, &err);
+        checkError(err, "clCreateBuffer frame input");
+        slot.devTemp = allocateBuffer(context, CL_MEM_READ_WRITE, frameBytes * sizeof(float), nullptr, &err);
+        checkError(err, "clCreateBuffer frame temp");
+        slot.devOut = allocateBuffer(context, CL_MEM_WRITE_ONLY, frameBytes, nullptr, &err);
+        checkError(err, "clCreateBuffer frame output");
+        
+        slot.kernelH = clCreateKernel(program, "convolve_h_u8", &err);
+        checkError(err, "clCreateKernel convolve_h_u8");
+        slot.kernelV = clCreateKernel(program, "convolve_v_u8", &err);
+        checkError(err, "clCreateKernel convolve_v_u8");
+        
+        clSetKernelArg(slot.kernelH, 0, sizeof(cl_mem), &slot.devIn);
+        clSetKernelArg(slot.kernelH, 1, sizeof(cl_mem), &slot.devTemp);
+        clSetKernelArg(slot.kernelH, 2, sizeof(cl_mem), &bufKernel);
+        clSetKernelArg(slot.kernelH, 3, sizeof(int), &width);
+        clSetKernelArg(slot.kernelH, 4, sizeof(int), &height);
+        clSetKernelArg(slot.kernelH, 5, sizeof(int), &ksize);
+        
+        clSetKernelArg(slot.kernelV, 0, sizeof(cl_mem), &slot.devTemp);
+        clSetKernelArg(slot.kernelV, 1, sizeof(cl_mem), &slot.devOut);
+        clSetKernelArg(slot.kernelV, 2, sizeof(cl_mem), &bufKernel);
+        clSetKernelArg(slot.kernelV, 3, sizeof(int), &width);
+        clSetKernelArg(slot.kernelV, 4, sizeof(int), &height);
+        clSetKernelArg(slot.kernelV, 5, sizeof(int), &ksize);
+        
+        slot.readDone = nullptr;
+    }
+    
+    std::atomic<int> completed(0);
+    std::vector<FrameRecord> records(cfg.frames);
+    std::vector<cl_event> writeEvents(cfg.frames), horizontalEvents(cfg.frames), computeEvents(cfg.frames);
+    size_t globalSize[2] = {(size_t)width, (size_t)height};
+    
+    auto frameInterval = std::chrono::duration<double>(cfg.targetFps > 0.0 ? 1.0 / cfg.targetFps : 0.0);
+    auto streamStart = std::chrono::high_resolution_clock::now();
+    int framesRun = 0;
+    
+    for (int i = 0; i < cfg.frames; i++) {
+        StreamSlot& slot = slots[i % NUM_SLOTS];
+        
+        // Back-pressure: the slot is free once its previous frame has been read back
+        if (slot.readDone) {
+            clWaitForEvents(1, &slot.readDone);
+            clReleaseEvent(slot.readDone);
+            slot.readDone = nullptr;
+        }
+        
+        if (rawFile.is_open()) {
+            if (!rawFile.read((char*)slot.hostIn, frameBytes)) {
+                rawFile.clear();
+                rawFile.seekg(0);
+                if (!rawFile.read((char*)slot.hostIn, frameBytes)) {
+                    std::cerr << "Raw file is smaller than one " << width << "x" << height << " frame\n";
+                    break;
+                }
+            }
+        } else {
+            std::copy(pool[i % POOL_FRAMES].begin(), pool[i % POOL_FRAMES].end(), slot.hostIn);
+        }
+        
+        // Paced mode: frame i "arrives" at its scheduled time, late or not
+        auto arrival = std::chrono::high_resolution_clock::now();
+        if (cfg.targetFps > 0.0) {
+            auto scheduled = streamStart + std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(frameInterval * i);
+            if (arrival < scheduled) {
+                std::this_thread::sleep_until(scheduled);
+            }
+            arrival = scheduled;
+        }
+        records[i].arrival = arrival;
+        records[i].completed = &completed;
+        
+        err = clEnqueueWriteBuffer(uploadQueue, slot.devIn, CL_FALSE, 0, frameBytes, slot.hostIn,
+                                   0, nullptr, &writeEvents[i]);
+        checkError(err, "clEnqueueWriteBuffer frame");
+        err = clEnqueueNDRangeKernel(computeQueue, slot.kernelH, 2, nullptr, globalSize, nullptr,
+                                     1, &writeEvents[i], &horizontalEvents[i]);
+        checkError(err, "clEnqueueNDRangeKernel convolve_h_u8");
+        err = clEnqueueNDRangeKernel(computeQueue, slot.kernelV, 2, nullptr, globalSize, nullptr,
+                                     0, nullptr, &computeEvents[i]);
+        checkError(err, "clEnqueueNDRangeKernel convolve_v_u8");
+        err = clEnqueueReadBuffer(downloadQueue, slot.devOut, CL_FALSE, 0, frameBytes, slot.hostOut,
+                                  1, &computeEvents[i], &slot.readDone);
+        checkError(err, "clEnqueueReadBuffer frame");
+        clSetEventCallback(slot.readDone, CL_COMPLETE, onFrameComplete, &records[i]);
+        
+        clFlush(uploadQueue);
+        clFlush(computeQueue);
+        clFlush(downloadQueue);
+        framesRun++;
+    }
+    
+    clFinish(uploadQueue);
+    clFinish(computeQueue);
+    clFinish(downloadQueue);
+    
+    // Callbacks may still be in flight after clFinish returns
+    while (completed.load(std::memory_order_acquire) < framesRun) {
+        std::this_thread::yield();
+    }
+    
+    if (framesRun > 0) {
+        std::vector<double> latencies(framesRun);
+        auto lastDone = records[0].done;
+        for (int i = 0; i < framesRun; i++) {
+            latencies[i] = std::chrono::duration<double, std::milli>(records[i].done - records[i].arrival).count();
+            lastDone = std::max(lastDone, records[i].done);
+        }
+        double elapsed = std::chrono::duration<double>(lastDone - records[0].arrival).count();
+        double sustainedFps = framesRun / elapsed;
+        
+        // Upload of frame N+1 vs compute of frame N, from the start of the horizontal pass
+        // to the end of the vertical one (same device, so timestamps are comparable)
+        int overlapped = 0;
+        for (int i = 0; i + 1 < framesRun; i++) {
+            cl_ulong uploadStart = eventTime(writeEvents[i + 1], CL_PROFILING_COMMAND_START);
+            cl_ulong uploadEnd = eventTime(writeEvents[i + 1], CL_PROFILING_COMMAND_END);
+            cl_ulong computeStart = eventTime(horizontalEvents[i], CL_PROFILING_COMMAND_START);
+            cl_ulong computeEnd = eventTime(computeEvents[i], CL_PROFILING_COMMAND_END);
+            if (uploadStart < computeEnd && uploadEnd > computeStart) overlapped++;
+        }
+        
+        std::sort(latencies.begin(), latencies.end());
+        
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << "Frames:                 " << framesRun << "\n";
+        std::cout << "Latency p50:            " << percentile(latencies, 0.50) << " ms\n";
+        std::cout << "Latency p99:            " << percentile(latencies, 0.99) << " ms\n";
+        std::cout << "Latency max:            " << latencies.back() << " ms\n";
+        std::cout << "Sustained throughput:   " << sustainedFps << " frames/s\n";
+        std::cout << "Upload/compute overlap: " << overlapped << " of " << (framesRun - 1) << " frame pairs\n";
+        
+        if (cfg.targetFps > 0.0) {
+            double budget = 1000.0 / cfg.targetFps;
+            int withinBudget = (int)std::count_if(latencies.begin(), latencies.end(),
+                                                  [budget](double l) { return l <= budget; });
+            bool sloMet = percentile(latencies, 0.99) <= budget && sustainedFps >= 0.99 * cfg.targetFps;
+            std::cout << "Frame budget:           " << budget << " ms ("
+                      << (100.0 * withinBudget / framesRun) << "% of frames within)\n";
+            std::cout << "SLO (p99 <= budget at " << cfg.targetFps << " fps): "
+                      << (sloMet ? "MET" : "MISSED") << "\n";
+        }
+        
+        // Verify the last frame against the CPU reference (2D kernel = outer product of the 1D kernel)
+        StreamSlot& last = slots[(framesRun - 1) % NUM_SLOTS];
+        HostVector<float> frameIn(frameBytes), frameRef(frameBytes);
+        HostVector<float> kernel2d(ksize * ksize);
+        for (size_t p = 0; p < frameBytes; p++) frameIn[p] = (float)last.hostIn[p];
+        for (int ky = 0; ky < ksize; ky++) {
+            for (int kx = 0; kx < ksize; kx++) {
+                kernel2d[ky * ksize + kx] = kernel1d[ky] * kernel1d[kx];
+            }
+        }
+        convolveOpenMP(frameIn, frameRef, kernel2d, width, height, ksize);
+        
+        size_t mismatches = 0;
+        for (size_t p = 0; p < frameBytes; p++) {
+            float ref = std::min(255.0f, std::max(0.0f, std::round(frameRef[p])));
+            if (std::abs(ref - (float)last.hostOut[p]) > 1.0f) mismatches++;
+        }
+        if (mismatches == 0) {
+            std::cout << "  ✓ Verified (last frame)\n";
+        } else {
+            std::cout << "  ✗ Failed (" << mismatches << " pixels differ)\n";
+        }
+    }
+    
+    for (int i = 0; i < framesRun; i++) {
+        clReleaseEvent(writeEvents[i]);
+        clReleaseEvent(horizontalEvents[i]);
+        clReleaseEvent(computeEvents[i]);
+    }
+    for (StreamSlot& slot : slots) {
+        if (slot.readDone) clReleaseEvent(slot.readDone);
+        clEnqueueUnmapMemObject(uploadQueue, slot.pinnedIn, slot.hostIn, 0, nullptr, nullptr);
+        clEnqueueUnmapMemObject(downloadQueue, slot.pinnedOut, slot.hostOut, 0, nullptr, nullptr);
+    }
+    clFinish(uploadQueue);
+    clFinish(downloadQueue);
+    for (StreamSlot& slot : slots) {
+        releaseBuffer(slot.pinnedIn);
+        releaseBuffer(slot.pinnedOut);
+        releaseBuffer(slot.devIn);
+        releaseBuffer(slot.devTemp);
+        releaseBuffer(slot.devOut);
+        clReleaseKernel(slot.kernelH);
+        clReleaseKernel(slot.kernelV);
+    }
+    releaseBuffer(bufKernel);
+    clReleaseCommandQueue(uploadQueue);
+    clReleaseCommandQueue(computeQueue);
+    clReleaseCommandQueue(downloadQueue);
+}
+
+// ============================================================================
+// Command-buffer record/replay (sequences, Submission: ../common/command_replay.h)
+// ============================================================================
+
+// Everything convolveSeparable sets up per call for convolve_h → convolve_v,
+// minus the buffers
+void setSeparableArgs(cl_kernel kernelH, cl_kernel kernelV,
+                      cl_mem bufInput, cl_mem bufTemp, cl_mem bufOutput, cl_mem bufKernel,
+                      int width, int height, int ksize) {
+    clSetKernelArg(kernelH, 0, sizeof(cl_mem), &bufInput);
+    clSetKernelArg(kernelH, 1, sizeof(cl_mem), &bufTemp);
+    clSetKernelArg(kernelH, 2, sizeof(cl_mem), &bufKernel);
+    clSetKernelArg(kernelH, 3, sizeof(int), &width);
+    clSetKernelArg(kernelH, 4, sizeof(int), &height);
+    clSetKernelArg(kernelH, 5, sizeof(int), &ksize);
+    
+    clSetKernelArg(kernelV, 0, sizeof(cl_mem), &bufTemp);
+    clSetKernelArg(kernelV, 1, sizeof(cl_mem), &bufOutput);
+    clSetKernelArg(kernelV, 2, sizeof(cl_mem), &bufKernel);
+    clSetKernelArg(kernelV, 3, sizeof(int), &width);
+    clSetKernelArg(kernelV, 4, sizeof(int), &height);
+    clSetKernelArg(kernelV, 5, sizeof(int), &ksize);
+}
+
+void printReplayRow(const std::string& name, double submitUs, double stepUs, double baselineSubmitUs, float error) {
+    std::cout << std::left << std::setw(28) << name
+              << std::right << std::setw(14) << submitUs
+              << std::setw(12) << stepUs
+              << std::setw(12) << (baselineSubmitUs - submitUs)
+              << std::setw(12) << std::scientific << std::setprecision(1) << error
+              << std::fixed << std::setprecision(2) << "\n";
+}
+
+// Replays the separable blur `steps` times per submission strategy, with one
+// clFinish at the end. "Submit" is host time spent in the submission calls
+// alone; "step" is wall time per iteration including the kernels.
+void runReplaySweep(int steps,
+                    const std::vector<cl_device_id>& devices,
+                    const std::vector<std::string>& deviceNames,
+                    const std::vector<cl_context>& contexts,
+                    const std::vector<cl_program>& programs) {
+    // Small images, where launch overhead is a visible part of a step
+    std::vector<int> imageSizes = {256, 512, 1024, 2048};
+    const int ksize = 7;
+    const Submission SUBMISSIONS[] = {Submission::PerStep, Submission::HostList, Submission::CommandBuffer};
+    
+    for (int imgSize : imageSizes) {
+        int width = imgSize;
+        int height = imgSize;
+        size_t imageSize = (size_t)width * height * sizeof(float);
+        
+        std::cout << "========================================\n";
+        std::cout << "Image: " << width << "x" << height << ", separable " << ksize << "x" << ksize
+                  << ", " << steps << " steps\n";
+        std::cout << "========================================\n";
+        
+        HostVector<float> input((size_t)width * height);
+        for (size_t i = 0; i < input.size(); i++) {
+            input[i] = static_cast<float>(i % 256) / 255.0f;
+        }
+        HostVector<float> output(input.size());
+        HostVector<float> kernel2d = createGaussianKernel(ksize, ksize / 6.0f);
+        HostVector<float> kernel1d = createGaussianKernel1D(ksize, ksize / 6.0f);
+        
+        convolveSerial(input, output, kernel2d, width, height, ksize);
+        HostVector<float> expectedResult = output;
+        
+        for (size_t i = 0; i < devices.size(); i++) {
+            cl_int err;
+            cl_command_queue queue = clCreateCommandQueueWithProperties(contexts[i], devices[i], nullptr, &err);
+            checkError(err, "clCreateCommandQueue");
+            
+            cl_mem bufInput = allocateBuffer(contexts[i], CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                             imageSize, (void*)input.data(), &err);
+            checkError(err, "clCreateBuffer input");
+            cl_mem bufTemp = allocateBuffer(contexts[i], CL_MEM_READ_WRITE, imageSize, nullptr, &err);
+            checkError(err, "clCreateBuffer temp");
+            cl_mem bufOutput = allocateBuffer(contexts[i], CL_MEM_WRITE_ONLY, imageSize, nullptr, &err);
+            checkError(err, "clCreateBuffer output");
+            cl_mem bufKernel = allocateBuffer(contexts[i], CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                              ksize * sizeof(float), (void*)kernel1d.data(), &err);
+            checkError(err, "clCreateBuffer kernel");
+            
+            cl_kernel kernelH = clCreateKernel(programs[i], "convolve_h", &err);
+            checkError(err, "clCreateKernel convolve_h");
+            cl_kernel kernelV = clCreateKernel(programs[i], "convolve_v", &err);
+            checkError(err, "clCreateKernel convolve_v");
+            setSeparableArgs(kernelH, kernelV, bufInput, bufTemp, bufOutput, bufKernel, width, height, ksize);
+            
+            size_t globalSize[2] = {(size_t)width, (size_t)height};
+            
+            std::cout << "\n" << deviceNames[i] << "\n";
+            std::cout << std::fixed << std::setprecision(2);
+            std::cout << std::left << std::setw(28) << "Submission"
+                      << std::right << std::setw(14) << "Submit (us)"
+                      << std::setw(12) << "Step (us)"
+                      << std::setw(12) << "Saved (us)"
+                      << std::setw(12) << "Max error" << "\n";
+            std::cout << std::string(78, '-') << "\n";
+            
+            double baselineSubmitUs = 0.0;
+            for (Submission submission : SUBMISSIONS) {
+                CommandSequence seq;
+                seq.queue = queue;
+                recordLaunch(seq, kernelH, 2, globalSize, nullptr);
+                recordLaunch(seq, kernelV, 2, globalSize, nullptr);
+                finalizeSequence(seq, devices[i], submission == Submission::CommandBuffer);
+                
+                if (submission == Submission::CommandBuffer && !seq.native) {
+                    std::cout << std::left << std::setw(28) << submissionName(submission)
+                              << "n/a (no cl_khr_command_buffer)\n";
+                    releaseSequence(seq);
+                    continue;
+                }
+                
+                // Step 0 is a warm-up, so first-launch costs stay out of the timing
+                double submitUs = 0.0;
+                auto start = std::chrono::high_resolution_clock::now();
+                for (int step = 0; step <= steps; step++) {
+                    auto submitStart = std::chrono::high_resolution_clock::now();
+                    if (submission == Submission::PerStep) {
+                        setSeparableArgs(kernelH, kernelV, bufInput, bufTemp, bufOutput, bufKernel,
+                                         width, height, ksize);
+                        clEnqueueNDRangeKernel(queue, kernelH, 2, nullptr, globalSize, nullptr, 0, nullptr, nullptr);
+                        clEnqueueNDRangeKernel(queue, kernelV, 2, nullptr, globalSize, nullptr, 0, nullptr, nullptr);
+                    } else {
+                        replaySequence(seq);
+                    }
+                    auto submitEnd = std::chrono::high_resolution_clock::now();
+                    
+                    if (step == 0) {
+                        clFinish(queue);
+                        start = std::chrono::high_resolution_clock::now();
+                    } else {
+                        submitUs += std::chrono::duration<double, std::micro>(submitEnd - submitStart).count();
+                    }
+                }
+                clFinish(queue);
+                auto end = std::chrono::high_resolution_clock::now();
+                double stepUs = std::chrono::duration<double, std::micro>(end - start).count() / steps;
+                submitUs /= steps;
+                if (submission == Submission::PerStep) baselineSubmitUs = submitUs;
+                
+                clEnqueueReadBuffer(queue, bufOutput, CL_TRUE, 0, imageSize, output.data(), 0, nullptr, nullptr);
+                std::string label = submissionName(submission);
+                if (seq.pendingWaits > 0) label += " (serialized)";
+                printReplayRow(label, submitUs, stepUs, baselineSubmitUs, maxAbsDiff(expectedResult, output));
+                
+                releaseSequence(seq);
+            }
+            
+            releaseBuffer(bufInput);
+            releaseBuffer(bufTemp);
+            releaseBuffer(bufOutput);
+            releaseBuffer(bufKernel);
+            clReleaseKernel(kernelH);
+            clReleaseKernel(kernelV);
+            clReleaseCommandQueue(queue);
+        }
+        
+        std::cout << "\n";
+    }
+}
+
+// ============================================================================
+// Task graph on out-of-order / multiple queues
+// ============================================================================
+
+// A node of the task graph: a kernel launch or a non-blocking transfer, with
+// the buffers it reads and writes. Dependencies are derived from those sets.
+enum class TaskKind { Kernel, Write, Read };
+
+struct GraphTask {
+    std::string name;
+    TaskKind kind;
+    cl_kernel kernel;               // Kernel: arguments already set, owned by the graph
+    cl_uint workDim;
+    size_t globalSize[2];
+    cl_mem buffer;                  // Write/Read
+    void* host;
+    size_t bytes;
+    std::vector<cl_mem> reads;
+    std::vector<cl_mem> writes;
+    std::vector<int> deps;          // derived by executeGraph
+    int queue;
+    cl_event event;
+};
+
+struct TaskGraph {
+    std::vector<cl_command_queue> queues;   // one out-of-order queue, or several in-order ones
+    bool outOfOrder;
+    std::vector<GraphTask> tasks;
+};
+
+bool deviceSupportsOutOfOrder(cl_device_id device) {
+    cl_command_queue_properties props = 0;
+    clGetDeviceInfo(device, CL_DEVICE_QUEUE_ON_HOST_PROPERTIES, sizeof(props), &props, nullptr);
+    return (props & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE) != 0;
+}
+
+TaskGraph createTaskGraph(cl_context context, cl_device_id device, int numQueues, bool outOfOrder) {
+    TaskGraph graph;
+    graph.outOfOrder = outOfOrder;
+    
+    cl_command_queue_properties queueProps = CL_QUEUE_PROFILING_ENABLE;
+    if (outOfOrder) queueProps |= CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE;
+    cl_queue_properties props[] = {CL_QUEUE_PROPERTIES, queueProps, 0};
+    for (int q = 0; q < (outOfOrder ? 1 : numQueues); q++) {
+        cl_int err;
+        graph.queues.push_back(clCreateCommandQueueWithProperties(context, device, props, &err));
+        checkError(err, "clCreateCommandQueue (graph)");
+    }
+    return graph;
+}
+
+int addKernelTask(TaskGraph& graph, const std::string& name, cl_kernel kernel,
+                  cl_uint workDim, const size_t* globalSize,
+                  const std::vector<cl_mem>& reads, const std::vector<cl_mem>& writes) {
+    GraphTask task = {};
+    task.name = name;
+    task.kind = TaskKind::Kernel;
+    task.kernel = kernel;
+    task.workDim = workDim;
+    for (cl_uint d = 0; d < workDim; d++) task.globalSize[d] = globalSize[d];
+    task.reads = reads;
+    task.writes = writes;
+    graph.tasks.push_back(task);
+    return (int)graph.tasks.size() - 1;
+}
+
+int addWriteTask(TaskGraph& graph, const std::string& name, cl_mem buffer, const void* host, size_t bytes) {
+    GraphTask task = {};
+    task.name = name;
+    task.kind = TaskKind::Write;
+    task.buffer = buffer;
+    task.host = const_cast<void*>(host);
+    task.bytes = bytes;
+    task.writes = {buffer};
+    graph.tasks.push_back(task);
+    return (int)graph.tasks.size() - 1;
+}
+
+int addReadTask(TaskGraph& graph, const std::string& name, cl_mem buffer, void* host, size_t bytes) {
+    GraphTask task = {};
+    task.name = name;
+    task.kind = TaskKind::Read;
+    task.buffer = buffer;
+    task.host = host;
+    task.bytes = bytes;
+    task.reads = {buffer};
+    graph.tasks.push_back(task);
+    return (int)graph.tasks.size() - 1;
+}
+
+// Derives dependencies from declaration order: a task waits for the last
+// writer of every buffer it touches (RAW, WAW) and, for buffers it writes, for
+// every reader since that write (WAR). With several in-order queues a task
+// follows a dependency whose queue it can extend, so chains stay on one queue
+// and branches fan out round-robin. Everything is enqueued non-blocking with
+// event wait lists; call finishGraph to wait.
+void executeGraph(TaskGraph& graph) {
+    std::map<cl_mem, int> lastWriter;
+    std::map<cl_mem, std::vector<int>> readersSinceWrite;
+    std::vector<int> queueTail(graph.queues.size(), -1);
+    int nextQueue = 0;
+    
+    for (int t = 0; t < (int)graph.tasks.size(); t++) {
+        GraphTask& task = graph.tasks[t];
+        
+        task.deps.clear();
+        for (cl_mem buf : task.reads) {
+            if (lastWriter.count(buf)) task.deps.push_back(lastWriter[buf]);
+        }
+        for (cl_mem buf : task.writes) {
+            if (lastWriter.count(buf)) task.deps.push_back(lastWriter[buf]);
+            for (int reader : readersSinceWrite[buf]) task.deps.push_back(reader);
+        }
+        std::sort(task.deps.begin(), task.deps.end());
+        task.deps.erase(std::unique(task.deps.begin(), task.deps.end()), task.deps.end());
+        task.deps.erase(std::remove(task.deps.begin(), task.deps.end(), t), task.deps.end());
+        
+        for (cl_mem buf : task.reads) readersSinceWrite[buf].push_back(t);
+        for (cl_mem buf : task.writes) {
+            lastWriter[buf] = t;
+            readersSinceWrite[buf].clear();
+        }
+        
+        task.queue = -1;
+        if (!graph.outOfOrder) {
+            for (auto dep = task.deps.rbegin(); dep != task.deps.rend() && task.queue < 0; ++dep) {
+                int q = graph.tasks[*dep].queue;
+                if (queueTail[q] == *dep) task.queue = q;
+            }
+        }
+        if (task.queue < 0) {
+            task.queue = nextQueue;
+            nextQueue = (nextQueue + 1) % graph.queues.size();
+        }
+        queueTail[task.queue] = t;
+        
+        std::vector<cl_event> waitList;
+        for (int dep : task.deps) waitList.push_back(graph.tasks[dep].event);
+        cl_uint numWaits = (cl_uint)waitList.size();
+        const cl_event* waits = numWaits ? waitList.data() : nullptr;
+        cl_command_queue queue = graph.queues[task.queue];
+        
+        cl_int err = CL_SUCCESS;
+        switch (task.kind) {
+            case TaskKind::Kernel:
+                err = clEnqueueNDRangeKernel(queue, task.kernel, task.workDim, nullptr, task.globalSize,
+                                             nullptr, numWaits, waits, &task.event);
+                break;
+            case TaskKind::Write:
+                err = clEnqueueWriteBuffer(queue, task.buffer, CL_FALSE, 0, task.bytes, task.host,
+                                           numWaits, waits, &task.event);
+                break;
+            case TaskKind::Read:
+                err = clEnqueueReadBuffer(queue, task.buffer, CL_FALSE, 0, task.bytes, task.host,
+                                          numWaits, waits, &task.event);
+                break;
+        }
+        checkError(err, task.name.c_str());
+    }
+    
+    for (auto& queue : graph.queues) clFlush(queue);
+}
+
+void finishGraph(TaskGraph& graph) {
+    for (auto& queue : graph.queues) clFinish(queue);
+}
+
+void releaseGraph(TaskGraph& graph) {
+    for (auto& task : graph.tasks) {
+        if (task.kind == TaskKind::Kernel) clReleaseKernel(task.kernel);
+        if (task.event) clReleaseEvent(task.event);
+    }
+    for (auto& queue : graph.queues) clReleaseCommandQueue(queue);
+    graph.tasks.clear();
+    graph.queues.clear();
+}
+
+// Achieved concurrency from the profiling events: busy time summed over all
+// tasks divided by the makespan (1.0 = fully serialized), plus the peak
+// number of tasks in flight. With `printTasks`, also prints one trace row per
+// task with a timeline bar.
+double graphConcurrency(const TaskGraph& graph, bool printTasks, int* peak) {
+    const int BAR_WIDTH = 50;
+    std::vector<cl_ulong> starts, ends;
+    for (const auto& task : graph.tasks) {
+        starts.push_back(eventTime(task.event, CL_PROFILING_COMMAND_START));
+        ends.push_back(eventTime(task.event, CL_PROFILING_COMMAND_END));
+    }
+    cl_ulong first = *std::min_element(starts.begin(), starts.end());
+    cl_ulong last = *std::max_element(ends.begin(), ends.end());
+    double span = (double)std::max<cl_ulong>(last - first, 1);
+    
+    double busy = 0.0;
+    std::vector<std::pair<cl_ulong, int>> edges;
+    for (size_t t = 0; t < graph.tasks.size(); t++) {
+        busy += (double)(ends[t] - starts[t]);
+        edges.push_back({starts[t], 1});
+        edges.push_back({ends[t], -1});
+    }
+    // Ends sort before starts at the same timestamp, so back-to-back tasks do not count as overlap
+    std::sort(edges.begin(), edges.end());
+    int inFlight = 0;
+    *peak = 0;
+    for (const auto& edge : edges) {
+        inFlight += edge.second;
+        *peak = std::max(*peak, inFlight);
+    }
+    
+    if (printTasks) {
+        std::cout << std::left << std::setw(24) << "Task"
+                  << std::right << std::setw(6) << "Queue"
+                  << std::left << "  " << std::setw(14) << "Deps"
+                  << std::right << std::setw(10) << "Start (us)"
+                  << std::setw(10) << "End (us)" << "  Timeline\n";
+        std::cout << std::string(66 + BAR_WIDTH, '-') << "\n";
+        for (size_t t = 0; t < graph.tasks.size(); t++) {
+            const GraphTask& task = graph.tasks[t];
+            std::string deps;
+            for (int dep : task.deps) deps += (deps.empty() ? "" : ",") + std::to_string(dep);
+            
+            int from = (int)((starts[t] - first) / span * BAR_WIDTH);
+            int to = std::max(from + 1, (int)((ends[t] - first) / span * BAR_WIDTH));
+            std::string bar(std::min(to, BAR_WIDTH), ' ');
+            std::fill(bar.begin() + std::min(from, BAR_WIDTH - 1), bar.end(), '#');
+            
+            std::cout << std::left << std::setw(24) << (std::to_string(t) + " " + task.name)
+                      << std::right << std::setw(6) << task.queue
+                      << std::left << "  " << std::setw(14) << (deps.empty() ? "-" : deps)
+                      << std::right << std::setw(10) << (starts[t] - first) / 1000.0
+                      << std::setw(10) << (ends[t] - first) / 1000.0
+                      << "  |" << bar << "\n";
+        }
+        std::cout << "\n";
+    }
+    
+    return busy / span;
+}
+
+// Per-frame device buffers of the difference-of-Gaussians graph
+struct DogFrameBuffers {
+    cl_mem input, tempSmall, tempLarge, blurSmall, blurLarge, output;
+};
+
+cl_kernel createSeparableKernel(cl_program program, const char* name,
+                                cl_mem input, cl_mem output, cl_mem filter,
+                                int width, int height, int ksize) {
+    cl_int err;
+    cl_kernel kernel = clCreateKernel(program, name, &err);
+    checkError(err, name);
+    clSetKernelArg(kernel, 0, sizeof(cl_mem), &input);
+    clSetKernelArg(kernel, 1, sizeof(cl_mem), &output);
+    clSetKernelArg(kernel, 2, sizeof(cl_mem), &filter);
+    clSetKernelArg(kernel, 3, sizeof(int), &width);
+    clSetKernelArg(kernel, 4, sizeof(int), &height);
+    clSetKernelArg(kernel, 5, sizeof(int), &ksize);
+    return kernel;
+}
+
+// Per frame: upload → two independent separable blurs (small and large sigma)
+// → difference → read back. The branches and the frames only share the
+// read-only filters, so the executor is free to overlap them with each other
+// and with the transfers.
+void buildDogGraph(TaskGraph& graph,
+                   const std::vector<HostVector<float>>& frames,
+                   std::vector<HostVector<float>>& results,
+                   const std::vector<DogFrameBuffers>& buffers,
+                   cl_mem filterSmall, cl_mem filterLarge,
+                   int width, int height, int kSmall, int kLarge,
+                   cl_program program) {
+    size_t imageBytes = (size_t)width * height * sizeof(float);
+    size_t globalSize[2] = {(size_t)width, (size_t)height};
+    size_t pixels = (size_t)width * height;
+    int count = (int)pixels;
+    
+    for (size_t f = 0; f < frames.size(); f++) {
+        const DogFrameBuffers& b = buffers[f];
+        std::string frame = "f" + std::to_string(f) + " ";
+        
+        addWriteTask(graph, frame + "upload", b.input, frames[f].data(), imageBytes);
+        
+        addKernelTask(graph, frame + "blur_h small",
+                      createSeparableKernel(program, "convolve_h", b.input, b.tempSmall, filterSmall,
+                                            width, height, kSmall),
+                      2, globalSize, {b.input, filterSmall}, {b.tempSmall});
+        addKernelTask(graph, frame + "blur_h large",
+                      createSeparableKernel(program, "convolve_h", b.input, b.tempLarge, filterLarge,
+                                            width, height, kLarge),
+                      2, globalSize, {b.input, filterLarge}, {b.tempLarge});
+        addKernelTask(graph, frame + "blur_v small",
+                      createSeparableKernel(program, "convolve_v", b.tempSmall, b.blurSmall, filterSmall,
+                                            width, height, kSmall),
+                      2, globalSize, {b.tempSmall, filterSmall}, {b.blurSmall});
+        addKernelTask(graph, frame + "blur_v large",
+                      createSeparableKernel(program, "convolve_v", b.tempLarge, b.blurLarge, filterLarge,
+                                            width, height, kLarge),
+                      2, globalSize, {b.tempLarge, filterLarge}, {b.blurLarge});
+        
+        cl_int err;
+        cl_kernel difference = clCreateKernel(program, "image_difference", &err);
+        checkError(err, "clCreateKernel image_difference");
+        clSetKernelArg(difference, 0, sizeof(cl_mem), &b.blurSmall);
+        clSetKernelArg(difference, 1, sizeof(cl_mem), &b.blurLarge);
+        clSetKernelArg(difference, 2, sizeof(cl_mem), &b.output);
+        clSetKernelArg(difference, 3, sizeof(int), &count);
+        addKernelTask(graph, frame + "difference", difference, 1, &pixels,
+                      {b.blurSmall, b.blurLarge}, {b.output});
+        
+        addReadTask(graph, frame + "download", b.output, results[f].data(), imageBytes);
+    }
+}
+
+struct GraphExecutor {
+    const char* name;
+    int numQueues;
+    bool outOfOrder;
+};
+
+// Runs the difference-of-Gaussians graph over `numFrames` frames on each
+// device with a serial in-order queue, several in-order queues and an
+// out-of-order queue, and prints the trace of the fastest executor
+void runTaskGraph(int numFrames, int imgSize,
+                  const std::vector<cl_device_id>& devices,
+                  const std::vector<std::string>& deviceNames,
+                  const std::vector<cl_context>& contexts,
+                  const std::vector<cl_program>& programs) {
+    const int kSmall = 5;
+    const int kLarge = 15;
+    const GraphExecutor EXECUTORS[] = {
+        {"In-order queue (serial)", 1, false},
+        {"3 in-order queues", 3, false},
+        {"Out-of-order queue", 1, true},
+    };
+    int width = imgSize;
+    int height = imgSize;
+    size_t imageBytes = (size_t)width * height * sizeof(float);
+    
+    std::cout << "Graph: " << numFrames << " frames of " << width << "x" << height
+              << ", upload -> blur " << kSmall << "x" << kSmall << " || blur " << kLarge << "x" << kLarge
+              << " -> difference -> download (" << numFrames * 7 << " tasks)\n\n";
+    
+    std::vector<HostVector<float>> frames(numFrames, HostVector<float>((size_t)width * height));
+    for (int f = 0; f < numFrames; f++) {
+        for (size_t i = 0; i < frames[f].size(); i++) {
+            frames[f][i] = static_cast<float>((i + f * 37) % 256) / 255.0f;
+        }
+    }
+    HostVector<float> kernel1dSmall = createGaussianKernel1D(kSmall, kSmall / 6.0f);
+    HostVector<float> kernel1dLarge = createGaussianKernel1D(kLarge, kLarge / 6.0f);
+    
+    // CPU reference for frame 0
+    HostVector<float> blurSmall(frames[0].size()), blurLarge(frames[0].size());
+    convolveSerial(frames[0], blurSmall, createGaussianKernel(kSmall, kSmall / 6.0f), width, height, kSmall);
+    convolveSerial(frames[0], blurLarge, createGaussianKernel(kLarge, kLarge / 6.0f), width, height, kLarge);
+    HostVector<float> expectedResult(frames[0].size());
+    for (size_t i = 0; i < expectedResult.size(); i++) expectedResult[i] = blurSmall[i] - blurLarge[i];
+    
+    for (size_t d = 0; d < devices.size(); d++) {
+        cl_int err;
+        std::vector<DogFrameBuffers> buffers(numFrames);
+        for (auto& b : buffers) {
+            cl_mem* all[] = {&b.input, &b.tempSmall, &b.tempLarge, &b.blurSmall, &b.blurLarge, &b.output};
+            for (cl_mem* buf : all) {
+                *buf = allocateBuffer(contexts[d], CL_MEM_READ_WRITE, imageBytes, nullptr, &err);
+                checkError(err, "clCreateBuffer (graph)");
+            }
+        }
+        cl_mem filterSmall = allocateBuffer(contexts[d], CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                            kSmall * sizeof(float), kernel1dSmall.data(), &err);
+        checkError(err, "clCreateBuffer filter");
+        cl_mem filterLarge = allocateBuffer(contexts[d], CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                            kLarge * sizeof(float), kernel1dLarge.data(), &err);
+        checkError(err, "clCreateBuffer filter");
+        std::vector<HostVector<float>> results(numFrames, HostVector<float>((size_t)width * height));
+        
+        std::cout << deviceNames[d] << "\n";
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << std::left << std::setw(28) << "Executor"
+                  << std::right << std::setw(12) << "Time (ms)"
+                  << std::setw(14) << "Concurrency"
+                  << std::setw(8) << "Peak"
+                  << std::setw(12) << "Max error" << "\n";
+        std::cout << std::string(74, '-') << "\n";
+        
+        double bestTime = 0.0;
+        int bestExecutor = -1;
+        for (int e = 0; e < (int)(sizeof(EXECUTORS) / sizeof(EXECUTORS[0])); e++) {
+            const GraphExecutor& executor = EXECUTORS[e];
+            if (executor.outOfOrder && !deviceSupportsOutOfOrder(devices[d])) {
+                std::cout << std::left << std::setw(28) << executor.name << "n/a (no out-of-order queues)\n";
+                continue;
+            }
+            
+            // Run 0 warms up; kernel creation and argument setup stay out of the timing
+            double timeMs = 0.0;
+            for (int run = 0; run < 2; run++) {
+                TaskGraph graph = createTaskGraph(contexts[d], devices[d], executor.numQueues, executor.outOfOrder);
+                buildDogGraph(graph, frames, results, buffers, filterSmall, filterLarge,
+                              width, height, kSmall, kLarge, programs[d]);
+                
+                auto start = std::chrono::high_resolution_clock::now();
+                executeGraph(graph);
+                finishGraph(graph);
+                auto end = std::chrono::high_resolution_clock::now();
+                timeMs = std::chrono::duration<double, std::milli>(end - start).count();
+                
+                if (run == 1) {
+                    int peak;
+                    double concurrency = graphConcurrency(graph, false, &peak);
+                    std::cout << std::left << std::setw(28) << executor.name
+                              << std::right << std::setw(12) << timeMs
+                              << std::setw(13) << concurrency << "x"
+                              << std::setw(8) << peak
+                              << std::setw(12) << std::scientific << std::setprecision(1)
+                              << maxAbsDiff(expectedResult, results[0])
+                              << std::fixed << std::setprecision(2) << "\n";
+                    if (bestExecutor < 0 || timeMs < bestTime) {
+                        bestTime = timeMs;
+                        bestExecutor = e;
+                    }
+                }
+                releaseGraph(graph);
+            }
+        }
+        
+        // Re-run the fastest executor once more for its trace
+        if (bestExecutor >= 0) {
+            const GraphExecutor& executor = EXECUTORS[bestExecutor];
+            std::cout << "\nTrace (" << executor.name << "):\n";
+            TaskGraph graph = createTaskGraph(contexts[d], devices[d], executor.numQueues, executor.outOfOrder);
+            buildDogGraph(graph, frames, results, buffers, filterSmall, filterLarge,
+                          width, height, kSmall, kLarge, programs[d]);
+            executeGraph(graph);
+            finishGraph(graph);
+            int peak;
+            graphConcurrency(graph, true, &peak);
+            releaseGraph(graph);
+        }
+        
+        for (auto& b : buffers) {
+            cl_mem all[] = {b.input, b.tempSmall, b.tempLarge, b.blurSmall, b.blurLarge, b.output};
+            for (cl_mem buf : all) releaseBuffer(buf);
+        }
+        releaseBuffer(filterSmall);
+        releaseBuffer(filterLarge);
+    }
+}
+
+// Parse "--stream [2k|4k|8k|WxH] [--fps F] [--frames N] [--ksize K] [--input file.raw]"
+bool parseStreamArgs(int argc, char** argv, StreamConfig& cfg) {
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "2k" || arg == "2K") { cfg.width = 2048; cfg.height = 1080; }
+        else if (arg == "4k" || arg == "4K") { cfg.width = 3840; cfg.height = 2160; }
+        else if (arg == "8k" || arg == "8K") { cfg.width = 7680; cfg.height = 4320; }
+        else if (arg.find('x') != std::string::npos && std::isdigit((unsigned char)arg[0])) {
+            cfg.width = std::stoi(arg.substr(0, arg.find('x')));
+            cfg.height = std::stoi(arg.substr(arg.find('x') + 1));
+        }
+        else if (arg == "--fps" && i + 1 < argc) cfg.targetFps = std::stod(argv[++i]);
+        else if (arg == "--frames" && i + 1 < argc) cfg.frames = std::stoi(argv[++i]);
+        else if (arg == "--ksize" && i + 1 < argc) cfg.ksize = std::stoi(argv[++i]);
+        else if (arg == "--input" && i + 1 < argc) cfg.rawFile = argv[++i];
+        else {
+            std::cerr << "Unknown stream option: " << arg << "\n";
+            return false;
+        }
+    }
+    return cfg.width > 0 && cfg.height > 0 && cfg.frames > 0 && cfg.ksize > 0 && (cfg.ksize % 2) == 1;
+}
+
+int main(int argc, char** argv) {
+    std::cout << "=== Image Convolution Performance Comparison ===\n\n";
+    
+    // Test configurations
+    std::vector<int> imageSizes = {512, 1024, 2048, 4096};
+    std::vector<int> kernelSizes = {3, 5, 7, 11, 15};
+    
+    // Get OpenCL devices
+    cl_uint numPlatforms;
+    clGetPlatformIDs(0, nullptr, &numPlatforms);
+    std::vector<cl_platform_id> platforms(numPlatforms);
+    clGetPlatformIDs(numPlatforms, platforms.data(), nullptr);
+    
+    std::vector<cl_device_id> devices;
+    std::vector<std::string> deviceNames;
+    std::vector<cl_context> contexts;
+    std::vector<cl_program> programs;
+    
+    std::string kernelSource = loadKernelSource("convolution.cl");
+    const char* kernelSourcePtr = kernelSource.c_str();
+    size_t kernelSourceSize = kernelSource.size();
+    
+    for (cl_uint p = 0; p < numPlatforms; p++) {
+        cl_uint numDevices;
+        cl_int err = clGetDeviceIDs(platforms[p], CL_DEVICE_TYPE_ALL, 0, nullptr, &numDevices);
+        if (err == CL_SUCCESS && numDevices > 0) {
+            std::vector<cl_device_id> platformDevices(numDevices);
+            clGetDeviceIDs(platforms[p], CL_DEVICE_TYPE_ALL, numDevices, platformDevices.data(), nullptr);
+            
+            for (cl_uint d = 0; d < numDevices; d++) {
+                devices.push_back(platformDevices[d]);
+                
+                char name[128];
+                clGetDeviceInfo(platformDevices[d], CL_DEVICE_NAME, sizeof(name), name, nullptr);
+                deviceNames.push_back(std::string(name));
+                
+                cl_context context = clCreateContext(nullptr, 1, &platformDevices[d], nullptr, nullptr, &err);
+                contexts.push_back(context);
+                
+                cl_program program = clCreateProgramWithSource(context, 1, &kernelSourcePtr, &kernelSourceSize, &err);
+                err = clBuildProgram(program, 1, &platformDevices[d], nullptr, nullptr, nullptr);
+                
+                // CHECK BUILD STATUS
+                if (err != CL_SUCCESS) {
+                    size_t logSize;
+                    clGetProgramBuildInfo(program, platformDevices[d], CL_PROGRAM_BUILD_LOG, 0, nullptr, &logSize);
+                    std::vector<char> log(logSize);
+                    clGetProgramBuildInfo(program, platformDevices[d], CL_PROGRAM_BUILD_LOG, logSize, log.data(), nullptr);
+                    std::cerr << "Build error for " << name << ":\n" << log.data() << "\n";
+                    std::cerr << "Skipping this device.\n\n";
+                    clReleaseContext(context);
+                    contexts.pop_back();
+                    devices.pop_back();
+                    deviceNames.pop_back();
+                    continue;
+                }
+                
+                programs.push_back(program);
+            }
+        }
+    }
+    
+    std::cout << "OpenMP threads: " << omp_get_max_threads() << "\n";
+    std::cout << "OpenCL devices: " << devices.size() << "\n\n";
+    
+    if (argc > 1 && std::string(argv[1]) == "--stream") {
+        StreamConfig cfg;
+        if (!parseStreamArgs(argc, argv, cfg)) {
+            std::cerr << "Usage: image_convolution --stream [2k|4k|8k|WxH] [--fps F] [--frames N]"
+                      << " [--ksize K] [--input frames.raw]\n";
+            return 1;
+        }
+        
+        std::cout << "=== Streaming Mode ===\n";
+        std::cout << "Frame size: " << cfg.width << "x" << cfg.height << " (8-bit grayscale)\n";
+        std::cout << "Source: " << (cfg.rawFile.empty() ? "synthetic generator" : cfg.rawFile) << "\n";
+        std::cout << "Target: " << (cfg.targetFps > 0.0 ? std::to_string((int)cfg.targetFps) + " fps" : "unpaced")
+                  << ", " << cfg.frames << " frames, separable " << cfg.ksize << "x" << cfg.ksize << " Gaussian\n\n";
+        
+        for (size_t i = 0; i < devices.size(); i++) {
+            runStreaming(cfg, devices[i], contexts[i], programs[i], deviceNames[i]);
+        }
+        
+        std::cout << "\n";
+        printPeakFootprint(deviceNames, contexts);
+        
+        for (auto& prog : programs) clReleaseProgram(prog);
+        for (auto& ctx : contexts) clReleaseContext(ctx);
+        return 0;
+    }
+    
+    if (argc > 1 && std::string(argv[1]) == "--box") {
+        std::cout << "=== Box/Mean Filter: Direct vs O(1) per Pixel ===\n\n";
+        runBoxFilterSweep(devices, deviceNames, contexts, programs);
+        
+        std::cout << "\n";
+        printPeakFootprint(deviceNames, contexts);
+        
+        for (auto& prog : programs) clReleaseProgram(prog);
+        for (auto& ctx : contexts) clReleaseContext(ctx);
+        return 0;
+    }
+    
+    if (argc > 1 && std::string(argv[1]) == "--multidevice") {
+        int imgSize = (argc > 2) ? std::atoi(argv[2]) : 4096;
+        int ksize = (argc > 3) ? std::atoi(argv[3]) : 15;
+        if (imgSize <= 0 || ksize <= 0 || (ksize % 2) == 0 || devices.empty()) {
+            std::cerr << "Usage: image_convolution --multidevice [size] [odd ksize]\n";
+            return 1;
+        }
+        
+        std::cout << "=== Multi-Device Row-Split Convolution ===\n\n";
+        runMultiDevice(imgSize, ksize, devices, deviceNames, contexts, programs);
+        
+        std::cout << "\n";
+        printPeakFootprint(deviceNames, contexts);
+        
+        for (auto& prog : programs) clReleaseProgram(prog);
+        for (auto& ctx : contexts) clReleaseContext(ctx);
+        return 0;
+    }
+    
+    if (argc > 1 && std::string(argv[1]) == "--layers") {
+        int batch = (argc > 2) ? std::atoi(argv[2]) : 8;
+        if (batch <= 0) {
+            std::cerr << "Usage: image_convolution --layers [batch]\n";
+            return 1;
+        }
+        
+        std::cout << "=== CNN Convolution Layers (NCHW) ===\n\n";
+        runConvLayers(batch, devices, deviceNames, contexts, programs);
+        
+        std::cout << "\n";
+        printPeakFootprint(deviceNames, contexts);
+        
+        for (auto& prog : programs) clReleaseProgram(prog);
+        for (auto& ctx : contexts) clReleaseContext(ctx);
+        return 0;
+    }
+    
+    if (argc > 1 && std::string(argv[1]) == "--precision") {
+        std::cout << "=== Precision Modes: Build Options vs Throughput and Error ===\n\n";
+        runPrecisionSweep(devices, deviceNames, contexts, kernelSource);
+        
+        std::cout << "\n";
+        printPeakFootprint(deviceNames, contexts);
+        
+        for (auto& prog : programs) clReleaseProgram(prog);
+        for (auto& ctx : contexts) clReleaseContext(ctx);
+        return 0;
+    }
+    
+    if (argc > 1 && std::string(argv[1]) == "--winograd") {
+        std::cout << "=== Winograd 3x3 Convolution vs Direct ===\n\n";
+        runWinogradSweep(devices, deviceNames, contexts, programs);
+        
+        std::cout << "\n";
+        printPeakFootprint(deviceNames, contexts);
+        
+        for (auto& prog : programs) clReleaseProgram(prog);
+        for (auto& ctx : contexts) clReleaseContext(ctx);
+        return 0;
+    }
+    
+    if (argc > 1 && std::string(argv[1]) == "--replay") {
+        int steps = (argc > 2) ? std::atoi(argv[2]) : 1000;
+        if (steps <= 0) {
+            std::cerr << "Usage: image_convolution --replay [steps]\n";
+            return 1;
+        }
+        
+        std::cout << "=== Record/Replay of the Separable Blur ===\n\n";
+        runReplaySweep(steps, devices, deviceNames, contexts, programs);
+        
+        std::cout << "\n";
+        printPeakFootprint(deviceNames, contexts);
+        
+        for (auto& prog : programs) clReleaseProgram(prog);
+        for (auto& ctx : contexts) clReleaseContext(ctx);
+        return 0;
+    }
+    
+    if (argc > 1 && std::string(argv[1]) == "--graph") {
+        int numFrames = (argc > 2) ? std::atoi(argv[2]) : 4;
+        int imgSize = (argc > 3) ? std::atoi(argv[3]) : 2048;
+        if (numFrames <= 0 || imgSize <= 0) {
+            std::cerr << "Usage: image_convolution --graph [frames] [size]\n";
+            return 1;
+        }
+        
+        std::cout << "=== Task Graph Executor (Difference of Gaussians) ===\n\n";
+        runTaskGraph(numFrames, imgSize, devices, deviceNames, contexts, programs);
+        
+        std::cout << "\n";
+        printPeakFootprint(deviceNames, contexts);
+        
+        for (auto& prog : programs) clReleaseProgram(prog);
+        for (auto& ctx : contexts) clReleaseContext(ctx);
+        return 0;
+    }
     
     // Test specific configuration
     for (int imgSize : imageSizes) {
@@ -344,41 +2694,50 @@ int main() {
             std::cout << "========================================\n";
             
             // Create synthetic image
-            std::vector<float> input(width * height);
+            HostVector<float> input(width * height);
             for (size_t i = 0; i < input.size(); i++) {
                 input[i] = static_cast<float>(i % 256) / 255.0f;
             }
             
-            std::vector<float> output(width * height);
-            std::vector<float> kernel2d = createGaussianKernel(ksize, ksize / 6.0f);
-            std::vector<float> kernel1d = createGaussianKernel1D(ksize, ksize / 6.0f);
+            HostVector<float> output(width * height);
+            HostVector<float> kernel2d = createGaussianKernel(ksize, ksize / 6.0f);
+            HostVector<float> kernel1d = createGaussianKernel1D(ksize, ksize / 6.0f);
             
             // Serial
+            resetMemoryPeaks();
             double serialTime = convolveSerial(input, output, kernel2d, width, height, ksize);
-            std::vector<float> expectedResult = output;
+            size_t serialHostPeak = hostMemory.peak;
+            HostVector<float> expectedResult = output;
             
             // OpenMP
             std::fill(output.begin(), output.end(), 0.0f);
+            resetMemoryPeaks();
             double openmpTime = convolveOpenMP(input, output, kernel2d, width, height, ksize);
+            size_t openmpHostPeak = hostMemory.peak;
             
             std::cout << "\n" << std::fixed << std::setprecision(2);
             std::cout << std::left << std::setw(40) << "Implementation"
                       << std::right << std::setw(12) << "Time (ms)"
-                      << std::setw(12) << "Speedup\n";
-            std::cout << std::string(64, '-') << "\n";
+                      << std::setw(12) << "Speedup"
+                      << std::setw(12) << "Host MB"
+                      << std::setw(12) << "Device MB" << "\n";
+            std::cout << std::string(88, '-') << "\n";
             
             std::cout << std::left << std::setw(40) << "Serial C++"
                       << std::right << std::setw(12) << serialTime
-                      << std::setw(12) << "1.00x\n";
+                      << std::setw(12) << "1.00x";
+            printFootprintColumns(serialHostPeak, nullptr);
             
             std::cout << std::left << std::setw(40) << "OpenMP"
                       << std::right << std::setw(12) << openmpTime
-                      << std::setw(12) << (serialTime / openmpTime) << "x\n";
+                      << std::setw(11) << (serialTime / openmpTime) << "x";
+            printFootprintColumns(openmpHostPeak, nullptr);
             
             // OpenCL devices
             for (size_t i = 0; i < devices.size(); i++) {
                 // Simple version
                 std::fill(output.begin(), output.end(), 0.0f);
+                resetMemoryPeaks();
                 double simpleTime = convolveOpenCL(input, output, kernel2d, width, height, ksize,
                                                     devices[i], contexts[i], programs[i],
                                                     "convolve_2d", false);
@@ -386,10 +2745,12 @@ int main() {
                 std::string name = "OpenCL: " + deviceNames[i].substr(0, 22);
                 std::cout << std::left << std::setw(40) << name
                           << std::right << std::setw(12) << simpleTime
-                          << std::setw(12) << (serialTime / simpleTime) << "x\n";
+                          << std::setw(11) << (serialTime / simpleTime) << "x";
+                printFootprintColumns(hostMemory.peak, contexts[i]);
                 
                 // Local memory version
                 std::fill(output.begin(), output.end(), 0.0f);
+                resetMemoryPeaks();
                 double localTime = convolveOpenCL(input, output, kernel2d, width, height, ksize,
                                                    devices[i], contexts[i], programs[i],
                                                    "convolve_2d_local", true);
@@ -397,17 +2758,20 @@ int main() {
                 std::string localName = "OpenCL: " + deviceNames[i].substr(0, 18) + " (local)";
                 std::cout << std::left << std::setw(40) << localName
                           << std::right << std::setw(12) << localTime
-                          << std::setw(12) << (serialTime / localTime) << "x\n";
+                          << std::setw(11) << (serialTime / localTime) << "x";
+                printFootprintColumns(hostMemory.peak, contexts[i]);
                 
                 // Separable version
                 std::fill(output.begin(), output.end(), 0.0f);
+                resetMemoryPeaks();
                 double sepTime = convolveSeparable(input, output, kernel1d, width, height, ksize,
                                                     devices[i], contexts[i], programs[i]);
                 
                 std::string sepName = "OpenCL: " + deviceNames[i].substr(0, 16) + " (separable)";
                 std::cout << std::left << std::setw(40) << sepName
                           << std::right << std::setw(12) << sepTime
-                          << std::setw(12) << (serialTime / sepTime) << "x\n";
+                          << std::setw(11) << (serialTime / sepTime) << "x";
+                printFootprintColumns(hostMemory.peak, contexts[i]);
             }
             
             std::cout << "\n";
@@ -9,7 +9,26 @@
 #include <algorithm>
 #include <random>
 #include <cmath>
+#include <string>
+#include <cstdlib>
+#include <cstdint>
+#include <atomic>
+#include <cstring>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 #include <omp.h>
+#include "../common/completion.h"
+#include "../common/command_replay.h"
+#include "../common/fp64.h"
+#ifdef HAVE_AVX_KERNEL
+#include "symmetric_avx.h"
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 struct Body {
     float x, y, z, w;  // position (w unused, for alignment)
@@ -57,29 +76,30 @@ void initializeBodies(std::vector<Body>& bodies, int n) {
 }
 
 // Serial N-body force calculation
+template <typename Real>
 double computeForcesSerial(const std::vector<Body>& bodies,
-                           std::vector<float>& acc_x,
-                           std::vector<float>& acc_y,
-                           std::vector<float>& acc_z,
+                           std::vector<Real>& acc_x,
+                           std::vector<Real>& acc_y,
+                           std::vector<Real>& acc_z,
                            float softening) {
     int n = bodies.size();
     
     auto start = std::chrono::high_resolution_clock::now();
     
     for (int i = 0; i < n; i++) {
-        float ax = 0.0f, ay = 0.0f, az = 0.0f;
+        Real ax = 0, ay = 0, az = 0;
         
         for (int j = 0; j < n; j++) {
             if (i == j) continue;
             
-            float dx = bodies[j].x - bodies[i].x;
-            float dy = bodies[j].y - bodies[i].y;
-            float dz = bodies[j].z - bodies[i].z;
+            Real dx = (Real)bodies[j].x - bodies[i].x;
+            Real dy = (Real)bodies[j].y - bodies[i].y;
+            Real dz = (Real)bodies[j].z - bodies[i].z;
             
-            float dist_sq = dx*dx + dy*dy + dz*dz + softening*softening;
-            float dist = std::sqrt(dist_sq);
-            float dist_cubed = dist_sq * dist;
-            float force = bodies[j].mass / dist_cubed;
+            Real dist_sq = dx*dx + dy*dy + dz*dz + (Real)softening*softening;
+            Real dist = std::sqrt(dist_sq);
+            Real dist_cubed = dist_sq * dist;
+            Real force = bodies[j].mass / dist_cubed;
             
             ax += dx * force;
             ay += dy * force;
@@ -96,10 +116,11 @@ double computeForcesSerial(const std::vector<Body>& bodies,
 }
 
 // OpenMP N-body
+template <typename Real>
 double computeForcesOpenMP(const std::vector<Body>& bodies,
-                           std::vector<float>& acc_x,
-                           std::vector<float>& acc_y,
-                           std::vector<float>& acc_z,
+                           std::vector<Real>& acc_x,
+                           std::vector<Real>& acc_y,
+                           std::vector<Real>& acc_z,
                            float softening) {
     int n = bodies.size();
     
@@ -107,19 +128,19 @@ double computeForcesOpenMP(const std::vector<Body>& bodies,
     
     #pragma omp parallel for
     for (int i = 0; i < n; i++) {
-        float ax = 0.0f, ay = 0.0f, az = 0.0f;
+        Real ax = 0, ay = 0, az = 0;
         
         for (int j = 0; j < n; j++) {
             if (i == j) continue;
             
-            float dx = bodies[j].x - bodies[i].x;
-            float dy = bodies[j].y - bodies[i].y;
-            float dz = bodies[j].z - bodies[i].z;
+            Real dx = (Real)bodies[j].x - bodies[i].x;
+            Real dy = (Real)bodies[j].y - bodies[i].y;
+            Real dz = (Real)bodies[j].z - bodies[i].z;
             
-            float dist_sq = dx*dx + dy*dy + dz*dz + softening*softening;
-            float dist = std::sqrt(dist_sq);
-            float dist_cubed = dist_sq * dist;
-            float force = bodies[j].mass / dist_cubed;
+            Real dist_sq = dx*dx + dy*dy + dz*dz + (Real)softening*softening;
+            Real dist = std::sqrt(dist_sq);
+            Real dist_cubed = dist_sq * dist;
+            Real force = bodies[j].mass / dist_cubed;
             
             ax += dx * force;
             ay += dy * force;
@@ -135,11 +156,12 @@ double computeForcesOpenMP(const std::vector<Body>& bodies,
     return std::chrono::duration<double, std::milli>(end - start).count();
 }
 
-// OpenCL N-body
+// OpenCL N-body. With double the *_fp64 kernels are used.
+template <typename Real>
 double computeForcesOpenCL(const std::vector<Body>& bodies,
-                           std::vector<float>& acc_x,
-                           std::vector<float>& acc_y,
-                           std::vector<float>& acc_z,
+                           std::vector<Real>& acc_x,
+                           std::vector<Real>& acc_y,
+                           std::vector<Real>& acc_z,
                            float softening,
                            cl_device_id device,
                            cl_context context,
@@ -152,30 +174,33 @@ double computeForcesOpenCL(const std::vector<Body>& bodies,
     checkError(err, "clCreateCommandQueue");
     
     // Prepare data
-    std::vector<float> positions(n * 4);
-    std::vector<float> masses(n);
-    std::vector<float> accelerations(n * 4);
+    std::vector<Real> positions(n * 4);
+    std::vector<Real> masses(n);
+    std::vector<Real> accelerations(n * 4);
+    Real soft = softening;
     
     for (int i = 0; i < n; i++) {
         positions[i*4 + 0] = bodies[i].x;
         positions[i*4 + 1] = bodies[i].y;
         positions[i*4 + 2] = bodies[i].z;
-        positions[i*4 + 3] = 0.0f;
+        positions[i*4 + 3] = 0;
         masses[i] = bodies[i].mass;
     }
     
     cl_mem bufPos = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
-                                    n * 4 * sizeof(float), positions.data(), &err);
+                                    (size_t)n * 4 * sizeof(Real), positions.data(), &err);
     checkError(err, "clCreateBuffer positions");
     
     cl_mem bufMass = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
-                                     n * sizeof(float), masses.data(), &err);
+                                     (size_t)n * sizeof(Real), masses.data(), &err);
     checkError(err, "clCreateBuffer masses");
     
-    cl_mem bufAcc = clCreateBuffer(context, CL_MEM_WRITE_ONLY, n * 4 * sizeof(float), nullptr, &err);
+    cl_mem bufAcc = clCreateBuffer(context, CL_MEM_WRITE_ONLY, (size_t)n * 4 * sizeof(Real), nullptr, &err);
     checkError(err, "clCreateBuffer accelerations");
     
-    const char* kernelName = useTiled ? "compute_forces_tiled" : "compute_forces";
+    const bool fp64 = sizeof(Real) == sizeof(double);
+    const char* kernelName = useTiled ? (fp64 ? "compute_forces_tiled_fp64" : "compute_forces_tiled")
+                                      : (fp64 ? "compute_forces_fp64" : "compute_forces");
     cl_kernel kernel = clCreateKernel(program, kernelName, &err);
     checkError(err, "clCreateKernel");
     
@@ -183,12 +208,12 @@ double computeForcesOpenCL(const std::vector<Body>& bodies,
     clSetKernelArg(kernel, 1, sizeof(cl_mem), &bufMass);
     clSetKernelArg(kernel, 2, sizeof(cl_mem), &bufAcc);
     clSetKernelArg(kernel, 3, sizeof(int), &n);
-    clSetKernelArg(kernel, 4, sizeof(float), &softening);
+    clSetKernelArg(kernel, 4, sizeof(Real), &soft);
     
     if (useTiled) {
         const int LOCAL_SIZE = 256;
-        clSetKernelArg(kernel, 5, LOCAL_SIZE * 4 * sizeof(float), nullptr);
-        clSetKernelArg(kernel, 6, LOCAL_SIZE * sizeof(float), nullptr);
+        clSetKernelArg(kernel, 5, LOCAL_SIZE * 4 * sizeof(Real), nullptr);
+        clSetKernelArg(kernel, 6, LOCAL_SIZE * sizeof(Real), nullptr);
     }
     
     auto start = std::chrono::high_resolution_clock::now();
@@ -208,7 +233,7 @@ double computeForcesOpenCL(const std::vector<Body>& bodies,
     
     auto end = std::chrono::high_resolution_clock::now();
     
-    clEnqueueReadBuffer(queue, bufAcc, CL_TRUE, 0, n * 4 * sizeof(float),
+    clEnqueueReadBuffer(queue, bufAcc, CL_TRUE, 0, (size_t)n * 4 * sizeof(Real),
                         accelerations.data(), 0, nullptr, nullptr);
     
     for (int i = 0; i < n; i++) {
@@ -226,70 +251,3857 @@ double computeForcesOpenCL(const std::vector<Body>& bodies,
     return std::chrono::duration<double, std::milli>(end - start).count();
 }
 
-int main() {
-    std::cout << "=== N-Body Simulation Performance Comparison ===\n\n";
+// Body layouts. Body (AoS) is the reference; the other two are built once
+// from it and then used as-is by both the CPU loops and the kernels.
+struct BodiesSoA {
+    std::vector<float> x, y, z, mass;
+};
+
+BodiesSoA toSoA(const std::vector<Body>& bodies) {
+    BodiesSoA soa;
+    for (const Body& b : bodies) {
+        soa.x.push_back(b.x);
+        soa.y.push_back(b.y);
+        soa.z.push_back(b.z);
+        soa.mass.push_back(b.mass);
+    }
+    return soa;
+}
+
+// x, y, z, mass per body (mass in the otherwise unused w lane)
+std::vector<float> toXYZM(const std::vector<Body>& bodies) {
+    std::vector<float> xyzm(bodies.size() * 4);
+    for (size_t i = 0; i < bodies.size(); i++) {
+        xyzm[i*4 + 0] = bodies[i].x;
+        xyzm[i*4 + 1] = bodies[i].y;
+        xyzm[i*4 + 2] = bodies[i].z;
+        xyzm[i*4 + 3] = bodies[i].mass;
+    }
+    return xyzm;
+}
+
+// OpenMP over SoA. With softening > 0 the i == j term is exactly zero (dx =
+// dy = dz = 0), so the self check is dropped and the inner loop vectorizes.
+double computeForcesOpenMPSoA(const BodiesSoA& soa,
+                              std::vector<float>& acc_x,
+                              std::vector<float>& acc_y,
+                              std::vector<float>& acc_z,
+                              float softening) {
+    int n = soa.x.size();
+    const float* x = soa.x.data();
+    const float* y = soa.y.data();
+    const float* z = soa.z.data();
+    const float* m = soa.mass.data();
+    const float softSq = softening * softening;
     
-    std::vector<int> bodyCounts = {128, 256, 512, 1024, 2048, 4096};
-    const float softening = 0.1f;
+    auto start = std::chrono::high_resolution_clock::now();
     
-    // Get OpenCL devices
-    cl_uint numPlatforms;
-    clGetPlatformIDs(0, nullptr, &numPlatforms);
-    std::vector<cl_platform_id> platforms(numPlatforms);
-    clGetPlatformIDs(numPlatforms, platforms.data(), nullptr);
+    #pragma omp parallel for
+    for (int i = 0; i < n; i++) {
+        float xi = x[i], yi = y[i], zi = z[i];
+        float ax = 0.0f, ay = 0.0f, az = 0.0f;
+        
+#if _OPENMP >= 201307  // omp simd is OpenMP 4.0; MSVC /openmp is 2.0
+        #pragma omp simd reduction(+:ax,ay,az)
+#endif
+        for (int j = 0; j < n; j++) {
+            float dx = x[j] - xi;
+            float dy = y[j] - yi;
+            float dz = z[j] - zi;
+            
+            float dist_sq = dx*dx + dy*dy + dz*dz + softSq;
+            float dist = std::sqrt(dist_sq);
+            float force = m[j] / (dist_sq * dist);
+            
+            ax += dx * force;
+            ay += dy * force;
+            az += dz * force;
+        }
+        
+        acc_x[i] = ax;
+        acc_y[i] = ay;
+        acc_z[i] = az;
+    }
     
-    std::vector<cl_device_id> devices;
-    std::vector<std::string> deviceNames;
-    std::vector<cl_context> contexts;
-    std::vector<cl_program> programs;
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// OpenMP over packed xyzm (same self-term reasoning as the SoA loop)
+double computeForcesOpenMPXYZM(const std::vector<float>& xyzm,
+                               std::vector<float>& acc_x,
+                               std::vector<float>& acc_y,
+                               std::vector<float>& acc_z,
+                               float softening) {
+    int n = xyzm.size() / 4;
+    const float* b = xyzm.data();
+    const float softSq = softening * softening;
     
-    std::string kernelSource = loadKernelSource("nbody.cl");
-    const char* kernelSourcePtr = kernelSource.c_str();
-    size_t kernelSourceSize = kernelSource.size();
+    auto start = std::chrono::high_resolution_clock::now();
     
-    for (cl_uint p = 0; p < numPlatforms; p++) {
-        cl_uint numDevices;
-        cl_int err = clGetDeviceIDs(platforms[p], CL_DEVICE_TYPE_ALL, 0, nullptr, &numDevices);
-        if (err == CL_SUCCESS && numDevices > 0) {
-            std::vector<cl_device_id> platformDevices(numDevices);
-            clGetDeviceIDs(platforms[p], CL_DEVICE_TYPE_ALL, numDevices, platformDevices.data(), nullptr);
+    #pragma omp parallel for
+    for (int i = 0; i < n; i++) {
+        float xi = b[i*4 + 0], yi = b[i*4 + 1], zi = b[i*4 + 2];
+        float ax = 0.0f, ay = 0.0f, az = 0.0f;
+        
+#if _OPENMP >= 201307
+        #pragma omp simd reduction(+:ax,ay,az)
+#endif
+        for (int j = 0; j < n; j++) {
+            float dx = b[j*4 + 0] - xi;
+            float dy = b[j*4 + 1] - yi;
+            float dz = b[j*4 + 2] - zi;
             
-            for (cl_uint d = 0; d < numDevices; d++) {
-                devices.push_back(platformDevices[d]);
-                
-                char name[128];
-                clGetDeviceInfo(platformDevices[d], CL_DEVICE_NAME, sizeof(name), name, nullptr);
-                deviceNames.push_back(std::string(name));
-                
-                cl_context context = clCreateContext(nullptr, 1, &platformDevices[d], nullptr, nullptr, &err);
-                contexts.push_back(context);
+            float dist_sq = dx*dx + dy*dy + dz*dz + softSq;
+            float dist = std::sqrt(dist_sq);
+            float force = b[j*4 + 3] / (dist_sq * dist);
+            
+            ax += dx * force;
+            ay += dy * force;
+            az += dz * force;
+        }
+        
+        acc_x[i] = ax;
+        acc_y[i] = ay;
+        acc_z[i] = az;
+    }
+    
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// OpenCL over SoA: the host arrays are uploaded as they are and the
+// accelerations come back as three arrays, so nothing is repacked
+double computeForcesOpenCLSoA(const BodiesSoA& soa,
+                              std::vector<float>& acc_x,
+                              std::vector<float>& acc_y,
+                              std::vector<float>& acc_z,
+                              float softening,
+                              cl_device_id device,
+                              cl_context context,
+                              cl_program program) {
+    cl_int err;
+    int n = soa.x.size();
+    const int LOCAL_SIZE = 256;
+    size_t bytes = (size_t)n * sizeof(float);
+    
+    cl_command_queue queue = clCreateCommandQueueWithProperties(context, device, nullptr, &err);
+    checkError(err, "clCreateCommandQueue");
+    
+    cl_mem bufIn[4];
+    const std::vector<float>* inputs[4] = {&soa.x, &soa.y, &soa.z, &soa.mass};
+    for (int c = 0; c < 4; c++) {
+        bufIn[c] = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                  bytes, (void*)inputs[c]->data(), &err);
+        checkError(err, "clCreateBuffer SoA input");
+    }
+    cl_mem bufOut[3];
+    for (int c = 0; c < 3; c++) {
+        bufOut[c] = clCreateBuffer(context, CL_MEM_WRITE_ONLY, bytes, nullptr, &err);
+        checkError(err, "clCreateBuffer SoA output");
+    }
+    
+    cl_kernel kernel = clCreateKernel(program, "compute_forces_soa", &err);
+    checkError(err, "clCreateKernel compute_forces_soa");
+    
+    for (int c = 0; c < 4; c++) clSetKernelArg(kernel, c, sizeof(cl_mem), &bufIn[c]);
+    for (int c = 0; c < 3; c++) clSetKernelArg(kernel, 4 + c, sizeof(cl_mem), &bufOut[c]);
+    clSetKernelArg(kernel, 7, sizeof(int), &n);
+    clSetKernelArg(kernel, 8, sizeof(float), &softening);
+    for (int c = 0; c < 4; c++) clSetKernelArg(kernel, 9 + c, LOCAL_SIZE * sizeof(float), nullptr);
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    size_t globalSize = ((n + LOCAL_SIZE - 1) / LOCAL_SIZE) * LOCAL_SIZE;
+    size_t localSize = LOCAL_SIZE;
+    err = clEnqueueNDRangeKernel(queue, kernel, 1, nullptr, &globalSize, &localSize, 0, nullptr, nullptr);
+    checkError(err, "clEnqueueNDRangeKernel");
+    
+    clFinish(queue);
+    
+    auto end = std::chrono::high_resolution_clock::now();
+    
+    std::vector<float>* outputs[3] = {&acc_x, &acc_y, &acc_z};
+    for (int c = 0; c < 3; c++) {
+        clEnqueueReadBuffer(queue, bufOut[c], CL_FALSE, 0, bytes, outputs[c]->data(), 0, nullptr, nullptr);
+    }
+    clFinish(queue);
+    
+    for (int c = 0; c < 4; c++) clReleaseMemObject(bufIn[c]);
+    for (int c = 0; c < 3; c++) clReleaseMemObject(bufOut[c]);
+    clReleaseKernel(kernel);
+    clReleaseCommandQueue(queue);
+    
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// OpenCL over packed xyzm: one input buffer, no masses buffer. The float4
+// accelerations are returned as they are (w = 0).
+double computeForcesOpenCLXYZM(const std::vector<float>& xyzm,
+                               std::vector<float>& accelerations,
+                               float softening,
+                               cl_device_id device,
+                               cl_context context,
+                               cl_program program) {
+    cl_int err;
+    int n = xyzm.size() / 4;
+    const int LOCAL_SIZE = 256;
+    
+    cl_command_queue queue = clCreateCommandQueueWithProperties(context, device, nullptr, &err);
+    checkError(err, "clCreateCommandQueue");
+    
+    cl_mem bufBodies = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                       (size_t)n * 4 * sizeof(float), (void*)xyzm.data(), &err);
+    checkError(err, "clCreateBuffer bodies");
+    
+    cl_mem bufAcc = clCreateBuffer(context, CL_MEM_WRITE_ONLY, (size_t)n * 4 * sizeof(float), nullptr, &err);
+    checkError(err, "clCreateBuffer accelerations");
+    
+    cl_kernel kernel = clCreateKernel(program, "compute_forces_xyzm", &err);
+    checkError(err, "clCreateKernel compute_forces_xyzm");
+    
+    clSetKernelArg(kernel, 0, sizeof(cl_mem), &bufBodies);
+    clSetKernelArg(kernel, 1, sizeof(cl_mem), &bufAcc);
+    clSetKernelArg(kernel, 2, sizeof(int), &n);
+    clSetKernelArg(kernel, 3, sizeof(float), &softening);
+    clSetKernelArg(kernel, 4, LOCAL_SIZE * 4 * sizeof(float), nullptr);
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    size_t globalSize = ((n + LOCAL_SIZE - 1) / LOCAL_SIZE) * LOCAL_SIZE;
+    size_t localSize = LOCAL_SIZE;
+    err = clEnqueueNDRangeKernel(queue, kernel, 1, nullptr, &globalSize, &localSize, 0, nullptr, nullptr);
+    checkError(err, "clEnqueueNDRangeKernel");
+    
+    clFinish(queue);
+    
+    auto end = std::chrono::high_resolution_clock::now();
+    
+    accelerations.resize(n * 4);
+    clEnqueueReadBuffer(queue, bufAcc, CL_TRUE, 0, (size_t)n * 4 * sizeof(float),
+                        accelerations.data(), 0, nullptr, nullptr);
+    
+    clReleaseMemObject(bufBodies);
+    clReleaseMemObject(bufAcc);
+    clReleaseKernel(kernel);
+    clReleaseCommandQueue(queue);
+    
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// Largest relative difference of an acceleration field from the reference,
+// relative to the largest reference magnitude
+float maxRelativeDiff(const std::vector<float>& ref_x, const std::vector<float>& ref_y,
+                      const std::vector<float>& ref_z, const std::vector<float>& x,
+                      const std::vector<float>& y, const std::vector<float>& z) {
+    float maxRef = 0.0f, maxDiff = 0.0f;
+    for (size_t i = 0; i < ref_x.size(); i++) {
+        maxRef = std::max(maxRef, std::sqrt(ref_x[i]*ref_x[i] + ref_y[i]*ref_y[i] + ref_z[i]*ref_z[i]));
+        float dx = x[i] - ref_x[i], dy = y[i] - ref_y[i], dz = z[i] - ref_z[i];
+        maxDiff = std::max(maxDiff, std::sqrt(dx*dx + dy*dy + dz*dz));
+    }
+    return maxRef > 0.0f ? maxDiff / maxRef : 0.0f;
+}
+
+void printLayoutRow(const std::string& name, double kernelMs, double callMs, double interactions, float error) {
+    std::cout << std::left << std::setw(40) << name
+              << std::right << std::setw(12) << kernelMs
+              << std::setw(14) << callMs
+              << std::setw(12) << (interactions / (kernelMs / 1000.0) / 1e9)
+              << std::setw(12) << std::scientific << std::setprecision(1) << error
+              << std::fixed << std::setprecision(2) << "\n";
+}
+
+void runLayoutSweep(float softening,
+                    const std::vector<cl_device_id>& devices,
+                    const std::vector<std::string>& deviceNames,
+                    const std::vector<cl_context>& contexts,
+                    const std::vector<cl_program>& programs) {
+    std::vector<int> bodyCounts = {2048, 8192, 32768};
+    
+    for (int n : bodyCounts) {
+        std::cout << "========================================\n";
+        std::cout << "Body layouts with " << n << " particles\n";
+        std::cout << "========================================\n";
+        
+        std::vector<Body> bodies(n);
+        initializeBodies(bodies, n);
+        
+        // Converted once, outside every timed region: this is the point
+        BodiesSoA soa = toSoA(bodies);
+        std::vector<float> xyzm = toXYZM(bodies);
+        
+        std::vector<float> ref_x(n), ref_y(n), ref_z(n);
+        std::vector<float> acc_x(n), acc_y(n), acc_z(n);
+        std::vector<float> acc4;
+        double interactions = (double)n * (n - 1);
+        
+        std::cout << "\n" << std::fixed << std::setprecision(2);
+        std::cout << std::left << std::setw(40) << "Implementation"
+                  << std::right << std::setw(12) << "Kernel (ms)"
+                  << std::setw(14) << "Per call (ms)"
+                  << std::setw(12) << "GInter/s"
+                  << std::setw(12) << "Rel. diff\n";
+        std::cout << std::string(90, '-') << "\n";
+        
+        // CPU: the timed region is the whole call
+        double ms = computeForcesOpenMP(bodies, ref_x, ref_y, ref_z, softening);
+        printLayoutRow("OpenMP AoS (Body)", ms, ms, interactions, 0.0f);
+        ms = computeForcesOpenMPSoA(soa, acc_x, acc_y, acc_z, softening);
+        printLayoutRow("OpenMP SoA", ms, ms, interactions,
+                       maxRelativeDiff(ref_x, ref_y, ref_z, acc_x, acc_y, acc_z));
+        ms = computeForcesOpenMPXYZM(xyzm, acc_x, acc_y, acc_z, softening);
+        printLayoutRow("OpenMP xyzm", ms, ms, interactions,
+                       maxRelativeDiff(ref_x, ref_y, ref_z, acc_x, acc_y, acc_z));
+        
+        // OpenCL: "Per call" wraps the whole function, so the AoS repacking,
+        // buffer creation, upload and readback all show up there
+        for (size_t i = 0; i < devices.size(); i++) {
+            std::string prefix = "OpenCL: " + deviceNames[i].substr(0, 20);
+            
+            auto callStart = std::chrono::high_resolution_clock::now();
+            double kernelMs = computeForcesOpenCL(bodies, acc_x, acc_y, acc_z, softening,
+                                                  devices[i], contexts[i], programs[i], true);
+            double callMs = std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - callStart).count();
+            printLayoutRow(prefix + " AoS", kernelMs, callMs, interactions,
+                           maxRelativeDiff(ref_x, ref_y, ref_z, acc_x, acc_y, acc_z));
+            
+            callStart = std::chrono::high_resolution_clock::now();
+            kernelMs = computeForcesOpenCLSoA(soa, acc_x, acc_y, acc_z, softening,
+                                              devices[i], contexts[i], programs[i]);
+            callMs = std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - callStart).count();
+            printLayoutRow(prefix + " SoA", kernelMs, callMs, interactions,
+                           maxRelativeDiff(ref_x, ref_y, ref_z, acc_x, acc_y, acc_z));
+            
+            callStart = std::chrono::high_resolution_clock::now();
+            kernelMs = computeForcesOpenCLXYZM(xyzm, acc4, softening, devices[i], contexts[i], programs[i]);
+            callMs = std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - callStart).count();
+            for (int b = 0; b < n; b++) {
+                acc_x[b] = acc4[b*4 + 0];
+                acc_y[b] = acc4[b*4 + 1];
+                acc_z[b] = acc4[b*4 + 2];
+            }
+            printLayoutRow(prefix + " xyzm", kernelMs, callMs, interactions,
+                           maxRelativeDiff(ref_x, ref_y, ref_z, acc_x, acc_y, acc_z));
+        }
+        
+        std::cout << "\n";
+    }
+}
+
+#ifdef HAVE_AVX_KERNEL
+// AVX needs CPU support and OS support for saving the YMM registers. This file
+// is built without AVX, so the check itself runs on any x86 CPU.
+bool cpuSupportsAVX() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    return osxsave && avx && (_xgetbv(0) & 0x6) == 0x6;
+#else
+    return __builtin_cpu_supports("avx");
+#endif
+}
+#endif
+
+// Symmetric (Newton's third law) CPU path: each pair is evaluated once and
+// the equal and opposite contributions go to both bodies. Every thread owns a
+// private copy of the acceleration arrays, so rows can be scheduled freely;
+// the copies are summed at the end. Arrays are padded with zero-mass bodies
+// so the AVX loop never needs a scalar tail.
+double computeForcesSymmetric(const BodiesSoA& soa,
+                              std::vector<float>& acc_x,
+                              std::vector<float>& acc_y,
+                              std::vector<float>& acc_z,
+                              float softening,
+                              bool vectorized) {
+    int n = soa.x.size();
+    const int PAD = 8;
+    int stride = ((n + PAD - 1) / PAD) * PAD + PAD;
+    int threads = omp_get_max_threads();
+    const float softSq = softening * softening;
+    
+    std::vector<float> x(stride, 0.0f), y(stride, 0.0f), z(stride, 0.0f), m(stride, 0.0f);
+    std::copy(soa.x.begin(), soa.x.end(), x.begin());
+    std::copy(soa.y.begin(), soa.y.end(), y.begin());
+    std::copy(soa.z.begin(), soa.z.end(), z.begin());
+    std::copy(soa.mass.begin(), soa.mass.end(), m.begin());
+    std::vector<float> priv((size_t)threads * 3 * stride);
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    #pragma omp parallel
+    {
+        float* ax = &priv[(size_t)omp_get_thread_num() * 3 * stride];
+        float* ay = ax + stride;
+        float* az = ay + stride;
+        std::fill(ax, ax + 3 * stride, 0.0f);
+        
+        // Row i has n-1-i pairs, so rows are handed out dynamically
+        #pragma omp for schedule(dynamic, 16)
+        for (int i = 0; i < n - 1; i++) {
+            float xi = x[i], yi = y[i], zi = z[i], mi = m[i];
+            float sx = 0.0f, sy = 0.0f, sz = 0.0f;
+            int j = i + 1;
+            
+#ifdef HAVE_AVX_KERNEL
+            if (vectorized) {
+                j = symmetricRowAVX(x.data(), y.data(), z.data(), m.data(), ax, ay, az,
+                                    i, n, softSq, &sx, &sy, &sz);
+            }
+#endif
+            for (; j < n; j++) {
+                float dx = x[j] - xi;
+                float dy = y[j] - yi;
+                float dz = z[j] - zi;
+                float distSq = dx*dx + dy*dy + dz*dz + softSq;
+                float inv = 1.0f / std::sqrt(distSq);
+                float inv3 = inv * inv * inv;
                 
-                cl_program program = clCreateProgramWithSource(context, 1, &kernelSourcePtr, &kernelSourceSize, &err);
-                err = clBuildProgram(program, 1, &platformDevices[d], nullptr, nullptr, nullptr);
-                if (err != CL_SUCCESS) {
-                    size_t logSize;
-                    clGetProgramBuildInfo(program, platformDevices[d], CL_PROGRAM_BUILD_LOG, 0, nullptr, &logSize);
-                    std::vector<char> log(logSize);
-                    clGetProgramBuildInfo(program, platformDevices[d], CL_PROGRAM_BUILD_LOG, logSize, log.data(), nullptr);
-                    std::cerr << "Build error for " << name << ":\n" << log.data() << "\n";
-                    clReleaseContext(context);
-                    contexts.pop_back();
-                    devices.pop_back();
-                    deviceNames.pop_back();
-                    continue;
-                }
-                programs.push_back(program);
+                float fj = m[j] * inv3;
+                float fi = mi * inv3;
+                sx += dx * fj;
+                sy += dy * fj;
+                sz += dz * fj;
+                ax[j] -= dx * fi;
+                ay[j] -= dy * fi;
+                az[j] -= dz * fi;
+            }
+            
+            ax[i] += sx;
+            ay[i] += sy;
+            az[i] += sz;
+        }
+        
+        // Implicit barrier above; now reduce the private copies body by body
+        #pragma omp for
+        for (int b = 0; b < n; b++) {
+            float sumX = 0.0f, sumY = 0.0f, sumZ = 0.0f;
+            for (int t = 0; t < threads; t++) {
+                const float* p = &priv[(size_t)t * 3 * stride];
+                sumX += p[b];
+                sumY += p[stride + b];
+                sumZ += p[2 * stride + b];
             }
+            acc_x[b] = sumX;
+            acc_y[b] = sumY;
+            acc_z[b] = sumZ;
         }
     }
     
-    std::cout << "OpenMP threads: " << omp_get_max_threads() << "\n";
-    std::cout << "OpenCL devices: " << devices.size() << "\n\n";
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void runSymmetricSweep(float softening) {
+    std::vector<int> bodyCounts = {4096, 16384, 32768};
+    
+#ifdef HAVE_AVX_KERNEL
+    const bool haveAVX = cpuSupportsAVX();
+#else
+    const bool haveAVX = false;
+#endif
+    
+    for (int n : bodyCounts) {
+        std::cout << "========================================\n";
+        std::cout << "Symmetric forces with " << n << " particles\n";
+        std::cout << "Pairs: " << ((long long)n * (n - 1) / 2) << " (each evaluated once)\n";
+        std::cout << "========================================\n";
+        
+        std::vector<Body> bodies(n);
+        initializeBodies(bodies, n);
+        BodiesSoA soa = toSoA(bodies);
+        
+        std::vector<float> ref_x(n), ref_y(n), ref_z(n);
+        std::vector<float> acc_x(n), acc_y(n), acc_z(n);
+        double interactions = (double)n * (n - 1);
+        
+        std::cout << "\n" << std::fixed << std::setprecision(2);
+        std::cout << std::left << std::setw(40) << "Implementation"
+                  << std::right << std::setw(12) << "Time (ms)"
+                  << std::setw(12) << "Speedup"
+                  << std::setw(12) << "GInter/s"
+                  << std::setw(12) << "Rel. diff\n";
+        std::cout << std::string(88, '-') << "\n";
+        
+        // GInter/s counts n(n-1) interactions for every row, so the symmetric
+        // paths get credit for the half they never compute
+        auto printRow = [&](const std::string& name, double ms, double baseMs, float diff) {
+            std::cout << std::left << std::setw(40) << name
+                      << std::right << std::setw(12) << ms
+                      << std::setw(11) << (baseMs / ms) << "x"
+                      << std::setw(12) << (interactions / (ms / 1000.0) / 1e9)
+                      << std::setw(12) << std::scientific << std::setprecision(1) << diff
+                      << std::fixed << std::setprecision(2) << "\n";
+        };
+        
+        double openmpTime = computeForcesOpenMP(bodies, ref_x, ref_y, ref_z, softening);
+        printRow("OpenMP (all pairs, AoS)", openmpTime, openmpTime, 0.0f);
+        
+        double ms = computeForcesOpenMPSoA(soa, acc_x, acc_y, acc_z, softening);
+        printRow("OpenMP (all pairs, SoA)", ms, openmpTime,
+                 maxRelativeDiff(ref_x, ref_y, ref_z, acc_x, acc_y, acc_z));
+        
+        ms = computeForcesSymmetric(soa, acc_x, acc_y, acc_z, softening, false);
+        printRow("Symmetric (scalar, sqrt)", ms, openmpTime,
+                 maxRelativeDiff(ref_x, ref_y, ref_z, acc_x, acc_y, acc_z));
+        
+        if (haveAVX) {
+            ms = computeForcesSymmetric(soa, acc_x, acc_y, acc_z, softening, true);
+            printRow("Symmetric (AVX, rsqrt+Newton)", ms, openmpTime,
+                     maxRelativeDiff(ref_x, ref_y, ref_z, acc_x, acc_y, acc_z));
+        } else {
+            std::cout << "Symmetric (AVX): not available (no AVX kernel in this build, or CPU lacks AVX)\n";
+        }
+        
+        std::cout << "\n";
+    }
+}
+
+// Device-resident simulation: positions, velocities and masses stay on the
+// device for the whole run; the host only reads back at snapshot intervals.
+struct DeviceSimulation {
+    int n;
+    size_t globalSize;
+    size_t localSize;
+    cl_command_queue queue;
+    cl_mem bufPos;
+    cl_mem bufVel;
+    cl_mem bufMass;
+    cl_mem bufAcc;
+    cl_kernel forceKernel;
+    cl_kernel integrateKernel;
+};
+
+// Every argument of both step kernels; none of them change between steps
+void setSimulationArgs(DeviceSimulation& sim, float softening, float dt) {
+    clSetKernelArg(sim.forceKernel, 0, sizeof(cl_mem), &sim.bufPos);
+    clSetKernelArg(sim.forceKernel, 1, sizeof(cl_mem), &sim.bufMass);
+    clSetKernelArg(sim.forceKernel, 2, sizeof(cl_mem), &sim.bufAcc);
+    clSetKernelArg(sim.forceKernel, 3, sizeof(int), &sim.n);
+    clSetKernelArg(sim.forceKernel, 4, sizeof(float), &softening);
+    clSetKernelArg(sim.forceKernel, 5, sim.localSize * 4 * sizeof(float), nullptr);
+    clSetKernelArg(sim.forceKernel, 6, sim.localSize * sizeof(float), nullptr);
+    
+    clSetKernelArg(sim.integrateKernel, 0, sizeof(cl_mem), &sim.bufPos);
+    clSetKernelArg(sim.integrateKernel, 1, sizeof(cl_mem), &sim.bufVel);
+    clSetKernelArg(sim.integrateKernel, 2, sizeof(cl_mem), &sim.bufAcc);
+    clSetKernelArg(sim.integrateKernel, 3, sizeof(int), &sim.n);
+    clSetKernelArg(sim.integrateKernel, 4, sizeof(float), &dt);
+}
+
+DeviceSimulation createDeviceSimulation(const std::vector<Body>& bodies,
+                                        float softening, float dt,
+                                        cl_device_id device,
+                                        cl_context context,
+                                        cl_program program) {
+    cl_int err;
+    DeviceSimulation sim;
+    sim.n = bodies.size();
+    
+    const int LOCAL_SIZE = 256;
+    sim.localSize = LOCAL_SIZE;
+    sim.globalSize = ((sim.n + LOCAL_SIZE - 1) / LOCAL_SIZE) * LOCAL_SIZE;
+    
+    sim.queue = clCreateCommandQueueWithProperties(context, device, nullptr, &err);
+    checkError(err, "clCreateCommandQueue");
+    
+    std::vector<float> positions(sim.n * 4);
+    std::vector<float> velocities(sim.n * 4);
+    std::vector<float> masses(sim.n);
+    for (int i = 0; i < sim.n; i++) {
+        positions[i*4 + 0] = bodies[i].x;
+        positions[i*4 + 1] = bodies[i].y;
+        positions[i*4 + 2] = bodies[i].z;
+        positions[i*4 + 3] = 0.0f;
+        velocities[i*4 + 0] = bodies[i].vx;
+        velocities[i*4 + 1] = bodies[i].vy;
+        velocities[i*4 + 2] = bodies[i].vz;
+        velocities[i*4 + 3] = 0.0f;
+        masses[i] = bodies[i].mass;
+    }
+    
+    sim.bufPos = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
+                                (size_t)sim.n * 4 * sizeof(float), positions.data(), &err);
+    checkError(err, "clCreateBuffer positions");
+    sim.bufVel = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
+                                (size_t)sim.n * 4 * sizeof(float), velocities.data(), &err);
+    checkError(err, "clCreateBuffer velocities");
+    sim.bufMass = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                 (size_t)sim.n * sizeof(float), masses.data(), &err);
+    checkError(err, "clCreateBuffer masses");
+    sim.bufAcc = clCreateBuffer(context, CL_MEM_READ_WRITE, (size_t)sim.n * 4 * sizeof(float), nullptr, &err);
+    checkError(err, "clCreateBuffer accelerations");
+    
+    // Arguments never change between steps, so they are set once here
+    sim.forceKernel = clCreateKernel(program, "compute_forces_tiled", &err);
+    checkError(err, "clCreateKernel compute_forces_tiled");
+    sim.integrateKernel = clCreateKernel(program, "integrate", &err);
+    checkError(err, "clCreateKernel integrate");
+    setSimulationArgs(sim, softening, dt);
+    
+    return sim;
+}
+
+// One timestep: forces then integration. The in-order queue serializes the
+// two kernels, so no events or host synchronization are needed. `done`, if
+// given, receives the integrate event (the end of the step).
+void enqueueSimulationStep(DeviceSimulation& sim, cl_event* done = nullptr) {
+    cl_int err = clEnqueueNDRangeKernel(sim.queue, sim.forceKernel, 1, nullptr,
+                                        &sim.globalSize, &sim.localSize, 0, nullptr, nullptr);
+    checkError(err, "clEnqueueNDRangeKernel compute_forces_tiled");
+    size_t integrateSize = sim.n;
+    err = clEnqueueNDRangeKernel(sim.queue, sim.integrateKernel, 1, nullptr,
+                                 &integrateSize, nullptr, 0, nullptr, done);
+    checkError(err, "clEnqueueNDRangeKernel integrate");
+}
+
+// Blocking read of the current state (float4 per body)
+void readSimulationState(DeviceSimulation& sim, std::vector<float>& positions, std::vector<float>& velocities) {
+    positions.resize(sim.n * 4);
+    velocities.resize(sim.n * 4);
+    clEnqueueReadBuffer(sim.queue, sim.bufPos, CL_FALSE, 0, (size_t)sim.n * 4 * sizeof(float),
+                        positions.data(), 0, nullptr, nullptr);
+    clEnqueueReadBuffer(sim.queue, sim.bufVel, CL_TRUE, 0, (size_t)sim.n * 4 * sizeof(float),
+                        velocities.data(), 0, nullptr, nullptr);
+}
+
+void releaseDeviceSimulation(DeviceSimulation& sim) {
+    clReleaseMemObject(sim.bufPos);
+    clReleaseMemObject(sim.bufVel);
+    clReleaseMemObject(sim.bufMass);
+    clReleaseMemObject(sim.bufAcc);
+    clReleaseKernel(sim.forceKernel);
+    clReleaseKernel(sim.integrateKernel);
+    clReleaseCommandQueue(sim.queue);
+}
+
+// Total momentum from a snapshot; it should stay constant, so its drift is a
+// cheap correctness check that costs nothing on the device.
+void totalMomentum(const std::vector<Body>& bodies, const std::vector<float>& velocities, double p[3]) {
+    p[0] = p[1] = p[2] = 0.0;
+    for (size_t i = 0; i < bodies.size(); i++) {
+        p[0] += (double)bodies[i].mass * velocities[i*4 + 0];
+        p[1] += (double)bodies[i].mass * velocities[i*4 + 1];
+        p[2] += (double)bodies[i].mass * velocities[i*4 + 2];
+    }
+}
+
+void runSimulation(int n, int steps, int snapshotEvery, float softening, float dt,
+                   const std::vector<cl_device_id>& devices,
+                   const std::vector<std::string>& deviceNames,
+                   const std::vector<cl_context>& contexts,
+                   const std::vector<cl_program>& programs) {
+    std::cout << "Bodies: " << n << ", Steps: " << steps << ", Snapshot every: " << snapshotEvery
+              << " steps, dt: " << dt << "\n\n";
+    
+    std::vector<Body> bodies(n);
+    initializeBodies(bodies, n);
+    
+    // Momentum scale for the relative drift: sum of |m*v| at t=0
+    double momentumScale = 0.0;
+    for (const Body& b : bodies) {
+        momentumScale += b.mass * std::sqrt(b.vx*b.vx + b.vy*b.vy + b.vz*b.vz);
+    }
+    
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << std::left << std::setw(32) << "Device"
+              << std::right << std::setw(12) << "Total (ms)"
+              << std::setw(12) << "Steps/s"
+              << std::setw(14) << "GInter/s"
+              << std::setw(14) << "Readback (ms)"
+              << std::setw(14) << "P drift\n";
+    std::cout << std::string(97, '-') << "\n";
+    
+    double interactionsPerStep = (double)n * (n - 1);
+    
+    for (size_t d = 0; d < devices.size(); d++) {
+        DeviceSimulation sim = createDeviceSimulation(bodies, softening, dt,
+                                                      devices[d], contexts[d], programs[d]);
+        std::vector<float> positions, velocities;
+        
+        // Reference momentum from the uploaded state (also completes the upload)
+        readSimulationState(sim, positions, velocities);
+        double p0[3];
+        totalMomentum(bodies, velocities, p0);
+        
+        double readbackMs = 0.0;
+        double p[3] = {p0[0], p0[1], p0[2]};
+        
+        auto start = std::chrono::high_resolution_clock::now();
+        
+        for (int step = 1; step <= steps; step++) {
+            enqueueSimulationStep(sim);
+            
+            if (step % snapshotEvery == 0 || step == steps) {
+                auto readStart = std::chrono::high_resolution_clock::now();
+                readSimulationState(sim, positions, velocities);
+                readbackMs += std::chrono::duration<double, std::milli>(
+                    std::chrono::high_resolution_clock::now() - readStart).count();
+                totalMomentum(bodies, velocities, p);
+            }
+        }
+        clFinish(sim.queue);
+        
+        auto end = std::chrono::high_resolution_clock::now();
+        double totalMs = std::chrono::duration<double, std::milli>(end - start).count();
+        
+        double drift = std::sqrt((p[0]-p0[0])*(p[0]-p0[0]) + (p[1]-p0[1])*(p[1]-p0[1]) +
+                                 (p[2]-p0[2])*(p[2]-p0[2])) / momentumScale;
+        
+        std::cout << std::left << std::setw(32) << deviceNames[d].substr(0, 30)
+                  << std::right << std::setw(12) << totalMs
+                  << std::setw(12) << (steps / (totalMs / 1000.0))
+                  << std::setw(14) << (interactionsPerStep * steps / (totalMs / 1000.0) / 1e9)
+                  << std::setw(14) << readbackMs
+                  << std::setw(13) << std::scientific << std::setprecision(1) << drift
+                  << std::fixed << std::setprecision(2) << "\n";
+        
+        releaseDeviceSimulation(sim);
+    }
+    
+    std::cout << "\nReadback time includes waiting for the queued steps to finish,\n"
+              << "so it is an upper bound on the cost of the snapshot transfers.\n";
+}
+
+// Precision modes: the same nbody.cl built with different options
+struct PrecisionMode {
+    const char* name;
+    const char* options;
+};
+
+const PrecisionMode PRECISION_MODES[] = {
+    {"precise (sqrt + div)", ""},
+    {"mad", "-cl-mad-enable"},
+    {"rsqrt", "-DFORCE_RSQRT"},
+    {"fast-relaxed-math", "-cl-fast-relaxed-math"},
+    {"fast + native_rsqrt", "-cl-fast-relaxed-math -DFORCE_NATIVE_RSQRT"},
+};
+
+// Returns nullptr (after printing the log) if the build fails
+cl_program buildProgram(cl_context context, cl_device_id device,
+                        const std::string& source, const char* options) {
+    cl_int err;
+    const char* sourcePtr = source.c_str();
+    size_t sourceSize = source.size();
+    
+    cl_program program = clCreateProgramWithSource(context, 1, &sourcePtr, &sourceSize, &err);
+    checkError(err, "clCreateProgramWithSource");
+    
+    err = clBuildProgram(program, 1, &device, options, nullptr, nullptr);
+    if (err != CL_SUCCESS) {
+        size_t logSize;
+        clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, 0, nullptr, &logSize);
+        std::vector<char> log(logSize);
+        clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, logSize, log.data(), nullptr);
+        std::cerr << "Build error (" << options << "):\n" << log.data() << "\n";
+        clReleaseProgram(program);
+        return nullptr;
+    }
+    return program;
+}
+
+// Kinetic + softened potential energy of a state (float4 per body), in double
+double totalEnergy(const std::vector<Body>& bodies,
+                   const std::vector<float>& positions,
+                   const std::vector<float>& velocities,
+                   float softening) {
+    int n = bodies.size();
+    double kinetic = 0.0, potential = 0.0;
+    double softSq = (double)softening * softening;
+    
+    #pragma omp parallel for reduction(+:kinetic,potential) schedule(dynamic, 64)
+    for (int i = 0; i < n; i++) {
+        double vx = velocities[i*4 + 0], vy = velocities[i*4 + 1], vz = velocities[i*4 + 2];
+        kinetic += 0.5 * bodies[i].mass * (vx*vx + vy*vy + vz*vz);
+        
+        for (int j = i + 1; j < n; j++) {
+            double dx = positions[j*4 + 0] - positions[i*4 + 0];
+            double dy = positions[j*4 + 1] - positions[i*4 + 1];
+            double dz = positions[j*4 + 2] - positions[i*4 + 2];
+            potential -= (double)bodies[i].mass * bodies[j].mass / std::sqrt(dx*dx + dy*dy + dz*dz + softSq);
+        }
+    }
+    
+    return kinetic + potential;
+}
+
+void runPrecisionSweep(float softening,
+                       const std::vector<cl_device_id>& devices,
+                       const std::vector<std::string>& deviceNames,
+                       const std::vector<cl_context>& contexts,
+                       const std::string& kernelSource) {
+    const int FORCE_BODIES = 8192;
+    const int DRIFT_BODIES = 2048;
+    const int DRIFT_STEPS = 2000;
+    const float dt = 0.01f;
+    
+    std::vector<Body> bodies(FORCE_BODIES);
+    initializeBodies(bodies, FORCE_BODIES);
+    std::vector<float> ref_x(FORCE_BODIES), ref_y(FORCE_BODIES), ref_z(FORCE_BODIES);
+    std::vector<float> acc_x(FORCE_BODIES), acc_y(FORCE_BODIES), acc_z(FORCE_BODIES);
+    computeForcesSerial(bodies, ref_x, ref_y, ref_z, softening);
+    double interactions = (double)FORCE_BODIES * (FORCE_BODIES - 1);
+    
+    std::vector<Body> driftBodies(DRIFT_BODIES);
+    initializeBodies(driftBodies, DRIFT_BODIES);
+    
+    std::cout << "Forces: " << FORCE_BODIES << " bodies, error vs serial C++\n";
+    std::cout << "Energy drift: " << DRIFT_BODIES << " bodies, " << DRIFT_STEPS
+              << " device-resident steps, dt = " << dt << "\n\n";
+    
+    for (size_t d = 0; d < devices.size(); d++) {
+        std::cout << "OpenCL: " << deviceNames[d] << "\n";
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << std::left << std::setw(28) << "Mode"
+                  << std::right << std::setw(12) << "Time (ms)"
+                  << std::setw(12) << "GInter/s"
+                  << std::setw(10) << "Speedup"
+                  << std::setw(14) << "Max rel err"
+                  << std::setw(14) << "Energy drift\n";
+        std::cout << std::string(89, '-') << "\n";
+        
+        double preciseMs = 0.0;
+        for (const PrecisionMode& mode : PRECISION_MODES) {
+            cl_program program = buildProgram(contexts[d], devices[d], kernelSource, mode.options);
+            if (!program) continue;
+            
+            // Warm-up, then the measured run
+            computeForcesOpenCL(bodies, acc_x, acc_y, acc_z, softening, devices[d], contexts[d], program, true);
+            double ms = computeForcesOpenCL(bodies, acc_x, acc_y, acc_z, softening,
+                                            devices[d], contexts[d], program, true);
+            if (preciseMs == 0.0) preciseMs = ms;
+            float error = maxRelativeDiff(ref_x, ref_y, ref_z, acc_x, acc_y, acc_z);
+            
+            DeviceSimulation sim = createDeviceSimulation(driftBodies, softening, dt,
+                                                          devices[d], contexts[d], program);
+            std::vector<float> positions, velocities;
+            readSimulationState(sim, positions, velocities);
+            double e0 = totalEnergy(driftBodies, positions, velocities, softening);
+            for (int step = 0; step < DRIFT_STEPS; step++) {
+                enqueueSimulationStep(sim);
+            }
+            readSimulationState(sim, positions, velocities);
+            double e1 = totalEnergy(driftBodies, positions, velocities, softening);
+            releaseDeviceSimulation(sim);
+            
+            std::cout << std::left << std::setw(28) << mode.name
+                      << std::right << std::setw(12) << ms
+                      << std::setw(12) << (interactions / (ms / 1000.0) / 1e9)
+                      << std::setw(9) << (preciseMs / ms) << "x"
+                      << std::setw(14) << std::scientific << std::setprecision(1) << error
+                      << std::setw(13) << std::abs((e1 - e0) / e0)
+                      << std::fixed << std::setprecision(2) << "\n";
+            
+            clReleaseProgram(program);
+        }
+        std::cout << "\n";
+    }
+    
+    std::cout << "Energy drift also contains the integrator's own error; compare each\n"
+              << "mode against the precise row rather than against zero.\n";
+}
+
+// Several bodies per work-item (compute_forces_multi). The xyzm array must be
+// padded to a multiple of tileSize * bodiesPerItem with zero-mass bodies.
+double computeForcesOpenCLMulti(const std::vector<float>& xyzmPadded,
+                                std::vector<float>& accelerations,
+                                float softening, int tileSize, int bodiesPerItem,
+                                cl_device_id device,
+                                cl_context context,
+                                cl_program program) {
+    cl_int err;
+    int nPadded = xyzmPadded.size() / 4;
+    
+    cl_command_queue queue = clCreateCommandQueueWithProperties(context, device, nullptr, &err);
+    checkError(err, "clCreateCommandQueue");
+    
+    cl_mem bufBodies = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                       nPadded * 4 * sizeof(float), (void*)xyzmPadded.data(), &err);
+    checkError(err, "clCreateBuffer bodies");
+    
+    cl_mem bufAcc = clCreateBuffer(context, CL_MEM_WRITE_ONLY, nPadded * 4 * sizeof(float), nullptr, &err);
+    checkError(err, "clCreateBuffer accelerations");
+    
+    cl_kernel kernel = clCreateKernel(program, "compute_forces_multi", &err);
+    checkError(err, "clCreateKernel compute_forces_multi");
+    
+    clSetKernelArg(kernel, 0, sizeof(cl_mem), &bufBodies);
+    clSetKernelArg(kernel, 1, sizeof(cl_mem), &bufAcc);
+    clSetKernelArg(kernel, 2, sizeof(int), &nPadded);
+    clSetKernelArg(kernel, 3, sizeof(float), &softening);
+    
+    size_t globalSize = nPadded / bodiesPerItem;
+    size_t localSize = tileSize;
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    err = clEnqueueNDRangeKernel(queue, kernel, 1, nullptr, &globalSize, &localSize, 0, nullptr, nullptr);
+    checkError(err, "clEnqueueNDRangeKernel");
+    
+    clFinish(queue);
+    
+    auto end = std::chrono::high_resolution_clock::now();
+    
+    accelerations.resize(nPadded * 4);
+    clEnqueueReadBuffer(queue, bufAcc, CL_TRUE, 0, nPadded * 4 * sizeof(float),
+                        accelerations.data(), 0, nullptr, nullptr);
+    
+    clReleaseMemObject(bufBodies);
+    clReleaseMemObject(bufAcc);
+    clReleaseKernel(kernel);
+    clReleaseCommandQueue(queue);
+    
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void runMultiBodySweep(float softening,
+                       const std::vector<cl_device_id>& devices,
+                       const std::vector<std::string>& deviceNames,
+                       const std::vector<cl_context>& contexts,
+                       const std::vector<cl_program>& programs,
+                       const std::string& kernelSource) {
+    const int TILE_SIZE = 256;
+    const int MAX_BODIES_PER_ITEM = 8;
+    std::vector<int> bodiesPerItem = {1, 2, 4, 8};
+    std::vector<int> bodyCounts = {4096, 16384, 65536};
+    
+    // One program per variant, built once per device
+    std::vector<std::vector<cl_program>> variants(devices.size());
+    for (size_t d = 0; d < devices.size(); d++) {
+        for (int bpi : bodiesPerItem) {
+            std::string options = "-DTILE_SIZE=" + std::to_string(TILE_SIZE) +
+                                  " -DBODIES_PER_ITEM=" + std::to_string(bpi);
+            variants[d].push_back(buildProgram(contexts[d], devices[d], kernelSource, options.c_str()));
+        }
+    }
+    
+    for (int n : bodyCounts) {
+        std::cout << "========================================\n";
+        std::cout << "Bodies per work-item with " << n << " particles\n";
+        std::cout << "========================================\n";
+        
+        std::vector<Body> bodies(n);
+        initializeBodies(bodies, n);
+        
+        // Zero-mass padding so every variant runs without bounds checks
+        int padMultiple = TILE_SIZE * MAX_BODIES_PER_ITEM;
+        int nPadded = ((n + padMultiple - 1) / padMultiple) * padMultiple;
+        std::vector<float> xyzm = toXYZM(bodies);
+        xyzm.resize(nPadded * 4, 0.0f);
+        
+        std::vector<float> ref_x(n), ref_y(n), ref_z(n);
+        std::vector<float> acc_x(n), acc_y(n), acc_z(n);
+        std::vector<float> acc4;
+        // Only real pairs are counted; padding work is overhead
+        double interactions = (double)n * (n - 1);
+        
+        std::cout << "\nPadded to " << nPadded << " bodies (tile " << TILE_SIZE << ")\n";
+        
+        for (size_t d = 0; d < devices.size(); d++) {
+            std::cout << "\nOpenCL: " << deviceNames[d] << "\n";
+            std::cout << std::fixed << std::setprecision(2);
+            std::cout << std::left << std::setw(36) << "Variant"
+                      << std::right << std::setw(12) << "Time (ms)"
+                      << std::setw(12) << "GInter/s"
+                      << std::setw(10) << "Speedup"
+                      << std::setw(14) << "Rel. diff\n";
+            std::cout << std::string(83, '-') << "\n";
+            
+            computeForcesOpenCL(bodies, ref_x, ref_y, ref_z, softening, devices[d], contexts[d], programs[d], true);
+            double baseMs = computeForcesOpenCL(bodies, ref_x, ref_y, ref_z, softening,
+                                                devices[d], contexts[d], programs[d], true);
+            std::cout << std::left << std::setw(36) << "compute_forces_tiled"
+                      << std::right << std::setw(12) << baseMs
+                      << std::setw(12) << (interactions / (baseMs / 1000.0) / 1e9)
+                      << std::setw(10) << "1.00x"
+                      << std::setw(13) << "-" << "\n";
+            
+            for (size_t v = 0; v < bodiesPerItem.size(); v++) {
+                if (!variants[d][v]) continue;
+                
+                computeForcesOpenCLMulti(xyzm, acc4, softening, TILE_SIZE, bodiesPerItem[v],
+                                         devices[d], contexts[d], variants[d][v]);
+                double ms = computeForcesOpenCLMulti(xyzm, acc4, softening, TILE_SIZE, bodiesPerItem[v],
+                                                     devices[d], contexts[d], variants[d][v]);
+                for (int b = 0; b < n; b++) {
+                    acc_x[b] = acc4[b*4 + 0];
+                    acc_y[b] = acc4[b*4 + 1];
+                    acc_z[b] = acc4[b*4 + 2];
+                }
+                
+                std::cout << std::left << std::setw(36) << ("multi: " + std::to_string(bodiesPerItem[v]) + " bodies/item")
+                          << std::right << std::setw(12) << ms
+                          << std::setw(12) << (interactions / (ms / 1000.0) / 1e9)
+                          << std::setw(9) << (baseMs / ms) << "x"
+                          << std::setw(13) << std::scientific << std::setprecision(1)
+                          << maxRelativeDiff(ref_x, ref_y, ref_z, acc_x, acc_y, acc_z)
+                          << std::fixed << std::setprecision(2) << "\n";
+            }
+        }
+        
+        std::cout << "\n";
+    }
+    
+    for (auto& deviceVariants : variants) {
+        for (cl_program program : deviceVariants) {
+            if (program) clReleaseProgram(program);
+        }
+    }
+}
+
+// ============================================================================
+// On-device diagnostics. On a diagnostic step compute_forces_potential
+// replaces compute_forces_tiled, then a two-stage reduction folds energy,
+// momentum and angular momentum into one float8 that is read back
+// non-blocking. The host never touches per-body data.
+// ============================================================================
+
+const int DIAGNOSTIC_GROUPS = 64;       // stage-1 work-groups (grid-strided)
+const int DIAGNOSTIC_LOCAL_SIZE = 256;  // power of two, for the tree reduction
+
+// s0 kinetic, s1 potential, s2-s4 momentum, s5-s7 angular momentum
+struct Diagnostics {
+    float values[8];
+};
+
+struct DeviceDiagnostics {
+    cl_kernel potentialKernel;
+    cl_kernel reduceKernel;
+    cl_kernel sumKernel;
+    cl_mem bufPartials;
+    cl_mem bufResult;
+};
+
+DeviceDiagnostics createDeviceDiagnostics(DeviceSimulation& sim, float softening,
+                                          cl_context context, cl_program program) {
+    cl_int err;
+    DeviceDiagnostics diag;
+    int groups = DIAGNOSTIC_GROUPS;
+    
+    diag.bufPartials = clCreateBuffer(context, CL_MEM_READ_WRITE, groups * 8 * sizeof(float), nullptr, &err);
+    checkError(err, "clCreateBuffer partials");
+    diag.bufResult = clCreateBuffer(context, CL_MEM_READ_WRITE, 8 * sizeof(float), nullptr, &err);
+    checkError(err, "clCreateBuffer result");
+    
+    diag.potentialKernel = clCreateKernel(program, "compute_forces_potential", &err);
+    checkError(err, "clCreateKernel compute_forces_potential");
+    clSetKernelArg(diag.potentialKernel, 0, sizeof(cl_mem), &sim.bufPos);
+    clSetKernelArg(diag.potentialKernel, 1, sizeof(cl_mem), &sim.bufMass);
+    clSetKernelArg(diag.potentialKernel, 2, sizeof(cl_mem), &sim.bufAcc);
+    clSetKernelArg(diag.potentialKernel, 3, sizeof(int), &sim.n);
+    clSetKernelArg(diag.potentialKernel, 4, sizeof(float), &softening);
+    clSetKernelArg(diag.potentialKernel, 5, sim.localSize * 4 * sizeof(float), nullptr);
+    clSetKernelArg(diag.potentialKernel, 6, sim.localSize * sizeof(float), nullptr);
+    
+    diag.reduceKernel = clCreateKernel(program, "reduce_diagnostics", &err);
+    checkError(err, "clCreateKernel reduce_diagnostics");
+    clSetKernelArg(diag.reduceKernel, 0, sizeof(cl_mem), &sim.bufPos);
+    clSetKernelArg(diag.reduceKernel, 1, sizeof(cl_mem), &sim.bufVel);
+    clSetKernelArg(diag.reduceKernel, 2, sizeof(cl_mem), &sim.bufMass);
+    clSetKernelArg(diag.reduceKernel, 3, sizeof(cl_mem), &sim.bufAcc);
+    clSetKernelArg(diag.reduceKernel, 4, sizeof(int), &sim.n);
+    clSetKernelArg(diag.reduceKernel, 5, sizeof(cl_mem), &diag.bufPartials);
+    clSetKernelArg(diag.reduceKernel, 6, DIAGNOSTIC_LOCAL_SIZE * 8 * sizeof(float), nullptr);
+    
+    diag.sumKernel = clCreateKernel(program, "sum_partials_float8", &err);
+    checkError(err, "clCreateKernel sum_partials_float8");
+    clSetKernelArg(diag.sumKernel, 0, sizeof(cl_mem), &diag.bufPartials);
+    clSetKernelArg(diag.sumKernel, 1, sizeof(int), &groups);
+    clSetKernelArg(diag.sumKernel, 2, sizeof(cl_mem), &diag.bufResult);
+    clSetKernelArg(diag.sumKernel, 3, DIAGNOSTIC_LOCAL_SIZE * 8 * sizeof(float), nullptr);
+    
+    return diag;
+}
+
+// Diagnostics of the current state. `result` is filled asynchronously and is
+// valid once the queue has passed this point (e.g. after the next clFinish).
+void enqueueDiagnostics(DeviceSimulation& sim, DeviceDiagnostics& diag, Diagnostics* result) {
+    cl_int err = clEnqueueNDRangeKernel(sim.queue, diag.potentialKernel, 1, nullptr,
+                                        &sim.globalSize, &sim.localSize, 0, nullptr, nullptr);
+    checkError(err, "clEnqueueNDRangeKernel compute_forces_potential");
+    
+    size_t reduceGlobal = DIAGNOSTIC_GROUPS * DIAGNOSTIC_LOCAL_SIZE;
+    size_t reduceLocal = DIAGNOSTIC_LOCAL_SIZE;
+    err = clEnqueueNDRangeKernel(sim.queue, diag.reduceKernel, 1, nullptr,
+                                 &reduceGlobal, &reduceLocal, 0, nullptr, nullptr);
+    checkError(err, "clEnqueueNDRangeKernel reduce_diagnostics");
+    err = clEnqueueNDRangeKernel(sim.queue, diag.sumKernel, 1, nullptr,
+                                 &reduceLocal, &reduceLocal, 0, nullptr, nullptr);
+    checkError(err, "clEnqueueNDRangeKernel sum_partials_float8");
+    
+    err = clEnqueueReadBuffer(sim.queue, diag.bufResult, CL_FALSE, 0, sizeof(Diagnostics),
+                              result, 0, nullptr, nullptr);
+    checkError(err, "clEnqueueReadBuffer diagnostics");
+}
+
+// Second half of a diagnostic step: the accelerations are already in bufAcc
+void enqueueIntegrate(DeviceSimulation& sim) {
+    size_t integrateSize = sim.n;
+    cl_int err = clEnqueueNDRangeKernel(sim.queue, sim.integrateKernel, 1, nullptr,
+                                        &integrateSize, nullptr, 0, nullptr, nullptr);
+    checkError(err, "clEnqueueNDRangeKernel integrate");
+}
+
+void releaseDeviceDiagnostics(DeviceDiagnostics& diag) {
+    clReleaseMemObject(diag.bufPartials);
+    clReleaseMemObject(diag.bufResult);
+    clReleaseKernel(diag.potentialKernel);
+    clReleaseKernel(diag.reduceKernel);
+    clReleaseKernel(diag.sumKernel);
+}
+
+// Host reference of the same quantities, in double
+void hostDiagnostics(const std::vector<Body>& bodies, const std::vector<float>& positions,
+                     const std::vector<float>& velocities, float softening, double out[8]) {
+    double energy = totalEnergy(bodies, positions, velocities, softening);
+    double kinetic = 0.0, l[3] = {0.0, 0.0, 0.0};
+    for (size_t i = 0; i < bodies.size(); i++) {
+        double m = bodies[i].mass;
+        double x = positions[i*4 + 0], y = positions[i*4 + 1], z = positions[i*4 + 2];
+        double px = m * velocities[i*4 + 0], py = m * velocities[i*4 + 1], pz = m * velocities[i*4 + 2];
+        kinetic += 0.5 * (px * velocities[i*4 + 0] + py * velocities[i*4 + 1] + pz * velocities[i*4 + 2]);
+        l[0] += y * pz - z * py;
+        l[1] += z * px - x * pz;
+        l[2] += x * py - y * px;
+    }
+    
+    double p[3];
+    totalMomentum(bodies, velocities, p);
+    out[0] = kinetic;
+    out[1] = energy - kinetic;
+    for (int c = 0; c < 3; c++) {
+        out[2 + c] = p[c];
+        out[5 + c] = l[c];
+    }
+}
+
+void runDiagnosticsSweep(int n, int steps, int diagnosticEvery, float softening, float dt,
+                         const std::vector<cl_device_id>& devices,
+                         const std::vector<std::string>& deviceNames,
+                         const std::vector<cl_context>& contexts,
+                         const std::vector<cl_program>& programs) {
+    std::cout << "Bodies: " << n << ", Steps: " << steps << ", Diagnostics every: " << diagnosticEvery
+              << " steps\n\n";
+    
+    std::vector<Body> bodies(n);
+    initializeBodies(bodies, n);
+    
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << std::left << std::setw(32) << "Device"
+              << std::right << std::setw(12) << "Step (ms)"
+              << std::setw(12) << "Diag (ms)"
+              << std::setw(12) << "Diag/step"
+              << std::setw(12) << "Host (ms)"
+              << std::setw(12) << "Host/step"
+              << std::setw(12) << "E drift"
+              << std::setw(12) << "P drift"
+              << std::setw(12) << "E err\n";
+    std::cout << std::string(127, '-') << "\n";
+    
+    for (size_t d = 0; d < devices.size(); d++) {
+        // Baseline: plain steps
+        DeviceSimulation sim = createDeviceSimulation(bodies, softening, dt, devices[d], contexts[d], programs[d]);
+        clFinish(sim.queue);
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int step = 0; step < steps; step++) enqueueSimulationStep(sim);
+        clFinish(sim.queue);
+        double baselineMs = std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - start).count();
+        releaseDeviceSimulation(sim);
+        
+        // Same run with a diagnostic every k steps. Results are collected in a
+        // preallocated array so the non-blocking reads have stable targets.
+        sim = createDeviceSimulation(bodies, softening, dt, devices[d], contexts[d], programs[d]);
+        DeviceDiagnostics diag = createDeviceDiagnostics(sim, softening, contexts[d], programs[d]);
+        std::vector<Diagnostics> history(steps / diagnosticEvery + 2);
+        int recorded = 0;
+        clFinish(sim.queue);
+        
+        start = std::chrono::high_resolution_clock::now();
+        for (int step = 0; step < steps; step++) {
+            if (step % diagnosticEvery == 0) {
+                enqueueDiagnostics(sim, diag, &history[recorded++]);
+                enqueueIntegrate(sim);
+            } else {
+                enqueueSimulationStep(sim);
+            }
+        }
+        clFinish(sim.queue);
+        double diagnosticMs = std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - start).count();
+        
+        // Final state: device diagnostics vs the host path (full readback + O(n²) sum in double)
+        enqueueDiagnostics(sim, diag, &history[recorded++]);
+        clFinish(sim.queue);
+        
+        start = std::chrono::high_resolution_clock::now();
+        std::vector<float> positions, velocities;
+        readSimulationState(sim, positions, velocities);
+        double reference[8];
+        hostDiagnostics(bodies, positions, velocities, softening, reference);
+        double hostMs = std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - start).count();
+        
+        releaseDeviceDiagnostics(diag);
+        releaseDeviceSimulation(sim);
+        
+        const float* first = history[0].values;
+        const float* last = history[recorded - 1].values;
+        double e0 = (double)first[0] + first[1];
+        double e1 = (double)last[0] + last[1];
+        double momentumScale = 0.0;
+        for (const Body& b : bodies) {
+            momentumScale += b.mass * std::sqrt(b.vx*b.vx + b.vy*b.vy + b.vz*b.vz);
+        }
+        double pDrift = std::sqrt((last[2]-first[2])*(last[2]-first[2]) + (last[3]-first[3])*(last[3]-first[3]) +
+                                  (last[4]-first[4])*(last[4]-first[4])) / momentumScale;
+        double energyError = std::abs(e1 - (reference[0] + reference[1])) / std::abs(reference[0] + reference[1]);
+        
+        double stepMs = baselineMs / steps;
+        double perDiagnosticMs = (diagnosticMs - baselineMs) / (recorded - 1);
+        
+        std::cout << std::left << std::setw(32) << deviceNames[d].substr(0, 30)
+                  << std::right << std::setw(12) << stepMs
+                  << std::setw(12) << perDiagnosticMs
+                  << std::setw(11) << (100.0 * perDiagnosticMs / stepMs) << "%"
+                  << std::setw(12) << hostMs
+                  << std::setw(11) << (100.0 * hostMs / stepMs) << "%"
+                  << std::scientific << std::setprecision(1)
+                  << std::setw(12) << (std::abs(e1 - e0) / std::abs(e0))
+                  << std::setw(12) << pDrift
+                  << std::setw(12) << energyError
+                  << std::fixed << std::setprecision(3) << "\n";
+    }
+    
+    std::cout << "\nDiag: extra time per diagnostic (potential-carrying force pass, two-stage reduction,\n"
+              << "32-byte read). Host: full readback plus the O(n²) double-precision sum it replaces.\n"
+              << "Overall overhead at every " << diagnosticEvery << " steps = Diag/step / " << diagnosticEvery << ".\n";
+}
+
+// ============================================================================
+// Asynchronous snapshots. The simulation thread only enqueues non-blocking
+// reads into a pinned staging slot and moves on; a background thread waits
+// for the read, encodes the slot and writes the file.
+//
+// Snapshot file (little-endian):
+//   SnapshotHeader
+//   masses      n x float32                      (always fp32, needed to restart)
+//   positions   n x 3 x float32, or float16 with SNAPSHOT_FP16
+//   velocities  n x 3 x float32
+// With SNAPSHOT_COMPRESSED the sections after the header are stored as
+// blocks: [uint32 rawSize][uint32 storedSize][data]. Each block is
+// byte-shuffled (byte k of every 4-byte word grouped together) and then
+// run-length encoded; storedSize == rawSize marks a block kept raw.
+// ============================================================================
+
+const uint32_t SNAPSHOT_FP16 = 1;
+const uint32_t SNAPSHOT_COMPRESSED = 2;
+const size_t SNAPSHOT_BLOCK = 64 * 1024;
+
+struct SnapshotHeader {
+    char magic[8];         // "NBSNAP01"
+    uint32_t version;
+    uint32_t flags;
+    uint64_t bodies;
+    uint64_t step;
+    double time;
+    float dt;
+    float softening;
+};
+static_assert(sizeof(SnapshotHeader) == 48, "snapshot header must stay 48 bytes");
+
+// float -> IEEE half, round to nearest even
+uint16_t floatToHalf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, 4);
+    uint32_t sign = (bits >> 16) & 0x8000u;
+    int32_t exponent = (int32_t)((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFFu;
+    
+    if (((bits >> 23) & 0xFF) == 0xFF) {                   // inf / NaN
+        return (uint16_t)(sign | 0x7C00u | (mantissa ? 0x200u : 0u));
+    }
+    if (exponent >= 31) return (uint16_t)(sign | 0x7C00u);  // overflow -> inf
+    if (exponent <= 0) {                                    // subnormal or zero
+        if (exponent < -10) return (uint16_t)sign;
+        mantissa |= 0x800000u;
+        uint32_t shift = (uint32_t)(14 - exponent);
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t midpoint = 1u << (shift - 1);
+        if (rest > midpoint || (rest == midpoint && (half & 1))) half++;
+        return (uint16_t)(sign | half);
+    }
+    
+    uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1FFFu;
+    if (rest > 0x1000u || (rest == 0x1000u && (half & 1))) half++;   // may carry into the exponent
+    return (uint16_t)half;
+}
+
+float halfToFloat(uint16_t half) {
+    uint32_t sign = (uint32_t)(half & 0x8000u) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FFu;
+    uint32_t bits;
+    
+    if (exponent == 0) {
+        if (mantissa == 0) {
+            bits = sign;
+        } else {                                            // subnormal: normalize
+            exponent = 127 - 15 + 1;
+            while (!(mantissa & 0x400u)) { mantissa <<= 1; exponent--; }
+            bits = sign | (exponent << 23) | ((mantissa & 0x3FFu) << 13);
+        }
+    } else if (exponent == 31) {
+        bits = sign | 0x7F800000u | (mantissa << 13);
+    } else {
+        bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    }
+    
+    float value;
+    std::memcpy(&value, &bits, 4);
+    return value;
+}
+
+// Byte-shuffle + run-length encoding of one block. Token byte c < 128: c + 1
+// literal bytes follow; c >= 128: the next byte repeats c - 126 times (2..129).
+void compressBlock(const uint8_t* raw, size_t size, std::vector<uint8_t>& out) {
+    std::vector<uint8_t> shuffled(size);
+    size_t words = size / 4;
+    for (size_t w = 0; w < words; w++) {
+        for (int b = 0; b < 4; b++) shuffled[b * words + w] = raw[w * 4 + b];
+    }
+    std::copy(raw + words * 4, raw + size, shuffled.begin() + words * 4);
+    
+    out.clear();
+    size_t i = 0;
+    while (i < size) {
+        size_t run = 1;
+        while (i + run < size && run < 129 && shuffled[i + run] == shuffled[i]) run++;
+        
+        if (run >= 2) {
+            out.push_back((uint8_t)(run + 126));
+            out.push_back(shuffled[i]);
+            i += run;
+        } else {
+            // Literal run up to the next pair of equal bytes
+            size_t start = i;
+            while (i < size && i - start < 128 &&
+                   !(i + 1 < size && shuffled[i + 1] == shuffled[i])) {
+                i++;
+            }
+            if (i == start) i++;   // a lone byte before a repeat run
+            out.push_back((uint8_t)(i - start - 1));
+            out.insert(out.end(), shuffled.begin() + start, shuffled.begin() + i);
+        }
+    }
+}
+
+bool decompressBlock(const uint8_t* data, size_t storedSize, uint8_t* raw, size_t size) {
+    std::vector<uint8_t> shuffled;
+    shuffled.reserve(size);
+    size_t i = 0;
+    while (i < storedSize && shuffled.size() < size) {
+        uint8_t token = data[i++];
+        if (token < 128) {
+            size_t count = token + 1;
+            if (i + count > storedSize) return false;
+            shuffled.insert(shuffled.end(), data + i, data + i + count);
+            i += count;
+        } else {
+            if (i >= storedSize) return false;
+            shuffled.insert(shuffled.end(), (size_t)token - 126, data[i++]);
+        }
+    }
+    if (shuffled.size() != size) return false;
+    
+    size_t words = size / 4;
+    for (size_t w = 0; w < words; w++) {
+        for (int b = 0; b < 4; b++) raw[w * 4 + b] = shuffled[b * words + w];
+    }
+    std::copy(shuffled.begin() + words * 4, shuffled.end(), raw + words * 4);
+    return true;
+}
+
+std::string snapshotFileName(uint64_t step) {
+    char name[64];
+    std::snprintf(name, sizeof(name), "snapshot_%06llu.nbs", (unsigned long long)step);
+    return name;
+}
+
+// Writes positions/velocities (float4 per body, as on the device) to `path`.
+// Returns the number of bytes written (0 on failure).
+size_t writeSnapshot(const std::string& path, const SnapshotHeader& header,
+                     const std::vector<float>& masses, const float* positions, const float* velocities) {
+    size_t n = header.bodies;
+    bool fp16 = (header.flags & SNAPSHOT_FP16) != 0;
+    
+    std::vector<uint8_t> payload;
+    payload.reserve(n * (4 + (fp16 ? 6 : 12) + 12));
+    auto append = [&payload](const void* data, size_t bytes) {
+        const uint8_t* p = (const uint8_t*)data;
+        payload.insert(payload.end(), p, p + bytes);
+    };
+    
+    append(masses.data(), (size_t)n * sizeof(float));
+    for (size_t i = 0; i < n; i++) {
+        if (fp16) {
+            uint16_t h[3] = {floatToHalf(positions[i*4 + 0]), floatToHalf(positions[i*4 + 1]),
+                             floatToHalf(positions[i*4 + 2])};
+            append(h, sizeof(h));
+        } else {
+            append(&positions[i*4], 3 * sizeof(float));
+        }
+    }
+    for (size_t i = 0; i < n; i++) {
+        append(&velocities[i*4], 3 * sizeof(float));
+    }
+    
+    std::ofstream file(path, std::ios::binary);
+    if (!file) return 0;
+    file.write((const char*)&header, sizeof(header));
+    size_t written = sizeof(header);
+    
+    if (header.flags & SNAPSHOT_COMPRESSED) {
+        std::vector<uint8_t> packed;
+        for (size_t offset = 0; offset < payload.size(); offset += SNAPSHOT_BLOCK) {
+            uint32_t rawSize = (uint32_t)std::min(SNAPSHOT_BLOCK, payload.size() - offset);
+            compressBlock(&payload[offset], rawSize, packed);
+            bool keepRaw = packed.size() >= rawSize;
+            uint32_t storedSize = keepRaw ? rawSize : (uint32_t)packed.size();
+            
+            file.write((const char*)&rawSize, 4);
+            file.write((const char*)&storedSize, 4);
+            file.write(keepRaw ? (const char*)&payload[offset] : (const char*)packed.data(), storedSize);
+            written += 8 + storedSize;
+        }
+    } else {
+        file.write((const char*)payload.data(), payload.size());
+        written += payload.size();
+    }
+    
+    return file ? written : 0;
+}
+
+// Reads a snapshot back into Body records for a restart
+bool loadSnapshot(const std::string& path, std::vector<Body>& bodies, SnapshotHeader& header) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.read((char*)&header, sizeof(header)) ||
+        std::memcmp(header.magic, "NBSNAP01", 8) != 0 || header.version != 1) {
+        std::cerr << "Not a snapshot file: " << path << "\n";
+        return false;
+    }
+    
+    size_t n = header.bodies;
+    bool fp16 = (header.flags & SNAPSHOT_FP16) != 0;
+    size_t payloadSize = n * (4 + (fp16 ? 6 : 12) + 12);
+    std::vector<uint8_t> payload(payloadSize);
+    
+    if (header.flags & SNAPSHOT_COMPRESSED) {
+        std::vector<uint8_t> stored;
+        for (size_t offset = 0; offset < payloadSize; ) {
+            uint32_t rawSize, storedSize;
+            if (!file.read((char*)&rawSize, 4) || !file.read((char*)&storedSize, 4) ||
+                offset + rawSize > payloadSize) {
+                return false;
+            }
+            stored.resize(storedSize);
+            if (!file.read((char*)stored.data(), storedSize)) return false;
+            if (storedSize == rawSize) {
+                std::copy(stored.begin(), stored.end(), payload.begin() + offset);
+            } else if (!decompressBlock(stored.data(), storedSize, &payload[offset], rawSize)) {
+                return false;
+            }
+            offset += rawSize;
+        }
+    } else if (!file.read((char*)payload.data(), payloadSize)) {
+        return false;
+    }
+    
+    const uint8_t* p = payload.data();
+    bodies.assign(n, Body{});
+    for (size_t i = 0; i < n; i++, p += 4) std::memcpy(&bodies[i].mass, p, 4);
+    for (size_t i = 0; i < n; i++) {
+        float xyz[3];
+        if (fp16) {
+            uint16_t h[3];
+            std::memcpy(h, p, 6);
+            p += 6;
+            for (int c = 0; c < 3; c++) xyz[c] = halfToFloat(h[c]);
+        } else {
+            std::memcpy(xyz, p, 12);
+            p += 12;
+        }
+        bodies[i].x = xyz[0];
+        bodies[i].y = xyz[1];
+        bodies[i].z = xyz[2];
+    }
+    for (size_t i = 0; i < n; i++, p += 12) {
+        std::memcpy(&bodies[i].vx, p, 12);
+    }
+    return true;
+}
+
+// One pinned staging slot: positions then velocities, float4 per body
+struct SnapshotSlot {
+    cl_mem pinned;
+    float* host;           // mapped once for the writer's lifetime
+    cl_event ready;        // both reads into `host` are complete
+    uint64_t step;
+    bool busy;
+};
+
+struct SnapshotWriter {
+    uint32_t flags;
+    float dt, softening;
+    std::vector<float> masses;
+    std::vector<SnapshotSlot> slots;
+    std::deque<int> pending;
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool stopping;
+    std::thread thread;
+    
+    std::vector<double> stallMs;         // simulation thread blocked per snapshot
+    std::vector<double> writeMs;         // encode + write per snapshot (writer thread)
+    size_t rawBytes, storedBytes;
+    std::string lastFile;
+};
+
+void snapshotWriterLoop(SnapshotWriter* writer) {
+    size_t n = writer->masses.size();
+    
+    for (;;) {
+        int slotIndex;
+        {
+            std::unique_lock<std::mutex> lock(writer->mutex);
+            writer->changed.wait(lock, [writer] { return writer->stopping || !writer->pending.empty(); });
+            if (writer->pending.empty()) return;
+            slotIndex = writer->pending.front();
+            writer->pending.pop_front();
+        }
+        
+        SnapshotSlot& slot = writer->slots[slotIndex];
+        clWaitForEvents(1, &slot.ready);
+        clReleaseEvent(slot.ready);
+        
+        auto start = std::chrono::high_resolution_clock::now();
+        
+        SnapshotHeader header = {};
+        std::memcpy(header.magic, "NBSNAP01", 8);
+        header.version = 1;
+        header.flags = writer->flags;
+        header.bodies = n;
+        header.step = slot.step;
+        header.time = slot.step * (double)writer->dt;
+        header.dt = writer->dt;
+        header.softening = writer->softening;
+        
+        std::string path = snapshotFileName(slot.step);
+        size_t written = writeSnapshot(path, header, writer->masses, slot.host, slot.host + n * 4);
+        if (written == 0) std::cerr << "Failed to write " << path << "\n";
+        
+        double ms = std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - start).count();
+        
+        std::lock_guard<std::mutex> lock(writer->mutex);
+        writer->writeMs.push_back(ms);
+        writer->rawBytes += sizeof(SnapshotHeader) + n * (4 + ((writer->flags & SNAPSHOT_FP16) ? 6 : 12) + 12);
+        writer->storedBytes += written;
+        writer->lastFile = path;
+        slot.busy = false;
+        writer->changed.notify_all();
+    }
+}
+
+void startSnapshotWriter(SnapshotWriter& writer, DeviceSimulation& sim, cl_context context,
+                         const std::vector<Body>& bodies, int numSlots,
+                         uint32_t flags, float dt, float softening) {
+    cl_int err;
+    size_t bytes = (size_t)sim.n * 8 * sizeof(float);
+    
+    writer.flags = flags;
+    writer.dt = dt;
+    writer.softening = softening;
+    writer.masses.clear();
+    for (const Body& b : bodies) writer.masses.push_back(b.mass);
+    writer.stopping = false;
+    writer.rawBytes = writer.storedBytes = 0;
+    
+    writer.slots.resize(numSlots);
+    for (SnapshotSlot& slot : writer.slots) {
+        slot.pinned = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, bytes, nullptr, &err);
+        checkError(err, "clCreateBuffer pinned snapshot");
+        slot.host = (float*)clEnqueueMapBuffer(sim.queue, slot.pinned, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE,
+                                               0, bytes, 0, nullptr, nullptr, &err);
+        checkError(err, "clEnqueueMapBuffer snapshot");
+        slot.ready = nullptr;
+        slot.busy = false;
+    }
+    
+    writer.thread = std::thread(snapshotWriterLoop, &writer);
+}
+
+// Called between steps. Blocks only if every slot is still being written;
+// returns the time the simulation thread was stalled.
+double requestSnapshot(SnapshotWriter& writer, DeviceSimulation& sim, uint64_t step) {
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    std::unique_lock<std::mutex> lock(writer.mutex);
+    int slotIndex = -1;
+    writer.changed.wait(lock, [&] {
+        for (size_t s = 0; s < writer.slots.size(); s++) {
+            if (!writer.slots[s].busy) { slotIndex = (int)s; return true; }
+        }
+        return false;
+    });
+    
+    SnapshotSlot& slot = writer.slots[slotIndex];
+    slot.busy = true;
+    slot.step = step;
+    size_t bytes = (size_t)sim.n * 4 * sizeof(float);
+    clEnqueueReadBuffer(sim.queue, sim.bufPos, CL_FALSE, 0, bytes, slot.host, 0, nullptr, nullptr);
+    clEnqueueReadBuffer(sim.queue, sim.bufVel, CL_FALSE, 0, bytes, slot.host + sim.n * 4, 0, nullptr, &slot.ready);
+    clFlush(sim.queue);
+    
+    writer.pending.push_back(slotIndex);
+    writer.changed.notify_all();
+    
+    double ms = std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - start).count();
+    writer.stallMs.push_back(ms);
+    return ms;
+}
+
+// Drains outstanding snapshots, then releases the staging slots
+void stopSnapshotWriter(SnapshotWriter& writer, DeviceSimulation& sim) {
+    {
+        std::lock_guard<std::mutex> lock(writer.mutex);
+        writer.stopping = true;
+        writer.changed.notify_all();
+    }
+    writer.thread.join();
+    
+    for (SnapshotSlot& slot : writer.slots) {
+        clEnqueueUnmapMemObject(sim.queue, slot.pinned, slot.host, 0, nullptr, nullptr);
+    }
+    clFinish(sim.queue);
+    for (SnapshotSlot& slot : writer.slots) clReleaseMemObject(slot.pinned);
+    writer.slots.clear();
+}
+
+void runSnapshotSimulation(int n, int steps, int snapshotEvery, uint32_t flags,
+                           const std::string& restartPath, float softening,
+                           cl_device_id device, const std::string& deviceName,
+                           cl_context context, cl_program program) {
+    const int NUM_SLOTS = 2;
+    float dt = 0.01f;
+    uint64_t firstStep = 0;
+    std::vector<Body> bodies;
+    
+    if (!restartPath.empty()) {
+        SnapshotHeader header;
+        if (!loadSnapshot(restartPath, bodies, header)) return;
+        firstStep = header.step;
+        dt = header.dt;
+        softening = header.softening;
+        n = bodies.size();
+        std::cout << "Restarting from " << restartPath << " (step " << firstStep << ", "
+                  << ((header.flags & SNAPSHOT_FP16) ? "fp16 positions: lossy" : "fp32") << ")\n";
+    } else {
+        bodies.resize(n);
+        initializeBodies(bodies, n);
+    }
+    
+    std::cout << "Device: " << deviceName << "\n";
+    std::cout << "Bodies: " << n << ", Steps: " << steps << ", Snapshot every: " << snapshotEvery
+              << ", Format: " << ((flags & SNAPSHOT_FP16) ? "fp16" : "fp32") << " positions"
+              << ((flags & SNAPSHOT_COMPRESSED) ? ", compressed" : "") << "\n\n";
+    
+    // Baseline: same run without snapshots
+    DeviceSimulation sim = createDeviceSimulation(bodies, softening, dt, device, context, program);
+    clFinish(sim.queue);
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int step = 0; step < steps; step++) enqueueSimulationStep(sim);
+    clFinish(sim.queue);
+    double baselineMs = std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - start).count();
+    releaseDeviceSimulation(sim);
+    
+    // With snapshots
+    sim = createDeviceSimulation(bodies, softening, dt, device, context, program);
+    SnapshotWriter writer;
+    startSnapshotWriter(writer, sim, context, bodies, NUM_SLOTS, flags, dt, softening);
+    clFinish(sim.queue);
+    
+    start = std::chrono::high_resolution_clock::now();
+    for (int step = 1; step <= steps; step++) {
+        enqueueSimulationStep(sim);
+        if (step % snapshotEvery == 0 || step == steps) {
+            requestSnapshot(writer, sim, firstStep + step);
+        }
+    }
+    clFinish(sim.queue);
+    double simulationMs = std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - start).count();
+    
+    std::vector<float> finalPos, finalVel;
+    readSimulationState(sim, finalPos, finalVel);
+    
+    stopSnapshotWriter(writer, sim);
+    double drainedMs = std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - start).count();
+    releaseDeviceSimulation(sim);
+    
+    auto average = [](const std::vector<double>& v) {
+        double sum = 0.0;
+        for (double x : v) sum += x;
+        return v.empty() ? 0.0 : sum / v.size();
+    };
+    
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Without snapshots:        " << baselineMs << " ms\n";
+    std::cout << "With snapshots:           " << simulationMs << " ms ("
+              << std::setprecision(1) << (100.0 * (simulationMs - baselineMs) / baselineMs) << "% overhead)\n";
+    std::cout << std::setprecision(3);
+    std::cout << "Until last file written:  " << drainedMs << " ms\n\n";
+    std::cout << "Snapshots:                " << writer.stallMs.size() << "\n";
+    std::cout << "Stall per snapshot:       avg " << average(writer.stallMs) << " ms, max "
+              << *std::max_element(writer.stallMs.begin(), writer.stallMs.end()) << " ms\n";
+    std::cout << "Write per snapshot:       avg " << average(writer.writeMs) << " ms, max "
+              << *std::max_element(writer.writeMs.begin(), writer.writeMs.end()) << " ms (background)\n";
+    std::cout << std::setprecision(2);
+    std::cout << "Bytes per snapshot:       " << (writer.storedBytes / writer.writeMs.size() / 1024.0)
+              << " KB (payload " << (writer.rawBytes / writer.writeMs.size() / 1024.0) << " KB, ratio "
+              << ((double)writer.rawBytes / writer.storedBytes) << "x)\n";
+    
+    // Restart check: the last snapshot must reproduce the final device state
+    std::vector<Body> restored;
+    SnapshotHeader header;
+    if (loadSnapshot(writer.lastFile, restored, header)) {
+        float maxPos = 0.0f, maxVel = 0.0f;
+        for (int i = 0; i < n; i++) {
+            maxPos = std::max({maxPos, std::abs(restored[i].x - finalPos[i*4 + 0]),
+                               std::abs(restored[i].y - finalPos[i*4 + 1]),
+                               std::abs(restored[i].z - finalPos[i*4 + 2])});
+            maxVel = std::max({maxVel, std::abs(restored[i].vx - finalVel[i*4 + 0]),
+                               std::abs(restored[i].vy - finalVel[i*4 + 1]),
+                               std::abs(restored[i].vz - finalVel[i*4 + 2])});
+        }
+        std::cout << "Restart check (" << writer.lastFile << "): max |dx| " << std::scientific
+                  << std::setprecision(1) << maxPos << ", max |dv| " << maxVel << std::fixed << "\n";
+        std::cout << "Resume with: nbody_simulation.exe --snapshots --restart " << writer.lastFile << "\n";
+    }
+}
+
+// ============================================================================
+// Barnes-Hut tree code (see nbody.cl for the algorithm). The CPU path mirrors
+// the kernels step for step with OpenMP; both rebuild the tree every call.
+// ============================================================================
+
+const int MORTON_BITS = 10;
+
+struct BarnesHutTree {
+    int n;
+    std::vector<uint64_t> keys;       // Morton code << 32 | body index, sorted
+    std::vector<float> sortedBodies;  // x, y, z, mass per body in key order
+    std::vector<int> children;        // 2 per internal node
+    std::vector<int> range;           // first/last sorted body per internal node
+    std::vector<int> parent;          // per node (internal then leaves)
+    std::vector<float> com;           // x, y, z, mass per internal node
+    std::vector<float> size;          // octree cell edge per internal node
+};
+
+uint32_t expandBits(uint32_t v) {
+    v = (v * 0x00010001u) & 0xFF0000FFu;
+    v = (v * 0x00000101u) & 0x0F00F00Fu;
+    v = (v * 0x00000011u) & 0xC30C30C3u;
+    v = (v * 0x00000005u) & 0x49249249u;
+    return v;
+}
+
+// Per-chunk std::sort followed by pairwise merges
+void parallelSortKeys(std::vector<uint64_t>& keys) {
+    int chunks = omp_get_max_threads();
+    std::vector<size_t> bounds(chunks + 1);
+    for (int c = 0; c <= chunks; c++) {
+        bounds[c] = keys.size() * c / chunks;
+    }
+    
+    #pragma omp parallel for
+    for (int c = 0; c < chunks; c++) {
+        std::sort(keys.begin() + bounds[c], keys.begin() + bounds[c + 1]);
+    }
+    
+    for (int width = 1; width < chunks; width *= 2) {
+        #pragma omp parallel for
+        for (int c = 0; c < chunks; c += 2 * width) {
+            if (c + width < chunks) {
+                std::inplace_merge(keys.begin() + bounds[c],
+                                   keys.begin() + bounds[c + width],
+                                   keys.begin() + bounds[std::min(c + 2 * width, chunks)]);
+            }
+        }
+    }
+}
+
+int countLeadingZeros(uint64_t x) {
+    if (x == 0) return 64;
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, x);
+    return 63 - (int)index;
+#else
+    return __builtin_clzll(x);
+#endif
+}
+
+int keyPrefix(const std::vector<uint64_t>& keys, int i, int j) {
+    if (j < 0 || j >= (int)keys.size()) return -1;
+    return countLeadingZeros(keys[i] ^ keys[j]);
+}
+
+void buildBarnesHutTreeCPU(const std::vector<Body>& bodies, BarnesHutTree& tree) {
+    int n = bodies.size();
+    tree.n = n;
+    tree.keys.resize(n);
+    tree.sortedBodies.resize(n * 4);
+    tree.children.resize(2 * (n - 1));
+    tree.range.resize(2 * (n - 1));
+    tree.parent.resize(2 * n - 1);
+    tree.com.resize(4 * (n - 1));
+    tree.size.resize(n - 1);
+    
+    // Bounding cube
+    float minX = bodies[0].x, minY = bodies[0].y, minZ = bodies[0].z;
+    float maxX = minX, maxY = minY, maxZ = minZ;
+    // Per-thread bounds merged at the end (min/max reductions need OpenMP 3.1)
+    #pragma omp parallel
+    {
+        float lminX = minX, lminY = minY, lminZ = minZ;
+        float lmaxX = maxX, lmaxY = maxY, lmaxZ = maxZ;
+        #pragma omp for
+        for (int i = 0; i < n; i++) {
+            lminX = std::min(lminX, bodies[i].x); lmaxX = std::max(lmaxX, bodies[i].x);
+            lminY = std::min(lminY, bodies[i].y); lmaxY = std::max(lmaxY, bodies[i].y);
+            lminZ = std::min(lminZ, bodies[i].z); lmaxZ = std::max(lmaxZ, bodies[i].z);
+        }
+        #pragma omp critical
+        {
+            minX = std::min(minX, lminX); maxX = std::max(maxX, lmaxX);
+            minY = std::min(minY, lminY); maxY = std::max(maxY, lmaxY);
+            minZ = std::min(minZ, lminZ); maxZ = std::max(maxZ, lmaxZ);
+        }
+    }
+    float boxSize = std::max({maxX - minX, maxY - minY, maxZ - minZ, 1e-6f}) * 1.001f;
+    float scale = (1 << MORTON_BITS) / boxSize;
+    
+    // Morton keys and sort
+    #pragma omp parallel for
+    for (int i = 0; i < n; i++) {
+        uint32_t x = std::clamp((int)((bodies[i].x - minX) * scale), 0, (1 << MORTON_BITS) - 1);
+        uint32_t y = std::clamp((int)((bodies[i].y - minY) * scale), 0, (1 << MORTON_BITS) - 1);
+        uint32_t z = std::clamp((int)((bodies[i].z - minZ) * scale), 0, (1 << MORTON_BITS) - 1);
+        uint32_t code = (expandBits(x) << 2) | (expandBits(y) << 1) | expandBits(z);
+        tree.keys[i] = ((uint64_t)code << 32) | (uint32_t)i;
+    }
+    parallelSortKeys(tree.keys);
+    
+    #pragma omp parallel for
+    for (int k = 0; k < n; k++) {
+        const Body& b = bodies[(uint32_t)tree.keys[k]];
+        tree.sortedBodies[k*4 + 0] = b.x;
+        tree.sortedBodies[k*4 + 1] = b.y;
+        tree.sortedBodies[k*4 + 2] = b.z;
+        tree.sortedBodies[k*4 + 3] = b.mass;
+    }
+    
+    // Radix tree, one iteration per internal node (same as build_radix_tree)
+    tree.parent[0] = -1;
+    #pragma omp parallel for
+    for (int i = 0; i < n - 1; i++) {
+        const std::vector<uint64_t>& keys = tree.keys;
+        int d = (keyPrefix(keys, i, i + 1) - keyPrefix(keys, i, i - 1)) > 0 ? 1 : -1;
+        
+        int prefixMin = keyPrefix(keys, i, i - d);
+        int lengthMax = 2;
+        while (keyPrefix(keys, i, i + lengthMax * d) > prefixMin) {
+            lengthMax *= 2;
+        }
+        int length = 0;
+        for (int t = lengthMax / 2; t >= 1; t /= 2) {
+            if (keyPrefix(keys, i, i + (length + t) * d) > prefixMin) {
+                length += t;
+            }
+        }
+        int j = i + length * d;
+        
+        int prefixNode = keyPrefix(keys, i, j);
+        int split = 0;
+        int t;
+        int divisor = 2;
+        do {
+            t = (length + divisor - 1) / divisor;
+            if (keyPrefix(keys, i, i + (split + t) * d) > prefixNode) {
+                split += t;
+            }
+            divisor *= 2;
+        } while (t > 1);
+        int gamma = i + split * d + std::min(d, 0);
+        
+        int first = std::min(i, j);
+        int last = std::max(i, j);
+        int left = (first == gamma) ? (n - 1 + gamma) : gamma;
+        int right = (last == gamma + 1) ? (n - 1 + gamma + 1) : gamma + 1;
+        
+        tree.children[i*2 + 0] = left;
+        tree.children[i*2 + 1] = right;
+        tree.range[i*2 + 0] = first;
+        tree.range[i*2 + 1] = last;
+        tree.parent[left] = i;
+        tree.parent[right] = i;
+        
+        int mortonPrefix = std::clamp(prefixNode - 2, 0, 3 * MORTON_BITS);
+        tree.size[i] = boxSize / (float)(1 << (mortonPrefix / 3));
+    }
+    
+    // Bottom-up centre of mass; the second child to arrive summarizes the node
+    std::vector<std::atomic<int>> visits(n - 1);
+    for (auto& v : visits) v.store(0, std::memory_order_relaxed);
+    
+    #pragma omp parallel for
+    for (int k = 0; k < n; k++) {
+        int node = tree.parent[n - 1 + k];
+        while (node >= 0) {
+            if (visits[node].fetch_add(1, std::memory_order_acq_rel) == 0) break;
+            
+            float a[4], b[4];
+            for (int c = 0; c < 2; c++) {
+                int child = tree.children[node*2 + c];
+                const float* src = (child >= n - 1) ? &tree.sortedBodies[(child - (n - 1)) * 4]
+                                                    : &tree.com[child * 4];
+                std::copy(src, src + 4, c == 0 ? a : b);
+            }
+            float mass = a[3] + b[3];
+            tree.com[node*4 + 0] = (a[0] * a[3] + b[0] * b[3]) / mass;
+            tree.com[node*4 + 1] = (a[1] * a[3] + b[1] * b[3]) / mass;
+            tree.com[node*4 + 2] = (a[2] * a[3] + b[2] * b[3]) / mass;
+            tree.com[node*4 + 3] = mass;
+            
+            node = tree.parent[node];
+        }
+    }
+}
+
+// Returns total time; buildMs receives the tree construction share
+double computeForcesBarnesHutCPU(const std::vector<Body>& bodies,
+                                 std::vector<float>& acc_x,
+                                 std::vector<float>& acc_y,
+                                 std::vector<float>& acc_z,
+                                 float softening, float theta,
+                                 double* buildMs) {
+    int n = bodies.size();
+    BarnesHutTree tree;
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    buildBarnesHutTreeCPU(bodies, tree);
+    
+    auto built = std::chrono::high_resolution_clock::now();
+    
+    const float thetaSq = theta * theta;
+    const float softSq = softening * softening;
+    
+    #pragma omp parallel for schedule(dynamic, 256)
+    for (int k = 0; k < n; k++) {
+        const float* pos = &tree.sortedBodies[k * 4];
+        float ax = 0.0f, ay = 0.0f, az = 0.0f;
+        
+        int stack[64];
+        int top = 0;
+        stack[top++] = 0;
+        
+        while (top > 0) {
+            int node = stack[--top];
+            const float* src;
+            
+            if (node >= n - 1) {
+                int body = node - (n - 1);
+                if (body == k) continue;
+                src = &tree.sortedBodies[body * 4];
+            } else {
+                src = &tree.com[node * 4];
+                float dx = src[0] - pos[0], dy = src[1] - pos[1], dz = src[2] - pos[2];
+                float distSq = dx*dx + dy*dy + dz*dz;
+                bool containsSelf = (k >= tree.range[node*2] && k <= tree.range[node*2 + 1]);
+                
+                if (containsSelf || tree.size[node] * tree.size[node] >= thetaSq * distSq) {
+                    stack[top++] = tree.children[node*2 + 0];
+                    stack[top++] = tree.children[node*2 + 1];
+                    continue;
+                }
+            }
+            
+            float dx = src[0] - pos[0], dy = src[1] - pos[1], dz = src[2] - pos[2];
+            float distSq = dx*dx + dy*dy + dz*dz + softSq;
+            float dist = std::sqrt(distSq);
+            float force = src[3] / (distSq * dist);
+            ax += dx * force;
+            ay += dy * force;
+            az += dz * force;
+        }
+        
+        uint32_t i = (uint32_t)tree.keys[k];
+        acc_x[i] = ax;
+        acc_y[i] = ay;
+        acc_z[i] = az;
+    }
+    
+    auto end = std::chrono::high_resolution_clock::now();
+    *buildMs = std::chrono::duration<double, std::milli>(built - start).count();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// OpenCL Barnes-Hut: bounding box, keys, bitonic sort, radix tree, centre of
+// mass and traversal all run as kernels. Only the per-group bounding box
+// partials come back to the host mid-pipeline.
+double computeForcesBarnesHutOpenCL(const std::vector<Body>& bodies,
+                                    std::vector<float>& acc_x,
+                                    std::vector<float>& acc_y,
+                                    std::vector<float>& acc_z,
+                                    float softening, float theta,
+                                    cl_device_id device,
+                                    cl_context context,
+                                    cl_program program,
+                                    double* buildMs) {
+    cl_int err;
+    int n = bodies.size();
+    const int LOCAL_SIZE = 256;
+    
+    cl_command_queue queue = clCreateCommandQueueWithProperties(context, device, nullptr, &err);
+    checkError(err, "clCreateCommandQueue");
+    
+    // Bitonic sort needs a power-of-two key count
+    int paddedN = 1;
+    while (paddedN < n) paddedN *= 2;
+    size_t groupCount = (n + LOCAL_SIZE - 1) / LOCAL_SIZE;
+    
+    std::vector<float> positions(n * 4);
+    std::vector<float> masses(n);
+    for (int i = 0; i < n; i++) {
+        positions[i*4 + 0] = bodies[i].x;
+        positions[i*4 + 1] = bodies[i].y;
+        positions[i*4 + 2] = bodies[i].z;
+        positions[i*4 + 3] = 0.0f;
+        masses[i] = bodies[i].mass;
+    }
+    
+    cl_mem bufPos = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                    (size_t)n * 4 * sizeof(float), positions.data(), &err);
+    checkError(err, "clCreateBuffer positions");
+    cl_mem bufMass = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                     (size_t)n * sizeof(float), masses.data(), &err);
+    checkError(err, "clCreateBuffer masses");
+    cl_mem bufGroupMin = clCreateBuffer(context, CL_MEM_WRITE_ONLY, groupCount * 4 * sizeof(float), nullptr, &err);
+    checkError(err, "clCreateBuffer group min");
+    cl_mem bufGroupMax = clCreateBuffer(context, CL_MEM_WRITE_ONLY, groupCount * 4 * sizeof(float), nullptr, &err);
+    checkError(err, "clCreateBuffer group max");
+    cl_mem bufKeys = clCreateBuffer(context, CL_MEM_READ_WRITE, (size_t)paddedN * sizeof(cl_ulong), nullptr, &err);
+    checkError(err, "clCreateBuffer keys");
+    cl_mem bufSorted = clCreateBuffer(context, CL_MEM_READ_WRITE, (size_t)n * 4 * sizeof(float), nullptr, &err);
+    checkError(err, "clCreateBuffer sorted bodies");
+    cl_mem bufChildren = clCreateBuffer(context, CL_MEM_READ_WRITE, (n - 1) * 2 * sizeof(int), nullptr, &err);
+    checkError(err, "clCreateBuffer children");
+    cl_mem bufRange = clCreateBuffer(context, CL_MEM_READ_WRITE, (n - 1) * 2 * sizeof(int), nullptr, &err);
+    checkError(err, "clCreateBuffer range");
+    cl_mem bufParent = clCreateBuffer(context, CL_MEM_READ_WRITE, (2 * n - 1) * sizeof(int), nullptr, &err);
+    checkError(err, "clCreateBuffer parent");
+    cl_mem bufSize = clCreateBuffer(context, CL_MEM_READ_WRITE, (n - 1) * sizeof(float), nullptr, &err);
+    checkError(err, "clCreateBuffer size");
+    cl_mem bufCom = clCreateBuffer(context, CL_MEM_READ_WRITE, (n - 1) * 4 * sizeof(float), nullptr, &err);
+    checkError(err, "clCreateBuffer com");
+    cl_mem bufVisits = clCreateBuffer(context, CL_MEM_READ_WRITE, (n - 1) * sizeof(int), nullptr, &err);
+    checkError(err, "clCreateBuffer visits");
+    cl_mem bufAcc = clCreateBuffer(context, CL_MEM_WRITE_ONLY, (size_t)n * 4 * sizeof(float), nullptr, &err);
+    checkError(err, "clCreateBuffer accelerations");
+    
+    cl_kernel kernelBox = clCreateKernel(program, "bounding_box_partial", &err);
+    checkError(err, "clCreateKernel bounding_box_partial");
+    cl_kernel kernelKeys = clCreateKernel(program, "compute_morton_keys", &err);
+    checkError(err, "clCreateKernel compute_morton_keys");
+    cl_kernel kernelSort = clCreateKernel(program, "bitonic_sort_step", &err);
+    checkError(err, "clCreateKernel bitonic_sort_step");
+    cl_kernel kernelGather = clCreateKernel(program, "gather_sorted_bodies", &err);
+    checkError(err, "clCreateKernel gather_sorted_bodies");
+    cl_kernel kernelBuild = clCreateKernel(program, "build_radix_tree", &err);
+    checkError(err, "clCreateKernel build_radix_tree");
+    cl_kernel kernelSummarize = clCreateKernel(program, "summarize_tree", &err);
+    checkError(err, "clCreateKernel summarize_tree");
+    cl_kernel kernelForces = clCreateKernel(program, "compute_forces_barnes_hut", &err);
+    checkError(err, "clCreateKernel compute_forces_barnes_hut");
+    
+    clSetKernelArg(kernelBox, 0, sizeof(cl_mem), &bufPos);
+    clSetKernelArg(kernelBox, 1, sizeof(cl_mem), &bufGroupMin);
+    clSetKernelArg(kernelBox, 2, sizeof(cl_mem), &bufGroupMax);
+    clSetKernelArg(kernelBox, 3, sizeof(int), &n);
+    clSetKernelArg(kernelBox, 4, LOCAL_SIZE * 4 * sizeof(float), nullptr);
+    clSetKernelArg(kernelBox, 5, LOCAL_SIZE * 4 * sizeof(float), nullptr);
+    
+    clSetKernelArg(kernelSort, 0, sizeof(cl_mem), &bufKeys);
+    
+    clSetKernelArg(kernelGather, 0, sizeof(cl_mem), &bufKeys);
+    clSetKernelArg(kernelGather, 1, sizeof(cl_mem), &bufPos);
+    clSetKernelArg(kernelGather, 2, sizeof(cl_mem), &bufMass);
+    clSetKernelArg(kernelGather, 3, sizeof(cl_mem), &bufSorted);
+    clSetKernelArg(kernelGather, 4, sizeof(int), &n);
+    
+    clSetKernelArg(kernelSummarize, 0, sizeof(cl_mem), &bufChildren);
+    clSetKernelArg(kernelSummarize, 1, sizeof(cl_mem), &bufParent);
+    clSetKernelArg(kernelSummarize, 2, sizeof(cl_mem), &bufSorted);
+    clSetKernelArg(kernelSummarize, 3, sizeof(cl_mem), &bufCom);
+    clSetKernelArg(kernelSummarize, 4, sizeof(cl_mem), &bufVisits);
+    clSetKernelArg(kernelSummarize, 5, sizeof(int), &n);
+    
+    clSetKernelArg(kernelForces, 0, sizeof(cl_mem), &bufKeys);
+    clSetKernelArg(kernelForces, 1, sizeof(cl_mem), &bufSorted);
+    clSetKernelArg(kernelForces, 2, sizeof(cl_mem), &bufChildren);
+    clSetKernelArg(kernelForces, 3, sizeof(cl_mem), &bufRange);
+    clSetKernelArg(kernelForces, 4, sizeof(cl_mem), &bufCom);
+    clSetKernelArg(kernelForces, 5, sizeof(cl_mem), &bufSize);
+    clSetKernelArg(kernelForces, 6, sizeof(cl_mem), &bufAcc);
+    clSetKernelArg(kernelForces, 7, sizeof(int), &n);
+    clSetKernelArg(kernelForces, 8, sizeof(float), &softening);
+    clSetKernelArg(kernelForces, 9, sizeof(float), &theta);
+    
+    size_t boxGlobal = groupCount * LOCAL_SIZE;
+    size_t boxLocal = LOCAL_SIZE;
+    size_t paddedGlobal = paddedN;
+    size_t bodyGlobal = n;
+    size_t nodeGlobal = n - 1;
+    std::vector<float> groupMin(groupCount * 4), groupMax(groupCount * 4);
+    int zero = 0;
+    
+    clFinish(queue);
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    // Bounding cube: per-group partials on the device, final reduction here
+    err = clEnqueueNDRangeKernel(queue, kernelBox, 1, nullptr, &boxGlobal, &boxLocal, 0, nullptr, nullptr);
+    checkError(err, "clEnqueueNDRangeKernel bounding_box_partial");
+    clEnqueueReadBuffer(queue, bufGroupMin, CL_FALSE, 0, groupCount * 4 * sizeof(float), groupMin.data(), 0, nullptr, nullptr);
+    clEnqueueReadBuffer(queue, bufGroupMax, CL_TRUE, 0, groupCount * 4 * sizeof(float), groupMax.data(), 0, nullptr, nullptr);
+    
+    cl_float4 boxMin = {{groupMin[0], groupMin[1], groupMin[2], 0.0f}};
+    float boxMax[3] = {groupMax[0], groupMax[1], groupMax[2]};
+    for (size_t g = 1; g < groupCount; g++) {
+        for (int c = 0; c < 3; c++) {
+            boxMin.s[c] = std::min(boxMin.s[c], groupMin[g*4 + c]);
+            boxMax[c] = std::max(boxMax[c], groupMax[g*4 + c]);
+        }
+    }
+    float boxSize = std::max({boxMax[0] - boxMin.s[0], boxMax[1] - boxMin.s[1],
+                              boxMax[2] - boxMin.s[2], 1e-6f}) * 1.001f;
+    float invBoxSize = 1.0f / boxSize;
+    
+    clSetKernelArg(kernelKeys, 0, sizeof(cl_mem), &bufPos);
+    clSetKernelArg(kernelKeys, 1, sizeof(cl_mem), &bufKeys);
+    clSetKernelArg(kernelKeys, 2, sizeof(int), &n);
+    clSetKernelArg(kernelKeys, 3, sizeof(cl_float4), &boxMin);
+    clSetKernelArg(kernelKeys, 4, sizeof(float), &invBoxSize);
+    clEnqueueNDRangeKernel(queue, kernelKeys, 1, nullptr, &paddedGlobal, nullptr, 0, nullptr, nullptr);
+    
+    for (cl_uint k = 2; k <= (cl_uint)paddedN; k *= 2) {
+        for (cl_uint j = k / 2; j > 0; j /= 2) {
+            clSetKernelArg(kernelSort, 1, sizeof(cl_uint), &j);
+            clSetKernelArg(kernelSort, 2, sizeof(cl_uint), &k);
+            clEnqueueNDRangeKernel(queue, kernelSort, 1, nullptr, &paddedGlobal, nullptr, 0, nullptr, nullptr);
+        }
+    }
+    
+    clEnqueueNDRangeKernel(queue, kernelGather, 1, nullptr, &bodyGlobal, nullptr, 0, nullptr, nullptr);
+    
+    clSetKernelArg(kernelBuild, 0, sizeof(cl_mem), &bufKeys);
+    clSetKernelArg(kernelBuild, 1, sizeof(cl_mem), &bufChildren);
+    clSetKernelArg(kernelBuild, 2, sizeof(cl_mem), &bufRange);
+    clSetKernelArg(kernelBuild, 3, sizeof(cl_mem), &bufParent);
+    clSetKernelArg(kernelBuild, 4, sizeof(cl_mem), &bufSize);
+    clSetKernelArg(kernelBuild, 5, sizeof(int), &n);
+    clSetKernelArg(kernelBuild, 6, sizeof(float), &boxSize);
+    clEnqueueNDRangeKernel(queue, kernelBuild, 1, nullptr, &nodeGlobal, nullptr, 0, nullptr, nullptr);
+    
+    clEnqueueFillBuffer(queue, bufVisits, &zero, sizeof(int), 0, (n - 1) * sizeof(int), 0, nullptr, nullptr);
+    err = clEnqueueNDRangeKernel(queue, kernelSummarize, 1, nullptr, &bodyGlobal, nullptr, 0, nullptr, nullptr);
+    checkError(err, "clEnqueueNDRangeKernel summarize_tree");
+    
+    clFinish(queue);
+    auto built = std::chrono::high_resolution_clock::now();
+    
+    err = clEnqueueNDRangeKernel(queue, kernelForces, 1, nullptr, &bodyGlobal, nullptr, 0, nullptr, nullptr);
+    checkError(err, "clEnqueueNDRangeKernel compute_forces_barnes_hut");
+    
+    clFinish(queue);
+    
+    auto end = std::chrono::high_resolution_clock::now();
+    
+    std::vector<float> accelerations(n * 4);
+    clEnqueueReadBuffer(queue, bufAcc, CL_TRUE, 0, (size_t)n * 4 * sizeof(float),
+                        accelerations.data(), 0, nullptr, nullptr);
+    for (int i = 0; i < n; i++) {
+        acc_x[i] = accelerations[i*4 + 0];
+        acc_y[i] = accelerations[i*4 + 1];
+        acc_z[i] = accelerations[i*4 + 2];
+    }
+    
+    for (cl_mem buf : {bufPos, bufMass, bufGroupMin, bufGroupMax, bufKeys, bufSorted, bufChildren,
+                       bufRange, bufParent, bufSize, bufCom, bufVisits, bufAcc}) {
+        clReleaseMemObject(buf);
+    }
+    for (cl_kernel kernel : {kernelBox, kernelKeys, kernelSort, kernelGather, kernelBuild,
+                             kernelSummarize, kernelForces}) {
+        clReleaseKernel(kernel);
+    }
+    clReleaseCommandQueue(queue);
+    
+    *buildMs = std::chrono::duration<double, std::milli>(built - start).count();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// Relative acceleration error against a double-precision direct sum, on an
+// evenly spaced sample of bodies (the full direct sum is O(n²))
+void barnesHutError(const std::vector<Body>& bodies,
+                    const std::vector<float>& acc_x,
+                    const std::vector<float>& acc_y,
+                    const std::vector<float>& acc_z,
+                    float softening, int samples,
+                    double* meanError, double* maxError) {
+    int n = bodies.size();
+    samples = std::min(samples, n);
+    double sum = 0.0, worst = 0.0;
+    
+    #pragma omp parallel reduction(+:sum)
+    {
+        double localWorst = 0.0;
+        #pragma omp for
+        for (int s = 0; s < samples; s++) {
+            int i = (int)((long long)s * n / samples);
+            double ax = 0.0, ay = 0.0, az = 0.0;
+            for (int j = 0; j < n; j++) {
+                if (i == j) continue;
+                double dx = bodies[j].x - bodies[i].x;
+                double dy = bodies[j].y - bodies[i].y;
+                double dz = bodies[j].z - bodies[i].z;
+                double distSq = dx*dx + dy*dy + dz*dz + (double)softening * softening;
+                double force = bodies[j].mass / (distSq * std::sqrt(distSq));
+                ax += dx * force;
+                ay += dy * force;
+                az += dz * force;
+            }
+            double ex = acc_x[i] - ax, ey = acc_y[i] - ay, ez = acc_z[i] - az;
+            double error = std::sqrt(ex*ex + ey*ey + ez*ez) / std::sqrt(ax*ax + ay*ay + az*az);
+            sum += error;
+            localWorst = std::max(localWorst, error);
+        }
+        #pragma omp critical
+        worst = std::max(worst, localWorst);
+    }
+    
+    *meanError = sum / samples;
+    *maxError = worst;
+}
+
+void printBarnesHutRow(const std::string& name, double buildMs, double totalMs,
+                       double directMs, double meanError, double maxError) {
+    std::cout << std::left << std::setw(36) << name
+              << std::right << std::setw(12) << buildMs
+              << std::setw(12) << (totalMs - buildMs)
+              << std::setw(12) << totalMs
+              << std::setw(11) << (directMs / totalMs) << "x";
+    if (meanError >= 0.0) {
+        std::cout << std::setw(12) << std::scientific << std::setprecision(1) << meanError
+                  << std::setw(12) << maxError << std::fixed << std::setprecision(2);
+    }
+    std::cout << "\n";
+}
+
+void runBarnesHutSweep(int maxBodies, float theta, float softening,
+                       const std::vector<cl_device_id>& devices,
+                       const std::vector<std::string>& deviceNames,
+                       const std::vector<cl_context>& contexts,
+                       const std::vector<cl_program>& programs) {
+    // Direct sums above this size are extrapolated as O(n²) from the last measurement
+    const int DIRECT_LIMIT = 65536;
+    const int ERROR_SAMPLES = 1024;
+    
+    std::vector<int> bodyCounts;
+    for (int n = 1024; n <= maxBodies; n *= 4) bodyCounts.push_back(n);
+    
+    // Crossover: first size where Barnes-Hut beats the direct sum, per implementation
+    std::vector<std::string> names = {"OpenMP"};
+    for (const std::string& name : deviceNames) names.push_back("OpenCL: " + name.substr(0, 28));
+    std::vector<int> crossover(names.size(), 0);
+    std::vector<double> directBase(names.size(), 0.0);
+    int directBaseN = 0;
+    
+    std::cout << "Theta: " << theta << ", error sampled on " << ERROR_SAMPLES << " bodies\n\n";
+    
+    for (int n : bodyCounts) {
+        std::cout << "========================================\n";
+        std::cout << "Barnes-Hut with " << n << " particles\n";
+        std::cout << "========================================\n";
+        
+        std::vector<Body> bodies(n);
+        initializeBodies(bodies, n);
+        std::vector<float> acc_x(n), acc_y(n), acc_z(n);
+        
+        bool measureDirect = (n <= DIRECT_LIMIT);
+        double scale = measureDirect ? 1.0 : ((double)n / directBaseN) * ((double)n / directBaseN);
+        
+        std::cout << "\n" << std::fixed << std::setprecision(2);
+        std::cout << std::left << std::setw(36) << "Implementation"
+                  << std::right << std::setw(12) << "Build (ms)"
+                  << std::setw(12) << "Walk (ms)"
+                  << std::setw(12) << "Total (ms)"
+                  << std::setw(12) << "Speedup"
+                  << std::setw(12) << "Mean err"
+                  << std::setw(12) << "Max err\n";
+        std::cout << std::string(108, '-') << "\n";
+        
+        for (size_t impl = 0; impl < names.size(); impl++) {
+            double directMs;
+            if (measureDirect) {
+                directMs = (impl == 0)
+                    ? computeForcesOpenMP(bodies, acc_x, acc_y, acc_z, softening)
+                    : computeForcesOpenCL(bodies, acc_x, acc_y, acc_z, softening,
+                                          devices[impl - 1], contexts[impl - 1], programs[impl - 1], true);
+                directBase[impl] = directMs;
+            } else {
+                directMs = directBase[impl] * scale;
+            }
+            
+            double buildMs;
+            double bhMs = (impl == 0)
+                ? computeForcesBarnesHutCPU(bodies, acc_x, acc_y, acc_z, softening, theta, &buildMs)
+                : computeForcesBarnesHutOpenCL(bodies, acc_x, acc_y, acc_z, softening, theta,
+                                               devices[impl - 1], contexts[impl - 1], programs[impl - 1],
+                                               &buildMs);
+            double meanError, maxError;
+            barnesHutError(bodies, acc_x, acc_y, acc_z, softening, ERROR_SAMPLES, &meanError, &maxError);
+            
+            std::cout << std::left << std::setw(36) << (names[impl] + (impl == 0 ? " direct" : " (tiled)")
+                                                        + (measureDirect ? "" : "*"))
+                      << std::right << std::setw(12) << "-"
+                      << std::setw(12) << "-"
+                      << std::setw(12) << directMs << "\n";
+            printBarnesHutRow(names[impl] + " Barnes-Hut", buildMs, bhMs, directMs, meanError, maxError);
+            
+            if (crossover[impl] == 0 && bhMs < directMs) crossover[impl] = n;
+        }
+        
+        if (measureDirect) directBaseN = n;
+        std::cout << "\n";
+    }
+    
+    std::cout << "* direct time extrapolated as O(n²) from " << directBaseN << " particles\n\n";
+    std::cout << "Crossover (first tested size where Barnes-Hut beats direct):\n";
+    for (size_t impl = 0; impl < names.size(); impl++) {
+        std::cout << "  " << std::left << std::setw(36) << names[impl];
+        if (crossover[impl] > 0) std::cout << crossover[impl] << " particles\n";
+        else std::cout << "not reached\n";
+    }
+}
+
+// ============================================================================
+// Cell-list short-range forces (see nbody.cl). Both paths rebuild the cell
+// list every call, as a simulation would every step.
+// ============================================================================
+
+struct CellListConfig {
+    float cutoff;
+    float stiffness;
+    float boxSize;
+    int grid;          // cells per axis, each at least one cutoff wide
+};
+
+CellListConfig makeCellListConfig(int n, float particlesPerCell) {
+    CellListConfig cfg;
+    cfg.cutoff = 1.0f;
+    cfg.stiffness = 25.0f;
+    cfg.grid = std::max(1, (int)std::cbrt(n / particlesPerCell));
+    cfg.boxSize = cfg.grid * cfg.cutoff;
+    return cfg;
+}
+
+// Uniform random particles in [0, boxSize)^3 as float4 (w = 0)
+std::vector<float> initializeParticles(int n, float boxSize) {
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<float> dist(0.0f, boxSize);
+    std::vector<float> positions((size_t)n * 4, 0.0f);
+    for (int i = 0; i < n; i++) {
+        positions[i*4 + 0] = dist(gen);
+        positions[i*4 + 1] = dist(gen);
+        positions[i*4 + 2] = dist(gen);
+    }
+    return positions;
+}
+
+int cellCoord(float v, float invCell, int grid) {
+    return std::clamp((int)(v * invCell), 0, grid - 1);
+}
+
+// OpenMP path; returns total time, buildMs receives the cell-list share
+double computeForcesCellListCPU(const std::vector<float>& positions,
+                                std::vector<float>& accelerations,
+                                const CellListConfig& cfg,
+                                double* buildMs) {
+    int n = positions.size() / 4;
+    int grid = cfg.grid;
+    int numCells = grid * grid * grid;
+    float invCell = 1.0f / cfg.cutoff;
+    
+    std::vector<uint64_t> keys(n);
+    std::vector<int> cellStart(numCells), cellEnd(numCells);
+    std::vector<float> sorted((size_t)n * 4);
+    accelerations.resize((size_t)n * 4);
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    #pragma omp parallel for
+    for (int i = 0; i < n; i++) {
+        int cx = cellCoord(positions[i*4 + 0], invCell, grid);
+        int cy = cellCoord(positions[i*4 + 1], invCell, grid);
+        int cz = cellCoord(positions[i*4 + 2], invCell, grid);
+        uint32_t cell = (uint32_t)((cz * grid + cy) * grid + cx);
+        keys[i] = ((uint64_t)cell << 32) | (uint32_t)i;
+    }
+    parallelSortKeys(keys);
+    
+    std::fill(cellStart.begin(), cellStart.end(), 0);
+    std::fill(cellEnd.begin(), cellEnd.end(), 0);
+    #pragma omp parallel for
+    for (int k = 0; k < n; k++) {
+        uint32_t cell = (uint32_t)(keys[k] >> 32);
+        if (k == 0 || (uint32_t)(keys[k - 1] >> 32) != cell) cellStart[cell] = k;
+        if (k == n - 1 || (uint32_t)(keys[k + 1] >> 32) != cell) cellEnd[cell] = k + 1;
+        std::copy(&positions[(size_t)(uint32_t)keys[k] * 4], &positions[(size_t)(uint32_t)keys[k] * 4 + 4],
+                  &sorted[(size_t)k * 4]);
+    }
+    
+    auto built = std::chrono::high_resolution_clock::now();
+    
+    const float cutoffSq = cfg.cutoff * cfg.cutoff;
+    const float invCutoff = 1.0f / cfg.cutoff;
+    
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (int k = 0; k < n; k++) {
+        const float* p = &sorted[(size_t)k * 4];
+        int cx = cellCoord(p[0], invCell, grid);
+        int cy = cellCoord(p[1], invCell, grid);
+        int cz = cellCoord(p[2], invCell, grid);
+        float ax = 0.0f, ay = 0.0f, az = 0.0f;
+        
+        for (int z = std::max(cz - 1, 0); z <= std::min(cz + 1, grid - 1); z++) {
+            for (int y = std::max(cy - 1, 0); y <= std::min(cy + 1, grid - 1); y++) {
+                for (int x = std::max(cx - 1, 0); x <= std::min(cx + 1, grid - 1); x++) {
+                    int cell = (z * grid + y) * grid + x;
+                    for (int j = cellStart[cell]; j < cellEnd[cell]; j++) {
+                        float dx = p[0] - sorted[(size_t)j*4 + 0];
+                        float dy = p[1] - sorted[(size_t)j*4 + 1];
+                        float dz = p[2] - sorted[(size_t)j*4 + 2];
+                        float distSq = dx*dx + dy*dy + dz*dz;
+                        if (distSq < cutoffSq && distSq > 0.0f) {
+                            float f = cfg.stiffness * (1.0f / std::sqrt(distSq) - invCutoff);
+                            ax += dx * f;
+                            ay += dy * f;
+                            az += dz * f;
+                        }
+                    }
+                }
+            }
+        }
+        
+        size_t i = (uint32_t)keys[k];
+        accelerations[i*4 + 0] = ax;
+        accelerations[i*4 + 1] = ay;
+        accelerations[i*4 + 2] = az;
+        accelerations[i*4 + 3] = 0.0f;
+    }
+    
+    auto end = std::chrono::high_resolution_clock::now();
+    *buildMs = std::chrono::duration<double, std::milli>(built - start).count();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// Device memory the OpenCL cell list needs (bitonic sort pads keys to 2^k)
+size_t cellListDeviceBytes(int n, const CellListConfig& cfg, size_t* largestBuffer) {
+    size_t paddedN = 1;
+    while (paddedN < (size_t)n) paddedN *= 2;
+    size_t numCells = (size_t)cfg.grid * cfg.grid * cfg.grid;
+    size_t float4s = (size_t)n * 4 * sizeof(float);
+    *largestBuffer = std::max(float4s, paddedN * sizeof(cl_ulong));
+    return 3 * float4s + paddedN * sizeof(cl_ulong) + 2 * numCells * sizeof(int);
+}
+
+double computeForcesCellListOpenCL(const std::vector<float>& positions,
+                                   std::vector<float>& accelerations,
+                                   const CellListConfig& cfg,
+                                   cl_device_id device,
+                                   cl_context context,
+                                   cl_program program,
+                                   double* buildMs) {
+    cl_int err;
+    int n = positions.size() / 4;
+    int grid = cfg.grid;
+    int numCells = grid * grid * grid;
+    float invCell = 1.0f / cfg.cutoff;
+    
+    int paddedN = 1;
+    while (paddedN < n) paddedN *= 2;
+    
+    cl_command_queue queue = clCreateCommandQueueWithProperties(context, device, nullptr, &err);
+    checkError(err, "clCreateCommandQueue");
+    
+    cl_mem bufPos = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                    (size_t)n * 4 * sizeof(float), (void*)positions.data(), &err);
+    checkError(err, "clCreateBuffer positions");
+    cl_mem bufKeys = clCreateBuffer(context, CL_MEM_READ_WRITE, (size_t)paddedN * sizeof(cl_ulong), nullptr, &err);
+    checkError(err, "clCreateBuffer keys");
+    cl_mem bufSorted = clCreateBuffer(context, CL_MEM_READ_WRITE, (size_t)n * 4 * sizeof(float), nullptr, &err);
+    checkError(err, "clCreateBuffer sorted positions");
+    cl_mem bufStart = clCreateBuffer(context, CL_MEM_READ_WRITE, (size_t)numCells * sizeof(int), nullptr, &err);
+    checkError(err, "clCreateBuffer cell start");
+    cl_mem bufEnd = clCreateBuffer(context, CL_MEM_READ_WRITE, (size_t)numCells * sizeof(int), nullptr, &err);
+    checkError(err, "clCreateBuffer cell end");
+    cl_mem bufAcc = clCreateBuffer(context, CL_MEM_WRITE_ONLY, (size_t)n * 4 * sizeof(float), nullptr, &err);
+    checkError(err, "clCreateBuffer accelerations");
+    
+    cl_kernel kernelKeys = clCreateKernel(program, "compute_cell_keys", &err);
+    checkError(err, "clCreateKernel compute_cell_keys");
+    cl_kernel kernelSort = clCreateKernel(program, "bitonic_sort_step", &err);
+    checkError(err, "clCreateKernel bitonic_sort_step");
+    cl_kernel kernelBounds = clCreateKernel(program, "find_cell_bounds", &err);
+    checkError(err, "clCreateKernel find_cell_bounds");
+    cl_kernel kernelGather = clCreateKernel(program, "gather_cell_sorted", &err);
+    checkError(err, "clCreateKernel gather_cell_sorted");
+    cl_kernel kernelForces = clCreateKernel(program, "compute_forces_cell_list", &err);
+    checkError(err, "clCreateKernel compute_forces_cell_list");
+    
+    clSetKernelArg(kernelKeys, 0, sizeof(cl_mem), &bufPos);
+    clSetKernelArg(kernelKeys, 1, sizeof(cl_mem), &bufKeys);
+    clSetKernelArg(kernelKeys, 2, sizeof(int), &n);
+    clSetKernelArg(kernelKeys, 3, sizeof(int), &grid);
+    clSetKernelArg(kernelKeys, 4, sizeof(float), &invCell);
+    
+    clSetKernelArg(kernelSort, 0, sizeof(cl_mem), &bufKeys);
+    
+    clSetKernelArg(kernelBounds, 0, sizeof(cl_mem), &bufKeys);
+    clSetKernelArg(kernelBounds, 1, sizeof(cl_mem), &bufStart);
+    clSetKernelArg(kernelBounds, 2, sizeof(cl_mem), &bufEnd);
+    clSetKernelArg(kernelBounds, 3, sizeof(int), &n);
+    
+    clSetKernelArg(kernelGather, 0, sizeof(cl_mem), &bufKeys);
+    clSetKernelArg(kernelGather, 1, sizeof(cl_mem), &bufPos);
+    clSetKernelArg(kernelGather, 2, sizeof(cl_mem), &bufSorted);
+    clSetKernelArg(kernelGather, 3, sizeof(int), &n);
+    
+    clSetKernelArg(kernelForces, 0, sizeof(cl_mem), &bufKeys);
+    clSetKernelArg(kernelForces, 1, sizeof(cl_mem), &bufSorted);
+    clSetKernelArg(kernelForces, 2, sizeof(cl_mem), &bufStart);
+    clSetKernelArg(kernelForces, 3, sizeof(cl_mem), &bufEnd);
+    clSetKernelArg(kernelForces, 4, sizeof(cl_mem), &bufAcc);
+    clSetKernelArg(kernelForces, 5, sizeof(int), &n);
+    clSetKernelArg(kernelForces, 6, sizeof(int), &grid);
+    clSetKernelArg(kernelForces, 7, sizeof(float), &invCell);
+    clSetKernelArg(kernelForces, 8, sizeof(float), &cfg.cutoff);
+    clSetKernelArg(kernelForces, 9, sizeof(float), &cfg.stiffness);
+    
+    size_t paddedGlobal = paddedN;
+    size_t bodyGlobal = n;
+    int zero = 0;
+    
+    clFinish(queue);
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    clEnqueueNDRangeKernel(queue, kernelKeys, 1, nullptr, &paddedGlobal, nullptr, 0, nullptr, nullptr);
+    for (cl_uint k = 2; k <= (cl_uint)paddedN; k *= 2) {
+        for (cl_uint j = k / 2; j > 0; j /= 2) {
+            clSetKernelArg(kernelSort, 1, sizeof(cl_uint), &j);
+            clSetKernelArg(kernelSort, 2, sizeof(cl_uint), &k);
+            clEnqueueNDRangeKernel(queue, kernelSort, 1, nullptr, &paddedGlobal, nullptr, 0, nullptr, nullptr);
+        }
+    }
+    clEnqueueFillBuffer(queue, bufStart, &zero, sizeof(int), 0, (size_t)numCells * sizeof(int), 0, nullptr, nullptr);
+    clEnqueueFillBuffer(queue, bufEnd, &zero, sizeof(int), 0, (size_t)numCells * sizeof(int), 0, nullptr, nullptr);
+    clEnqueueNDRangeKernel(queue, kernelBounds, 1, nullptr, &bodyGlobal, nullptr, 0, nullptr, nullptr);
+    err = clEnqueueNDRangeKernel(queue, kernelGather, 1, nullptr, &bodyGlobal, nullptr, 0, nullptr, nullptr);
+    checkError(err, "clEnqueueNDRangeKernel cell list build");
+    
+    clFinish(queue);
+    auto built = std::chrono::high_resolution_clock::now();
+    
+    err = clEnqueueNDRangeKernel(queue, kernelForces, 1, nullptr, &bodyGlobal, nullptr, 0, nullptr, nullptr);
+    checkError(err, "clEnqueueNDRangeKernel compute_forces_cell_list");
+    
+    clFinish(queue);
+    
+    auto end = std::chrono::high_resolution_clock::now();
+    
+    accelerations.resize((size_t)n * 4);
+    clEnqueueReadBuffer(queue, bufAcc, CL_TRUE, 0, (size_t)n * 4 * sizeof(float),
+                        accelerations.data(), 0, nullptr, nullptr);
+    
+    for (cl_mem buf : {bufPos, bufKeys, bufSorted, bufStart, bufEnd, bufAcc}) {
+        clReleaseMemObject(buf);
+    }
+    for (cl_kernel kernel : {kernelKeys, kernelSort, kernelBounds, kernelGather, kernelForces}) {
+        clReleaseKernel(kernel);
+    }
+    clReleaseCommandQueue(queue);
+    
+    *buildMs = std::chrono::duration<double, std::milli>(built - start).count();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// Brute-force check on a few particles: O(samples * n) instead of O(n²)
+float cellListSampleError(const std::vector<float>& positions,
+                          const std::vector<float>& accelerations,
+                          const CellListConfig& cfg, int samples) {
+    int n = positions.size() / 4;
+    float worst = 0.0f;
+    
+    // Per-thread maxima merged under critical (max reductions need OpenMP 3.1)
+    #pragma omp parallel
+    {
+        float localWorst = 0.0f;
+        #pragma omp for
+        for (int s = 0; s < samples; s++) {
+            size_t i = (size_t)s * n / samples;
+            double ax = 0.0, ay = 0.0, az = 0.0;
+            for (int j = 0; j < n; j++) {
+                double dx = positions[i*4 + 0] - positions[(size_t)j*4 + 0];
+                double dy = positions[i*4 + 1] - positions[(size_t)j*4 + 1];
+                double dz = positions[i*4 + 2] - positions[(size_t)j*4 + 2];
+                double distSq = dx*dx + dy*dy + dz*dz;
+                if (distSq < (double)cfg.cutoff * cfg.cutoff && distSq > 0.0) {
+                    double f = cfg.stiffness * (1.0 / std::sqrt(distSq) - 1.0 / cfg.cutoff);
+                    ax += dx * f;
+                    ay += dy * f;
+                    az += dz * f;
+                }
+            }
+            double ex = accelerations[i*4 + 0] - ax, ey = accelerations[i*4 + 1] - ay, ez = accelerations[i*4 + 2] - az;
+            double mag = std::max(std::sqrt(ax*ax + ay*ay + az*az), 1e-6);
+            localWorst = std::max(localWorst, (float)(std::sqrt(ex*ex + ey*ey + ez*ez) / mag));
+        }
+        #pragma omp critical
+        worst = std::max(worst, localWorst);
+    }
+    return worst;
+}
+
+void runCellListSweep(int maxParticles,
+                      const std::vector<cl_device_id>& devices,
+                      const std::vector<std::string>& deviceNames,
+                      const std::vector<cl_context>& contexts,
+                      const std::vector<cl_program>& programs) {
+    const float PARTICLES_PER_CELL = 8.0f;
+    const int ERROR_SAMPLES = 64;
+    
+    std::vector<int> counts;
+    for (int n = 100000; n <= maxParticles; n *= 10) counts.push_back(n);
+    
+    for (int n : counts) {
+        CellListConfig cfg = makeCellListConfig(n, PARTICLES_PER_CELL);
+        double density = n / ((double)cfg.boxSize * cfg.boxSize * cfg.boxSize);
+        double neighbours = density * 4.0 / 3.0 * M_PI * cfg.cutoff * cfg.cutoff * cfg.cutoff;
+        
+        std::cout << "========================================\n";
+        std::cout << "Cell list with " << n << " particles\n";
+        std::cout << "Grid " << cfg.grid << "^3, ~" << std::fixed << std::setprecision(1) << neighbours
+                  << " neighbours within cutoff, ~" << (27.0 * density) << " candidates scanned\n";
+        std::cout << "All-pairs would scan " << (n - 1) << " per particle\n";
+        std::cout << "========================================\n";
+        
+        std::vector<float> positions = initializeParticles(n, cfg.boxSize);
+        std::vector<float> acc;
+        
+        std::cout << "\n" << std::fixed << std::setprecision(2);
+        std::cout << std::left << std::setw(36) << "Implementation"
+                  << std::right << std::setw(12) << "Build (ms)"
+                  << std::setw(12) << "Forces (ms)"
+                  << std::setw(12) << "Total (ms)"
+                  << std::setw(14) << "MParticles/s"
+                  << std::setw(12) << "Max error\n";
+        std::cout << std::string(97, '-') << "\n";
+        
+        auto printRow = [&](const std::string& name, double buildMs, double totalMs) {
+            std::cout << std::left << std::setw(36) << name
+                      << std::right << std::setw(12) << buildMs
+                      << std::setw(12) << (totalMs - buildMs)
+                      << std::setw(12) << totalMs
+                      << std::setw(14) << (n / (totalMs / 1000.0) / 1e6)
+                      << std::setw(12) << std::scientific << std::setprecision(1)
+                      << cellListSampleError(positions, acc, cfg, ERROR_SAMPLES)
+                      << std::fixed << std::setprecision(2) << "\n";
+        };
+        
+        double buildMs;
+        double totalMs = computeForcesCellListCPU(positions, acc, cfg, &buildMs);
+        printRow("OpenMP", buildMs, totalMs);
+        
+        for (size_t d = 0; d < devices.size(); d++) {
+            std::string name = "OpenCL: " + deviceNames[d].substr(0, 28);
+            
+            cl_ulong globalMem, maxAlloc;
+            clGetDeviceInfo(devices[d], CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(globalMem), &globalMem, nullptr);
+            clGetDeviceInfo(devices[d], CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(maxAlloc), &maxAlloc, nullptr);
+            size_t largest;
+            size_t needed = cellListDeviceBytes(n, cfg, &largest);
+            if (needed > globalMem / 2 || largest > maxAlloc) {
+                std::cout << std::left << std::setw(36) << name << "skipped (needs "
+                          << (needed >> 20) << " MB)\n";
+                continue;
+            }
+            
+            totalMs = computeForcesCellListOpenCL(positions, acc, cfg, devices[d], contexts[d], programs[d], &buildMs);
+            printRow(name, buildMs, totalMs);
+        }
+        
+        std::cout << "\n";
+    }
+    
+    std::cout << "Max error: relative to a double-precision brute-force sum over all\n"
+              << "particles, on " << ERROR_SAMPLES << " sampled particles.\n";
+}
+
+// ============================================================================
+// Multi-device decomposition with a ring-ordered exchange. Devices live in
+// separate contexts, so new positions travel device -> host -> device. In
+// step t, device d first computes against its own block (already resident),
+// then against blocks d-1, d-2, ... in ring order; each block's upload is
+// enqueued on a separate transfer queue and the force pass for it waits only
+// on that upload, so transfers overlap with the passes before them.
+// ============================================================================
+
+struct BodySlice {
+    int device;                 // index into devices/contexts/programs
+    int offset, count;          // target bodies owned by this device
+    cl_command_queue computeQueue;
+    cl_command_queue transferQueue;
+    cl_mem bufBodies;           // all n bodies (xyzm)
+    cl_mem bufVel, bufAcc;      // owned slice only
+    cl_kernel forceKernel, integrateKernel;
+    cl_event integrateEvent;    // last integrate (writes may not overwrite before it)
+    cl_event readEvent;         // owned slice copied to the host
+};
+
+// Runs `steps` steps split across `slices` and returns ms per step.
+// xyzm/velocities are the initial state; xyzm receives the final positions.
+double simulateSplit(std::vector<float>& xyzm,
+                     const std::vector<float>& velocities,
+                     std::vector<BodySlice>& slices,
+                     int steps, float dt, float softening,
+                     const std::vector<cl_device_id>& devices,
+                     const std::vector<cl_context>& contexts,
+                     const std::vector<cl_program>& programs) {
+    cl_int err;
+    int n = xyzm.size() / 4;
+    int numSlices = slices.size();
+    const int LOCAL_SIZE = 256;
+    size_t localSize = LOCAL_SIZE;
+    
+    for (BodySlice& slice : slices) {
+        cl_context context = contexts[slice.device];
+        slice.computeQueue = clCreateCommandQueueWithProperties(context, devices[slice.device], nullptr, &err);
+        checkError(err, "clCreateCommandQueue compute");
+        slice.transferQueue = clCreateCommandQueueWithProperties(context, devices[slice.device], nullptr, &err);
+        checkError(err, "clCreateCommandQueue transfer");
+        
+        slice.bufBodies = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
+                                         (size_t)n * 4 * sizeof(float), xyzm.data(), &err);
+        checkError(err, "clCreateBuffer bodies");
+        slice.bufVel = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
+                                      (size_t)slice.count * 4 * sizeof(float),
+                                      (void*)&velocities[(size_t)slice.offset * 4], &err);
+        checkError(err, "clCreateBuffer velocities");
+        slice.bufAcc = clCreateBuffer(context, CL_MEM_READ_WRITE, (size_t)slice.count * 4 * sizeof(float), nullptr, &err);
+        checkError(err, "clCreateBuffer accelerations");
+        
+        slice.forceKernel = clCreateKernel(programs[slice.device], "compute_forces_block", &err);
+        checkError(err, "clCreateKernel compute_forces_block");
+        clSetKernelArg(slice.forceKernel, 0, sizeof(cl_mem), &slice.bufBodies);
+        clSetKernelArg(slice.forceKernel, 1, sizeof(cl_mem), &slice.bufAcc);
+        clSetKernelArg(slice.forceKernel, 2, sizeof(int), &slice.offset);
+        clSetKernelArg(slice.forceKernel, 3, sizeof(int), &slice.count);
+        clSetKernelArg(slice.forceKernel, 6, sizeof(float), &softening);
+        clSetKernelArg(slice.forceKernel, 8, LOCAL_SIZE * 4 * sizeof(float), nullptr);
+        
+        slice.integrateKernel = clCreateKernel(programs[slice.device], "integrate_range", &err);
+        checkError(err, "clCreateKernel integrate_range");
+        clSetKernelArg(slice.integrateKernel, 0, sizeof(cl_mem), &slice.bufBodies);
+        clSetKernelArg(slice.integrateKernel, 1, sizeof(cl_mem), &slice.bufVel);
+        clSetKernelArg(slice.integrateKernel, 2, sizeof(cl_mem), &slice.bufAcc);
+        clSetKernelArg(slice.integrateKernel, 3, sizeof(int), &slice.offset);
+        clSetKernelArg(slice.integrateKernel, 4, sizeof(int), &slice.count);
+        clSetKernelArg(slice.integrateKernel, 5, sizeof(float), &dt);
+        
+        slice.integrateEvent = nullptr;
+        slice.readEvent = nullptr;
+    }
+    for (BodySlice& slice : slices) clFinish(slice.computeQueue);
+    
+    // Step t reads results into staging[t % 2] and step t+1 uploads from it.
+    // Before step t+2 reads into the same buffer, the uploads sourced from it
+    // must be complete (writeEvents[t % 2]).
+    std::vector<float> staging[2] = {xyzm, xyzm};
+    std::vector<cl_event> writeEvents[2];
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    for (int step = 0; step < steps; step++) {
+        int cur = step % 2;
+        int prev = 1 - cur;
+        
+        for (int stage = 0; stage < numSlices; stage++) {
+            for (int d = 0; d < numSlices; d++) {
+                BodySlice& slice = slices[d];
+                const BodySlice& source = slices[(d - stage + numSlices) % numSlices];
+                cl_event upload = nullptr;
+                
+                // Stage 0 is the device's own block, updated in place by integrate
+                if (stage > 0 && step > 0) {
+                    clWaitForEvents(1, &source.readEvent);
+                    err = clEnqueueWriteBuffer(slice.transferQueue, slice.bufBodies, CL_FALSE,
+                                               (size_t)source.offset * 4 * sizeof(float),
+                                               (size_t)source.count * 4 * sizeof(float),
+                                               &staging[prev][(size_t)source.offset * 4],
+                                               1, &slice.integrateEvent, &upload);
+                    checkError(err, "clEnqueueWriteBuffer block");
+                    writeEvents[prev].push_back(upload);
+                    // Another queue waits on `upload`, so it must be submitted now
+                    clFlush(slice.transferQueue);
+                }
+                
+                int accumulate = (stage > 0) ? 1 : 0;
+                clSetKernelArg(slice.forceKernel, 4, sizeof(int), &source.offset);
+                clSetKernelArg(slice.forceKernel, 5, sizeof(int), &source.count);
+                clSetKernelArg(slice.forceKernel, 7, sizeof(int), &accumulate);
+                size_t globalSize = ((slice.count + LOCAL_SIZE - 1) / LOCAL_SIZE) * LOCAL_SIZE;
+                err = clEnqueueNDRangeKernel(slice.computeQueue, slice.forceKernel, 1, nullptr,
+                                             &globalSize, &localSize, upload ? 1 : 0,
+                                             upload ? &upload : nullptr, nullptr);
+                checkError(err, "clEnqueueNDRangeKernel compute_forces_block");
+            }
+            
+            // Submit this stage before the host blocks on the next stage's sources
+            for (BodySlice& slice : slices) clFlush(slice.computeQueue);
+        }
+        
+        if (!writeEvents[cur].empty()) {
+            clWaitForEvents(writeEvents[cur].size(), writeEvents[cur].data());
+            for (cl_event e : writeEvents[cur]) clReleaseEvent(e);
+            writeEvents[cur].clear();
+        }
+        
+        for (BodySlice& slice : slices) {
+            if (slice.integrateEvent) clReleaseEvent(slice.integrateEvent);
+            if (slice.readEvent) clReleaseEvent(slice.readEvent);
+            slice.readEvent = nullptr;
+            
+            size_t globalSize = slice.count;
+            clEnqueueNDRangeKernel(slice.computeQueue, slice.integrateKernel, 1, nullptr,
+                                   &globalSize, nullptr, 0, nullptr, &slice.integrateEvent);
+            // A single device has nobody to send to; it is read once at the end
+            if (numSlices > 1 || step == steps - 1) {
+                clEnqueueReadBuffer(slice.computeQueue, slice.bufBodies, CL_FALSE,
+                                    (size_t)slice.offset * 4 * sizeof(float),
+                                    (size_t)slice.count * 4 * sizeof(float),
+                                    &staging[cur][(size_t)slice.offset * 4], 0, nullptr, &slice.readEvent);
+            }
+            clFlush(slice.computeQueue);
+        }
+    }
+    
+    for (BodySlice& slice : slices) {
+        clFinish(slice.computeQueue);
+        clFinish(slice.transferQueue);
+    }
+    
+    auto end = std::chrono::high_resolution_clock::now();
+    
+    xyzm = staging[(steps - 1) % 2];
+    
+    for (int p = 0; p < 2; p++) {
+        for (cl_event e : writeEvents[p]) clReleaseEvent(e);
+    }
+    for (BodySlice& slice : slices) {
+        if (slice.integrateEvent) clReleaseEvent(slice.integrateEvent);
+        if (slice.readEvent) clReleaseEvent(slice.readEvent);
+        clReleaseMemObject(slice.bufBodies);
+        clReleaseMemObject(slice.bufVel);
+        clReleaseMemObject(slice.bufAcc);
+        clReleaseKernel(slice.forceKernel);
+        clReleaseKernel(slice.integrateKernel);
+        clReleaseCommandQueue(slice.computeQueue);
+        clReleaseCommandQueue(slice.transferQueue);
+    }
+    
+    return std::chrono::duration<double, std::milli>(end - start).count() / steps;
+}
+
+// Split n bodies across the given devices in proportion to their throughput.
+// A device whose share rounds down to zero gets no slice, so no launch is empty.
+std::vector<BodySlice> makeBodySlices(int n, const std::vector<int>& deviceSet,
+                                      const std::vector<double>& stepTimes) {
+    double totalRate = 0.0;
+    for (int d : deviceSet) totalRate += 1.0 / stepTimes[d];
+    
+    std::vector<BodySlice> slices;
+    int offset = 0;
+    for (size_t i = 0; i < deviceSet.size(); i++) {
+        BodySlice slice = {};
+        slice.device = deviceSet[i];
+        slice.offset = offset;
+        slice.count = (i + 1 == deviceSet.size())
+            ? n - offset
+            : (int)(n * (1.0 / stepTimes[deviceSet[i]]) / totalRate);
+        if (slice.count <= 0) continue;
+        offset += slice.count;
+        slices.push_back(slice);
+    }
+    return slices;
+}
+
+void runMultiDeviceScaling(int maxBodies, float softening,
+                           const std::vector<cl_device_id>& devices,
+                           const std::vector<std::string>& deviceNames,
+                           const std::vector<cl_context>& contexts,
+                           const std::vector<cl_program>& programs) {
+    const float dt = 0.01f;
+    int numDevices = devices.size();
+    
+    for (int n = 65536; n <= maxBodies; n *= 4) {
+        // All-pairs is O(n²) per step, so fewer steps at the larger sizes
+        int steps = (n <= 65536) ? 10 : (n <= 262144) ? 4 : 2;
+        
+        std::cout << "========================================\n";
+        std::cout << "Split simulation with " << n << " particles, " << steps << " steps\n";
+        std::cout << "========================================\n";
+        
+        std::vector<Body> bodies(n);
+        initializeBodies(bodies, n);
+        std::vector<float> initial = toXYZM(bodies);
+        std::vector<float> velocities((size_t)n * 4, 0.0f);
+        for (int i = 0; i < n; i++) {
+            velocities[(size_t)i*4 + 0] = bodies[i].vx;
+            velocities[(size_t)i*4 + 1] = bodies[i].vy;
+            velocities[(size_t)i*4 + 2] = bodies[i].vz;
+        }
+        
+        std::cout << "\n" << std::fixed << std::setprecision(2);
+        std::cout << std::left << std::setw(44) << "Configuration"
+                  << std::right << std::setw(14) << "ms / step"
+                  << std::setw(12) << "GInter/s"
+                  << std::setw(10) << "Speedup"
+                  << std::setw(12) << "Efficiency"
+                  << std::setw(12) << "Max |dx|\n";
+        std::cout << std::string(103, '-') << "\n";
+        
+        double interactions = (double)n * (n - 1);
+        std::vector<double> stepTimes(numDevices);
+        std::vector<float> reference;
+        std::vector<double> unit(numDevices, 1.0);
+        
+        // Single-device runs: baseline, split weights, and reference positions
+        for (int d = 0; d < numDevices; d++) {
+            std::vector<float> xyzm = initial;
+            std::vector<BodySlice> slices = makeBodySlices(n, {d}, unit);
+            stepTimes[d] = simulateSplit(xyzm, velocities, slices, steps, dt, softening,
+                                         devices, contexts, programs);
+            if (reference.empty()) reference = xyzm;
+            
+            std::cout << std::left << std::setw(44) << ("1 device: " + deviceNames[d].substr(0, 32))
+                      << std::right << std::setw(14) << stepTimes[d]
+                      << std::setw(12) << (interactions / (stepTimes[d] / 1000.0) / 1e9) << "\n";
+        }
+        
+        // Add devices fastest first
+        std::vector<int> order(numDevices);
+        for (int d = 0; d < numDevices; d++) order[d] = d;
+        std::sort(order.begin(), order.end(), [&](int a, int b) { return stepTimes[a] < stepTimes[b]; });
+        double bestSingle = stepTimes[order[0]];
+        
+        for (int k = 2; k <= numDevices; k++) {
+            std::vector<int> deviceSet(order.begin(), order.begin() + k);
+            std::vector<float> xyzm = initial;
+            std::vector<BodySlice> slices = makeBodySlices(n, deviceSet, stepTimes);
+            double ms = simulateSplit(xyzm, velocities, slices, steps, dt, softening,
+                                      devices, contexts, programs);
+            
+            double idealMs = 0.0;
+            for (int d : deviceSet) idealMs += 1.0 / stepTimes[d];
+            idealMs = 1.0 / idealMs;
+            
+            float maxDiff = 0.0f;
+            for (size_t i = 0; i < xyzm.size(); i++) {
+                maxDiff = std::max(maxDiff, std::abs(xyzm[i] - reference[i]));
+            }
+            
+            std::cout << std::left << std::setw(44) << (std::to_string(slices.size()) + " devices (ring exchange)")
+                      << std::right << std::setw(14) << ms
+                      << std::setw(12) << (interactions / (ms / 1000.0) / 1e9)
+                      << std::setw(9) << (bestSingle / ms) << "x"
+                      << std::setw(11) << (100.0 * idealMs / ms) << "%"
+                      << std::setw(12) << std::scientific << std::setprecision(1) << maxDiff
+                      << std::fixed << std::setprecision(2) << "\n";
+        }
+        
+        if (numDevices < 2) {
+            std::cout << "(only one OpenCL device: nothing to split)\n";
+        }
+        std::cout << "\n";
+    }
+    
+    std::cout << "Speedup is against the fastest single device; efficiency against the\n"
+              << "sum of the participating devices' single-device throughputs.\n"
+              << "Max |dx| is the largest position difference from the first device's\n"
+              << "single-device run (only summation order differs).\n";
+}
+
+// ============================================================================
+// Completion policies for small, latency-bound steps (the policies themselves
+// are in ../common/completion.h, shared with 003)
+// ============================================================================
+
+// Step latency (forces + integrate, launch until the host sees completion) at
+// the small body counts where launch and wakeup overhead dominate
+void runCompletionPolicies(int iterations, float softening,
+                           const std::vector<cl_device_id>& devices,
+                           const std::vector<std::string>& deviceNames,
+                           const std::vector<cl_context>& contexts,
+                           const std::vector<cl_program>& programs) {
+    const int bodyCounts[] = {128, 256, 512, 1024};
+    const int WARMUP = 20;
+    const float dt = 0.01f;
+    
+    std::cout << "Steps per policy: " << iterations << ", hybrid spin: " << HYBRID_SPIN_US << " us\n\n";
+    std::cout << std::fixed << std::setprecision(1);
+    
+    for (size_t d = 0; d < devices.size(); d++) {
+        std::cout << deviceNames[d] << "\n";
+        std::cout << std::left << std::setw(8) << "Bodies"
+                  << std::setw(20) << "Policy"
+                  << std::right << std::setw(10) << "p50 (us)"
+                  << std::setw(10) << "p90"
+                  << std::setw(10) << "p99"
+                  << std::setw(10) << "p99.9"
+                  << std::setw(10) << "max\n";
+        std::cout << std::string(77, '-') << "\n";
+        
+        for (int n : bodyCounts) {
+            std::vector<Body> bodies(n);
+            initializeBodies(bodies, n);
+            
+            for (Completion policy : COMPLETION_POLICIES) {
+                DeviceSimulation sim = createDeviceSimulation(bodies, softening, dt,
+                                                              devices[d], contexts[d], programs[d]);
+                clFinish(sim.queue);
+                
+                std::vector<double> latencies;
+                latencies.reserve(iterations);
+                for (int step = 0; step < WARMUP + iterations; step++) {
+                    cl_event done;
+                    auto start = std::chrono::high_resolution_clock::now();
+                    enqueueSimulationStep(sim, &done);
+                    waitForCompletion(sim.queue, done, policy);
+                    auto end = std::chrono::high_resolution_clock::now();
+                    clReleaseEvent(done);
+                    
+                    if (step >= WARMUP) {
+                        latencies.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+                    }
+                }
+                releaseDeviceSimulation(sim);
+                std::sort(latencies.begin(), latencies.end());
+                
+                std::cout << std::left << std::setw(8) << n
+                          << std::setw(20) << completionName(policy)
+                          << std::right << std::setw(10) << percentile(latencies, 0.50)
+                          << std::setw(10) << percentile(latencies, 0.90)
+                          << std::setw(10) << percentile(latencies, 0.99)
+                          << std::setw(10) << percentile(latencies, 0.999)
+                          << std::setw(10) << latencies.back() << "\n";
+            }
+        }
+        std::cout << "\n";
+    }
+    
+    std::cout << "busy-poll keeps one core at 100% while waiting; hybrid bounds that to the spin window.\n";
+}
+
+// ============================================================================
+// Command-buffer record/replay (sequences, Submission: ../common/command_replay.h)
+// ============================================================================
+
+// Steps a fresh simulation `steps` times per submission strategy, with one
+// clFinish at the end. "Submit" is host time spent in the submission calls
+// alone; "step" is wall time per step including the kernels. Every strategy
+// starts from the same bodies, so final positions must match the baseline.
+void runReplaySweep(int steps, float softening,
+                    const std::vector<cl_device_id>& devices,
+                    const std::vector<std::string>& deviceNames,
+                    const std::vector<cl_context>& contexts,
+                    const std::vector<cl_program>& programs) {
+    // Small systems, where launch overhead is a visible part of a step
+    const int bodyCounts[] = {256, 1024, 4096};
+    const float dt = 0.01f;
+    const Submission SUBMISSIONS[] = {Submission::PerStep, Submission::HostList, Submission::CommandBuffer};
+    
+    std::cout << "Steps per strategy: " << steps << "\n\n";
+    
+    for (size_t d = 0; d < devices.size(); d++) {
+        std::cout << deviceNames[d] << "\n";
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << std::left << std::setw(8) << "Bodies"
+                  << std::setw(28) << "Submission"
+                  << std::right << std::setw(14) << "Submit (us)"
+                  << std::setw(12) << "Step (us)"
+                  << std::setw(12) << "Saved (us)"
+                  << std::setw(12) << "Max diff" << "\n";
+        std::cout << std::string(86, '-') << "\n";
+        
+        for (int n : bodyCounts) {
+            std::vector<Body> bodies(n);
+            initializeBodies(bodies, n);
+            
+            double baselineSubmitUs = 0.0;
+            std::vector<float> baselinePositions, positions, velocities;
+            for (Submission submission : SUBMISSIONS) {
+                DeviceSimulation sim = createDeviceSimulation(bodies, softening, dt,
+                                                              devices[d], contexts[d], programs[d]);
+                size_t integrateSize = sim.n;
+                
+                CommandSequence seq;
+                seq.queue = sim.queue;
+                recordLaunch(seq, sim.forceKernel, 1, &sim.globalSize, &sim.localSize);
+                recordLaunch(seq, sim.integrateKernel, 1, &integrateSize, nullptr);
+                finalizeSequence(seq, devices[d], submission == Submission::CommandBuffer);
+                
+                if (submission == Submission::CommandBuffer && !seq.native) {
+                    std::cout << std::left << std::setw(8) << n
+                              << std::setw(28) << submissionName(submission)
+                              << "n/a (no cl_khr_command_buffer)\n";
+                    releaseSequence(seq);
+                    releaseDeviceSimulation(sim);
+                    continue;
+                }
+                clFinish(sim.queue);
+                
+                double submitUs = 0.0;
+                auto start = std::chrono::high_resolution_clock::now();
+                for (int step = 0; step < steps; step++) {
+                    auto submitStart = std::chrono::high_resolution_clock::now();
+                    if (submission == Submission::PerStep) {
+                        setSimulationArgs(sim, softening, dt);
+                        enqueueSimulationStep(sim);
+                    } else {
+                        replaySequence(seq);
+                    }
+                    auto submitEnd = std::chrono::high_resolution_clock::now();
+                    submitUs += std::chrono::duration<double, std::micro>(submitEnd - submitStart).count();
+                }
+                clFinish(sim.queue);
+                auto end = std::chrono::high_resolution_clock::now();
+                double stepUs = std::chrono::duration<double, std::micro>(end - start).count() / steps;
+                submitUs /= steps;
+                
+                readSimulationState(sim, positions, velocities);
+                if (submission == Submission::PerStep) {
+                    baselineSubmitUs = submitUs;
+                    baselinePositions = positions;
+                }
+                float diff = 0.0f;
+                for (size_t k = 0; k < positions.size(); k++) {
+                    diff = std::max(diff, std::abs(positions[k] - baselinePositions[k]));
+                }
+                
+                std::string label = submissionName(submission);
+                if (seq.pendingWaits > 0) label += " (serialized)";
+                std::cout << std::left << std::setw(8) << n
+                          << std::setw(28) << label
+                          << std::right << std::setw(14) << submitUs
+                          << std::setw(12) << stepUs
+                          << std::setw(12) << (baselineSubmitUs - submitUs)
+                          << std::setw(12) << std::scientific << std::setprecision(1) << diff
+                          << std::fixed << std::setprecision(2) << "\n";
+                
+                releaseSequence(seq);
+                releaseDeviceSimulation(sim);
+            }
+        }
+        std::cout << "\n";
+    }
+}
+
+// ============================================================================
+// Double precision (cl_khr_fp64)
+// ============================================================================
+
+// `steps` device-resident steps (tiled forces + integrate) in float or double.
+// Returns ms; `positions` receives the final state (4 per body).
+template <typename Real>
+double simulateOpenCL(const std::vector<Body>& bodies, int steps, float dt, float softening,
+                      std::vector<Real>& positions,
+                      cl_device_id device, cl_context context, cl_program program) {
+    cl_int err;
+    int n = bodies.size();
+    const size_t LOCAL_SIZE = 256;
+    const bool fp64 = sizeof(Real) == sizeof(double);
+    Real soft = softening, step = dt;
+    
+    positions.assign((size_t)n * 4, 0);
+    std::vector<Real> velocities((size_t)n * 4, 0), masses(n);
+    for (int i = 0; i < n; i++) {
+        positions[i*4 + 0] = bodies[i].x;
+        positions[i*4 + 1] = bodies[i].y;
+        positions[i*4 + 2] = bodies[i].z;
+        velocities[i*4 + 0] = bodies[i].vx;
+        velocities[i*4 + 1] = bodies[i].vy;
+        velocities[i*4 + 2] = bodies[i].vz;
+        masses[i] = bodies[i].mass;
+    }
+    
+    cl_command_queue queue = clCreateCommandQueueWithProperties(context, device, nullptr, &err);
+    checkError(err, "clCreateCommandQueue");
+    size_t bytes = (size_t)n * 4 * sizeof(Real);
+    cl_mem bufPos = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, bytes, positions.data(), &err);
+    checkError(err, "clCreateBuffer positions");
+    cl_mem bufVel = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, bytes, velocities.data(), &err);
+    checkError(err, "clCreateBuffer velocities");
+    cl_mem bufMass = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                    (size_t)n * sizeof(Real), masses.data(), &err);
+    checkError(err, "clCreateBuffer masses");
+    cl_mem bufAcc = clCreateBuffer(context, CL_MEM_READ_WRITE, bytes, nullptr, &err);
+    checkError(err, "clCreateBuffer accelerations");
+    
+    cl_kernel forceKernel = clCreateKernel(program, fp64 ? "compute_forces_tiled_fp64" : "compute_forces_tiled", &err);
+    checkError(err, "clCreateKernel forces");
+    clSetKernelArg(forceKernel, 0, sizeof(cl_mem), &bufPos);
+    clSetKernelArg(forceKernel, 1, sizeof(cl_mem), &bufMass);
+    clSetKernelArg(forceKernel, 2, sizeof(cl_mem), &bufAcc);
+    clSetKernelArg(forceKernel, 3, sizeof(int), &n);
+    clSetKernelArg(forceKernel, 4, sizeof(Real), &soft);
+    clSetKernelArg(forceKernel, 5, LOCAL_SIZE * 4 * sizeof(Real), nullptr);
+    clSetKernelArg(forceKernel, 6, LOCAL_SIZE * sizeof(Real), nullptr);
+    
+    cl_kernel integrateKernel = clCreateKernel(program, fp64 ? "integrate_fp64" : "integrate", &err);
+    checkError(err, "clCreateKernel integrate");
+    clSetKernelArg(integrateKernel, 0, sizeof(cl_mem), &bufPos);
+    clSetKernelArg(integrateKernel, 1, sizeof(cl_mem), &bufVel);
+    clSetKernelArg(integrateKernel, 2, sizeof(cl_mem), &bufAcc);
+    clSetKernelArg(integrateKernel, 3, sizeof(int), &n);
+    clSetKernelArg(integrateKernel, 4, sizeof(Real), &step);
+    clFinish(queue);
+    
+    size_t globalSize = ((size_t)n + LOCAL_SIZE - 1) / LOCAL_SIZE * LOCAL_SIZE;
+    size_t integrateSize = n;
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int s = 0; s < steps; s++) {
+        clEnqueueNDRangeKernel(queue, forceKernel, 1, nullptr, &globalSize, &LOCAL_SIZE, 0, nullptr, nullptr);
+        clEnqueueNDRangeKernel(queue, integrateKernel, 1, nullptr, &integrateSize, nullptr, 0, nullptr, nullptr);
+    }
+    clFinish(queue);
+    double ms = std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - start).count();
+    
+    clEnqueueReadBuffer(queue, bufPos, CL_TRUE, 0, bytes, positions.data(), 0, nullptr, nullptr);
+    
+    clReleaseMemObject(bufPos);
+    clReleaseMemObject(bufVel);
+    clReleaseMemObject(bufMass);
+    clReleaseMemObject(bufAcc);
+    clReleaseKernel(forceKernel);
+    clReleaseKernel(integrateKernel);
+    clReleaseCommandQueue(queue);
+    return ms;
+}
+
+// max |a - ref| / max |ref| over three component arrays
+template <typename Real>
+double maxAccelerationError(const std::vector<double>& rx, const std::vector<double>& ry, const std::vector<double>& rz,
+                            const std::vector<Real>& x, const std::vector<Real>& y, const std::vector<Real>& z) {
+    double maxDiff = 0.0, maxRef = 0.0;
+    for (size_t i = 0; i < rx.size(); i++) {
+        double dx = x[i] - rx[i], dy = y[i] - ry[i], dz = z[i] - rz[i];
+        maxDiff = std::max(maxDiff, std::sqrt(dx*dx + dy*dy + dz*dz));
+        maxRef = std::max(maxRef, std::sqrt(rx[i]*rx[i] + ry[i]*ry[i] + rz[i]*rz[i]));
+    }
+    return maxDiff / maxRef;
+}
+
+void runFp64Comparison(int n, float softening,
+                       const std::vector<cl_device_id>& devices,
+                       const std::vector<std::string>& deviceNames,
+                       const std::vector<cl_context>& contexts,
+                       const std::vector<cl_program>& programs) {
+    const int STEPS = 100;
+    const float dt = 0.01f;
+    double interactions = (double)n * (n - 1);
+    
+    std::cout << "Bodies: " << n << ", Integration: " << STEPS << " steps\n\n";
+    
+    std::vector<Body> bodies(n);
+    initializeBodies(bodies, n);
+    
+    // CPU baselines in double; the serial result is the reference
+    std::vector<double> ref_x(n), ref_y(n), ref_z(n), acc_x(n), acc_y(n), acc_z(n);
+    double serialTime = computeForcesSerial(bodies, ref_x, ref_y, ref_z, softening);
+    double openmpTime = computeForcesOpenMP(bodies, acc_x, acc_y, acc_z, softening);
+    
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << std::left << std::setw(36) << "Implementation"
+              << std::right << std::setw(12) << "fp32 GInt/s"
+              << std::setw(12) << "fp64 GInt/s"
+              << std::setw(12) << "fp64:fp32"
+              << std::setw(12) << "fp32 error"
+              << std::setw(12) << "fp64 error\n";
+    std::cout << std::string(96, '-') << "\n";
+    
+    std::cout << std::left << std::setw(36) << "Serial C++ (double)"
+              << std::right << std::setw(12) << "-"
+              << std::setw(12) << (interactions / (serialTime / 1000.0) / 1e9) << "\n";
+    std::cout << std::left << std::setw(36) << "OpenMP (double)"
+              << std::right << std::setw(12) << "-"
+              << std::setw(12) << (interactions / (openmpTime / 1000.0) / 1e9)
+              << std::setw(24) << std::scientific << std::setprecision(1)
+              << maxAccelerationError(ref_x, ref_y, ref_z, acc_x, acc_y, acc_z)
+              << std::fixed << std::setprecision(2) << "\n";
+    
+    std::vector<float> accf_x(n), accf_y(n), accf_z(n);
+    
+    for (size_t d = 0; d < devices.size(); d++) {
+        bool fp64 = deviceSupportsFp64(devices[d]);
+        
+        for (bool tiled : {false, true}) {
+            std::string name = "OpenCL: " + deviceNames[d].substr(0, 18) + (tiled ? " (tiled)" : " (simple)");
+            
+            double fp32Time = computeForcesOpenCL(bodies, accf_x, accf_y, accf_z, softening,
+                                                  devices[d], contexts[d], programs[d], tiled);
+            double fp32Error = maxAccelerationError(ref_x, ref_y, ref_z, accf_x, accf_y, accf_z);
+            
+            std::cout << std::left << std::setw(36) << name
+                      << std::right << std::setw(12) << (interactions / (fp32Time / 1000.0) / 1e9);
+            
+            if (!fp64) {
+                std::cout << std::setw(12) << "n/a" << std::setw(12) << "-"
+                          << std::setw(12) << std::scientific << std::setprecision(1) << fp32Error
+                          << std::fixed << std::setprecision(2) << "   (no cl_khr_fp64)\n";
+                continue;
+            }
+            
+            double fp64Time = computeForcesOpenCL(bodies, acc_x, acc_y, acc_z, softening,
+                                                  devices[d], contexts[d], programs[d], tiled);
+            char ratio[32];
+            std::snprintf(ratio, sizeof(ratio), "1:%.1f", fp64Time / fp32Time);
+            
+            std::cout << std::setw(12) << (interactions / (fp64Time / 1000.0) / 1e9)
+                      << std::setw(12) << ratio
+                      << std::scientific << std::setprecision(1)
+                      << std::setw(12) << fp32Error
+                      << std::setw(12) << maxAccelerationError(ref_x, ref_y, ref_z, acc_x, acc_y, acc_z)
+                      << std::fixed << std::setprecision(2) << "\n";
+        }
+        
+        // Device-resident integration in both precisions: steps/s and how far
+        // the float trajectory has drifted from the double one
+        if (fp64) {
+            std::vector<float> posf;
+            std::vector<double> posd;
+            double fp32Ms = simulateOpenCL(bodies, STEPS, dt, softening, posf, devices[d], contexts[d], programs[d]);
+            double fp64Ms = simulateOpenCL(bodies, STEPS, dt, softening, posd, devices[d], contexts[d], programs[d]);
+            
+            double maxDx = 0.0;
+            for (int i = 0; i < n; i++) {
+                for (int c = 0; c < 3; c++) maxDx = std::max(maxDx, std::abs(posf[i*4 + c] - posd[i*4 + c]));
+            }
+            
+            std::cout << "  integration: " << (STEPS / (fp32Ms / 1000.0)) << " / "
+                      << (STEPS / (fp64Ms / 1000.0)) << " steps/s (fp32 / fp64), fp32 max |dx| after "
+                      << STEPS << " steps: " << std::scientific << std::setprecision(1) << maxDx
+                      << std::fixed << std::setprecision(2) << "\n";
+        }
+    }
+    
+    std::cout << "\nfp64:fp32 is the throughput ratio (1:2 = doubles at half the float rate;\n"
+              << "consumer GPUs are typically 1:16 to 1:64). Errors are relative to the serial double forces.\n";
+}
+
+// ============================================================================
+// Large-scale direct sum (64K-16M bodies). Sizes are capped per device by its
+// memory, each force pass is split into launches of a bounded number of
+// interactions, and the CPU baselines are measured on a sample of target
+// bodies and extrapolated instead of running for hours.
+// ============================================================================
+
+const double LARGE_INTERACTIONS_PER_LAUNCH = 4294967296.0;  // 2^32, well under a display watchdog
+const double LARGE_TIME_LIMIT_MS = 120000.0;                 // skip sizes predicted to take longer
+const int LARGE_SERIAL_SAMPLE = 64;
+const int LARGE_OPENMP_SAMPLE = 4096;
+
+// Largest body count whose buffers (xyzm + accelerations, 32 bytes per body)
+// fit in half the device's global memory, with each buffer within one allocation
+long long maxBodiesForDevice(cl_device_id device) {
+    cl_ulong globalMem, maxAlloc;
+    clGetDeviceInfo(device, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(globalMem), &globalMem, nullptr);
+    clGetDeviceInfo(device, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(maxAlloc), &maxAlloc, nullptr);
+    
+    long long byMemory = (long long)(globalMem / 2 / (8 * sizeof(float)));
+    long long byAlloc = (long long)(maxAlloc / (4 * sizeof(float)));
+    return std::min({byMemory, byAlloc, (long long)INT32_MAX});
+}
+
+// Direct sum for targets [0, count) against all sources (xyzm). Returns ms.
+double computeForcesSampled(const std::vector<float>& xyzm, int count,
+                            std::vector<float>& acc, float softening, bool parallel) {
+    int n = xyzm.size() / 4;
+    float softSq = softening * softening;
+    acc.assign((size_t)count * 3, 0.0f);
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    #pragma omp parallel for schedule(static) if (parallel)
+    for (int i = 0; i < count; i++) {
+        float xi = xyzm[(size_t)i*4 + 0], yi = xyzm[(size_t)i*4 + 1], zi = xyzm[(size_t)i*4 + 2];
+        float ax = 0.0f, ay = 0.0f, az = 0.0f;
+        
+        for (int j = 0; j < n; j++) {
+            if (i == j) continue;
+            float dx = xyzm[(size_t)j*4 + 0] - xi;
+            float dy = xyzm[(size_t)j*4 + 1] - yi;
+            float dz = xyzm[(size_t)j*4 + 2] - zi;
+            float distSq = dx*dx + dy*dy + dz*dz + softSq;
+            float force = xyzm[(size_t)j*4 + 3] / (distSq * std::sqrt(distSq));
+            ax += dx * force;
+            ay += dy * force;
+            az += dz * force;
+        }
+        
+        acc[(size_t)i*3 + 0] = ax;
+        acc[(size_t)i*3 + 1] = ay;
+        acc[(size_t)i*3 + 2] = az;
+    }
+    
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// One force pass with compute_forces_block over all n targets, issued as a
+// series of launches that each cover `chunk` targets via the global work
+// offset (target_offset 0, target_count n, so global ids index the arrays
+// directly). Returns ms for the kernels only.
+double computeForcesOpenCLLarge(const std::vector<float>& xyzm, std::vector<float>& acc4,
+                                float softening, cl_device_id device,
+                                cl_context context, cl_program program) {
+    cl_int err;
+    int n = xyzm.size() / 4;
+    size_t bytes = (size_t)n * 4 * sizeof(float);
+    const size_t LOCAL_SIZE = 256;
+    
+    cl_command_queue queue = clCreateCommandQueueWithProperties(context, device, nullptr, &err);
+    checkError(err, "clCreateCommandQueue");
+    
+    cl_mem bufBodies = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                      bytes, (void*)xyzm.data(), &err);
+    checkError(err, "clCreateBuffer bodies");
+    cl_mem bufAcc = clCreateBuffer(context, CL_MEM_WRITE_ONLY, bytes, nullptr, &err);
+    checkError(err, "clCreateBuffer accelerations");
+    
+    cl_kernel kernel = clCreateKernel(program, "compute_forces_block", &err);
+    checkError(err, "clCreateKernel compute_forces_block");
+    int zero = 0;
+    clSetKernelArg(kernel, 0, sizeof(cl_mem), &bufBodies);
+    clSetKernelArg(kernel, 1, sizeof(cl_mem), &bufAcc);
+    clSetKernelArg(kernel, 2, sizeof(int), &zero);
+    clSetKernelArg(kernel, 3, sizeof(int), &n);
+    clSetKernelArg(kernel, 4, sizeof(int), &zero);
+    clSetKernelArg(kernel, 5, sizeof(int), &n);
+    clSetKernelArg(kernel, 6, sizeof(float), &softening);
+    clSetKernelArg(kernel, 7, sizeof(int), &zero);
+    clSetKernelArg(kernel, 8, LOCAL_SIZE * 4 * sizeof(float), nullptr);
+    clFinish(queue);
+    
+    size_t paddedN = ((size_t)n + LOCAL_SIZE - 1) / LOCAL_SIZE * LOCAL_SIZE;
+    size_t chunk = (size_t)(LARGE_INTERACTIONS_PER_LAUNCH / n) / LOCAL_SIZE * LOCAL_SIZE;
+    chunk = std::max(LOCAL_SIZE, std::min(chunk, paddedN));
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    for (size_t offset = 0; offset < paddedN; offset += chunk) {
+        size_t globalSize = std::min(chunk, paddedN - offset);
+        err = clEnqueueNDRangeKernel(queue, kernel, 1, &offset, &globalSize, &LOCAL_SIZE, 0, nullptr, nullptr);
+        checkError(err, "clEnqueueNDRangeKernel compute_forces_block");
+    }
+    clFinish(queue);
+    
+    double ms = std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - start).count();
+    
+    acc4.resize((size_t)n * 4);
+    clEnqueueReadBuffer(queue, bufAcc, CL_TRUE, 0, bytes, acc4.data(), 0, nullptr, nullptr);
+    
+    clReleaseMemObject(bufBodies);
+    clReleaseMemObject(bufAcc);
+    clReleaseKernel(kernel);
+    clReleaseCommandQueue(queue);
+    return ms;
+}
+
+void runLargeScaleSweep(long long maxBodies, float softening,
+                        const std::vector<cl_device_id>& devices,
+                        const std::vector<std::string>& deviceNames,
+                        const std::vector<cl_context>& contexts,
+                        const std::vector<cl_program>& programs) {
+    std::vector<long long> deviceLimit(devices.size());
+    std::vector<double> lastMs(devices.size(), 0.0);
+    std::vector<long long> lastN(devices.size(), 0);
+    
+    for (size_t d = 0; d < devices.size(); d++) {
+        deviceLimit[d] = maxBodiesForDevice(devices[d]);
+        std::cout << deviceNames[d] << ": up to " << deviceLimit[d] << " bodies by memory\n";
+    }
+    std::cout << "\n";
+    
+    for (long long nn = 65536; nn <= maxBodies; nn *= 4) {
+        int n = (int)nn;
+        double interactions = (double)n * (n - 1);
+        
+        std::cout << "========================================\n";
+        std::cout << "N-Body with " << n << " particles\n";
+        std::cout << "Force calculations: " << ((long long)n * (n - 1)) << " (O(n²))\n";
+        std::cout << "========================================\n";
+        
+        std::vector<Body> bodies(n);
+        initializeBodies(bodies, n);
+        std::vector<float> xyzm = toXYZM(bodies);
+        
+        // CPU baselines on the first targets only, scaled by n / sample
+        std::vector<float> serialAcc, openmpAcc;
+        int serialSample = std::min(LARGE_SERIAL_SAMPLE, n);
+        int openmpSample = std::min(LARGE_OPENMP_SAMPLE, n);
+        double serialMs = computeForcesSampled(xyzm, serialSample, serialAcc, softening, false) * n / serialSample;
+        double openmpMs = computeForcesSampled(xyzm, openmpSample, openmpAcc, softening, true) * n / openmpSample;
+        
+        std::cout << "\n" << std::fixed << std::setprecision(2);
+        std::cout << std::left << std::setw(40) << "Implementation"
+                  << std::right << std::setw(14) << "Time (ms)"
+                  << std::setw(12) << "GInter/s"
+                  << std::setw(12) << "Speedup"
+                  << std::setw(12) << "Max error\n";
+        std::cout << std::string(89, '-') << "\n";
+        
+        std::cout << std::left << std::setw(40) << "Serial C++ (extrapolated)"
+                  << std::right << std::setw(14) << serialMs
+                  << std::setw(12) << (interactions / (serialMs / 1000.0) / 1e9)
+                  << std::setw(12) << "1.00x" << "\n";
+        std::cout << std::left << std::setw(40) << "OpenMP (extrapolated)"
+                  << std::right << std::setw(14) << openmpMs
+                  << std::setw(12) << (interactions / (openmpMs / 1000.0) / 1e9)
+                  << std::setw(11) << (serialMs / openmpMs) << "x" << "\n";
+        
+        for (size_t d = 0; d < devices.size(); d++) {
+            std::string name = "OpenCL: " + deviceNames[d].substr(0, 30);
+            
+            if (n > deviceLimit[d]) {
+                std::cout << std::left << std::setw(40) << name << "skipped (needs "
+                          << (((long long)n * 32) >> 20) << " MB)\n";
+                continue;
+            }
+            // O(n²): predict from the previous size on this device
+            if (lastN[d] > 0) {
+                double predictedMs = lastMs[d] * ((double)n / lastN[d]) * ((double)n / lastN[d]);
+                if (predictedMs > LARGE_TIME_LIMIT_MS) {
+                    std::cout << std::left << std::setw(40) << name << "skipped (est. "
+                              << std::setprecision(0) << (predictedMs / 1000.0) << " s)\n"
+                              << std::setprecision(2);
+                    continue;
+                }
+            }
+            
+            std::vector<float> acc4;
+            double ms = computeForcesOpenCLLarge(xyzm, acc4, softening, devices[d], contexts[d], programs[d]);
+            lastMs[d] = ms;
+            lastN[d] = n;
+            
+            // Relative error on the serially computed sample
+            double maxError = 0.0;
+            for (int i = 0; i < serialSample; i++) {
+                double ref = std::sqrt((double)serialAcc[i*3]*serialAcc[i*3] + (double)serialAcc[i*3 + 1]*serialAcc[i*3 + 1] +
+                                       (double)serialAcc[i*3 + 2]*serialAcc[i*3 + 2]);
+                double dx = acc4[(size_t)i*4 + 0] - serialAcc[i*3 + 0];
+                double dy = acc4[(size_t)i*4 + 1] - serialAcc[i*3 + 1];
+                double dz = acc4[(size_t)i*4 + 2] - serialAcc[i*3 + 2];
+                maxError = std::max(maxError, std::sqrt(dx*dx + dy*dy + dz*dz) / ref);
+            }
+            
+            std::cout << std::left << std::setw(40) << name
+                      << std::right << std::setw(14) << ms
+                      << std::setw(12) << (interactions / (ms / 1000.0) / 1e9)
+                      << std::setw(11) << (serialMs / ms) << "x"
+                      << std::setw(12) << std::scientific << std::setprecision(1) << maxError
+                      << std::fixed << std::setprecision(2) << "\n";
+        }
+        
+        std::cout << "\n";
+    }
+    
+    std::cout << "Serial and OpenMP times are measured on the first " << LARGE_SERIAL_SAMPLE << " / "
+              << LARGE_OPENMP_SAMPLE << " bodies\n"
+              << "against all n sources and scaled by n / sample. Max error: OpenCL vs serial on that sample.\n";
+}
+
+int main(int argc, char** argv) {
+    std::cout << "=== N-Body Simulation Performance Comparison ===\n\n";
+    
+    std::vector<int> bodyCounts = {128, 256, 512, 1024, 2048, 4096};
+    const float softening = 0.1f;
+    
+    // Get OpenCL devices
+    cl_uint numPlatforms;
+    clGetPlatformIDs(0, nullptr, &numPlatforms);
+    std::vector<cl_platform_id> platforms(numPlatforms);
+    clGetPlatformIDs(numPlatforms, platforms.data(), nullptr);
+    
+    std::vector<cl_device_id> devices;
+    std::vector<std::string> deviceNames;
+    std::vector<cl_context> contexts;
+    std::vector<cl_program> programs;
+    
+    std::string kernelSource = loadKernelSource("nbody.cl");
+    const char* kernelSourcePtr = kernelSource.c_str();
+    size_t kernelSourceSize = kernelSource.size();
+    
+    for (cl_uint p = 0; p < numPlatforms; p++) {
+        cl_uint numDevices;
+        cl_int err = clGetDeviceIDs(platforms[p], CL_DEVICE_TYPE_ALL, 0, nullptr, &numDevices);
+        if (err == CL_SUCCESS && numDevices > 0) {
+            std::vector<cl_device_id> platformDevices(numDevices);
+            clGetDeviceIDs(platforms[p], CL_DEVICE_TYPE_ALL, numDevices, platformDevices.data(), nullptr);
+            
+            for (cl_uint d = 0; d < numDevices; d++) {
+                devices.push_back(platformDevices[d]);
+                
+                char name[128];
+                clGetDeviceInfo(platformDevices[d], CL_DEVICE_NAME, sizeof(name), name, nullptr);
+                deviceNames.push_back(std::string(name));
+                
+                cl_context context = clCreateContext(nullptr, 1, &platformDevices[d], nullptr, nullptr, &err);
+                contexts.push_back(context);
+                
+                cl_program program = clCreateProgramWithSource(context, 1, &kernelSourcePtr, &kernelSourceSize, &err);
+                err = clBuildProgram(program, 1, &platformDevices[d], nullptr, nullptr, nullptr);
+                if (err != CL_SUCCESS) {
+                    size_t logSize;
+                    clGetProgramBuildInfo(program, platformDevices[d], CL_PROGRAM_BUILD_LOG, 0, nullptr, &logSize);
+                    std::vector<char> log(logSize);
+                    clGetProgramBuildInfo(program, platformDevices[d], CL_PROGRAM_BUILD_LOG, logSize, log.data(), nullptr);
+                    std::cerr << "Build error for " << name << ":\n" << log.data() << "\n";
+                    clReleaseContext(context);
+                    contexts.pop_back();
+                    devices.pop_back();
+                    deviceNames.pop_back();
+                    continue;
+                }
+                programs.push_back(program);
+            }
+        }
+    }
+    
+    std::cout << "OpenMP threads: " << omp_get_max_threads() << "\n";
+    std::cout << "OpenCL devices: " << devices.size() << "\n\n";
+    
+    if (argc > 1 && std::string(argv[1]) == "--layouts") {
+        std::cout << "=== Body Layouts: AoS vs SoA vs packed xyzm ===\n\n";
+        runLayoutSweep(softening, devices, deviceNames, contexts, programs);
+        
+        for (auto& prog : programs) clReleaseProgram(prog);
+        for (auto& ctx : contexts) clReleaseContext(ctx);
+        return 0;
+    }
+    
+    if (argc > 1 && std::string(argv[1]) == "--symmetric") {
+        std::cout << "=== Symmetric-Force SIMD CPU Path ===\n\n";
+        runSymmetricSweep(softening);
+        
+        for (auto& prog : programs) clReleaseProgram(prog);
+        for (auto& ctx : contexts) clReleaseContext(ctx);
+        return 0;
+    }
+    
+    if (argc > 1 && std::string(argv[1]) == "--precision") {
+        std::cout << "=== Precision Modes: Build Options vs Throughput and Error ===\n\n";
+        runPrecisionSweep(softening, devices, deviceNames, contexts, kernelSource);
+        
+        for (auto& prog : programs) clReleaseProgram(prog);
+        for (auto& ctx : contexts) clReleaseContext(ctx);
+        return 0;
+    }
+    
+    if (argc > 1 && std::string(argv[1]) == "--multibody") {
+        std::cout << "=== Bodies per Work-Item (register blocking) ===\n\n";
+        runMultiBodySweep(softening, devices, deviceNames, contexts, programs, kernelSource);
+        
+        for (auto& prog : programs) clReleaseProgram(prog);
+        for (auto& ctx : contexts) clReleaseContext(ctx);
+        return 0;
+    }
+    
+    if (argc > 1 && std::string(argv[1]) == "--barneshut") {
+        int maxBodies = (argc > 2) ? std::atoi(argv[2]) : 1048576;
+        float theta = (argc > 3) ? (float)std::atof(argv[3]) : 0.5f;
+        
+        std::cout << "=== Barnes-Hut O(n log n) vs Direct O(n²) ===\n\n";
+        runBarnesHutSweep(maxBodies, theta, softening, devices, deviceNames, contexts, programs);
+        
+        for (auto& prog : programs) clReleaseProgram(prog);
+        for (auto& ctx : contexts) clReleaseContext(ctx);
+        return 0;
+    }
+    
+    if (argc > 1 && std::string(argv[1]) == "--celllist") {
+        int maxParticles = (argc > 2) ? std::atoi(argv[2]) : 10000000;
+        
+        std::cout << "=== Cell-List Short-Range Forces ===\n\n";
+        runCellListSweep(maxParticles, devices, deviceNames, contexts, programs);
+        
+        for (auto& prog : programs) clReleaseProgram(prog);
+        for (auto& ctx : contexts) clReleaseContext(ctx);
+        return 0;
+    }
+    
+    if (argc > 1 && std::string(argv[1]) == "--multidevice") {
+        int maxBodies = (argc > 2) ? std::atoi(argv[2]) : 1048576;
+        
+        std::cout << "=== Multi-Device Decomposition (strong scaling) ===\n\n";
+        runMultiDeviceScaling(maxBodies, softening, devices, deviceNames, contexts, programs);
+        
+        for (auto& prog : programs) clReleaseProgram(prog);
+        for (auto& ctx : contexts) clReleaseContext(ctx);
+        return 0;
+    }
+    
+    if (argc > 1 && std::string(argv[1]) == "--completion") {
+        int iterations = (argc > 2) ? std::atoi(argv[2]) : 2000;
+        
+        std::cout << "=== Completion Policies: Small-Size Tail Latency ===\n\n";
+        runCompletionPolicies(std::max(iterations, 10), softening, devices, deviceNames, contexts, programs);
+        
+        for (auto& prog : programs) clReleaseProgram(prog);
+        for (auto& ctx : contexts) clReleaseContext(ctx);
+        return 0;
+    }
+    
+    if (argc > 1 && std::string(argv[1]) == "--replay") {
+        int steps = (argc > 2) ? std::atoi(argv[2]) : 1000;
+        
+        std::cout << "=== Record/Replay of the Simulation Step ===\n\n";
+        runReplaySweep(std::max(steps, 1), softening, devices, deviceNames, contexts, programs);
+        
+        for (auto& prog : programs) clReleaseProgram(prog);
+        for (auto& ctx : contexts) clReleaseContext(ctx);
+        return 0;
+    }
+    
+    if (argc > 1 && std::string(argv[1]) == "--fp64") {
+        int n = (argc > 2) ? std::atoi(argv[2]) : 8192;
+        
+        std::cout << "=== Double Precision (cl_khr_fp64) ===\n\n";
+        runFp64Comparison(n, softening, devices, deviceNames, contexts, programs);
+        
+        for (auto& prog : programs) clReleaseProgram(prog);
+        for (auto& ctx : contexts) clReleaseContext(ctx);
+        return 0;
+    }
+    
+    if (argc > 1 && std::string(argv[1]) == "--large") {
+        long long maxBodies = (argc > 2) ? std::atoll(argv[2]) : 1048576;
+        
+        std::cout << "=== Large-Scale Direct Sum ===\n\n";
+        runLargeScaleSweep(std::min(maxBodies, (long long)INT32_MAX), softening,
+                           devices, deviceNames, contexts, programs);
+        
+        for (auto& prog : programs) clReleaseProgram(prog);
+        for (auto& ctx : contexts) clReleaseContext(ctx);
+        return 0;
+    }
+    
+    if (argc > 1 && std::string(argv[1]) == "--diagnostics") {
+        int n = (argc > 2) ? std::atoi(argv[2]) : 16384;
+        int steps = (argc > 3) ? std::atoi(argv[3]) : 500;
+        int every = (argc > 4) ? std::atoi(argv[4]) : 10;
+        const float dt = 0.01f;
+        
+        std::cout << "=== On-Device Energy and Momentum Diagnostics ===\n\n";
+        runDiagnosticsSweep(n, steps, std::max(1, every), softening, dt,
+                            devices, deviceNames, contexts, programs);
+        
+        for (auto& prog : programs) clReleaseProgram(prog);
+        for (auto& ctx : contexts) clReleaseContext(ctx);
+        return 0;
+    }
+    
+    if (argc > 1 && std::string(argv[1]) == "--snapshots") {
+        // --snapshots [bodies] [steps] [every] [--fp16] [--compress] [--restart file]
+        std::vector<int> numbers;
+        uint32_t flags = 0;
+        std::string restartPath;
+        for (int a = 2; a < argc; a++) {
+            std::string arg = argv[a];
+            if (arg == "--fp16") flags |= SNAPSHOT_FP16;
+            else if (arg == "--compress") flags |= SNAPSHOT_COMPRESSED;
+            else if (arg == "--restart" && a + 1 < argc) restartPath = argv[++a];
+            else numbers.push_back(std::atoi(arg.c_str()));
+        }
+        int n = (numbers.size() > 0) ? numbers[0] : 65536;
+        int steps = (numbers.size() > 1) ? numbers[1] : 200;
+        int every = (numbers.size() > 2) ? numbers[2] : 20;
+        
+        std::cout << "=== Asynchronous Snapshot Writer ===\n\n";
+        if (!devices.empty()) {
+            runSnapshotSimulation(n, steps, std::max(1, every), flags, restartPath, softening,
+                                  devices[0], deviceNames[0], contexts[0], programs[0]);
+        }
+        
+        for (auto& prog : programs) clReleaseProgram(prog);
+        for (auto& ctx : contexts) clReleaseContext(ctx);
+        return 0;
+    }
+    
+    if (argc > 1 && std::string(argv[1]) == "--simulate") {
+        int n = (argc > 2) ? std::atoi(argv[2]) : 8192;
+        int steps = (argc > 3) ? std::atoi(argv[3]) : 1000;
+        int snapshotEvery = (argc > 4) ? std::atoi(argv[4]) : 100;
+        const float dt = 0.01f;
+        
+        std::cout << "=== Device-Resident Time Integration ===\n\n";
+        runSimulation(n, steps, std::max(1, snapshotEvery), softening, dt,
+                      devices, deviceNames, contexts, programs);
+        
+        for (auto& prog : programs) clReleaseProgram(prog);
+        for (auto& ctx : contexts) clReleaseContext(ctx);
+        return 0;
+    }
     
     for (int n : bodyCounts) {
         std::cout << "========================================\n";
         std::cout << "N-Body with " << n << " particles\n";
-        std::cout << "Force calculations: " << (n * (n-1)) << " (O(n²))\n";
+        std::cout << "Force calculations: " << ((long long)n * (n - 1)) << " (O(n²))\n";
         std::cout << "========================================\n";
         
         std::vector<Body> bodies(n);
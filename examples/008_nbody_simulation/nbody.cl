@@ -1,3 +1,21 @@
+// Precision knob, selected with build options (see --precision in main.cpp).
+// Default: sqrt and a divide, the most accurate form. -DFORCE_RSQRT uses the
+// full-precision rsqrt builtin, -DFORCE_NATIVE_RSQRT the hardware estimate.
+// -cl-mad-enable / -cl-fast-relaxed-math apply on top of any of them.
+inline float pair_force(float mass, float dist_sq)
+{
+#if defined(FORCE_NATIVE_RSQRT)
+    float inv_dist = native_rsqrt(dist_sq);
+    return mass * inv_dist * inv_dist * inv_dist;
+#elif defined(FORCE_RSQRT)
+    float inv_dist = rsqrt(dist_sq);
+    return mass * inv_dist * inv_dist * inv_dist;
+#else
+    float dist = sqrt(dist_sq);
+    return mass / (dist_sq * dist);
+#endif
+}
+
 // Simple N-body kernel - each thread computes forces on one body
 __kernel void compute_forces(__global const float4* positions,
                              __global const float* masses,
@@ -20,12 +38,9 @@ __kernel void compute_forces(__global const float4* positions,
         
         // Distance with softening
         float dist_sq = r.x * r.x + r.y * r.y + r.z * r.z + softening * softening;
-        float dist = sqrt(dist_sq);
-        float dist_cubed = dist_sq * dist;
-        
         // Newton's law: F = G * m1 * m2 / r^2
         // a = F / m1 = G * m2 / r^2
-        float force = masses[j] / dist_cubed;
+        float force = pair_force(masses[j], dist_sq);
         
         acc += r * force;
     }
@@ -74,9 +89,7 @@ __kernel void compute_forces_tiled(__global const float4* positions,
                 
                 float4 r = shared_pos[k] - pos_i;
                 float dist_sq = r.x * r.x + r.y * r.y + r.z * r.z + softening * softening;
-                float dist = sqrt(dist_sq);
-                float dist_cubed = dist_sq * dist;
-                float force = shared_mass[k] / dist_cubed;
+                float force = pair_force(shared_mass[k], dist_sq);
                 
                 acc += r * force;
             }
@@ -103,8 +116,858 @@ __kernel void integrate(__global float4* positions,
     float4 vel = velocities[i];
     float4 acc = accelerations[i];
     
-    // Velocity Verlet integration
-    vel += acc * dt;
-    positions[i] += vel * dt;
+    // Velocity Verlet integration. Only xyz is updated: on diagnostic steps
+    // acc.w carries the body's potential (compute_forces_potential).
+    vel.xyz += acc.xyz * dt;
+    positions[i].xyz += vel.xyz * dt;
+    velocities[i] = vel;
+}
+// ============================================================================
+// Barnes-Hut tree code (O(n log n))
+//
+// Bodies are sorted along a Morton (Z-order) curve and a binary radix tree is
+// built over the sorted keys in parallel (Karras, "Maximizing Parallelism in
+// the Construction of BVHs, Octrees, and k-d Trees", HPG 2012). Every octree
+// cell is a subtree of the radix tree (three radix levels per octree level),
+// so the cell edge of a node follows from the length of its key prefix.
+//
+// Node numbering: internal nodes 0..n-2 (root = 0), leaf k = n-1+k, which is
+// the k-th body in Morton order.
+// ============================================================================
+
+#define MORTON_BITS 10
+
+// Per-work-group min/max of positions; the host reduces the partials
+__kernel void bounding_box_partial(__global const float4* positions,
+                                   __global float4* group_min,
+                                   __global float4* group_max,
+                                   const int n,
+                                   __local float4* local_min,
+                                   __local float4* local_max)
+{
+    int gid = get_global_id(0);
+    int lid = get_local_id(0);
+    
+    float4 p = positions[min(gid, n - 1)];
+    local_min[lid] = p;
+    local_max[lid] = p;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    
+    for (int stride = get_local_size(0) / 2; stride > 0; stride /= 2) {
+        if (lid < stride) {
+            local_min[lid] = fmin(local_min[lid], local_min[lid + stride]);
+            local_max[lid] = fmax(local_max[lid], local_max[lid + stride]);
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    
+    if (lid == 0) {
+        group_min[get_group_id(0)] = local_min[0];
+        group_max[get_group_id(0)] = local_max[0];
+    }
+}
+
+// Spread the low 10 bits of v so there are two zero bits between each
+inline uint expand_bits(uint v)
+{
+    v = (v * 0x00010001u) & 0xFF0000FFu;
+    v = (v * 0x00000101u) & 0x0F00F00Fu;
+    v = (v * 0x00000011u) & 0xC30C30C3u;
+    v = (v * 0x00000005u) & 0x49249249u;
+    return v;
+}
+
+// Key = 30-bit Morton code in the high word, body index in the low word, so
+// keys are unique even when bodies share a Morton cell. Padding keys beyond n
+// are ULONG_MAX and sort to the end.
+__kernel void compute_morton_keys(__global const float4* positions,
+                                  __global ulong* keys,
+                                  const int n,
+                                  const float4 box_min,
+                                  const float inv_box_size)
+{
+    int i = get_global_id(0);
+    if (i >= n) {
+        keys[i] = ULONG_MAX;
+        return;
+    }
+    
+    float4 cell = (positions[i] - box_min) * (inv_box_size * (1 << MORTON_BITS));
+    uint x = (uint)clamp((int)cell.x, 0, (1 << MORTON_BITS) - 1);
+    uint y = (uint)clamp((int)cell.y, 0, (1 << MORTON_BITS) - 1);
+    uint z = (uint)clamp((int)cell.z, 0, (1 << MORTON_BITS) - 1);
+    uint code = (expand_bits(x) << 2) | (expand_bits(y) << 1) | expand_bits(z);
+    
+    keys[i] = ((ulong)code << 32) | (uint)i;
+}
+
+// One compare-exchange stage of a bitonic sort over a power-of-two array
+__kernel void bitonic_sort_step(__global ulong* keys,
+                                const uint j,
+                                const uint k)
+{
+    uint i = get_global_id(0);
+    uint partner = i ^ j;
+    if (partner <= i) return;
+    
+    ulong a = keys[i];
+    ulong b = keys[partner];
+    bool ascending = (i & k) == 0;
+    if ((a > b) == ascending) {
+        keys[i] = b;
+        keys[partner] = a;
+    }
+}
+
+// Gather bodies into Morton order as (x, y, z, mass)
+__kernel void gather_sorted_bodies(__global const ulong* keys,
+                                   __global const float4* positions,
+                                   __global const float* masses,
+                                   __global float4* sorted_bodies,
+                                   const int n)
+{
+    int k = get_global_id(0);
+    if (k >= n) return;
+    
+    uint i = (uint)keys[k];
+    float4 p = positions[i];
+    p.w = masses[i];
+    sorted_bodies[k] = p;
+}
+
+// Length of the common key prefix of sorted keys i and j, -1 outside [0, n)
+inline int key_prefix(__global const ulong* keys, int n, int i, int j)
+{
+    if (j < 0 || j >= n) return -1;
+    return (int)clz(keys[i] ^ keys[j]);
+}
+
+// One work-item per internal node: find the key range it covers and where
+// that range splits, then link both children to it
+__kernel void build_radix_tree(__global const ulong* keys,
+                               __global int2* node_children,
+                               __global int2* node_range,
+                               __global int* node_parent,
+                               __global float* node_size,
+                               const int n,
+                               const float box_size)
+{
+    int i = get_global_id(0);
+    if (i >= n - 1) return;
+    
+    // Direction of the range: towards the neighbour with the longer prefix
+    int d = (key_prefix(keys, n, i, i + 1) - key_prefix(keys, n, i, i - 1)) > 0 ? 1 : -1;
+    
+    // Upper bound for the range length, then binary search for the other end
+    int prefix_min = key_prefix(keys, n, i, i - d);
+    int length_max = 2;
+    while (key_prefix(keys, n, i, i + length_max * d) > prefix_min) {
+        length_max *= 2;
+    }
+    int length = 0;
+    for (int t = length_max / 2; t >= 1; t /= 2) {
+        if (key_prefix(keys, n, i, i + (length + t) * d) > prefix_min) {
+            length += t;
+        }
+    }
+    int j = i + length * d;
+    
+    // Binary search for the split position within [i, j]
+    int prefix_node = key_prefix(keys, n, i, j);
+    int split = 0;
+    int t;
+    int divisor = 2;
+    do {
+        t = (length + divisor - 1) / divisor;
+        if (key_prefix(keys, n, i, i + (split + t) * d) > prefix_node) {
+            split += t;
+        }
+        divisor *= 2;
+    } while (t > 1);
+    int gamma = i + split * d + min(d, 0);
+    
+    int first = min(i, j);
+    int last = max(i, j);
+    int left = (first == gamma) ? (n - 1 + gamma) : gamma;
+    int right = (last == gamma + 1) ? (n - 1 + gamma + 1) : gamma + 1;
+    
+    node_children[i] = (int2)(left, right);
+    node_range[i] = (int2)(first, last);
+    node_parent[left] = i;
+    node_parent[right] = i;
+    if (i == 0) node_parent[0] = -1;
+    
+    // The top 2 key bits are always zero; every 3 Morton bits halve the cell
+    int morton_prefix = clamp(prefix_node - 2, 0, 3 * MORTON_BITS);
+    node_size[i] = box_size / (float)(1 << (morton_prefix / 3));
+}
+
+// Bottom-up centre of mass: one work-item per leaf walks towards the root.
+// The first child to arrive at a node stops; the second one knows both
+// children are complete and summarizes the node.
+__kernel void summarize_tree(__global const int2* node_children,
+                             __global const int* node_parent,
+                             __global const float4* sorted_bodies,
+                             volatile __global float4* node_com,
+                             volatile __global int* node_visits,
+                             const int n)
+{
+    int k = get_global_id(0);
+    if (k >= n) return;
+    
+    int node = node_parent[n - 1 + k];
+    while (node >= 0) {
+        mem_fence(CLK_GLOBAL_MEM_FENCE);
+        if (atomic_inc(&node_visits[node]) == 0) return;
+        mem_fence(CLK_GLOBAL_MEM_FENCE);
+        
+        int2 children = node_children[node];
+        float4 a = (children.x >= n - 1) ? sorted_bodies[children.x - (n - 1)] : node_com[children.x];
+        float4 b = (children.y >= n - 1) ? sorted_bodies[children.y - (n - 1)] : node_com[children.y];
+        
+        float mass = a.w + b.w;
+        float4 com = (a * a.w + b * b.w) / mass;
+        com.w = mass;
+        node_com[node] = com;
+        
+        node = node_parent[node];
+    }
+}
+
+// Theta-controlled traversal, one work-item per body in Morton order so
+// neighbouring work-items walk nearly the same part of the tree. A node is
+// accepted when size / distance < theta and the body is not inside it.
+#define TRAVERSAL_STACK 64
+
+__kernel void compute_forces_barnes_hut(__global const ulong* keys,
+                                        __global const float4* sorted_bodies,
+                                        __global const int2* node_children,
+                                        __global const int2* node_range,
+                                        __global const float4* node_com,
+                                        __global const float* node_size,
+                                        __global float4* accelerations,
+                                        const int n,
+                                        const float softening,
+                                        const float theta)
+{
+    int k = get_global_id(0);
+    if (k >= n) return;
+    
+    float4 pos_i = sorted_bodies[k];
+    float4 acc = (float4)(0.0f, 0.0f, 0.0f, 0.0f);
+    float theta_sq = theta * theta;
+    float soft_sq = softening * softening;
+    
+    int stack[TRAVERSAL_STACK];
+    int top = 0;
+    stack[top++] = 0;
+    
+    while (top > 0) {
+        int node = stack[--top];
+        float4 source;
+        
+        if (node >= n - 1) {
+            int body = node - (n - 1);
+            if (body == k) continue;
+            source = sorted_bodies[body];
+        } else {
+            source = node_com[node];
+            float4 r = source - pos_i;
+            float dist_sq = r.x * r.x + r.y * r.y + r.z * r.z;
+            float size = node_size[node];
+            int2 range = node_range[node];
+            bool contains_self = (k >= range.x && k <= range.y);
+            
+            if (contains_self || size * size >= theta_sq * dist_sq) {
+                int2 children = node_children[node];
+                stack[top++] = children.x;
+                stack[top++] = children.y;
+                continue;
+            }
+        }
+        
+        float4 r = source - pos_i;
+        float dist_sq = r.x * r.x + r.y * r.y + r.z * r.z + soft_sq;
+        float force = pair_force(source.w, dist_sq);
+        acc += r * force;
+    }
+    
+    acc.w = 0.0f;
+    accelerations[(uint)keys[k]] = acc;
+}
+
+// ============================================================================
+// Layout variants of compute_forces_tiled. The loop structure is identical;
+// only the way bodies are stored differs.
+// ============================================================================
+
+// Struct-of-arrays: one scalar array per component, so each load is a
+// contiguous scalar stream
+__kernel void compute_forces_soa(__global const float* pos_x,
+                                 __global const float* pos_y,
+                                 __global const float* pos_z,
+                                 __global const float* masses,
+                                 __global float* acc_x,
+                                 __global float* acc_y,
+                                 __global float* acc_z,
+                                 const int n,
+                                 const float softening,
+                                 __local float* shared_x,
+                                 __local float* shared_y,
+                                 __local float* shared_z,
+                                 __local float* shared_mass)
+{
+    int global_id = get_global_id(0);
+    int local_id = get_local_id(0);
+    int local_size = get_local_size(0);
+    
+    float ax = 0.0f, ay = 0.0f, az = 0.0f;
+    float px = 0.0f, py = 0.0f, pz = 0.0f;
+    if (global_id < n) {
+        px = pos_x[global_id];
+        py = pos_y[global_id];
+        pz = pos_z[global_id];
+    }
+    
+    int num_tiles = (n + local_size - 1) / local_size;
+    
+    for (int tile = 0; tile < num_tiles; tile++) {
+        int j = tile * local_size + local_id;
+        
+        if (j < n) {
+            shared_x[local_id] = pos_x[j];
+            shared_y[local_id] = pos_y[j];
+            shared_z[local_id] = pos_z[j];
+            shared_mass[local_id] = masses[j];
+        } else {
+            shared_x[local_id] = 0.0f;
+            shared_y[local_id] = 0.0f;
+            shared_z[local_id] = 0.0f;
+            shared_mass[local_id] = 0.0f;
+        }
+        
+        barrier(CLK_LOCAL_MEM_FENCE);
+        
+        if (global_id < n) {
+            for (int k = 0; k < local_size; k++) {
+                int j_global = tile * local_size + k;
+                if (j_global >= n || j_global == global_id) continue;
+                
+                float dx = shared_x[k] - px;
+                float dy = shared_y[k] - py;
+                float dz = shared_z[k] - pz;
+                float dist_sq = dx * dx + dy * dy + dz * dz + softening * softening;
+                float force = pair_force(shared_mass[k], dist_sq);
+                
+                ax += dx * force;
+                ay += dy * force;
+                az += dz * force;
+            }
+        }
+        
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    
+    if (global_id < n) {
+        acc_x[global_id] = ax;
+        acc_y[global_id] = ay;
+        acc_z[global_id] = az;
+    }
+}
+
+// Packed xyzm: mass rides in the w lane of the position, so one 16-byte load
+// fetches everything about a source body and the masses buffer disappears
+__kernel void compute_forces_xyzm(__global const float4* bodies,
+                                  __global float4* accelerations,
+                                  const int n,
+                                  const float softening,
+                                  __local float4* shared_bodies)
+{
+    int global_id = get_global_id(0);
+    int local_id = get_local_id(0);
+    int local_size = get_local_size(0);
+    
+    float4 acc = (float4)(0.0f, 0.0f, 0.0f, 0.0f);
+    float4 pos_i = (global_id < n) ? bodies[global_id] : (float4)(0.0f);
+    
+    int num_tiles = (n + local_size - 1) / local_size;
+    
+    for (int tile = 0; tile < num_tiles; tile++) {
+        int j = tile * local_size + local_id;
+        
+        shared_bodies[local_id] = (j < n) ? bodies[j] : (float4)(0.0f);
+        
+        barrier(CLK_LOCAL_MEM_FENCE);
+        
+        if (global_id < n) {
+            for (int k = 0; k < local_size; k++) {
+                int j_global = tile * local_size + k;
+                if (j_global >= n || j_global == global_id) continue;
+                
+                float4 body_j = shared_bodies[k];
+                float4 r = body_j - pos_i;
+                float dist_sq = r.x * r.x + r.y * r.y + r.z * r.z + softening * softening;
+                float force = pair_force(body_j.w, dist_sq);
+                
+                acc += r * force;
+            }
+        }
+        
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    
+    if (global_id < n) {
+        acc.w = 0.0f;
+        accelerations[global_id] = acc;
+    }
+}
+
+// ============================================================================
+// Several target bodies per work-item. Each source body loaded from local
+// memory is reused for BODIES_PER_ITEM targets held in registers. The host
+// pads the xyzm array with zero-mass bodies to a multiple of
+// TILE_SIZE * BODIES_PER_ITEM, so there are no bounds or self checks: padding
+// contributes nothing and the self term is zero (r = 0, softening > 0).
+// Both constants are build options, so the tile loop has a compile-time trip
+// count and can be unrolled.
+// ============================================================================
+
+#ifndef TILE_SIZE
+#define TILE_SIZE 256
+#endif
+#ifndef BODIES_PER_ITEM
+#define BODIES_PER_ITEM 1
+#endif
+
+__kernel __attribute__((reqd_work_group_size(TILE_SIZE, 1, 1)))
+void compute_forces_multi(__global const float4* bodies,
+                          __global float4* accelerations,
+                          const int n_padded,
+                          const float softening)
+{
+    __local float4 tile[TILE_SIZE];
+    
+    int local_id = get_local_id(0);
+    // Targets are strided by TILE_SIZE so global loads and stores stay coalesced
+    int base = get_group_id(0) * TILE_SIZE * BODIES_PER_ITEM + local_id;
+    float soft_sq = softening * softening;
+    
+    float4 pos[BODIES_PER_ITEM];
+    float4 acc[BODIES_PER_ITEM];
+    for (int b = 0; b < BODIES_PER_ITEM; b++) {
+        pos[b] = bodies[base + b * TILE_SIZE];
+        acc[b] = (float4)(0.0f);
+    }
+    
+    for (int start = 0; start < n_padded; start += TILE_SIZE) {
+        tile[local_id] = bodies[start + local_id];
+        barrier(CLK_LOCAL_MEM_FENCE);
+        
+        #pragma unroll 8
+        for (int k = 0; k < TILE_SIZE; k++) {
+            float4 source = tile[k];
+            for (int b = 0; b < BODIES_PER_ITEM; b++) {
+                float4 r = source - pos[b];
+                float dist_sq = r.x * r.x + r.y * r.y + r.z * r.z + soft_sq;
+                acc[b] += r * pair_force(source.w, dist_sq);
+            }
+        }
+        
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    
+    for (int b = 0; b < BODIES_PER_ITEM; b++) {
+        acc[b].w = 0.0f;
+        accelerations[base + b * TILE_SIZE] = acc[b];
+    }
+}
+
+// ============================================================================
+// Cell-list short-range forces. Particles interact only within a cutoff, so
+// space is binned into a uniform grid of cells one cutoff wide: after sorting
+// particles by cell, each particle only scans its own and the 26 neighbouring
+// cells. The force is a soft-sphere repulsion (the DPD conservative force),
+// F = stiffness * (1 - r / cutoff) along r, which stays finite for any
+// initial configuration.
+// ============================================================================
+
+// Key = cell index in the high word, particle index in the low word.
+// Padding keys beyond n are ULONG_MAX and sort to the end.
+__kernel void compute_cell_keys(__global const float4* positions,
+                                __global ulong* keys,
+                                const int n,
+                                const int grid,
+                                const float inv_cell_size)
+{
+    int i = get_global_id(0);
+    if (i >= n) {
+        keys[i] = ULONG_MAX;
+        return;
+    }
+    
+    float4 p = positions[i] * inv_cell_size;
+    int cx = clamp((int)p.x, 0, grid - 1);
+    int cy = clamp((int)p.y, 0, grid - 1);
+    int cz = clamp((int)p.z, 0, grid - 1);
+    uint cell = (uint)((cz * grid + cy) * grid + cx);
+    
+    keys[i] = ((ulong)cell << 32) | (uint)i;
+}
+
+// Sorted particles [cell_start, cell_end) belong to each cell; empty cells
+// keep the [0, 0) the host fills in
+__kernel void find_cell_bounds(__global const ulong* keys,
+                               __global int* cell_start,
+                               __global int* cell_end,
+                               const int n)
+{
+    int k = get_global_id(0);
+    if (k >= n) return;
+    
+    uint cell = (uint)(keys[k] >> 32);
+    if (k == 0 || (uint)(keys[k - 1] >> 32) != cell) cell_start[cell] = k;
+    if (k == n - 1 || (uint)(keys[k + 1] >> 32) != cell) cell_end[cell] = k + 1;
+}
+
+__kernel void gather_cell_sorted(__global const ulong* keys,
+                                 __global const float4* positions,
+                                 __global float4* sorted_positions,
+                                 const int n)
+{
+    int k = get_global_id(0);
+    if (k >= n) return;
+    sorted_positions[k] = positions[(uint)keys[k]];
+}
+
+// One work-item per particle in cell order, so a work-group scans nearly the
+// same neighbour cells and the loads stay cached
+__kernel void compute_forces_cell_list(__global const ulong* keys,
+                                       __global const float4* sorted_positions,
+                                       __global const int* cell_start,
+                                       __global const int* cell_end,
+                                       __global float4* accelerations,
+                                       const int n,
+                                       const int grid,
+                                       const float inv_cell_size,
+                                       const float cutoff,
+                                       const float stiffness)
+{
+    int k = get_global_id(0);
+    if (k >= n) return;
+    
+    float4 pos_i = sorted_positions[k];
+    int cx = clamp((int)(pos_i.x * inv_cell_size), 0, grid - 1);
+    int cy = clamp((int)(pos_i.y * inv_cell_size), 0, grid - 1);
+    int cz = clamp((int)(pos_i.z * inv_cell_size), 0, grid - 1);
+    float cutoff_sq = cutoff * cutoff;
+    float inv_cutoff = 1.0f / cutoff;
+    float4 acc = (float4)(0.0f, 0.0f, 0.0f, 0.0f);
+    
+    for (int z = max(cz - 1, 0); z <= min(cz + 1, grid - 1); z++) {
+        for (int y = max(cy - 1, 0); y <= min(cy + 1, grid - 1); y++) {
+            for (int x = max(cx - 1, 0); x <= min(cx + 1, grid - 1); x++) {
+                int cell = (z * grid + y) * grid + x;
+                int end = cell_end[cell];
+                
+                for (int j = cell_start[cell]; j < end; j++) {
+                    float4 r = pos_i - sorted_positions[j];
+                    float dist_sq = r.x * r.x + r.y * r.y + r.z * r.z;
+                    
+                    // dist_sq == 0 skips the particle itself
+                    if (dist_sq < cutoff_sq && dist_sq > 0.0f) {
+                        acc += r * (stiffness * (rsqrt(dist_sq) - inv_cutoff));
+                    }
+                }
+            }
+        }
+    }
+    
+    acc.w = 0.0f;
+    accelerations[(uint)keys[k]] = acc;
+}
+
+// ============================================================================
+// Multi-device decomposition. Each device owns a contiguous slice of target
+// bodies and holds a full copy of all positions (xyzm, mass in w). Forces are
+// accumulated one source block at a time, so a device can start on the
+// blocks it already has while the others are still arriving.
+// ============================================================================
+
+__kernel void compute_forces_block(__global const float4* bodies,
+                                   __global float4* accelerations,
+                                   const int target_offset,
+                                   const int target_count,
+                                   const int source_offset,
+                                   const int source_count,
+                                   const float softening,
+                                   const int accumulate,
+                                   __local float4* shared_bodies)
+{
+    int global_id = get_global_id(0);
+    int local_id = get_local_id(0);
+    int local_size = get_local_size(0);
+    bool active = global_id < target_count;
+    float soft_sq = softening * softening;
+    
+    float4 acc = (float4)(0.0f, 0.0f, 0.0f, 0.0f);
+    float4 pos_i = active ? bodies[target_offset + global_id] : (float4)(0.0f);
+    
+    for (int tile_start = 0; tile_start < source_count; tile_start += local_size) {
+        int j = tile_start + local_id;
+        shared_bodies[local_id] = (j < source_count) ? bodies[source_offset + j] : (float4)(0.0f);
+        
+        barrier(CLK_LOCAL_MEM_FENCE);
+        
+        // The self term is zero (r = 0, softening > 0), so no index check
+        int tile_count = min(local_size, source_count - tile_start);
+        if (active) {
+            for (int k = 0; k < tile_count; k++) {
+                float4 r = shared_bodies[k] - pos_i;
+                float dist_sq = r.x * r.x + r.y * r.y + r.z * r.z + soft_sq;
+                acc += r * pair_force(shared_bodies[k].w, dist_sq);
+            }
+        }
+        
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    
+    if (active) {
+        acc.w = 0.0f;
+        if (accumulate) acc += accelerations[global_id];
+        accelerations[global_id] = acc;
+    }
+}
+
+// integrate for a slice of an xyzm array (velocity w stays 0, so mass is kept)
+__kernel void integrate_range(__global float4* bodies,
+                              __global float4* velocities,
+                              __global const float4* accelerations,
+                              const int offset,
+                              const int count,
+                              const float dt)
+{
+    int i = get_global_id(0);
+    if (i >= count) return;
+    
+    float4 vel = velocities[i] + accelerations[i] * dt;
+    bodies[offset + i] += vel * dt;
+    velocities[i] = vel;
+}
+
+// ============================================================================
+// On-device diagnostics: energy, momentum and angular momentum reduced to a
+// single float8, so only 32 bytes cross the bus per check.
+// ============================================================================
+
+// compute_forces_tiled that also stores the softened potential
+// phi_i = -sum_j m_j / sqrt(r^2 + eps^2) in acc.w. Used on diagnostic steps
+// in place of compute_forces_tiled; the extra cost is one sqrt per pair.
+__kernel void compute_forces_potential(__global const float4* positions,
+                                       __global const float* masses,
+                                       __global float4* accelerations,
+                                       const int n,
+                                       const float softening,
+                                       __local float4* shared_pos,
+                                       __local float* shared_mass)
+{
+    int global_id = get_global_id(0);
+    int local_id = get_local_id(0);
+    int local_size = get_local_size(0);
+    
+    float3 acc = (float3)(0.0f);
+    float phi = 0.0f;
+    float4 pos_i = (global_id < n) ? positions[global_id] : (float4)(0.0f);
+    
+    int num_tiles = (n + local_size - 1) / local_size;
+    
+    for (int tile = 0; tile < num_tiles; tile++) {
+        int j = tile * local_size + local_id;
+        
+        if (j < n) {
+            shared_pos[local_id] = positions[j];
+            shared_mass[local_id] = masses[j];
+        } else {
+            shared_pos[local_id] = (float4)(0.0f);
+            shared_mass[local_id] = 0.0f;
+        }
+        
+        barrier(CLK_LOCAL_MEM_FENCE);
+        
+        if (global_id < n) {
+            for (int k = 0; k < local_size; k++) {
+                int j_global = tile * local_size + k;
+                if (j_global >= n || j_global == global_id) continue;
+                
+                float3 r = shared_pos[k].xyz - pos_i.xyz;
+                float dist_sq = dot(r, r) + softening * softening;
+                
+                acc += r * pair_force(shared_mass[k], dist_sq);
+                phi -= shared_mass[k] / sqrt(dist_sq);
+            }
+        }
+        
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    
+    if (global_id < n) {
+        accelerations[global_id] = (float4)(acc, phi);
+    }
+}
+
+// Tree reduction of a float8 per work-item in local memory (power-of-two
+// work-group size); the result ends up in scratch[0].
+inline void reduce_local_float8(__local float8* scratch, float8 value)
+{
+    int lid = get_local_id(0);
+    scratch[lid] = value;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    
+    for (int stride = get_local_size(0) / 2; stride > 0; stride >>= 1) {
+        if (lid < stride) scratch[lid] += scratch[lid + stride];
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+}
+
+// Stage 1: each work-group sums a grid-strided share of the bodies.
+// Per body: s0 kinetic, s1 potential (half of m_i * phi_i, since every pair
+// appears in both phi_i and phi_j), s2-s4 momentum, s5-s7 angular momentum.
+__kernel void reduce_diagnostics(__global const float4* positions,
+                                 __global const float4* velocities,
+                                 __global const float* masses,
+                                 __global const float4* accelerations,
+                                 const int n,
+                                 __global float8* partials,
+                                 __local float8* scratch)
+{
+    float8 sum = (float8)(0.0f);
+    
+    for (int i = get_global_id(0); i < n; i += get_global_size(0)) {
+        float m = masses[i];
+        float3 x = positions[i].xyz;
+        float3 p = m * velocities[i].xyz;
+        float3 l = cross(x, p);
+        
+        sum += (float8)(0.5f * dot(p, velocities[i].xyz),
+                        0.5f * m * accelerations[i].w,
+                        p.x, p.y, p.z, l.x, l.y, l.z);
+    }
+    
+    reduce_local_float8(scratch, sum);
+    if (get_local_id(0) == 0) partials[get_group_id(0)] = scratch[0];
+}
+
+// Stage 2: a single work-group folds the per-group partials into result[0]
+__kernel void sum_partials_float8(__global const float8* partials,
+                                  const int count,
+                                  __global float8* result,
+                                  __local float8* scratch)
+{
+    float8 sum = (float8)(0.0f);
+    for (int i = get_local_id(0); i < count; i += get_local_size(0)) {
+        sum += partials[i];
+    }
+    
+    reduce_local_float8(scratch, sum);
+    if (get_local_id(0) == 0) result[0] = scratch[0];
+}
+
+// ============================================================================
+// Double-precision variants of compute_forces, compute_forces_tiled and
+// integrate. Compiled only where the device supports doubles; the host
+// checks CL_DEVICE_DOUBLE_FP_CONFIG before creating them. They always use sqrt and
+// a divide: the precision knob above is about trading accuracy away.
+// ============================================================================
+
+#if defined(cl_khr_fp64) || defined(__opencl_c_fp64)
+#if defined(cl_khr_fp64)
+#pragma OPENCL EXTENSION cl_khr_fp64 : enable
+#endif
+
+__kernel void compute_forces_fp64(__global const double4* positions,
+                                  __global const double* masses,
+                                  __global double4* accelerations,
+                                  const int n,
+                                  const double softening)
+{
+    int i = get_global_id(0);
+    if (i >= n) return;
+    
+    double4 pos_i = positions[i];
+    double4 acc = (double4)(0.0);
+    
+    for (int j = 0; j < n; j++) {
+        if (i == j) continue;
+        
+        double4 r = positions[j] - pos_i;
+        double dist_sq = r.x * r.x + r.y * r.y + r.z * r.z + softening * softening;
+        acc += r * (masses[j] / (dist_sq * sqrt(dist_sq)));
+    }
+    
+    accelerations[i] = acc;
+}
+
+__kernel void compute_forces_tiled_fp64(__global const double4* positions,
+                                        __global const double* masses,
+                                        __global double4* accelerations,
+                                        const int n,
+                                        const double softening,
+                                        __local double4* shared_pos,
+                                        __local double* shared_mass)
+{
+    int global_id = get_global_id(0);
+    int local_id = get_local_id(0);
+    int local_size = get_local_size(0);
+    
+    double4 acc = (double4)(0.0);
+    double4 pos_i = (global_id < n) ? positions[global_id] : (double4)(0.0);
+    
+    int num_tiles = (n + local_size - 1) / local_size;
+    
+    for (int tile = 0; tile < num_tiles; tile++) {
+        int j = tile * local_size + local_id;
+        
+        if (j < n) {
+            shared_pos[local_id] = positions[j];
+            shared_mass[local_id] = masses[j];
+        } else {
+            shared_pos[local_id] = (double4)(0.0);
+            shared_mass[local_id] = 0.0;
+        }
+        
+        barrier(CLK_LOCAL_MEM_FENCE);
+        
+        if (global_id < n) {
+            for (int k = 0; k < local_size; k++) {
+                int j_global = tile * local_size + k;
+                if (j_global >= n || j_global == global_id) continue;
+                
+                double4 r = shared_pos[k] - pos_i;
+                double dist_sq = r.x * r.x + r.y * r.y + r.z * r.z + softening * softening;
+                acc += r * (shared_mass[k] / (dist_sq * sqrt(dist_sq)));
+            }
+        }
+        
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    
+    if (global_id < n) {
+        accelerations[global_id] = acc;
+    }
+}
+
+__kernel void integrate_fp64(__global double4* positions,
+                             __global double4* velocities,
+                             __global const double4* accelerations,
+                             const int n,
+                             const double dt)
+{
+    int i = get_global_id(0);
+    if (i >= n) return;
+    
+    double4 vel = velocities[i];
+    vel.xyz += accelerations[i].xyz * dt;
+    positions[i].xyz += vel.xyz * dt;
     velocities[i] = vel;
-}
\ No newline at end of file
+}
+
+#endif
@@ -0,0 +1,48 @@
+#include <immintrin.h>
+#include "symmetric_avx.h"
+
+int symmetricRowAVX(const float* x, const float* y, const float* z, const float* m,
+                    float* ax, float* ay, float* az,
+                    int i, int n, float softSq,
+                    float* sx, float* sy, float* sz) {
+    __m256 vxi = _mm256_set1_ps(x[i]), vyi = _mm256_set1_ps(y[i]), vzi = _mm256_set1_ps(z[i]);
+    __m256 vmi = _mm256_set1_ps(m[i]);
+    __m256 vsoft = _mm256_set1_ps(softSq);
+    __m256 half = _mm256_set1_ps(0.5f), threeHalves = _mm256_set1_ps(1.5f);
+    __m256 vsx = _mm256_setzero_ps(), vsy = _mm256_setzero_ps(), vsz = _mm256_setzero_ps();
+    
+    // Bodies past n have zero mass, so overrunning n is harmless
+    int j = i + 1;
+    for (; j < n; j += 8) {
+        __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(&x[j]), vxi);
+        __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(&y[j]), vyi);
+        __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(&z[j]), vzi);
+        __m256 distSq = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)),
+                                      _mm256_add_ps(_mm256_mul_ps(dz, dz), vsoft));
+        
+        // 12-bit rsqrt estimate plus one Newton step: y * (1.5 - 0.5 * d * y * y)
+        __m256 inv = _mm256_rsqrt_ps(distSq);
+        inv = _mm256_mul_ps(inv, _mm256_sub_ps(threeHalves,
+                  _mm256_mul_ps(_mm256_mul_ps(half, distSq), _mm256_mul_ps(inv, inv))));
+        __m256 inv3 = _mm256_mul_ps(inv, _mm256_mul_ps(inv, inv));
+        
+        __m256 fj = _mm256_mul_ps(_mm256_loadu_ps(&m[j]), inv3);   // pull on i
+        __m256 fi = _mm256_mul_ps(vmi, inv3);                      // pull on j
+        
+        vsx = _mm256_add_ps(vsx, _mm256_mul_ps(dx, fj));
+        vsy = _mm256_add_ps(vsy, _mm256_mul_ps(dy, fj));
+        vsz = _mm256_add_ps(vsz, _mm256_mul_ps(dz, fj));
+        _mm256_storeu_ps(&ax[j], _mm256_sub_ps(_mm256_loadu_ps(&ax[j]), _mm256_mul_ps(dx, fi)));
+        _mm256_storeu_ps(&ay[j], _mm256_sub_ps(_mm256_loadu_ps(&ay[j]), _mm256_mul_ps(dy, fi)));
+        _mm256_storeu_ps(&az[j], _mm256_sub_ps(_mm256_loadu_ps(&az[j]), _mm256_mul_ps(dz, fi)));
+    }
+    
+    float lanes[8];
+    _mm256_storeu_ps(lanes, vsx);
+    for (int l = 0; l < 8; l++) *sx += lanes[l];
+    _mm256_storeu_ps(lanes, vsy);
+    for (int l = 0; l < 8; l++) *sy += lanes[l];
+    _mm256_storeu_ps(lanes, vsz);
+    for (int l = 0; l < 8; l++) *sz += lanes[l];
+    return j;
+}
@@ -0,0 +1,11 @@
+// AVX inner loop of the symmetric-force CPU path. symmetric_avx.cpp is the only
+// file built with AVX enabled; main.cpp calls it only after cpuSupportsAVX().
+#pragma once
+
+// Row i of the pair triangle, 8 bodies at a time from j = i + 1: the pull on i
+// is added to *sx/*sy/*sz and the reaction subtracted from ax/ay/az[j]. The
+// arrays must be padded with zero-mass bodies past n. Returns the first j left.
+int symmetricRowAVX(const float* x, const float* y, const float* z, const float* m,
+                    float* ax, float* ay, float* az,
+                    int i, int n, float softSq,
+                    float* sx, float* sy, float* sz);
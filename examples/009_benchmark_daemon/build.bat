@@ -0,0 +1,33 @@
+@echo off
+setlocal
+
+set CMAKE="%ProgramFiles(x86)%\Microsoft Visual Studio\2019\BuildTools\Common7\IDE\CommonExtensions\Microsoft\CMake\CMake\bin\cmake.exe"
+
+if not exist build mkdir build
+cd build
+%CMAKE% .. -G "Visual Studio 16 2019" -A x64
+if errorlevel 1 (
+    cd ..
+    pause
+    exit /b 1
+)
+
+%CMAKE% --build . --config Release
+if errorlevel 1 (
+    cd ..
+    pause
+    exit /b 1
+)
+
+copy ..\workloads.cl Release\workloads.cl >nul
+
+cd ..
+echo.
+echo Built build\Release\bench_daemon.exe and build\Release\bench_client.exe
+echo.
+echo Start the daemon in its own window:
+echo     cd build\Release ^&^& bench_daemon.exe
+echo Then run jobs from another:
+echo     bench_client.exe run matmul 256,512,1024 all
+echo     bench_client.exe shutdown
+pause
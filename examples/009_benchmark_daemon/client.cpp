@@ -0,0 +1,167 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <map>
+#include <chrono>
+#include <iomanip>
+#include <cstdlib>
+#include "ipc.h"
+
+// Thin client for the benchmark daemon: sends requests, prints the replies as
+// tables. Everything expensive (contexts, program builds) lives in the daemon.
+
+using Clock = std::chrono::high_resolution_clock;
+
+// "1K" -> 1024, "4M" -> 4194304, plain numbers pass through
+long long parseSize(const std::string& text) {
+    long long value = std::atoll(text.c_str());
+    char suffix = text.empty() ? '\0' : text.back();
+    if (suffix == 'K' || suffix == 'k') value *= 1024;
+    if (suffix == 'M' || suffix == 'm') value *= 1024 * 1024;
+    return value;
+}
+
+std::vector<std::string> splitList(const std::string& text) {
+    std::vector<std::string> items;
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t end = text.find(',', start);
+        if (end == std::string::npos) end = text.size();
+        if (end > start) items.push_back(text.substr(start, end - start));
+        start = end + 1;
+    }
+    return items;
+}
+
+// "OK a=1 b=2" -> {a: 1, b: 2}
+std::map<std::string, std::string> parseReply(const std::string& reply) {
+    std::map<std::string, std::string> fields;
+    for (const auto& word : splitWords(reply)) {
+        size_t eq = word.find('=');
+        if (eq != std::string::npos) fields[word.substr(0, eq)] = word.substr(eq + 1);
+    }
+    return fields;
+}
+
+bool request(socket_t s, LineReader& reader, const std::string& line, std::string& reply) {
+    return sendLine(s, line) && readLine(reader, reply);
+}
+
+// LIST, returning backend names in daemon order and printing them with their descriptions
+std::vector<std::string> listBackends(socket_t s, LineReader& reader, bool print) {
+    std::vector<std::string> backends;
+    std::string reply;
+    if (!request(s, reader, "LIST", reply) || reply.compare(0, 2, "OK") != 0) return backends;
+
+    auto fields = parseReply(reply);
+    int count = std::atoi(fields["backends"].c_str());
+    if (print) std::cout << "Workloads: " << fields["workloads"] << "\n\nBackends:\n";
+    for (int i = 0; i < count; i++) {
+        std::string line;
+        if (!readLine(reader, line)) break;
+        backends.push_back(line.substr(0, line.find(' ')));
+        if (print) std::cout << "  " << line << "\n";
+    }
+    return backends;
+}
+
+void printUsage() {
+    std::cerr << "Usage: bench_client [--socket path] <command>\n"
+              << "  list                                          backends and workloads\n"
+              << "  run <workload> <sizes> <backend|all> [repeats] sizes: comma list, K/M suffixes\n"
+              << "  stats                                         daemon uptime, jobs, buffer pool\n"
+              << "  shutdown                                      stop the daemon\n";
+}
+
+int main(int argc, char** argv) {
+    std::string socketPath = defaultSocketPath();
+    int arg = 1;
+    if (argc > 2 && std::string(argv[1]) == "--socket") {
+        socketPath = argv[2];
+        arg = 3;
+    }
+    if (arg >= argc) {
+        printUsage();
+        return 1;
+    }
+    std::string command = argv[arg];
+
+    if (!initSockets()) return 1;
+    socket_t s = connectLocal(socketPath);
+    if (s == INVALID_SOCKET) {
+        std::cerr << "Cannot connect to " << socketPath << " - is bench_daemon running?\n";
+        return 1;
+    }
+    LineReader reader{s, ""};
+    std::string reply;
+    int status = 0;
+
+    if (command == "list") {
+        listBackends(s, reader, true);
+    } else if (command == "stats" || command == "shutdown") {
+        if (request(s, reader, command == "stats" ? "STATS" : "SHUTDOWN", reply)) {
+            std::cout << reply << "\n";
+        }
+    } else if (command == "run" && arg + 3 < argc) {
+        std::string workload = argv[arg + 1];
+        std::vector<std::string> sizes = splitList(argv[arg + 2]);
+        std::vector<std::string> backends = (std::string(argv[arg + 3]) == "all")
+                                            ? listBackends(s, reader, false)
+                                            : splitList(argv[arg + 3]);
+        std::string repeats = (arg + 4 < argc) ? argv[arg + 4] : "5";
+
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << std::left << std::setw(12) << "Size"
+                  << std::setw(12) << "Backend"
+                  << std::right << std::setw(12) << "Upload ms"
+                  << std::setw(12) << "Best ms"
+                  << std::setw(12) << "Mean ms"
+                  << std::setw(10) << "GFLOPS"
+                  << std::setw(16) << "Checksum"
+                  << std::setw(8) << "Pool"
+                  << std::setw(14) << "Round trip ms" << "\n";
+        std::cout << std::string(108, '-') << "\n";
+
+        for (const auto& size : sizes) {
+            for (const auto& backend : backends) {
+                std::string line = "RUN " + workload + " " + std::to_string(parseSize(size)) + " " + backend + " " + repeats;
+                auto start = Clock::now();
+                if (!request(s, reader, line, reply)) {
+                    std::cerr << "Connection lost\n";
+                    return 1;
+                }
+                double roundTripMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+                std::cout << std::left << std::setw(12) << size << std::setw(12) << backend;
+                if (reply.compare(0, 2, "OK") != 0) {
+                    std::cout << reply << "\n";
+                    status = 1;
+                    continue;
+                }
+                auto fields = parseReply(reply);
+                // Buffers served from the daemon's pool / buffers the job needed
+                int hits = std::atoi(fields["pool_hits"].c_str());
+                int leased = hits + std::atoi(fields["pool_misses"].c_str());
+                std::string pool = leased ? std::to_string(hits) + "/" + std::to_string(leased) : "-";
+                std::cout << std::right << std::setw(12) << fields["upload_ms"]
+                          << std::setw(12) << fields["best_ms"]
+                          << std::setw(12) << fields["mean_ms"]
+                          << std::setw(10) << fields["gflops"]
+                          << std::setw(16) << fields["checksum"]
+                          << std::setw(8) << pool
+                          << std::setw(14) << roundTripMs << "\n";
+            }
+        }
+
+        // The cost every standalone example binary pays before its first kernel
+        if (request(s, reader, "STATS", reply)) {
+            std::cout << "\nDaemon startup (paid once, not per run): " << parseReply(reply)["startup_ms"] << " ms\n";
+        }
+    } else {
+        printUsage();
+        status = 1;
+    }
+
+    closeSocket(s);
+    return status;
+}
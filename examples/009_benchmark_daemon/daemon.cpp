@@ -0,0 +1,762 @@
+#define CL_TARGET_OPENCL_VERSION 300
+#include <CL/opencl.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <map>
+#include <chrono>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstdint>
+#include <new>
+#include <omp.h>
+#include "ipc.h"
+
+// Benchmark daemon: pays platform discovery, context creation and program
+// builds once, then serves jobs (workload, size, backend) from a local socket.
+// Jobs run one at a time so they never skew each other's timings.
+
+using Clock = std::chrono::high_resolution_clock;
+
+std::string loadKernelSource(const char* filename) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open kernel file: " << filename << "\n";
+        return "";
+    }
+    return std::string(std::istreambuf_iterator<char>(file),
+                       std::istreambuf_iterator<char>());
+}
+
+void checkError(cl_int err, const char* operation) {
+    if (err != CL_SUCCESS) {
+        std::cerr << "Error during " << operation << ": " << err << "\n";
+        exit(1);
+    }
+}
+
+double elapsedMs(Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// ============================================================================
+// Warm device state
+// ============================================================================
+
+const char* KERNEL_NAMES[] = {
+    "vector_add", "matvec_multiply", "matrix_multiply_tiled", "convolve_h", "convolve_v", "compute_forces_tiled"
+};
+
+struct PooledBuffer {
+    cl_mem mem;
+    size_t bytes;
+    bool inUse;
+};
+
+// Everything a job would otherwise create from scratch: context, queue, built
+// program, kernel objects and a pool of device buffers that outlive jobs
+struct WarmDevice {
+    cl_device_id id;
+    std::string name;
+    cl_context context;
+    cl_command_queue queue;
+    cl_program program;
+    std::map<std::string, cl_kernel> kernels;
+    std::vector<PooledBuffer> pool;
+    size_t poolLimit;           // idle buffers are freed beyond this many bytes
+    cl_ulong maxAlloc;
+    long long poolHits = 0;
+    long long poolMisses = 0;
+};
+
+size_t poolBytes(const WarmDevice& dev) {
+    size_t total = 0;
+    for (const auto& buf : dev.pool) total += buf.bytes;
+    return total;
+}
+
+// Reuses an idle buffer of at least `bytes` (but at most twice that, so a
+// small job does not tie up a huge one), or allocates a new one after freeing
+// idle buffers until the pool fits its budget
+cl_mem acquireBuffer(WarmDevice& dev, size_t bytes, bool* hit, cl_int* err) {
+    int best = -1;
+    for (int i = 0; i < (int)dev.pool.size(); i++) {
+        const PooledBuffer& buf = dev.pool[i];
+        if (!buf.inUse && buf.bytes >= bytes && buf.bytes <= 2 * bytes &&
+            (best < 0 || buf.bytes < dev.pool[best].bytes)) {
+            best = i;
+        }
+    }
+    if (best >= 0) {
+        dev.pool[best].inUse = true;
+        dev.poolHits++;
+        *hit = true;
+        *err = CL_SUCCESS;
+        return dev.pool[best].mem;
+    }
+
+    while (poolBytes(dev) + bytes > dev.poolLimit) {
+        auto idle = std::find_if(dev.pool.begin(), dev.pool.end(),
+                                 [](const PooledBuffer& buf) { return !buf.inUse; });
+        if (idle == dev.pool.end()) break;
+        clReleaseMemObject(idle->mem);
+        dev.pool.erase(idle);
+    }
+
+    cl_mem mem = clCreateBuffer(dev.context, CL_MEM_READ_WRITE, bytes, nullptr, err);
+    if (*err != CL_SUCCESS) return nullptr;
+    dev.pool.push_back({mem, bytes, true});
+    dev.poolMisses++;
+    *hit = false;
+    return mem;
+}
+
+void releaseBuffer(WarmDevice& dev, cl_mem mem) {
+    for (auto& buf : dev.pool) {
+        if (buf.mem == mem) buf.inUse = false;
+    }
+}
+
+// ============================================================================
+// Jobs
+// ============================================================================
+
+struct JobResult {
+    std::string error;          // empty on success
+    double uploadMs = 0.0;
+    double bestMs = 0.0;
+    double meanMs = 0.0;
+    double checksum = 0.0;
+    int poolHits = 0;
+    int poolMisses = 0;
+};
+
+// Buffers leased from a device pool for the duration of one job
+struct BufferLease {
+    WarmDevice* dev;
+    JobResult* result;
+    std::vector<cl_mem> mems;
+
+    cl_mem acquire(size_t bytes) {
+        bool hit;
+        cl_int err;
+        cl_mem mem = acquireBuffer(*dev, bytes, &hit, &err);
+        if (err != CL_SUCCESS) {
+            result->error = "clCreateBuffer failed (" + std::to_string(err) + ")";
+            return nullptr;
+        }
+        (hit ? result->poolHits : result->poolMisses)++;
+        mems.push_back(mem);
+        return mem;
+    }
+
+    ~BufferLease() {
+        for (cl_mem mem : mems) releaseBuffer(*dev, mem);
+    }
+};
+
+// Deterministic input data (cheap enough to regenerate per job)
+float inputValue(size_t i, int stream) {
+    uint32_t h = (uint32_t)(i * 2654435761u) ^ (uint32_t)(stream * 40503u);
+    h ^= h >> 15;
+    h *= 2246822519u;
+    h ^= h >> 13;
+    return (h & 0xFFFFFF) / 16777216.0f;
+}
+
+std::vector<float> makeInput(size_t count, int stream) {
+    std::vector<float> data(count);
+    for (size_t i = 0; i < count; i++) data[i] = inputValue(i, stream);
+    return data;
+}
+
+// Runs `once` `repeats` times and keeps best and mean
+template <typename Fn>
+void timeRepeats(int repeats, JobResult& result, Fn once) {
+    double total = 0.0;
+    result.bestMs = 1e30;
+    for (int r = 0; r < repeats; r++) {
+        auto start = Clock::now();
+        once();
+        double ms = elapsedMs(start, Clock::now());
+        total += ms;
+        result.bestMs = std::min(result.bestMs, ms);
+    }
+    result.meanMs = total / repeats;
+}
+
+// Sum of |output|: N-body accelerations sum to ~0 (momentum), so a plain sum would hide errors
+double checksum(const std::vector<float>& data) {
+    double sum = 0.0;
+    for (float v : data) sum += std::abs(v);
+    return sum;
+}
+
+// Blocking uploads of host inputs, timed as the job's upload cost
+bool uploadInputs(WarmDevice& dev, const std::vector<std::pair<cl_mem, const std::vector<float>*>>& uploads,
+                  JobResult& result) {
+    auto start = Clock::now();
+    for (const auto& upload : uploads) {
+        cl_int err = clEnqueueWriteBuffer(dev.queue, upload.first, CL_TRUE, 0,
+                                          upload.second->size() * sizeof(float),
+                                          upload.second->data(), 0, nullptr, nullptr);
+        if (err != CL_SUCCESS) {
+            result.error = "clEnqueueWriteBuffer failed (" + std::to_string(err) + ")";
+            return false;
+        }
+    }
+    result.uploadMs = elapsedMs(start, Clock::now());
+    return true;
+}
+
+bool enqueueKernel(WarmDevice& dev, cl_kernel kernel, cl_uint dims, const size_t* global, const size_t* local,
+                   JobResult& result) {
+    cl_int err = clEnqueueNDRangeKernel(dev.queue, kernel, dims, nullptr, global, local, 0, nullptr, nullptr);
+    if (err != CL_SUCCESS) {
+        result.error = "clEnqueueNDRangeKernel failed (" + std::to_string(err) + ")";
+        return false;
+    }
+    return true;
+}
+
+bool readOutput(WarmDevice& dev, cl_mem mem, std::vector<float>& output, JobResult& result) {
+    cl_int err = clEnqueueReadBuffer(dev.queue, mem, CL_TRUE, 0, output.size() * sizeof(float),
+                                     output.data(), 0, nullptr, nullptr);
+    if (err != CL_SUCCESS) {
+        result.error = "clEnqueueReadBuffer failed (" + std::to_string(err) + ")";
+        return false;
+    }
+    return true;
+}
+
+// The CPU paths are the examples' serial loops; `parallel` turns on OpenMP
+// through the `if` clause so serial and OpenMP share one implementation.
+
+// vector_add: size = elements
+void jobVectorAdd(long long size, int repeats, bool parallel, WarmDevice* dev, JobResult& result) {
+    size_t n = size;
+    std::vector<float> a = makeInput(n, 1), b = makeInput(n, 2), c(n);
+
+    if (!dev) {
+        timeRepeats(repeats, result, [&] {
+            #pragma omp parallel for if(parallel)
+            for (int i = 0; i < (int)n; i++) c[i] = a[i] + b[i];
+        });
+    } else {
+        BufferLease lease{dev, &result, {}};
+        cl_mem bufA = lease.acquire(n * sizeof(float));
+        cl_mem bufB = lease.acquire(n * sizeof(float));
+        cl_mem bufC = lease.acquire(n * sizeof(float));
+        if (!result.error.empty() || !uploadInputs(*dev, {{bufA, &a}, {bufB, &b}}, result)) return;
+
+        cl_kernel kernel = dev->kernels["vector_add"];
+        unsigned int count = (unsigned int)n;
+        clSetKernelArg(kernel, 0, sizeof(cl_mem), &bufA);
+        clSetKernelArg(kernel, 1, sizeof(cl_mem), &bufB);
+        clSetKernelArg(kernel, 2, sizeof(cl_mem), &bufC);
+        clSetKernelArg(kernel, 3, sizeof(unsigned int), &count);
+
+        bool ok = true;
+        timeRepeats(repeats, result, [&] {
+            ok = ok && enqueueKernel(*dev, kernel, 1, &n, nullptr, result);
+            clFinish(dev->queue);
+        });
+        if (!ok || !readOutput(*dev, bufC, c, result)) return;
+    }
+    result.checksum = checksum(c);
+}
+
+// matvec: size = N for an NxN matrix
+void jobMatvec(long long size, int repeats, bool parallel, WarmDevice* dev, JobResult& result) {
+    int n = (int)size;
+    std::vector<float> matrix = makeInput((size_t)n * n, 1), vec = makeInput(n, 2), out(n);
+
+    if (!dev) {
+        timeRepeats(repeats, result, [&] {
+            #pragma omp parallel for if(parallel)
+            for (int i = 0; i < n; i++) {
+                float sum = 0.0f;
+                for (int j = 0; j < n; j++) sum += matrix[(size_t)i * n + j] * vec[j];
+                out[i] = sum;
+            }
+        });
+    } else {
+        BufferLease lease{dev, &result, {}};
+        cl_mem bufM = lease.acquire(matrix.size() * sizeof(float));
+        cl_mem bufV = lease.acquire(vec.size() * sizeof(float));
+        cl_mem bufR = lease.acquire(out.size() * sizeof(float));
+        if (!result.error.empty() || !uploadInputs(*dev, {{bufM, &matrix}, {bufV, &vec}}, result)) return;
+
+        cl_kernel kernel = dev->kernels["matvec_multiply"];
+        clSetKernelArg(kernel, 0, sizeof(cl_mem), &bufM);
+        clSetKernelArg(kernel, 1, sizeof(cl_mem), &bufV);
+        clSetKernelArg(kernel, 2, sizeof(cl_mem), &bufR);
+        clSetKernelArg(kernel, 3, sizeof(int), &n);
+        clSetKernelArg(kernel, 4, sizeof(int), &n);
+
+        size_t global = n;
+        bool ok = true;
+        timeRepeats(repeats, result, [&] {
+            ok = ok && enqueueKernel(*dev, kernel, 1, &global, nullptr, result);
+            clFinish(dev->queue);
+        });
+        if (!ok || !readOutput(*dev, bufR, out, result)) return;
+    }
+    result.checksum = checksum(out);
+}
+
+// matmul: size = N for NxN matrices
+void jobMatmul(long long size, int repeats, bool parallel, WarmDevice* dev, JobResult& result) {
+    const int TILE_SIZE = 16;
+    int n = (int)size;
+    std::vector<float> A = makeInput((size_t)n * n, 1), B = makeInput((size_t)n * n, 2), C((size_t)n * n);
+
+    if (!dev) {
+        timeRepeats(repeats, result, [&] {
+            #pragma omp parallel for if(parallel)
+            for (int i = 0; i < n; i++) {
+                float* row = &C[(size_t)i * n];
+                std::fill(row, row + n, 0.0f);
+                for (int k = 0; k < n; k++) {
+                    float a = A[(size_t)i * n + k];
+                    const float* bRow = &B[(size_t)k * n];
+                    for (int j = 0; j < n; j++) row[j] += a * bRow[j];
+                }
+            }
+        });
+    } else {
+        BufferLease lease{dev, &result, {}};
+        cl_mem bufA = lease.acquire(A.size() * sizeof(float));
+        cl_mem bufB = lease.acquire(B.size() * sizeof(float));
+        cl_mem bufC = lease.acquire(C.size() * sizeof(float));
+        if (!result.error.empty() || !uploadInputs(*dev, {{bufA, &A}, {bufB, &B}}, result)) return;
+
+        cl_kernel kernel = dev->kernels["matrix_multiply_tiled"];
+        clSetKernelArg(kernel, 0, sizeof(cl_mem), &bufA);
+        clSetKernelArg(kernel, 1, sizeof(cl_mem), &bufB);
+        clSetKernelArg(kernel, 2, sizeof(cl_mem), &bufC);
+        clSetKernelArg(kernel, 3, sizeof(int), &n);
+        clSetKernelArg(kernel, 4, sizeof(int), &n);
+        clSetKernelArg(kernel, 5, sizeof(int), &n);
+        clSetKernelArg(kernel, 6, TILE_SIZE * TILE_SIZE * sizeof(float), nullptr);
+        clSetKernelArg(kernel, 7, TILE_SIZE * TILE_SIZE * sizeof(float), nullptr);
+
+        size_t padded = ((n + TILE_SIZE - 1) / TILE_SIZE) * TILE_SIZE;
+        size_t global[2] = {padded, padded};
+        size_t local[2] = {TILE_SIZE, TILE_SIZE};
+        bool ok = true;
+        timeRepeats(repeats, result, [&] {
+            ok = ok && enqueueKernel(*dev, kernel, 2, global, local, result);
+            clFinish(dev->queue);
+        });
+        if (!ok || !readOutput(*dev, bufC, C, result)) return;
+    }
+    result.checksum = checksum(C);
+}
+
+const int CONVOLVE_KSIZE = 15;
+
+// convolve: size = N for an NxN image, separable 15x15 Gaussian
+void jobConvolve(long long size, int repeats, bool parallel, WarmDevice* dev, JobResult& result) {
+    int n = (int)size;
+    int ksize = CONVOLVE_KSIZE;
+    int khalf = ksize / 2;
+    std::vector<float> image = makeInput((size_t)n * n, 1), temp((size_t)n * n), out((size_t)n * n);
+
+    std::vector<float> filter(ksize);
+    float sigma = ksize / 6.0f, total = 0.0f;
+    for (int k = 0; k < ksize; k++) {
+        filter[k] = std::exp(-(k - khalf) * (k - khalf) / (2.0f * sigma * sigma));
+        total += filter[k];
+    }
+    for (float& f : filter) f /= total;
+
+    if (!dev) {
+        timeRepeats(repeats, result, [&] {
+            #pragma omp parallel for if(parallel)
+            for (int y = 0; y < n; y++) {
+                for (int x = 0; x < n; x++) {
+                    float sum = 0.0f;
+                    for (int k = -khalf; k <= khalf; k++) {
+                        int ix = std::min(std::max(x + k, 0), n - 1);
+                        sum += image[(size_t)y * n + ix] * filter[k + khalf];
+                    }
+                    temp[(size_t)y * n + x] = sum;
+                }
+            }
+            #pragma omp parallel for if(parallel)
+            for (int y = 0; y < n; y++) {
+                for (int x = 0; x < n; x++) {
+                    float sum = 0.0f;
+                    for (int k = -khalf; k <= khalf; k++) {
+                        int iy = std::min(std::max(y + k, 0), n - 1);
+                        sum += temp[(size_t)iy * n + x] * filter[k + khalf];
+                    }
+                    out[(size_t)y * n + x] = sum;
+                }
+            }
+        });
+    } else {
+        BufferLease lease{dev, &result, {}};
+        cl_mem bufIn = lease.acquire(image.size() * sizeof(float));
+        cl_mem bufTemp = lease.acquire(temp.size() * sizeof(float));
+        cl_mem bufOut = lease.acquire(out.size() * sizeof(float));
+        cl_mem bufFilter = lease.acquire(filter.size() * sizeof(float));
+        if (!result.error.empty() || !uploadInputs(*dev, {{bufIn, &image}, {bufFilter, &filter}}, result)) return;
+
+        cl_kernel kernelH = dev->kernels["convolve_h"];
+        cl_kernel kernelV = dev->kernels["convolve_v"];
+        cl_mem passes[2][2] = {{bufIn, bufTemp}, {bufTemp, bufOut}};
+        cl_kernel kernels[2] = {kernelH, kernelV};
+        for (int p = 0; p < 2; p++) {
+            clSetKernelArg(kernels[p], 0, sizeof(cl_mem), &passes[p][0]);
+            clSetKernelArg(kernels[p], 1, sizeof(cl_mem), &passes[p][1]);
+            clSetKernelArg(kernels[p], 2, sizeof(cl_mem), &bufFilter);
+            clSetKernelArg(kernels[p], 3, sizeof(int), &n);
+            clSetKernelArg(kernels[p], 4, sizeof(int), &n);
+            clSetKernelArg(kernels[p], 5, sizeof(int), &ksize);
+        }
+
+        size_t global[2] = {(size_t)n, (size_t)n};
+        bool ok = true;
+        timeRepeats(repeats, result, [&] {
+            ok = ok && enqueueKernel(*dev, kernelH, 2, global, nullptr, result);
+            ok = ok && enqueueKernel(*dev, kernelV, 2, global, nullptr, result);
+            clFinish(dev->queue);
+        });
+        if (!ok || !readOutput(*dev, bufOut, out, result)) return;
+    }
+    result.checksum = checksum(out);
+}
+
+const float NBODY_SOFTENING = 0.01f;
+
+// nbody: size = bodies, one all-pairs force evaluation
+void jobNbody(long long size, int repeats, bool parallel, WarmDevice* dev, JobResult& result) {
+    const int LOCAL_SIZE = 256;
+    int n = (int)size;
+    float softening = NBODY_SOFTENING;
+    std::vector<float> positions((size_t)n * 4), masses(n), acc((size_t)n * 4);
+    for (int i = 0; i < n; i++) {
+        for (int c = 0; c < 3; c++) positions[i*4 + c] = inputValue(i, c + 1) * 2.0f - 1.0f;
+        positions[i*4 + 3] = 0.0f;
+        masses[i] = 1.0f / n;
+    }
+
+    if (!dev) {
+        timeRepeats(repeats, result, [&] {
+            #pragma omp parallel for if(parallel)
+            for (int i = 0; i < n; i++) {
+                float ax = 0.0f, ay = 0.0f, az = 0.0f;
+                for (int j = 0; j < n; j++) {
+                    if (i == j) continue;
+                    float dx = positions[j*4 + 0] - positions[i*4 + 0];
+                    float dy = positions[j*4 + 1] - positions[i*4 + 1];
+                    float dz = positions[j*4 + 2] - positions[i*4 + 2];
+                    float distSq = dx * dx + dy * dy + dz * dz + softening * softening;
+                    float force = masses[j] / (distSq * std::sqrt(distSq));
+                    ax += dx * force;
+                    ay += dy * force;
+                    az += dz * force;
+                }
+                acc[i*4 + 0] = ax;
+                acc[i*4 + 1] = ay;
+                acc[i*4 + 2] = az;
+                acc[i*4 + 3] = 0.0f;
+            }
+        });
+    } else {
+        BufferLease lease{dev, &result, {}};
+        cl_mem bufPos = lease.acquire(positions.size() * sizeof(float));
+        cl_mem bufMass = lease.acquire(masses.size() * sizeof(float));
+        cl_mem bufAcc = lease.acquire(acc.size() * sizeof(float));
+        if (!result.error.empty() || !uploadInputs(*dev, {{bufPos, &positions}, {bufMass, &masses}}, result)) return;
+
+        cl_kernel kernel = dev->kernels["compute_forces_tiled"];
+        clSetKernelArg(kernel, 0, sizeof(cl_mem), &bufPos);
+        clSetKernelArg(kernel, 1, sizeof(cl_mem), &bufMass);
+        clSetKernelArg(kernel, 2, sizeof(cl_mem), &bufAcc);
+        clSetKernelArg(kernel, 3, sizeof(int), &n);
+        clSetKernelArg(kernel, 4, sizeof(float), &softening);
+        clSetKernelArg(kernel, 5, LOCAL_SIZE * 4 * sizeof(float), nullptr);
+        clSetKernelArg(kernel, 6, LOCAL_SIZE * sizeof(float), nullptr);
+
+        size_t global = ((n + LOCAL_SIZE - 1) / LOCAL_SIZE) * LOCAL_SIZE;
+        size_t local = LOCAL_SIZE;
+        bool ok = true;
+        timeRepeats(repeats, result, [&] {
+            ok = ok && enqueueKernel(*dev, kernel, 1, &global, &local, result);
+            clFinish(dev->queue);
+        });
+        if (!ok || !readOutput(*dev, bufAcc, acc, result)) return;
+    }
+    result.checksum = checksum(acc);
+}
+
+struct Workload {
+    const char* name;
+    void (*run)(long long size, int repeats, bool parallel, WarmDevice* dev, JobResult& result);
+    double (*flop)(double size);        // floating-point operations per repeat
+    double (*deviceBytes)(double size); // largest single buffer
+    double (*hostBytes)(double size);   // all host vectors the job allocates
+};
+
+const Workload WORKLOADS[] = {
+    {"vector_add", jobVectorAdd,
+     [](double n) { return n; },                                  [](double n) { return n * 4; },
+     [](double n) { return 3 * n * 4; }},
+    {"matvec",     jobMatvec,
+     [](double n) { return 2.0 * n * n; },                        [](double n) { return n * n * 4; },
+     [](double n) { return (n * n + 2 * n) * 4; }},
+    {"matmul",     jobMatmul,
+     [](double n) { return 2.0 * n * n * n; },                    [](double n) { return n * n * 4; },
+     [](double n) { return 3 * n * n * 4; }},
+    {"convolve",   jobConvolve,
+     [](double n) { return 4.0 * CONVOLVE_KSIZE * n * n; },       [](double n) { return n * n * 4; },
+     [](double n) { return 3 * n * n * 4; }},
+    {"nbody",      jobNbody,
+     [](double n) { return 20.0 * n * (n - 1); },                 [](double n) { return n * 16; },
+     [](double n) { return n * 36; }},
+};
+
+// Refuse jobs whose host inputs alone would exceed this, whatever the backend
+const double MAX_HOST_BYTES = 4.0 * 1024 * 1024 * 1024;
+
+// ============================================================================
+// Request handling
+// ============================================================================
+
+struct DaemonState {
+    std::vector<WarmDevice> devices;
+    double startupMs;
+    Clock::time_point started;
+    long long jobs = 0;
+};
+
+std::string formatNumber(double value, int precision) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(precision) << value;
+    return out.str();
+}
+
+// RUN <workload> <size> <serial|openmp|opencl:N> [repeats]
+std::string handleRun(const std::vector<std::string>& words, DaemonState& state) {
+    if (words.size() < 4) return "ERR usage: RUN <workload> <size> <backend> [repeats]";
+
+    const Workload* workload = nullptr;
+    for (const auto& w : WORKLOADS) {
+        if (words[1] == w.name) workload = &w;
+    }
+    if (!workload) return "ERR unknown workload " + words[1];
+
+    long long size = std::atoll(words[2].c_str());
+    int repeats = (words.size() > 4) ? std::atoi(words[4].c_str()) : 5;
+    if (size <= 0 || size > (1LL << 31) - 1 || repeats <= 0) return "ERR bad size or repeats";
+    if (workload->hostBytes((double)size) > MAX_HOST_BYTES) return "ERR size exceeds host memory limit";
+
+    const std::string& backend = words[3];
+    WarmDevice* dev = nullptr;
+    bool parallel = false;
+    if (backend == "openmp") {
+        parallel = true;
+    } else if (backend.compare(0, 7, "opencl:") == 0) {
+        int index = std::atoi(backend.c_str() + 7);
+        if (index < 0 || index >= (int)state.devices.size()) return "ERR no such device " + backend;
+        dev = &state.devices[index];
+        if (workload->deviceBytes((double)size) > (double)dev->maxAlloc) {
+            return "ERR size exceeds CL_DEVICE_MAX_MEM_ALLOC_SIZE on " + backend;
+        }
+    } else if (backend != "serial") {
+        return "ERR unknown backend " + backend;
+    }
+
+    JobResult result;
+    auto start = Clock::now();
+    try {
+        workload->run(size, repeats, parallel, dev, result);
+    } catch (const std::bad_alloc&) {
+        result.error = "host allocation failed";
+    } catch (const std::exception& e) {
+        result.error = e.what();
+    }
+    double jobMs = elapsedMs(start, Clock::now());
+    state.jobs++;
+
+    if (!result.error.empty()) return "ERR " + result.error;
+
+    double gflops = workload->flop((double)size) / (result.bestMs / 1000.0) / 1e9;
+    return "OK workload=" + words[1] + " size=" + std::to_string(size) + " backend=" + backend +
+           " repeats=" + std::to_string(repeats) +
+           " upload_ms=" + formatNumber(result.uploadMs, 3) +
+           " best_ms=" + formatNumber(result.bestMs, 3) +
+           " mean_ms=" + formatNumber(result.meanMs, 3) +
+           " gflops=" + formatNumber(gflops, 2) +
+           " checksum=" + formatNumber(result.checksum, 4) +
+           " pool_hits=" + std::to_string(result.poolHits) +
+           " pool_misses=" + std::to_string(result.poolMisses) +
+           " job_ms=" + formatNumber(jobMs, 3);
+}
+
+// LIST: "OK backends=N workloads=a,b,..." followed by one "<backend> <description>" line per backend
+std::string handleList(const DaemonState& state) {
+    std::string workloads;
+    for (const auto& w : WORKLOADS) workloads += (workloads.empty() ? "" : ",") + std::string(w.name);
+
+    std::string response = "OK backends=" + std::to_string(2 + state.devices.size()) + " workloads=" + workloads;
+    response += "\nserial CPU (1 thread)";
+    response += "\nopenmp CPU (" + std::to_string(omp_get_max_threads()) + " threads)";
+    for (size_t i = 0; i < state.devices.size(); i++) {
+        response += "\nopencl:" + std::to_string(i) + " " + state.devices[i].name;
+    }
+    return response;
+}
+
+std::string handleStats(const DaemonState& state) {
+    size_t buffers = 0, bytes = 0;
+    long long hits = 0, misses = 0;
+    for (const auto& dev : state.devices) {
+        buffers += dev.pool.size();
+        bytes += poolBytes(dev);
+        hits += dev.poolHits;
+        misses += dev.poolMisses;
+    }
+    return "OK startup_ms=" + formatNumber(state.startupMs, 1) +
+           " uptime_s=" + formatNumber(elapsedMs(state.started, Clock::now()) / 1000.0, 1) +
+           " jobs=" + std::to_string(state.jobs) +
+           " pool_buffers=" + std::to_string(buffers) +
+           " pool_mb=" + formatNumber(bytes / (1024.0 * 1024.0), 1) +
+           " pool_hits=" + std::to_string(hits) +
+           " pool_misses=" + std::to_string(misses);
+}
+
+std::string handleRequest(const std::string& line, DaemonState& state, bool& shutdown) {
+    std::vector<std::string> words = splitWords(line);
+    if (words.empty()) return "ERR empty request";
+
+    if (words[0] == "RUN") return handleRun(words, state);
+    if (words[0] == "LIST") return handleList(state);
+    if (words[0] == "STATS") return handleStats(state);
+    if (words[0] == "SHUTDOWN") {
+        shutdown = true;
+        return "OK shutting down";
+    }
+    return "ERR unknown command " + words[0];
+}
+
+int main(int argc, char** argv) {
+    std::string socketPath = (argc > 2 && std::string(argv[1]) == "--socket") ? argv[2] : defaultSocketPath();
+
+    std::cout << "=== OpenCL Benchmark Daemon ===\n\n";
+
+    DaemonState state;
+    auto startupBegin = Clock::now();
+
+    std::string kernelSource = loadKernelSource("workloads.cl");
+    const char* kernelSourcePtr = kernelSource.c_str();
+    size_t kernelSourceSize = kernelSource.size();
+
+    cl_uint numPlatforms = 0;
+    clGetPlatformIDs(0, nullptr, &numPlatforms);
+    std::vector<cl_platform_id> platforms(numPlatforms);
+    clGetPlatformIDs(numPlatforms, platforms.data(), nullptr);
+
+    for (cl_uint p = 0; p < numPlatforms; p++) {
+        cl_uint numDevices;
+        cl_int err = clGetDeviceIDs(platforms[p], CL_DEVICE_TYPE_ALL, 0, nullptr, &numDevices);
+        if (err != CL_SUCCESS || numDevices == 0) continue;
+        std::vector<cl_device_id> platformDevices(numDevices);
+        clGetDeviceIDs(platforms[p], CL_DEVICE_TYPE_ALL, numDevices, platformDevices.data(), nullptr);
+
+        for (cl_uint d = 0; d < numDevices; d++) {
+            WarmDevice dev;
+            dev.id = platformDevices[d];
+            char name[128];
+            clGetDeviceInfo(dev.id, CL_DEVICE_NAME, sizeof(name), name, nullptr);
+            dev.name = name;
+
+            dev.context = clCreateContext(nullptr, 1, &dev.id, nullptr, nullptr, &err);
+            checkError(err, "clCreateContext");
+            dev.queue = clCreateCommandQueueWithProperties(dev.context, dev.id, nullptr, &err);
+            checkError(err, "clCreateCommandQueue");
+            dev.program = clCreateProgramWithSource(dev.context, 1, &kernelSourcePtr, &kernelSourceSize, &err);
+            err = clBuildProgram(dev.program, 1, &dev.id, nullptr, nullptr, nullptr);
+            if (err != CL_SUCCESS) {
+                size_t logSize;
+                clGetProgramBuildInfo(dev.program, dev.id, CL_PROGRAM_BUILD_LOG, 0, nullptr, &logSize);
+                std::vector<char> log(logSize);
+                clGetProgramBuildInfo(dev.program, dev.id, CL_PROGRAM_BUILD_LOG, logSize, log.data(), nullptr);
+                std::cerr << "Build error for " << name << ":\n" << log.data() << "\nSkipping this device.\n\n";
+                clReleaseProgram(dev.program);
+                clReleaseCommandQueue(dev.queue);
+                clReleaseContext(dev.context);
+                continue;
+            }
+            for (const char* kernelName : KERNEL_NAMES) {
+                dev.kernels[kernelName] = clCreateKernel(dev.program, kernelName, &err);
+                checkError(err, kernelName);
+            }
+
+            cl_ulong globalMem;
+            clGetDeviceInfo(dev.id, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(globalMem), &globalMem, nullptr);
+            clGetDeviceInfo(dev.id, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(dev.maxAlloc), &dev.maxAlloc, nullptr);
+            dev.poolLimit = globalMem / 2;
+
+            state.devices.push_back(dev);
+        }
+    }
+
+    state.startupMs = elapsedMs(startupBegin, Clock::now());
+    state.started = Clock::now();
+
+    for (size_t i = 0; i < state.devices.size(); i++) {
+        std::cout << "opencl:" << i << "  " << state.devices[i].name << "\n";
+    }
+    std::cout << "OpenMP threads: " << omp_get_max_threads() << "\n";
+    std::cout << "Startup (discovery, contexts, program builds): " << std::fixed << std::setprecision(1)
+              << state.startupMs << " ms\n\n";
+
+    if (!initSockets()) {
+        std::cerr << "Socket initialization failed\n";
+        return 1;
+    }
+    socket_t listener = listenLocal(socketPath);
+    if (listener == INVALID_SOCKET) {
+        std::cerr << "Cannot listen on " << socketPath << "\n";
+        return 1;
+    }
+    std::cout << "Listening on " << socketPath << " (stop with: bench_client shutdown)\n";
+
+    bool shutdown = false;
+    while (!shutdown) {
+        socket_t client = accept(listener, nullptr, nullptr);
+        if (client == INVALID_SOCKET) continue;
+
+        // One connection at a time, one request per line, until the client hangs up
+        LineReader reader{client, ""};
+        std::string line;
+        while (!shutdown && readLine(reader, line)) {
+            std::string response = handleRequest(line, state, shutdown);
+            std::cout << "  " << line << " -> " << response.substr(0, response.find('\n')) << "\n";
+            if (!sendLine(client, response)) break;
+        }
+        closeSocket(client);
+    }
+
+    closeSocket(listener);
+    std::remove(socketPath.c_str());
+
+    for (auto& dev : state.devices) {
+        for (auto& buf : dev.pool) clReleaseMemObject(buf.mem);
+        for (auto& kernel : dev.kernels) clReleaseKernel(kernel.second);
+        clReleaseProgram(dev.program);
+        clReleaseCommandQueue(dev.queue);
+        clReleaseContext(dev.context);
+    }
+
+    std::cout << "Served " << state.jobs << " jobs\n";
+    return 0;
+}
@@ -0,0 +1,125 @@
+// Local IPC shared by the daemon and the client: AF_UNIX stream sockets (Linux,
+// macOS, and Windows 10 1803+ via afunix.h) carrying a line-oriented text
+// protocol. One request per line, one response per line unless noted.
+#pragma once
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <afunix.h>
+typedef SOCKET socket_t;
+inline void closeSocket(socket_t s) { closesocket(s); }
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <signal.h>
+typedef int socket_t;
+const socket_t INVALID_SOCKET = -1;
+inline void closeSocket(socket_t s) { close(s); }
+#endif
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+
+inline std::string defaultSocketPath() {
+#ifdef _WIN32
+    const char* temp = std::getenv("TEMP");
+    return std::string(temp ? temp : ".") + "\\opencl_bench.sock";
+#else
+    return "/tmp/opencl_bench.sock";
+#endif
+}
+
+inline bool initSockets() {
+#ifdef _WIN32
+    WSADATA data;
+    return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+#else
+    // A client that disconnects mid-response must not kill the daemon
+    signal(SIGPIPE, SIG_IGN);
+    return true;
+#endif
+}
+
+inline bool makeAddress(const std::string& path, sockaddr_un& addr) {
+    if (path.size() >= sizeof(addr.sun_path)) return false;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    return true;
+}
+
+// Binds and listens on `path`, replacing a stale socket file left by a
+// daemon that did not shut down cleanly
+inline socket_t listenLocal(const std::string& path) {
+    sockaddr_un addr;
+    if (!makeAddress(path, addr)) return INVALID_SOCKET;
+    
+    socket_t s = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (s == INVALID_SOCKET) return INVALID_SOCKET;
+    std::remove(path.c_str());
+    if (bind(s, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(s, 4) != 0) {
+        closeSocket(s);
+        return INVALID_SOCKET;
+    }
+    return s;
+}
+
+inline socket_t connectLocal(const std::string& path) {
+    sockaddr_un addr;
+    if (!makeAddress(path, addr)) return INVALID_SOCKET;
+    
+    socket_t s = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (s == INVALID_SOCKET) return INVALID_SOCKET;
+    if (connect(s, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        closeSocket(s);
+        return INVALID_SOCKET;
+    }
+    return s;
+}
+
+inline bool sendLine(socket_t s, const std::string& line) {
+    std::string data = line + "\n";
+    size_t sent = 0;
+    while (sent < data.size()) {
+        int n = send(s, data.data() + sent, (int)(data.size() - sent), 0);
+        if (n <= 0) return false;
+        sent += n;
+    }
+    return true;
+}
+
+// Buffered line reader; strips the trailing "\n" (and "\r")
+struct LineReader {
+    socket_t sock;
+    std::string buffer;
+};
+
+inline bool readLine(LineReader& reader, std::string& line) {
+    size_t pos;
+    while ((pos = reader.buffer.find('\n')) == std::string::npos) {
+        char chunk[4096];
+        int n = recv(reader.sock, chunk, sizeof(chunk), 0);
+        if (n <= 0) return false;
+        reader.buffer.append(chunk, n);
+    }
+    line = reader.buffer.substr(0, pos);
+    reader.buffer.erase(0, pos + 1);
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    return true;
+}
+
+inline std::vector<std::string> splitWords(const std::string& line) {
+    std::vector<std::string> words;
+    size_t start = 0;
+    while (start < line.size()) {
+        size_t end = line.find(' ', start);
+        if (end == std::string::npos) end = line.size();
+        if (end > start) words.push_back(line.substr(start, end - start));
+        start = end + 1;
+    }
+    return words;
+}
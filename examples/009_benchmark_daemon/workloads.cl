@@ -0,0 +1,182 @@
+// Kernels served by the benchmark daemon, copied from the examples they come
+// from so the daemon builds one program per device at startup.
+
+// 003_breakeven_analysis
+__kernel void vector_add(__global const float* a,
+                         __global const float* b,
+                         __global float* result,
+                         const unsigned int n)
+{
+    int gid = get_global_id(0);
+    if (gid < n) {
+        result[gid] = a[gid] + b[gid];
+    }
+}
+
+// 005_parallelization_comparison
+__kernel void matvec_multiply(__global const float* matrix,
+                              __global const float* vector,
+                              __global float* result,
+                              const int rows,
+                              const int cols)
+{
+    int i = get_global_id(0);
+    if (i < rows) {
+        float sum = 0.0f;
+        for (int j = 0; j < cols; j++) {
+            sum += matrix[i * cols + j] * vector[j];
+        }
+        result[i] = sum;
+    }
+}
+
+// 006_matrix_multiply (C = A * B, A is MxN, B is NxK)
+__kernel void matrix_multiply_tiled(__global const float* A,
+                                    __global const float* B,
+                                    __global float* C,
+                                    const int M,
+                                    const int N,
+                                    const int K,
+                                    __local float* A_tile,
+                                    __local float* B_tile)
+{
+    const int TILE_SIZE = 16;
+    
+    int globalRow = get_global_id(0);
+    int globalCol = get_global_id(1);
+    int localRow = get_local_id(0);
+    int localCol = get_local_id(1);
+    
+    float sum = 0.0f;
+    
+    int numTiles = (N + TILE_SIZE - 1) / TILE_SIZE;
+    
+    for (int t = 0; t < numTiles; t++) {
+        int tiledRow = TILE_SIZE * t + localCol;
+        int tiledCol = TILE_SIZE * t + localRow;
+        
+        A_tile[localRow * TILE_SIZE + localCol] = 
+            (globalRow < M && tiledRow < N) ? A[globalRow * N + tiledRow] : 0.0f;
+        
+        B_tile[localRow * TILE_SIZE + localCol] = 
+            (tiledCol < N && globalCol < K) ? B[tiledCol * K + globalCol] : 0.0f;
+        
+        barrier(CLK_LOCAL_MEM_FENCE);
+        
+        for (int k = 0; k < TILE_SIZE; k++) {
+            sum += A_tile[localRow * TILE_SIZE + k] * B_tile[k * TILE_SIZE + localCol];
+        }
+        
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    
+    if (globalRow < M && globalCol < K) {
+        C[globalRow * K + globalCol] = sum;
+    }
+}
+
+// 007_image_convolution (separable passes, clamp-to-edge)
+inline int clamp_int(int val, int min_val, int max_val) {
+    if (val < min_val) return min_val;
+    if (val > max_val) return max_val;
+    return val;
+}
+
+__kernel void convolve_h(__global const float* input,
+                         __global float* output,
+                         __constant float* filter,
+                         const int width,
+                         const int height,
+                         const int ksize)
+{
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+    
+    if (x >= width || y >= height) return;
+    
+    int khalf = ksize / 2;
+    float sum = 0.0f;
+    
+    for (int k = -khalf; k <= khalf; k++) {
+        int ix = clamp_int(x + k, 0, width - 1);
+        sum += input[y * width + ix] * filter[k + khalf];
+    }
+    
+    output[y * width + x] = sum;
+}
+
+__kernel void convolve_v(__global const float* input,
+                         __global float* output,
+                         __constant float* filter,
+                         const int width,
+                         const int height,
+                         const int ksize)
+{
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+    
+    if (x >= width || y >= height) return;
+    
+    int khalf = ksize / 2;
+    float sum = 0.0f;
+    
+    for (int k = -khalf; k <= khalf; k++) {
+        int iy = clamp_int(y + k, 0, height - 1);
+        sum += input[iy * width + x] * filter[k + khalf];
+    }
+    
+    output[y * width + x] = sum;
+}
+
+// 008_nbody_simulation (default precision: sqrt and a divide)
+__kernel void compute_forces_tiled(__global const float4* positions,
+                                   __global const float* masses,
+                                   __global float4* accelerations,
+                                   const int n,
+                                   const float softening,
+                                   __local float4* shared_pos,
+                                   __local float* shared_mass)
+{
+    int global_id = get_global_id(0);
+    int local_id = get_local_id(0);
+    int local_size = get_local_size(0);
+    
+    float4 acc = (float4)(0.0f, 0.0f, 0.0f, 0.0f);
+    float4 pos_i = (global_id < n) ? positions[global_id] : (float4)(0.0f);
+    
+    int num_tiles = (n + local_size - 1) / local_size;
+    
+    for (int tile = 0; tile < num_tiles; tile++) {
+        int j = tile * local_size + local_id;
+        
+        if (j < n) {
+            shared_pos[local_id] = positions[j];
+            shared_mass[local_id] = masses[j];
+        } else {
+            shared_pos[local_id] = (float4)(0.0f);
+            shared_mass[local_id] = 0.0f;
+        }
+        
+        barrier(CLK_LOCAL_MEM_FENCE);
+        
+        if (global_id < n) {
+            for (int k = 0; k < local_size; k++) {
+                int j_global = tile * local_size + k;
+                if (j_global >= n || j_global == global_id) continue;
+                
+                float4 r = shared_pos[k] - pos_i;
+                float dist_sq = r.x * r.x + r.y * r.y + r.z * r.z + softening * softening;
+                float dist = sqrt(dist_sq);
+                float force = shared_mass[k] / (dist_sq * dist);
+                
+                acc += r * force;
+            }
+        }
+        
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    
+    if (global_id < n) {
+        accelerations[global_id] = acc;
+    }
+}
@@ -0,0 +1,162 @@
+// Command-buffer record/replay shared by 007 and 008: a fixed kernel sequence
+// is recorded once, then replayed through cl_khr_command_buffer where the
+// device and headers support it, or through a pre-baked host launch list.
+#pragma once
+
+#include <CL/opencl.h>
+#include <string>
+#include <vector>
+
+// Defined by each example (prints the error and exits)
+void checkError(cl_int err, const char* operation);
+
+// One recorded NDRange launch. Kernel arguments are whatever was set before
+// recording; replay never touches them.
+struct RecordedLaunch {
+    cl_kernel kernel;
+    cl_uint workDim;
+    size_t globalSize[3];
+    size_t localSize[3];
+    bool hasLocalSize;
+};
+
+// A fixed kernel sequence, recorded once and replayed every iteration. It is
+// baked into a cl_khr_command_buffer when the device (and the OpenCL headers)
+// support one; otherwise replay walks a pre-baked host list of launches.
+struct CommandSequence {
+    cl_command_queue queue;
+    std::vector<RecordedLaunch> launches;
+    bool native = false;
+    int pendingWaits = 0;       // replays that had to wait for the previous one
+#ifdef cl_khr_command_buffer
+    cl_command_buffer_khr commandBuffer = nullptr;
+    clEnqueueCommandBufferKHR_fn enqueueCommandBuffer = nullptr;
+    clReleaseCommandBufferKHR_fn releaseCommandBuffer = nullptr;
+#endif
+};
+
+inline bool deviceSupportsCommandBuffer(cl_device_id device) {
+    size_t size;
+    clGetDeviceInfo(device, CL_DEVICE_EXTENSIONS, 0, nullptr, &size);
+    std::string extensions(size, '\0');
+    clGetDeviceInfo(device, CL_DEVICE_EXTENSIONS, size, &extensions[0], nullptr);
+    return extensions.find("cl_khr_command_buffer") != std::string::npos;
+}
+
+inline void recordLaunch(CommandSequence& seq, cl_kernel kernel, cl_uint workDim,
+                         const size_t* globalSize, const size_t* localSize) {
+    RecordedLaunch launch = {};
+    launch.kernel = kernel;
+    launch.workDim = workDim;
+    launch.hasLocalSize = localSize != nullptr;
+    for (cl_uint d = 0; d < workDim; d++) {
+        launch.globalSize[d] = globalSize[d];
+        launch.localSize[d] = localSize ? localSize[d] : 0;
+    }
+    seq.launches.push_back(launch);
+}
+
+// Bakes the recorded launches. With `allowNative` a command buffer is tried
+// first; any failure along the way leaves the host list in charge.
+inline void finalizeSequence(CommandSequence& seq, cl_device_id device, bool allowNative) {
+#ifdef cl_khr_command_buffer
+    if (!allowNative || !deviceSupportsCommandBuffer(device)) return;
+    
+    cl_platform_id platform;
+    clGetDeviceInfo(device, CL_DEVICE_PLATFORM, sizeof(platform), &platform, nullptr);
+    auto createCommandBuffer = (clCreateCommandBufferKHR_fn)
+        clGetExtensionFunctionAddressForPlatform(platform, "clCreateCommandBufferKHR");
+    auto commandNDRangeKernel = (clCommandNDRangeKernelKHR_fn)
+        clGetExtensionFunctionAddressForPlatform(platform, "clCommandNDRangeKernelKHR");
+    auto finalizeCommandBuffer = (clFinalizeCommandBufferKHR_fn)
+        clGetExtensionFunctionAddressForPlatform(platform, "clFinalizeCommandBufferKHR");
+    seq.enqueueCommandBuffer = (clEnqueueCommandBufferKHR_fn)
+        clGetExtensionFunctionAddressForPlatform(platform, "clEnqueueCommandBufferKHR");
+    seq.releaseCommandBuffer = (clReleaseCommandBufferKHR_fn)
+        clGetExtensionFunctionAddressForPlatform(platform, "clReleaseCommandBufferKHR");
+    if (!createCommandBuffer || !commandNDRangeKernel || !finalizeCommandBuffer ||
+        !seq.enqueueCommandBuffer || !seq.releaseCommandBuffer) {
+        return;
+    }
+    
+    cl_int err;
+    cl_command_buffer_khr commandBuffer = createCommandBuffer(1, &seq.queue, nullptr, &err);
+    if (err != CL_SUCCESS) return;
+    
+    // Commands in a command buffer are only ordered by sync points, even when
+    // it was created from an in-order queue, so each launch waits on the last
+    cl_sync_point_khr previous = 0;
+    for (size_t k = 0; k < seq.launches.size() && err == CL_SUCCESS; k++) {
+        const RecordedLaunch& launch = seq.launches[k];
+        cl_sync_point_khr point;
+        err = commandNDRangeKernel(commandBuffer, nullptr, nullptr, launch.kernel, launch.workDim,
+                                   nullptr, launch.globalSize,
+                                   launch.hasLocalSize ? launch.localSize : nullptr,
+                                   k > 0 ? 1 : 0, k > 0 ? &previous : nullptr, &point, nullptr);
+        previous = point;
+    }
+    if (err == CL_SUCCESS) err = finalizeCommandBuffer(commandBuffer);
+    if (err != CL_SUCCESS) {
+        seq.releaseCommandBuffer(commandBuffer);
+        return;
+    }
+    
+    seq.commandBuffer = commandBuffer;
+    seq.native = true;
+#else
+    (void)seq;
+    (void)device;
+    (void)allowNative;
+#endif
+}
+
+// Submits the whole sequence. `done`, if given, receives an event that
+// completes with the last launch.
+inline void replaySequence(CommandSequence& seq, cl_event* done = nullptr) {
+    cl_int err;
+#ifdef cl_khr_command_buffer
+    if (seq.native) {
+        err = seq.enqueueCommandBuffer(0, nullptr, seq.commandBuffer, 0, nullptr, done);
+        if (err == CL_INVALID_OPERATION) {
+            // Without simultaneous-use support a command buffer cannot be
+            // resubmitted while the previous submission is still pending
+            seq.pendingWaits++;
+            clFinish(seq.queue);
+            err = seq.enqueueCommandBuffer(0, nullptr, seq.commandBuffer, 0, nullptr, done);
+        }
+        checkError(err, "clEnqueueCommandBufferKHR");
+        return;
+    }
+#endif
+    for (size_t k = 0; k < seq.launches.size(); k++) {
+        const RecordedLaunch& launch = seq.launches[k];
+        err = clEnqueueNDRangeKernel(seq.queue, launch.kernel, launch.workDim, nullptr, launch.globalSize,
+                                     launch.hasLocalSize ? launch.localSize : nullptr, 0, nullptr,
+                                     k + 1 == seq.launches.size() ? done : nullptr);
+        checkError(err, "clEnqueueNDRangeKernel (replay)");
+    }
+}
+
+inline void releaseSequence(CommandSequence& seq) {
+#ifdef cl_khr_command_buffer
+    if (seq.native) seq.releaseCommandBuffer(seq.commandBuffer);
+#endif
+    seq.native = false;
+    seq.launches.clear();
+}
+
+// How one iteration is submitted in the replay benchmarks
+enum class Submission {
+    PerStep,        // set every argument and enqueue each kernel, every iteration
+    HostList,       // replay a pre-baked host list (arguments set once)
+    CommandBuffer   // replay a cl_khr_command_buffer
+};
+
+inline const char* submissionName(Submission submission) {
+    switch (submission) {
+        case Submission::PerStep:       return "Per-step setup";
+        case Submission::HostList:      return "Pre-baked host list";
+        case Submission::CommandBuffer: return "Command buffer";
+    }
+    return "";
+}
@@ -0,0 +1,65 @@
+// Completion policies shared by the latency modes of 003 and 008: how the host
+// waits for a queue's work, and the percentile helper that 001 and 007 also use
+// for their latency tables.
+#pragma once
+
+#include <CL/opencl.h>
+#include <chrono>
+#include <vector>
+
+// How the host waits for a queue's work. Blocking waits let the thread sleep
+// but pay an OS wakeup; polling burns a core but notices completion at once.
+enum class Completion {
+    Finish,          // clFinish on the queue
+    WaitForEvents,   // clWaitForEvents on the last command's event
+    BusyPoll,        // clFlush, then spin on CL_EVENT_COMMAND_EXECUTION_STATUS
+    Hybrid           // spin up to HYBRID_SPIN_US, then block in clWaitForEvents
+};
+
+const Completion COMPLETION_POLICIES[] = {
+    Completion::Finish, Completion::WaitForEvents, Completion::BusyPoll, Completion::Hybrid
+};
+const double HYBRID_SPIN_US = 100.0;
+
+inline const char* completionName(Completion policy) {
+    switch (policy) {
+        case Completion::Finish:        return "clFinish";
+        case Completion::WaitForEvents: return "clWaitForEvents";
+        case Completion::BusyPoll:      return "busy-poll";
+        case Completion::Hybrid:        return "hybrid spin+block";
+    }
+    return "";
+}
+
+// Waits until `event` (the last command enqueued on `queue`) has completed
+inline void waitForCompletion(cl_command_queue queue, cl_event event, Completion policy) {
+    if (policy == Completion::Finish) {
+        clFinish(queue);
+        return;
+    }
+    if (policy == Completion::WaitForEvents) {
+        clWaitForEvents(1, &event);
+        return;
+    }
+    
+    // Polling only works if the commands have actually been submitted
+    clFlush(queue);
+    auto start = std::chrono::high_resolution_clock::now();
+    cl_int status;
+    for (;;) {
+        clGetEventInfo(event, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(status), &status, nullptr);
+        if (status <= CL_COMPLETE) return;
+        
+        if (policy == Completion::Hybrid &&
+            std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count()
+                > HYBRID_SPIN_US) {
+            clWaitForEvents(1, &event);
+            return;
+        }
+    }
+}
+
+// p in [0, 1] of an already sorted vector
+inline double percentile(const std::vector<double>& sorted, double p) {
+    return sorted[(size_t)(p * (sorted.size() - 1) + 0.5)];
+}
@@ -0,0 +1,14 @@
+// Double-precision support check shared by 005, 006 and 008, so every example
+// decides whether to run its *_fp64 kernels the same way.
+#pragma once
+
+#include <CL/opencl.h>
+
+// Devices without doubles report an empty CL_DEVICE_DOUBLE_FP_CONFIG. Unlike the
+// extension string, this also covers OpenCL 3.0 devices that support fp64 as the
+// optional __opencl_c_fp64 feature without listing cl_khr_fp64.
+inline bool deviceSupportsFp64(cl_device_id device) {
+    cl_device_fp_config config = 0;
+    clGetDeviceInfo(device, CL_DEVICE_DOUBLE_FP_CONFIG, sizeof(config), &config, nullptr);
+    return config != 0;
+}
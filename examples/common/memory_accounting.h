@@ -0,0 +1,84 @@
+// Memory accounting shared by 003 and 007: current and peak host bytes through
+// a tracking allocator, and cl_mem bytes per context through allocateBuffer.
+#pragma once
+
+#include <CL/opencl.h>
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Current and peak bytes of one pool: host allocations, or one context's cl_mems.
+// Atomic because OpenMP workers allocate their own scratch vectors.
+struct MemoryCounter {
+    std::atomic<size_t> current{0};
+    std::atomic<size_t> peak{0};
+};
+
+inline MemoryCounter hostMemory;
+inline std::map<cl_context, MemoryCounter> deviceMemory;
+inline std::map<cl_mem, std::pair<cl_context, size_t>> liveBuffers;
+
+inline void countAllocation(MemoryCounter& counter, size_t bytes) {
+    size_t now = counter.current.fetch_add(bytes) + bytes;
+    size_t peak = counter.peak.load();
+    while (now > peak && !counter.peak.compare_exchange_weak(peak, now)) {}
+}
+
+// std::allocator that books every allocation against hostMemory
+template <typename T>
+struct TrackingAllocator {
+    using value_type = T;
+    
+    TrackingAllocator() = default;
+    template <typename U> TrackingAllocator(const TrackingAllocator<U>&) {}
+    
+    T* allocate(size_t n) {
+        T* p = std::allocator<T>().allocate(n);
+        countAllocation(hostMemory, n * sizeof(T));
+        return p;
+    }
+    void deallocate(T* p, size_t n) {
+        hostMemory.current -= n * sizeof(T);
+        std::allocator<T>().deallocate(p, n);
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const TrackingAllocator<T>&, const TrackingAllocator<U>&) { return true; }
+template <typename T, typename U>
+bool operator!=(const TrackingAllocator<T>&, const TrackingAllocator<U>&) { return false; }
+
+template <typename T>
+using HostVector = std::vector<T, TrackingAllocator<T>>;
+
+// clCreateBuffer / clReleaseMemObject that keep each context's cl_mem total
+inline cl_mem allocateBuffer(cl_context context, cl_mem_flags flags, size_t size, void* hostPtr, cl_int* err) {
+    cl_mem buffer = clCreateBuffer(context, flags, size, hostPtr, err);
+    if (buffer) {
+        countAllocation(deviceMemory[context], size);
+        liveBuffers[buffer] = {context, size};
+    }
+    return buffer;
+}
+
+inline void releaseBuffer(cl_mem buffer) {
+    auto it = liveBuffers.find(buffer);
+    if (it != liveBuffers.end()) {
+        deviceMemory[it->second.first].current -= it->second.second;
+        liveBuffers.erase(it);
+    }
+    clReleaseMemObject(buffer);
+}
+
+// Starts a new measurement: peaks drop to whatever is live right now
+inline void resetMemoryPeaks() {
+    hostMemory.peak = hostMemory.current.load();
+    for (auto& entry : deviceMemory) entry.second.peak = entry.second.current.load();
+}
+
+inline double toMB(size_t bytes) {
+    return bytes / (1024.0 * 1024.0);
+}